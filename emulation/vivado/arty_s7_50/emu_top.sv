@@ -44,6 +44,7 @@ module emu_top #(
     .mem_read  (mem_read),
     .mem_write (mem_write),
     .mem_be    (mem_be),
+    .mem_ifetch(),
     .pc        (pc)
   );
 
@@ -19,7 +19,8 @@
  *   - Register load enables (load_pc, load_ir, load_mar, load_mdr, load_reg)
  *   - Multiplexer selects (rs1_mux_sel, rs2_mux_sel, databus_mux_sel, mdr_mux_sel)
  *   - ALU operation select (alu_op)
- *   - Memory interface signals (mem_read, mem_write)
+ *   - Memory interface signals (mem_read, mem_write, mem_ifetch)
+ *   - Performance monitor events for csr_file (hpm_events)
  */
 
 `include "datatypes.sv"
@@ -40,6 +41,7 @@ module control
   output databus_mux_sel_t databus_mux_sel,
   output logic mem_write,
   output logic mem_read,
+  output logic mem_ifetch,     // mem_read is an instruction fetch
   output mem_size_t mem_size,
   output logic load_unsigned,
   output logic [4:0] rs1,
@@ -60,7 +62,10 @@ module control
   output logic load_mepc,         // High when writing current PC to mepc
   output logic load_mcause,       // High when writing mcause
   output logic load_mtval,        // High when writing mtval
-  output logic [31:0] mcause_val  // Value to write to mcause
+  output logic [31:0] mcause_val, // Value to write to mcause
+  // Performance monitor: bit N is high in the cycles event N (hpm_event_t)
+  // counts
+  output logic [15:0] hpm_events
 );
 
   logic [2:0] instr_type;
@@ -145,7 +150,7 @@ module control
     // Error States
     ERROR_INVALID_OPCODE,         // Invalid instruction opcode detected
     ERROR_OPCODE_NOT_IMPLEMENTED  // Valid but unimplemented instruction (CSR, FENCE, etc.)
-  } state, next_state;
+  } state /*verilator public_flat_rd*/, next_state;
 
   always_ff @ (posedge clk) begin
     if (!rst_n) begin
@@ -438,6 +443,7 @@ module control
     rs1_mux_sel = RS1_OUT;
     rs2_mux_sel = RS2_OUT;
     mem_read = 0;
+    mem_ifetch = 0;
     mem_write = 0;
     alu_op = ALU_ADD;
     csr_access = 1'b0;
@@ -457,6 +463,7 @@ module control
       load_ir = 1'b0;
       load_reg = 1'b0;
       mem_read = 1'b0;
+      mem_ifetch = 1'b0;
       mem_write = 1'b0;
     end
     else begin
@@ -466,6 +473,7 @@ module control
       end
       FETCH_1: begin
         mem_read = 1'b1;
+        mem_ifetch = 1'b1;
       end
       FETCH_2: begin
         load_mdr = 1'b1;
@@ -771,6 +779,27 @@ module control
     end
   end
 
+  // Performance monitor events. The wait events are high for every cycle
+  // the FSM waits on mem_resp; the others for one cycle per instruction
+  always_comb begin
+    hpm_events = 16'h0;
+    if (rst_n) begin
+      hpm_events[HPM_EVENT_FETCH_WAIT]   = state == FETCH_1;
+      hpm_events[HPM_EVENT_LOAD_WAIT]    = state == LD_2;
+      hpm_events[HPM_EVENT_STORE_WAIT]   = state == ST_3;
+      hpm_events[HPM_EVENT_BRANCH_TAKEN] = state == BRANCH_T;
+      hpm_events[HPM_EVENT_JUMP]         = state == JAL_1 || state == JALR_1;
+      hpm_events[HPM_EVENT_TRAP]         = state == TRAP_ENTRY_0;
+      hpm_events[HPM_EVENT_CSR]          = state == CSR_1;
+      hpm_events[HPM_EVENT_LOAD_BYTE]    = state == LD_0 && mem_size == MEM_SIZE_BYTE;
+      hpm_events[HPM_EVENT_LOAD_HALF]    = state == LD_0 && mem_size == MEM_SIZE_HALF;
+      hpm_events[HPM_EVENT_LOAD_WORD]    = state == LD_0 && mem_size == MEM_SIZE_WORD;
+      hpm_events[HPM_EVENT_STORE_BYTE]   = state == ST_0 && mem_size == MEM_SIZE_BYTE;
+      hpm_events[HPM_EVENT_STORE_HALF]   = state == ST_0 && mem_size == MEM_SIZE_HALF;
+      hpm_events[HPM_EVENT_STORE_WORD]   = state == ST_0 && mem_size == MEM_SIZE_WORD;
+    end
+  end
+
   // Export funct3 for CSR ALU
   assign funct3_out = funct3;
 
@@ -22,7 +22,9 @@
 
 `include "datatypes.sv"
 
-module core_top (
+module core_top #(
+  parameter int HPM_COUNTERS = 4  // Performance counters in csr_file (1-29)
+) (
   input logic clk,
   input logic rst_n,
   input logic [31:0] mem_rdata,
@@ -32,6 +34,7 @@ module core_top (
   output logic mem_read,
   output logic mem_write,
   output logic [3:0] mem_be,  // Byte enables for sub-word memory access
+  output logic mem_ifetch,    // High with mem_read for an instruction fetch
   output logic [31:0] pc  // Program counter output for testbench visibility
 );
 
@@ -87,6 +90,7 @@ wire csr_we;              // CSR write enable (from csr_alu)
 wire [31:0] csr_operand;  // RS1 or zero-extended immediate
 wire rs1_is_zero;         // True if rs1=x0 or zimm=0
 wire instret_inc;         // Increment instruction retired counter
+wire [15:0] hpm_events;   // Performance monitor events (hpm_event_t bits)
 
 // Trap handling signals
 wire trap_entry;          // High during trap entry
@@ -163,7 +167,7 @@ assign trap_csr_wdata = is_trap_operation ? trap_wdata : csr_wdata;
 assign trap_csr_we = load_mepc | load_mcause | load_mtval | (csr_we & csr_write);
 
 // CSR register file for user-mode counters and machine-mode trap handling
-csr_file u_csr_file (
+csr_file #(.HPM_COUNTERS(HPM_COUNTERS)) u_csr_file (
   .clk(clk),
   .rst_n(rst_n),
   .csr_addr(trap_csr_addr),   // Muxed CSR address
@@ -171,7 +175,8 @@ csr_file u_csr_file (
   .csr_we(trap_csr_we),       // Muxed write enable
   .csr_rdata(csr_rdata),      // Read data
   .csr_valid(csr_valid),      // Address valid signal
-  .instret_inc(instret_inc)   // Increment instruction retired counter
+  .instret_inc(instret_inc),  // Increment instruction retired counter
+  .hpm_events(hpm_events)     // Performance monitor events from control
 );
 
 // CSR ALU for read-modify-write operations
@@ -220,6 +225,7 @@ control u_control (
   .load_reg(load_reg),
   .mem_write(mem_write),
   .mem_read(mem_read),
+  .mem_ifetch(mem_ifetch),
   .mem_resp(mem_resp),
   .rs1_mux_sel(rs1_mux_sel),
   .rs2_mux_sel(rs2_mux_sel),
@@ -243,7 +249,8 @@ control u_control (
   .load_mepc(load_mepc),
   .load_mcause(load_mcause),
   .load_mtval(load_mtval),
-  .mcause_val(mcause_val));
+  .mcause_val(mcause_val),
+  .hpm_events(hpm_events));
 
 alu #(.WIDTH(32)) u_alu (
   .a(rs1_mux_out),
@@ -15,10 +15,27 @@
 //   0x342 - mcause         - Machine trap cause
 //   0x343 - mtval          - Machine bad address or instruction
 //
+// Hardware performance monitor (HPM_COUNTERS counters, N = 3..2+HPM_COUNTERS):
+//   0xB03-0xB1F - mhpmcounterN[31:0]  - Event counter (read-write)
+//   0xB83-0xB9F - mhpmcounterNh[63:32]
+//   0xC03-0xC1F - hpmcounterN[31:0]   - Read-only shadows
+//   0xC83-0xC9F - hpmcounterNh[63:32]
+//   0x323-0x33F - mhpmeventN          - Event selector (hpm_event_t value)
+//   0x320       - mcountinhibit       - Bit N stops mhpmcounterN
+//
+// A counter adds one in every cycle its selected hpm_events bit is high
+// and its mcountinhibit bit is clear; a CSR write to it in the same cycle
+// wins. Selector values other than hpm_event_t events count nothing.
+// Counters past HPM_COUNTERS read zero and ignore writes. The cycle (CY)
+// and instret (IR) bits of mcountinhibit are read-only zero: those counters
+// always run.
+//
 // Invalid CSR addresses signal an error.
 //
 
-module csr_file (
+module csr_file #(
+  parameter int HPM_COUNTERS = 4     // mhpmcounter3 onwards, 1 to 29
+) (
   input  logic        clk,
   input  logic        rst_n,
 
@@ -30,19 +47,32 @@ module csr_file (
   output logic        csr_valid,     // 1 if address is valid, 0 for invalid
 
   // Counter control
-  input  logic        instret_inc    // Increment instruction retired counter
+  input  logic        instret_inc,   // Increment instruction retired counter
+  input  logic [15:0] hpm_events     // Performance events this cycle (hpm_event_t bits)
 );
 
   // 64-bit counters
-  logic [63:0] cycle_counter;
-  logic [63:0] time_counter;    // Mirrors cycle counter per user requirements
-  logic [63:0] instret_counter;
+  // Public so the simulation harness can advance cycle/time when it
+  // fast-forwards over memory wait cycles, read instret and the machine
+  // CSRs for hang detection, and load all of them when it hands a program
+  // over from the functional model
+  logic [63:0] cycle_counter /*verilator public_flat_rw*/;
+  logic [63:0] time_counter /*verilator public_flat_rw*/;    // Mirrors cycle counter per user requirements
+  logic [63:0] instret_counter /*verilator public_flat_rw*/;
 
   // Machine-mode CSRs
-  logic [31:0] mtvec;           // Machine trap vector base address
-  logic [31:0] mepc;            // Machine exception program counter
-  logic [31:0] mcause;          // Machine cause register
-  logic [31:0] mtval;           // Machine trap value
+  logic [31:0] mtvec /*verilator public_flat_rw*/;  // Machine trap vector base address
+  logic [31:0] mepc /*verilator public_flat_rw*/;   // Machine exception program counter
+  logic [31:0] mcause /*verilator public_flat_rw*/; // Machine cause register
+  logic [31:0] mtval /*verilator public_flat_rw*/;  // Machine trap value
+
+  // Hardware performance monitor; mhpmcounter[0] is mhpmcounter3. Public
+  // so the harness can apply fast-forwarded wait cycles and hand them over
+  // like the counters above
+  localparam logic [31:0] HPM_INHIBIT_MASK = ((32'h1 << HPM_COUNTERS) - 32'h1) << 3;
+  logic [63:0] mhpmcounter [HPM_COUNTERS] /*verilator public_flat_rw*/;
+  logic [31:0] mhpmevent [HPM_COUNTERS] /*verilator public_flat_rw*/;
+  logic [31:0] mcountinhibit /*verilator public_flat_rw*/;
 
   // Counter increment logic
   always_ff @(posedge clk or negedge rst_n) begin
@@ -85,6 +115,50 @@ module csr_file (
     end
   end
 
+  // Performance counter logic
+  always_ff @(posedge clk or negedge rst_n) begin
+    if (!rst_n) begin
+      mcountinhibit <= 32'h0;
+      for (int i = 0; i < HPM_COUNTERS; i++) begin
+        mhpmcounter[i] <= 64'h0;
+        mhpmevent[i]   <= 32'h0;
+      end
+    end else begin
+      if (csr_we && csr_addr == 12'h320) begin
+        mcountinhibit <= csr_wdata & HPM_INHIBIT_MASK;
+      end
+
+      for (int i = 0; i < HPM_COUNTERS; i++) begin
+        if (csr_we && csr_addr == 12'h323 + 12'(i)) begin
+          mhpmevent[i] <= csr_wdata;
+        end
+
+        if (csr_we && csr_addr == 12'hB03 + 12'(i)) begin
+          mhpmcounter[i][31:0] <= csr_wdata;
+        end else if (csr_we && csr_addr == 12'hB83 + 12'(i)) begin
+          mhpmcounter[i][63:32] <= csr_wdata;
+        end else if (!mcountinhibit[i + 3] && mhpmevent[i][31:4] == 28'h0 &&
+                     hpm_events[mhpmevent[i][3:0]]) begin
+          mhpmcounter[i] <= mhpmcounter[i] + 64'h1;
+        end
+      end
+    end
+  end
+
+  // Counter and selector addressed by csr_addr[4:0] (zero if unimplemented)
+  logic [63:0] hpm_counter;
+  logic [31:0] hpm_event;
+  always_comb begin
+    hpm_counter = 64'h0;
+    hpm_event = 32'h0;
+    for (int i = 0; i < HPM_COUNTERS; i++) begin
+      if (csr_addr[4:0] == 5'(i + 3)) begin
+        hpm_counter = mhpmcounter[i];
+        hpm_event = mhpmevent[i];
+      end
+    end
+  end
+
   // CSR address decoding and read logic
   always_comb begin
     csr_rdata = 32'h0;
@@ -105,9 +179,32 @@ module csr_file (
       12'h342: csr_rdata = mcause;                   // mcause
       12'h343: csr_rdata = mtval;                    // mtval
 
+      // Performance monitor control
+      12'h320: csr_rdata = mcountinhibit;            // mcountinhibit
+
       default: begin
         csr_rdata = 32'h0;
         csr_valid = 1'b0;  // Invalid CSR address
+
+        // Performance monitor counters 3-31, implemented or not
+        if (csr_addr[4:0] >= 5'd3) begin
+          case (csr_addr[11:5])
+            7'h58, 7'h60: begin                      // [m]hpmcounterN
+              csr_rdata = hpm_counter[31:0];
+              csr_valid = 1'b1;
+            end
+            7'h5C, 7'h64: begin                      // [m]hpmcounterNh
+              csr_rdata = hpm_counter[63:32];
+              csr_valid = 1'b1;
+            end
+            7'h19: begin                             // mhpmeventN
+              csr_rdata = hpm_event;
+              csr_valid = 1'b1;
+            end
+            default: begin
+            end
+          endcase
+        end
       end
     endcase
   end
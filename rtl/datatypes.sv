@@ -109,4 +109,23 @@ typedef enum bit [2:0] {
   CSR_RCI = 3'b111    // CSRRCI - Atomic Read and Clear Bits Immediate
 } csr_op_t;
 
+// Hardware performance monitor events (mhpmeventN values). control.sv
+// drives one hpm_events bit per event, high in each cycle the event counts
+typedef enum bit [3:0] {
+  HPM_EVENT_NONE         = 4'd0,   // Counter does not count
+  HPM_EVENT_FETCH_WAIT   = 4'd1,   // FETCH_1 cycles (instruction fetch wait)
+  HPM_EVENT_LOAD_WAIT    = 4'd2,   // LD_2 cycles (load data wait)
+  HPM_EVENT_STORE_WAIT   = 4'd3,   // ST_3 cycles (store completion wait)
+  HPM_EVENT_BRANCH_TAKEN = 4'd4,   // Taken conditional branches
+  HPM_EVENT_JUMP         = 4'd5,   // JAL and JALR
+  HPM_EVENT_TRAP         = 4'd6,   // Trap entries (ECALL, EBREAK)
+  HPM_EVENT_CSR          = 4'd7,   // CSR instructions
+  HPM_EVENT_LOAD_BYTE    = 4'd8,   // LB, LBU
+  HPM_EVENT_LOAD_HALF    = 4'd9,   // LH, LHU
+  HPM_EVENT_LOAD_WORD    = 4'd10,  // LW
+  HPM_EVENT_STORE_BYTE   = 4'd11,  // SB
+  HPM_EVENT_STORE_HALF   = 4'd12,  // SH
+  HPM_EVENT_STORE_WORD   = 4'd13   // SW
+} hpm_event_t;
+
 `endif
@@ -30,7 +30,9 @@ module dff_init (
 
   output wire q;
 
-  reg data;
+  // Public so the simulation harness can load program_register contents
+  // (the PC) directly
+  reg data /*verilator public_flat_rw*/;
 
   assign q = data;
 
@@ -46,7 +46,8 @@ module regfile (
   output logic [WIDTH-1:0] a;
   output logic [WIDTH-1:0] b;
 
-  reg [WIDTH-1:0] data [DEPTH-1:0];
+  // Public so the simulation harness can hash and load architectural state
+  reg [WIDTH-1:0] data [DEPTH-1:0] /*verilator public_flat_rw*/;
 
   // Output logic
   always_comb begin
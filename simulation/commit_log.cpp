@@ -0,0 +1,228 @@
+/*
+ * Instruction Commit Log Implementation
+ */
+
+#include "include/commit_log.h"
+#include <cstdio>
+#include <zlib.h>
+
+namespace {
+// Records the reader inflates at a time
+constexpr size_t READ_RECORDS = 4096;
+
+// Spike prints values zero-padded to their width in bits
+void print_value(std::string &out, uint32_t bits, uint32_t value) {
+  char text[16];
+  std::snprintf(text, sizeof(text), "0x%0*x", static_cast<int>(bits / 4),
+                value);
+  out += text;
+}
+} // namespace
+
+uint32_t commit_dest_reg(uint32_t insn) {
+  switch (insn & 0x7F) {
+  case 0x37: // LUI
+  case 0x17: // AUIPC
+  case 0x6F: // JAL
+  case 0x67: // JALR
+  case 0x03: // Loads
+  case 0x13: // OP-IMM
+  case 0x33: // OP
+    return (insn >> 7) & 31;
+  case 0x73: // CSR instructions (funct3 != 0); ECALL/EBREAK/MRET write none
+    return ((insn >> 12) & 7) ? (insn >> 7) & 31 : 0;
+  default:
+    return 0;
+  }
+}
+
+uint32_t commit_access_size(uint32_t insn) {
+  uint32_t opcode = insn & 0x7F;
+  if (opcode != 0x03 && opcode != 0x23) {
+    return 0;
+  }
+  return 1u << ((insn >> 12) & 3);
+}
+
+std::string format_spike(const CommitRecord &record) {
+  std::string line = "core   0: 3 ";
+  print_value(line, 32, record.pc);
+  line += " (";
+  print_value(line, 32, record.insn);
+  line += ")";
+  if ((record.flags & COMMIT_RD_WRITE) && record.rd != 0) {
+    char reg[8];
+    std::snprintf(reg, sizeof(reg), " x%-2u ", record.rd);
+    line += reg;
+    print_value(line, 32, record.rd_value);
+  }
+  if (record.flags & (COMMIT_LOAD | COMMIT_STORE)) {
+    line += " mem ";
+    print_value(line, 32, record.mem_addr);
+  }
+  if (record.flags & COMMIT_STORE) {
+    line += " ";
+    print_value(line, 8 * record.mem_size, record.mem_data);
+  }
+  return line;
+}
+
+CommitLogWriter::CommitLogWriter()
+    : file(nullptr), active(0), fill(0), records(0), pending(false),
+      pending_buffer(0), pending_count(0), stop(false), failed(false) {}
+
+CommitLogWriter::~CommitLogWriter() { close(); }
+
+bool CommitLogWriter::open(const std::string &path) {
+  close();
+  // Level 1: the writer has to keep up with the simulation, and commit
+  // records compress well even at the fastest setting
+  file = gzopen(path.c_str(), "wb1");
+  if (!file) {
+    return false;
+  }
+  gzbuffer(file, 256 * 1024);
+
+  CommitLogHeader header = {COMMIT_LOG_MAGIC, COMMIT_LOG_VERSION,
+                            sizeof(CommitRecord), 0};
+  if (gzwrite(file, &header, sizeof(header)) != sizeof(header)) {
+    gzclose(file);
+    file = nullptr;
+    return false;
+  }
+
+  for (std::vector<CommitRecord> &buffer : buffers) {
+    buffer.resize(BUFFER_RECORDS);
+  }
+  active = 0;
+  fill = 0;
+  records = 0;
+  pending = false;
+  stop = false;
+  failed = false;
+  worker = std::thread(&CommitLogWriter::worker_loop, this);
+  return true;
+}
+
+bool CommitLogWriter::close() {
+  if (!file) {
+    return true;
+  }
+  if (fill > 0) {
+    hand_off();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+  cv.notify_all();
+  worker.join();
+
+  bool ok = !failed && gzclose(file) == Z_OK;
+  file = nullptr;
+  return ok;
+}
+
+void CommitLogWriter::hand_off() {
+  {
+    // Wait for the writer to finish the other buffer
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this]() { return !pending; });
+    pending = true;
+    pending_buffer = active;
+    pending_count = fill;
+  }
+  cv.notify_all();
+  records += fill;
+  active ^= 1;
+  fill = 0;
+}
+
+void CommitLogWriter::worker_loop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    cv.wait(lock, [this]() { return pending || stop; });
+    if (!pending) {
+      return; // Stopped with nothing left to write
+    }
+
+    // Compress outside the lock; the simulation thread is filling the
+    // other buffer meanwhile
+    const CommitRecord *data = buffers[pending_buffer].data();
+    unsigned bytes =
+        static_cast<unsigned>(pending_count * sizeof(CommitRecord));
+    lock.unlock();
+    bool ok = gzwrite(file, data, bytes) == static_cast<int>(bytes);
+    lock.lock();
+
+    failed = failed || !ok;
+    pending = false;
+    cv.notify_all();
+  }
+}
+
+CommitLogReader::CommitLogReader() : file(nullptr), position(0) {}
+
+CommitLogReader::~CommitLogReader() {
+  if (file) {
+    gzclose(file);
+  }
+}
+
+bool CommitLogReader::open(const std::string &path) {
+  if (file) {
+    gzclose(file);
+  }
+  buffer.clear();
+  position = 0;
+  error.clear();
+
+  file = gzopen(path.c_str(), "rb");
+  if (!file) {
+    error = "cannot open " + path;
+    return false;
+  }
+  CommitLogHeader header = {};
+  if (gzread(file, &header, sizeof(header)) != sizeof(header) ||
+      header.magic != COMMIT_LOG_MAGIC) {
+    error = path + " is not a commit log";
+  } else if (header.version != COMMIT_LOG_VERSION ||
+             header.record_size != sizeof(CommitRecord)) {
+    error = path + ": unsupported commit log version " +
+            std::to_string(header.version);
+  }
+  if (!error.empty()) {
+    gzclose(file);
+    file = nullptr;
+    return false;
+  }
+  return true;
+}
+
+bool CommitLogReader::next(CommitRecord &record) {
+  if (position == buffer.size()) {
+    if (!file) {
+      return false;
+    }
+    buffer.resize(READ_RECORDS);
+    int bytes =
+        gzread(file, buffer.data(),
+               static_cast<unsigned>(READ_RECORDS * sizeof(CommitRecord)));
+    if (bytes < 0) {
+      int code = 0;
+      error = gzerror(file, &code);
+      bytes = 0;
+    } else if (bytes % sizeof(CommitRecord) != 0) {
+      error = "commit log ends in a partial record";
+    }
+    buffer.resize(static_cast<size_t>(bytes) / sizeof(CommitRecord));
+    position = 0;
+    if (buffer.empty()) {
+      gzclose(file);
+      file = nullptr;
+      return false;
+    }
+  }
+  record = buffer[position++];
+  return true;
+}
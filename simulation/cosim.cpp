@@ -0,0 +1,257 @@
+/*
+ * Lockstep Co-Simulation Checker Implementation
+ */
+
+#include "include/cosim.h"
+#include "include/test_utils.h"
+#include <chrono>
+#include <sstream>
+
+namespace {
+// Polls of an empty queue before the checker starts sleeping
+constexpr int SPIN_POLLS = 64;
+constexpr auto IDLE_SLEEP = std::chrono::microseconds(20);
+
+uint32_t byte_mask(uint8_t byte_enables) {
+  uint32_t mask = 0;
+  for (int i = 0; i < 4; i++) {
+    if (byte_enables & (1u << i)) {
+      mask |= 0xFFu << (i * 8);
+    }
+  }
+  return mask;
+}
+
+// cycle/time read the RTL's clock, which the untimed ISS cannot know
+bool reads_clock_csr(uint32_t insn) {
+  if ((insn & 0x7F) != 0x73 || ((insn >> 12) & 0x7) == 0) {
+    return false;
+  }
+  uint32_t csr = insn >> 20;
+  return csr == 0xC00 || csr == 0xC01 || csr == 0xC80 || csr == 0xC81;
+}
+} // namespace
+
+CosimChecker::CosimChecker(uint32_t memory_size)
+    : iss_log(LogLevel::ERROR), memory(memory_size, 4, false, &iss_log),
+      store_watch(-1), store_seen(false), store_addr(0), store_data(0),
+      store_be(0), iss_regs(), queue(QUEUE_CAPACITY), stop(false),
+      mismatch(false), checked(0), pushed(0) {
+  IssConfig config;
+  config.log_level = LogLevel::ERROR;
+  iss.reset(new Rv32iIss(memory, config));
+
+  // Every bus store the reference makes, for comparison with the RTL's
+  store_watch = memory.add_write_watch(
+      0, 0xFFFFFFFF, [this](uint32_t addr, uint32_t data, uint8_t be) {
+        store_seen = true;
+        store_addr = addr;
+        store_data = data;
+        store_be = be;
+      });
+}
+
+CosimChecker::~CosimChecker() {
+  stop.store(true, std::memory_order_release);
+  if (worker.joinable()) {
+    worker.join();
+  }
+  memory.remove_write_watch(store_watch);
+}
+
+bool CosimChecker::load_program(const std::string &program_file) {
+  return iss->load_program(program_file);
+}
+
+void CosimChecker::start() {
+  if (!worker.joinable()) {
+    worker = std::thread(&CosimChecker::worker_loop, this);
+  }
+}
+
+void CosimChecker::push(const CosimCommit &commit) {
+  while (!queue.try_push(commit)) {
+    std::this_thread::yield();
+  }
+  pushed++;
+}
+
+void CosimChecker::drain() {
+  while (checked.load(std::memory_order_acquire) != pushed) {
+    std::this_thread::yield();
+  }
+}
+
+uint64_t CosimChecker::skip(uint64_t instructions) {
+  // The worker is idle once drained, so the reference can be stepped here
+  uint64_t retired = iss->step(instructions);
+  for (uint32_t i = 0; i < 32; i++) {
+    iss_regs[i] = iss->get_reg(i);
+  }
+  history.clear();
+  return retired;
+}
+
+void CosimChecker::worker_loop() {
+  int idle_polls = 0;
+  CosimCommit commit;
+  while (true) {
+    if (queue.try_pop(commit)) {
+      idle_polls = 0;
+      // After a mismatch the reference state is meaningless; keep
+      // draining so the RTL side never blocks
+      if (!mismatch.load(std::memory_order_relaxed)) {
+        check(commit);
+      }
+      checked.fetch_add(1, std::memory_order_release);
+      continue;
+    }
+
+    // Only exit once everything pushed before stop has been consumed
+    if (stop.load(std::memory_order_acquire)) {
+      if (!queue.try_pop(commit)) {
+        return;
+      }
+      checked.fetch_add(1, std::memory_order_release);
+      continue;
+    }
+
+    if (++idle_polls < SPIN_POLLS) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(IDLE_SLEEP);
+    }
+  }
+}
+
+void CosimChecker::check(const CosimCommit &rtl_commit) {
+  CosimCommit rtl = rtl_commit;
+  CosimCommit ref = step_reference(rtl);
+  rtl.pc = ref.pc;
+  rtl.insn = ref.insn;
+
+  history.emplace_back(rtl, ref);
+  if (history.size() > CONTEXT_INSNS) {
+    history.pop_front();
+  }
+
+  std::string difference = describe_difference(rtl, ref);
+  if (difference.empty()) {
+    return;
+  }
+
+  report.push_back("Mismatch at instruction " + std::to_string(rtl.index) +
+                   ", PC " + to_hex_string(ref.pc, 8) + " (" +
+                   to_hex_string(ref.insn, 8) + "): " + difference);
+  report.push_back("Last " + std::to_string(history.size()) +
+                   " instructions (RTL | reference):");
+  for (const auto &entry : history) {
+    report.push_back("  #" + std::to_string(entry.first.index) + " " +
+                     to_hex_string(entry.first.pc, 8) + " " +
+                     to_hex_string(entry.first.insn, 8) + "  " +
+                     format_commit(entry.first) + " | " +
+                     format_commit(entry.second));
+  }
+  mismatch.store(true, std::memory_order_release);
+}
+
+CosimCommit CosimChecker::step_reference(const CosimCommit &rtl) {
+  CosimCommit ref;
+  ref.index = iss->get_instret();
+  ref.pc = iss->get_pc();
+  ref.insn = memory.backdoor_read_word(ref.pc & ~3u);
+
+  store_seen = false;
+  if (iss->step(1) == 0) {
+    // Halted: the RTL retired an instruction the core should stop on
+    ref.next_pc = ref.pc;
+    ref.halt = true;
+    return ref;
+  }
+  ref.next_pc = iss->get_pc();
+
+  if (reads_clock_csr(ref.insn)) {
+    // Adopt the RTL's counter value so later instructions see the same
+    uint32_t rd = (ref.insn >> 7) & 0x1F;
+    if (rd != 0) {
+      bool written = rtl.reg_changes == 1 && rtl.rd == rd;
+      iss->set_reg(rd, written ? rtl.rd_value : iss_regs[rd]);
+    }
+  }
+
+  for (uint32_t i = 1; i < 32; i++) {
+    uint32_t value = iss->get_reg(i);
+    if (value != iss_regs[i]) {
+      if (ref.reg_changes == 0) {
+        ref.rd = static_cast<uint8_t>(i);
+        ref.rd_value = value;
+      }
+      ref.reg_changes++;
+      iss_regs[i] = value;
+    }
+  }
+
+  ref.store = store_seen;
+  ref.store_addr = store_addr;
+  ref.store_data = store_data;
+  ref.store_be = store_be;
+  if (!ref.store) {
+    ref.store_addr = ref.store_data = ref.store_be = 0;
+  }
+
+  iss->get_csr(0x305, ref.mtvec);
+  iss->get_csr(0x341, ref.mepc);
+  iss->get_csr(0x342, ref.mcause);
+  iss->get_csr(0x343, ref.mtval);
+  return ref;
+}
+
+std::string CosimChecker::describe_difference(const CosimCommit &rtl,
+                                              const CosimCommit &ref) const {
+  std::ostringstream out;
+  if (ref.halt) {
+    out << "reference halts on this instruction, RTL retired it";
+  } else if (rtl.next_pc != ref.next_pc) {
+    out << "next PC " << to_hex_string(rtl.next_pc, 8) << ", expected "
+        << to_hex_string(ref.next_pc, 8);
+  } else if (rtl.reg_changes != ref.reg_changes || rtl.rd != ref.rd ||
+             rtl.rd_value != ref.rd_value) {
+    out << "register write " << format_commit(rtl) << ", expected "
+        << format_commit(ref);
+  } else if (rtl.store != ref.store || rtl.store_addr != ref.store_addr ||
+             rtl.store_be != ref.store_be ||
+             ((rtl.store_data ^ ref.store_data) & byte_mask(ref.store_be))) {
+    out << "store " << format_commit(rtl) << ", expected "
+        << format_commit(ref);
+  } else if (rtl.mtvec != ref.mtvec || rtl.mepc != ref.mepc ||
+             rtl.mcause != ref.mcause || rtl.mtval != ref.mtval) {
+    out << "mtvec/mepc/mcause/mtval " << to_hex_string(rtl.mtvec, 8) << "/"
+        << to_hex_string(rtl.mepc, 8) << "/" << to_hex_string(rtl.mcause, 8)
+        << "/" << to_hex_string(rtl.mtval, 8) << ", expected "
+        << to_hex_string(ref.mtvec, 8) << "/" << to_hex_string(ref.mepc, 8)
+        << "/" << to_hex_string(ref.mcause, 8) << "/"
+        << to_hex_string(ref.mtval, 8);
+  }
+  return out.str();
+}
+
+std::string CosimChecker::format_commit(const CosimCommit &commit) {
+  if (commit.halt) {
+    return "halt";
+  }
+  std::ostringstream out;
+  out << "-> " << to_hex_string(commit.next_pc, 8);
+  if (commit.reg_changes > 0) {
+    out << " x" << static_cast<int>(commit.rd) << "="
+        << to_hex_string(commit.rd_value, 8);
+    if (commit.reg_changes > 1) {
+      out << " (+" << (commit.reg_changes - 1) << " more)";
+    }
+  }
+  if (commit.store) {
+    out << " [" << to_hex_string(commit.store_addr, 8) << "]="
+        << to_hex_string(commit.store_data & byte_mask(commit.store_be), 8)
+        << "/" << static_cast<int>(commit.store_be);
+  }
+  return out.str();
+}
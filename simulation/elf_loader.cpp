@@ -0,0 +1,351 @@
+/*
+ * ELF32 Program Loader Implementation
+ */
+
+#include "include/elf_loader.h"
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ELF constants (subset of <elf.h>, spelled out to stay self-contained)
+namespace {
+constexpr uint8_t ELFCLASS32 = 1;
+constexpr uint8_t ELFDATA2LSB = 1;
+constexpr uint16_t EM_RISCV = 243;
+constexpr uint32_t PT_LOAD = 1;
+constexpr uint32_t SHT_SYMTAB = 2;
+constexpr uint32_t ELF32_EHDR_SIZE = 52;
+constexpr uint32_t ELF32_PHDR_SIZE = 32;
+constexpr uint32_t ELF32_SHDR_SIZE = 40;
+constexpr uint32_t ELF32_SYM_SIZE = 16;
+constexpr char ELF_MAGIC[4] = {0x7F, 'E', 'L', 'F'};
+
+// Hex digit value, or -1 for a non-hex character
+int hex_digit(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+bool is_space(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+} // namespace
+
+ElfImage::ElfImage()
+    : data(nullptr), size(0), mapping(nullptr), mapping_size(0), elf(false),
+      entry_point(0) {}
+
+ElfImage::~ElfImage() { release(); }
+
+void ElfImage::release() {
+  if (mapping) {
+    munmap(mapping, mapping_size);
+    mapping = nullptr;
+    mapping_size = 0;
+  }
+  buffer.clear();
+  data = nullptr;
+  size = 0;
+  elf = false;
+  entry_point = 0;
+  segments.clear();
+  symbols.clear();
+  error.clear();
+}
+
+bool ElfImage::fail(const std::string &message) {
+  error = message;
+  return false;
+}
+
+bool ElfImage::load_file(const std::string &filename) {
+  release();
+
+  // Sniff the first bytes: a binary ELF starts with "\x7F" "ELF",
+  // anything else is treated as a hex-text (.ini) image
+  char magic[4] = {0, 0, 0, 0};
+  {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+      return fail("Cannot open file: " + filename);
+    }
+    file.read(magic, sizeof(magic));
+  }
+
+  bool ok = (std::memcmp(magic, ELF_MAGIC, 4) == 0) ? read_binary(filename)
+                                                     : read_hex_text(filename);
+  if (!ok) {
+    return false;
+  }
+
+  // Hex images that hold an ELF are parsed as such; otherwise they are a
+  // flat image loaded at address 0
+  if (size >= 4 && std::memcmp(data, ELF_MAGIC, 4) == 0) {
+    return parse_elf();
+  }
+  return true;
+}
+
+bool ElfImage::read_binary(const std::string &filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return fail("Cannot open file: " + filename);
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return fail("Cannot stat file: " + filename);
+  }
+
+  size_t file_size = static_cast<size_t>(st.st_size);
+  if (file_size >= MMAP_THRESHOLD) {
+    void *map = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+      return fail("Cannot map file: " + filename);
+    }
+    mapping = map;
+    mapping_size = file_size;
+    data = static_cast<const uint8_t *>(map);
+    size = file_size;
+    return true;
+  }
+
+  buffer.resize(file_size);
+  size_t done = 0;
+  while (done < file_size) {
+    ssize_t n = read(fd, buffer.data() + done, file_size - done);
+    if (n <= 0) {
+      close(fd);
+      return fail("Cannot read file: " + filename);
+    }
+    done += static_cast<size_t>(n);
+  }
+  close(fd);
+
+  data = buffer.data();
+  size = buffer.size();
+  return true;
+}
+
+bool ElfImage::read_hex_text(const std::string &filename) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    return fail("Cannot open file: " + filename);
+  }
+  std::string text((std::istreambuf_iterator<char>(file)),
+                   std::istreambuf_iterator<char>());
+
+  // Each whitespace-separated token is one byte ("AB" or "0xAB"), matching
+  // MemoryModel::load_hex_file; tokens shorter than two characters and
+  // tokens without leading hex digits are skipped
+  buffer.reserve(text.size() / 3 + 1);
+  size_t pos = 0;
+  while (pos < text.size()) {
+    while (pos < text.size() && is_space(text[pos])) {
+      pos++;
+    }
+    size_t start = pos;
+    while (pos < text.size() && !is_space(text[pos])) {
+      pos++;
+    }
+    if (pos - start < 2) {
+      continue;
+    }
+
+    size_t digit = start;
+    if (text[digit] == '0' &&
+        (text[digit + 1] == 'x' || text[digit + 1] == 'X')) {
+      digit += 2;
+    }
+    uint32_t value = 0;
+    bool any = false;
+    for (; digit < pos; digit++) {
+      int v = hex_digit(text[digit]);
+      if (v < 0) {
+        break;
+      }
+      value = (value << 4) | static_cast<uint32_t>(v);
+      any = true;
+    }
+    if (any) {
+      buffer.push_back(static_cast<uint8_t>(value));
+    }
+  }
+
+  data = buffer.data();
+  size = buffer.size();
+  return true;
+}
+
+uint16_t ElfImage::read16(size_t offset) const {
+  return static_cast<uint16_t>(data[offset] | (data[offset + 1] << 8));
+}
+
+uint32_t ElfImage::read32(size_t offset) const {
+  return static_cast<uint32_t>(data[offset]) |
+         (static_cast<uint32_t>(data[offset + 1]) << 8) |
+         (static_cast<uint32_t>(data[offset + 2]) << 16) |
+         (static_cast<uint32_t>(data[offset + 3]) << 24);
+}
+
+bool ElfImage::parse_elf() {
+  if (size < ELF32_EHDR_SIZE) {
+    return fail("Truncated ELF header");
+  }
+  if (data[4] != ELFCLASS32) {
+    return fail("Not an ELF32 file");
+  }
+  if (data[5] != ELFDATA2LSB) {
+    return fail("Not a little-endian ELF file");
+  }
+  if (read16(18) != EM_RISCV) {
+    return fail("Not a RISC-V ELF file (e_machine=" +
+                std::to_string(read16(18)) + ")");
+  }
+
+  entry_point = read32(24);
+  uint32_t phoff = read32(28);
+  uint32_t shoff = read32(32);
+  uint16_t phentsize = read16(42);
+  uint16_t phnum = read16(44);
+  uint16_t shentsize = read16(46);
+  uint16_t shnum = read16(48);
+
+  // Program headers - keep only PT_LOAD segments
+  if (phnum > 0 && phentsize < ELF32_PHDR_SIZE) {
+    return fail("Invalid program header size");
+  }
+  if (static_cast<uint64_t>(phoff) +
+          static_cast<uint64_t>(phnum) * phentsize >
+      size) {
+    return fail("Program headers extend past end of file");
+  }
+  for (uint16_t i = 0; i < phnum; i++) {
+    size_t ph = phoff + static_cast<size_t>(i) * phentsize;
+    if (read32(ph) != PT_LOAD) {
+      continue;
+    }
+
+    ElfSegment segment;
+    segment.file_offset = read32(ph + 4);
+    segment.paddr = read32(ph + 12);
+    segment.file_size = read32(ph + 16);
+    segment.mem_size = read32(ph + 20);
+    if (static_cast<uint64_t>(segment.file_offset) + segment.file_size >
+        size) {
+      return fail("Segment " + std::to_string(i) +
+                  " extends past end of file");
+    }
+    if (segment.file_size > segment.mem_size) {
+      return fail("Segment " + std::to_string(i) +
+                  " has p_filesz larger than p_memsz");
+    }
+    segments.push_back(segment);
+  }
+
+  if (segments.empty()) {
+    return fail("ELF file has no PT_LOAD segments");
+  }
+
+  elf = true;
+  parse_symbols(shoff, shentsize, shnum);
+  return true;
+}
+
+void ElfImage::parse_symbols(uint32_t shoff, uint32_t shentsize,
+                             uint32_t shnum) {
+  // Symbols are optional (stripped images still load)
+  if (shoff == 0 || shnum == 0 || shentsize < ELF32_SHDR_SIZE ||
+      static_cast<uint64_t>(shoff) + static_cast<uint64_t>(shnum) * shentsize >
+          size) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < shnum; i++) {
+    size_t sh = shoff + static_cast<size_t>(i) * shentsize;
+    if (read32(sh + 4) != SHT_SYMTAB) {
+      continue;
+    }
+
+    uint32_t sym_offset = read32(sh + 16);
+    uint32_t sym_size = read32(sh + 20);
+    uint32_t str_index = read32(sh + 24); // sh_link -> string table
+    if (str_index >= shnum ||
+        static_cast<uint64_t>(sym_offset) + sym_size > size) {
+      continue;
+    }
+
+    size_t str_sh = shoff + static_cast<size_t>(str_index) * shentsize;
+    uint32_t str_offset = read32(str_sh + 16);
+    uint32_t str_size = read32(str_sh + 20);
+    if (static_cast<uint64_t>(str_offset) + str_size > size) {
+      continue;
+    }
+
+    for (uint32_t off = 0; off + ELF32_SYM_SIZE <= sym_size;
+         off += ELF32_SYM_SIZE) {
+      size_t sym = sym_offset + off;
+      uint32_t name = read32(sym);
+      if (name == 0 || name >= str_size) {
+        continue;
+      }
+
+      const char *name_ptr =
+          reinterpret_cast<const char *>(data + str_offset + name);
+      size_t name_len = strnlen(name_ptr, str_size - name);
+      ElfSymbol symbol;
+      symbol.value = read32(sym + 4);
+      symbol.size = read32(sym + 8);
+      symbol.type = data[sym + 12] & 0xF;
+      symbols.emplace(std::string(name_ptr, name_len), symbol);
+    }
+  }
+}
+
+bool ElfImage::load_into(MemoryModel &memory) const {
+  if (!data) {
+    return false;
+  }
+
+  if (!elf) {
+    // Flat image: copy verbatim at address 0
+    if (size > memory.get_size()) {
+      return false;
+    }
+    memory.backdoor_write_block(0, data, static_cast<uint32_t>(size));
+    return true;
+  }
+
+  for (const ElfSegment &segment : segments) {
+    if (static_cast<uint64_t>(segment.paddr) + segment.mem_size >
+        memory.get_size()) {
+      return false;
+    }
+    memory.backdoor_write_block(segment.paddr, data + segment.file_offset,
+                                segment.file_size);
+    // .bss: zero-fill the part of the segment not backed by the file
+    memory.backdoor_fill(segment.paddr + segment.file_size, 0,
+                         segment.mem_size - segment.file_size);
+  }
+  return true;
+}
+
+bool ElfImage::find_symbol(const std::string &name, uint32_t &value) const {
+  auto it = symbols.find(name);
+  if (it == symbols.end()) {
+    return false;
+  }
+  value = it->second.value;
+  return true;
+}
@@ -0,0 +1,202 @@
+/*
+ * Control FSM Occupancy Profile Implementation
+ */
+
+#include "include/fsm_profile.h"
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+const char *const CLASS_NAMES[FSM_NUM_CLASSES] = {
+    "lui",    "auipc", "jal",   "jalr", "branch_taken", "branch_not_taken",
+    "op_imm", "op",    "fence", "load", "store",        "csr",
+    "trap",   "mret",  "halt"};
+
+const char *const GROUP_NAMES[FSM_NUM_GROUPS] = {
+    "fetch", "fetch_wait", "decode", "execute", "mem_wait", "pc_inc"};
+
+double cpi(uint64_t cycles, uint64_t instructions) {
+  return instructions ? static_cast<double>(cycles) / instructions : 0.0;
+}
+} // namespace
+
+FsmProfile::FsmProfile() { reset(); }
+
+void FsmProfile::reset() {
+  for (uint32_t cls = 0; cls < FSM_NUM_CLASSES; cls++) {
+    for (uint32_t state = 0; state < FSM_NUM_STATES; state++) {
+      cycles[cls][state] = 0;
+    }
+    instructions[cls] = 0;
+  }
+  for (uint64_t &count : pending) {
+    count = 0;
+  }
+  pending_cycles = 0;
+}
+
+void FsmProfile::retire(uint32_t insn) {
+  // BRANCH_T only runs for a taken branch
+  FsmClass cls = FsmTiming::classify(insn, pending[FSM_BRANCH_T] > 0);
+  for (uint32_t state = 0; state < FSM_NUM_STATES; state++) {
+    cycles[cls][state] += pending[state];
+    pending[state] = 0;
+  }
+  instructions[cls]++;
+  pending_cycles = 0;
+}
+
+uint64_t FsmProfile::get_instructions() const {
+  uint64_t total = 0;
+  for (uint64_t count : instructions) {
+    total += count;
+  }
+  return total;
+}
+
+uint64_t FsmProfile::get_cycles() const {
+  uint64_t total = 0;
+  for (uint32_t cls = 0; cls < FSM_NUM_CLASSES; cls++) {
+    total += get_cycles(static_cast<FsmClass>(cls));
+  }
+  return total;
+}
+
+uint64_t FsmProfile::get_cycles(FsmClass cls) const {
+  uint64_t total = 0;
+  for (uint64_t count : cycles[cls]) {
+    total += count;
+  }
+  return total;
+}
+
+uint64_t FsmProfile::get_group_cycles(FsmClass cls, FsmGroup group) const {
+  uint64_t total = 0;
+  for (uint32_t state = 0; state < FSM_NUM_STATES; state++) {
+    if (group_of(static_cast<FsmState>(state)) == group) {
+      total += cycles[cls][state];
+    }
+  }
+  return total;
+}
+
+std::string FsmProfile::format_table() const {
+  std::ostringstream out;
+  out << std::left << std::setw(17) << "class" << std::right
+      << std::setw(10) << "insns" << std::setw(12) << "cycles"
+      << std::setw(8) << "CPI";
+  for (uint32_t group = 0; group < FSM_NUM_GROUPS; group++) {
+    out << std::setw(12) << GROUP_NAMES[group];
+  }
+  out << "\n" << std::fixed << std::setprecision(2);
+
+  for (uint32_t c = 0; c <= FSM_NUM_CLASSES; c++) {
+    // The last row is the total over all classes
+    const bool total = c == FSM_NUM_CLASSES;
+    const FsmClass cls = static_cast<FsmClass>(c);
+    uint64_t count = total ? get_instructions() : instructions[cls];
+    uint64_t class_cycles = total ? get_cycles() : get_cycles(cls);
+    if (!total && class_cycles == 0) {
+      continue;
+    }
+    out << std::left << std::setw(17) << (total ? "total" : CLASS_NAMES[c])
+        << std::right << std::setw(10) << count << std::setw(12)
+        << class_cycles << std::setw(8) << cpi(class_cycles, count);
+    for (uint32_t g = 0; g < FSM_NUM_GROUPS; g++) {
+      uint64_t group_cycles = 0;
+      for (uint32_t other = 0; other < FSM_NUM_CLASSES; other++) {
+        if (total || other == c) {
+          group_cycles += get_group_cycles(static_cast<FsmClass>(other),
+                                           static_cast<FsmGroup>(g));
+        }
+      }
+      out << std::setw(12) << group_cycles;
+    }
+    out << "\n";
+  }
+  if (pending_cycles > 0) {
+    out << "in flight at the end: " << pending_cycles << " cycles\n";
+  }
+  return out.str();
+}
+
+std::string FsmProfile::format_json() const {
+  std::ostringstream out;
+  out << "{\n"
+      << "  \"instructions\": " << get_instructions() << ",\n"
+      << "  \"cycles\": " << get_cycles() << ",\n"
+      << "  \"in_flight_cycles\": " << pending_cycles << ",\n"
+      << "  \"states\": {";
+  for (uint32_t state = 0; state < FSM_NUM_STATES; state++) {
+    uint64_t total = pending[state];
+    for (uint32_t cls = 0; cls < FSM_NUM_CLASSES; cls++) {
+      total += cycles[cls][state];
+    }
+    out << (state ? ", " : "") << "\"" << FsmTiming::state_name(state)
+        << "\": " << total;
+  }
+  out << "},\n  \"classes\": [";
+
+  bool first = true;
+  for (uint32_t c = 0; c < FSM_NUM_CLASSES; c++) {
+    const FsmClass cls = static_cast<FsmClass>(c);
+    const uint64_t class_cycles = get_cycles(cls);
+    if (class_cycles == 0) {
+      continue;
+    }
+    char cpi_text[32];
+    std::snprintf(cpi_text, sizeof(cpi_text), "%.4f",
+                  cpi(class_cycles, instructions[c]));
+    out << (first ? "\n" : ",\n") << "    {\"class\": \"" << CLASS_NAMES[c]
+        << "\", \"instructions\": " << instructions[c]
+        << ", \"cycles\": " << class_cycles << ", \"cpi\": " << cpi_text
+        << ",\n     \"groups\": {";
+    for (uint32_t g = 0; g < FSM_NUM_GROUPS; g++) {
+      out << (g ? ", " : "") << "\"" << GROUP_NAMES[g]
+          << "\": " << get_group_cycles(cls, static_cast<FsmGroup>(g));
+    }
+    out << "},\n     \"states\": {";
+    bool first_state = true;
+    for (uint32_t state = 0; state < FSM_NUM_STATES; state++) {
+      if (cycles[c][state] == 0) {
+        continue;
+      }
+      out << (first_state ? "" : ", ") << "\""
+          << FsmTiming::state_name(state) << "\": " << cycles[c][state];
+      first_state = false;
+    }
+    out << "}}";
+    first = false;
+  }
+  out << "\n  ]\n}\n";
+  return out.str();
+}
+
+const char *FsmProfile::class_name(FsmClass cls) {
+  return cls < FSM_NUM_CLASSES ? CLASS_NAMES[cls] : "?";
+}
+
+const char *FsmProfile::group_name(FsmGroup group) {
+  return group < FSM_NUM_GROUPS ? GROUP_NAMES[group] : "?";
+}
+
+FsmGroup FsmProfile::group_of(FsmState state) {
+  switch (state) {
+  case FSM_FETCH_0:
+  case FSM_FETCH_2:
+  case FSM_FETCH_3:
+    return FSM_GROUP_FETCH;
+  case FSM_FETCH_1:
+    return FSM_GROUP_FETCH_WAIT;
+  case FSM_DECODE:
+    return FSM_GROUP_DECODE;
+  case FSM_LD_2:
+  case FSM_ST_3:
+    return FSM_GROUP_MEM_WAIT;
+  case FSM_PC_INC:
+    return FSM_GROUP_PC_INC;
+  default:
+    return FSM_GROUP_EXECUTE;
+  }
+}
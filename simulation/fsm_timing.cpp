@@ -0,0 +1,184 @@
+/*
+ * Control FSM Timing Model Implementation
+ */
+
+#include "include/fsm_timing.h"
+
+namespace {
+const char *const STATE_NAMES[FSM_NUM_STATES] = {
+    "FETCH_0",      "FETCH_1",      "FETCH_2",
+    "FETCH_3",      "DECODE",       "BRANCH_0",
+    "BRANCH_T",     "PC_INC",       "JAL_0",
+    "JAL_1",        "REG_REG",      "REG_IMM",
+    "LUI_0",        "AUIPC_0",      "JALR_0",
+    "JALR_1",       "LD_0",         "LD_1",
+    "LD_2",         "LD_3",         "LD_4",
+    "ST_0",         "ST_1",         "ST_2",
+    "ST_3",         "CSR_0",        "CSR_1",
+    "TRAP_ENTRY_0", "TRAP_ENTRY_1", "TRAP_ENTRY_2",
+    "TRAP_ENTRY_3", "TRAP_ENTRY_4", "MRET_0",
+    "FENCE_0",      "ERROR_INVALID_OPCODE", "ERROR_OPCODE_NOT_IMPLEMENTED"};
+} // namespace
+
+int csr_hpm_index(uint32_t addr) {
+  if ((addr & 0x1F) < 3) {
+    return -1;
+  }
+  switch (addr >> 5) {
+  case 0xB00 >> 5: // mhpmcounterN
+  case 0xB80 >> 5: // mhpmcounterNh
+  case 0xC00 >> 5: // hpmcounterN
+  case 0xC80 >> 5: // hpmcounterNh
+  case 0x320 >> 5: // mhpmeventN
+    return static_cast<int>(addr & 0x1F) - 3;
+  default:
+    return -1;
+  }
+}
+
+bool is_csr_address(uint32_t addr) {
+  if (csr_hpm_index(addr) >= 0) {
+    return true;
+  }
+  switch (addr) {
+  case 0xC00:
+  case 0xC01:
+  case 0xC02:
+  case 0xC80:
+  case 0xC81:
+  case 0xC82:
+  case 0x305:
+  case 0x341:
+  case 0x342:
+  case 0x343:
+  case 0x320: // mcountinhibit
+    return true;
+  default:
+    return false;
+  }
+}
+
+FsmTiming::FsmTiming(uint32_t delay) : memory_delay(delay), class_cycles() {
+  for (uint32_t cls = 0; cls < FSM_NUM_CLASSES; cls++) {
+    uint32_t total = 0;
+    for (const FsmPhase &phase : sequence(static_cast<FsmClass>(cls))) {
+      if (phase.cycles == 0) {
+        total = 0;
+        break;
+      }
+      total += phase.cycles;
+    }
+    class_cycles[cls] = total;
+  }
+}
+
+FsmClass FsmTiming::classify(uint32_t insn, bool branch_taken) {
+  const uint32_t funct3 = (insn >> 12) & 0x7;
+  switch (insn & 0x7F) {
+  case 0x37:
+    return FSM_CLASS_LUI;
+  case 0x17:
+    return FSM_CLASS_AUIPC;
+  case 0x6F:
+    return FSM_CLASS_JAL;
+  case 0x67:
+    return FSM_CLASS_JALR;
+  case 0x63: // funct3 2/3 fall through BRANCH_0 to PC_INC
+    return (branch_taken && funct3 != 2 && funct3 != 3)
+               ? FSM_CLASS_BRANCH_TAKEN
+               : FSM_CLASS_BRANCH_NOT_TAKEN;
+  case 0x03:
+    return FSM_CLASS_LOAD;
+  case 0x23:
+    return FSM_CLASS_STORE;
+  case 0x13:
+    return FSM_CLASS_REG_IMM;
+  case 0x33:
+    return FSM_CLASS_REG_REG;
+  case 0x0F:
+    return FSM_CLASS_FENCE;
+  case 0x73:
+    if (funct3 == 0) {
+      return (insn >> 20) == 0x302 ? FSM_CLASS_MRET : FSM_CLASS_TRAP;
+    }
+    return is_csr_address(insn >> 20) ? FSM_CLASS_CSR : FSM_CLASS_HALT;
+  default:
+    return FSM_CLASS_HALT;
+  }
+}
+
+std::vector<FsmPhase> FsmTiming::sequence(FsmClass cls) const {
+  const uint32_t d = memory_delay;
+  std::vector<FsmPhase> phases = {{FSM_FETCH_0, 1},
+                                  {FSM_FETCH_1, d + 1},
+                                  {FSM_FETCH_2, 1},
+                                  {FSM_FETCH_3, 1},
+                                  {FSM_DECODE, 1}};
+
+  switch (cls) {
+  case FSM_CLASS_LUI:
+    phases.insert(phases.end(), {{FSM_LUI_0, 1}, {FSM_PC_INC, 1}});
+    break;
+  case FSM_CLASS_AUIPC:
+    phases.insert(phases.end(), {{FSM_AUIPC_0, 1}, {FSM_PC_INC, 1}});
+    break;
+  case FSM_CLASS_JAL:
+    phases.insert(phases.end(), {{FSM_JAL_0, 1}, {FSM_JAL_1, 1}});
+    break;
+  case FSM_CLASS_JALR:
+    phases.insert(phases.end(), {{FSM_JALR_0, 1}, {FSM_JALR_1, 1}});
+    break;
+  case FSM_CLASS_BRANCH_TAKEN:
+    phases.insert(phases.end(), {{FSM_BRANCH_0, 1}, {FSM_BRANCH_T, 1}});
+    break;
+  case FSM_CLASS_BRANCH_NOT_TAKEN:
+    phases.insert(phases.end(), {{FSM_BRANCH_0, 1}, {FSM_PC_INC, 1}});
+    break;
+  case FSM_CLASS_REG_IMM:
+    phases.insert(phases.end(), {{FSM_REG_IMM, 1}, {FSM_PC_INC, 1}});
+    break;
+  case FSM_CLASS_REG_REG:
+    phases.insert(phases.end(), {{FSM_REG_REG, 1}, {FSM_PC_INC, 1}});
+    break;
+  case FSM_CLASS_FENCE:
+    phases.insert(phases.end(), {{FSM_FENCE_0, 1}, {FSM_PC_INC, 1}});
+    break;
+  case FSM_CLASS_LOAD:
+    phases.insert(phases.end(), {{FSM_LD_0, 1},
+                                 {FSM_LD_1, 1},
+                                 {FSM_LD_2, d},
+                                 {FSM_LD_3, 1},
+                                 {FSM_LD_4, 1},
+                                 {FSM_PC_INC, 1}});
+    break;
+  case FSM_CLASS_STORE:
+    phases.insert(phases.end(), {{FSM_ST_0, 1},
+                                 {FSM_ST_1, 1},
+                                 {FSM_ST_2, 1},
+                                 {FSM_ST_3, d},
+                                 {FSM_PC_INC, 1}});
+    break;
+  case FSM_CLASS_CSR:
+    phases.insert(phases.end(),
+                  {{FSM_CSR_0, 1}, {FSM_CSR_1, 1}, {FSM_PC_INC, 1}});
+    break;
+  case FSM_CLASS_TRAP:
+    phases.insert(phases.end(), {{FSM_TRAP_ENTRY_0, 1},
+                                 {FSM_TRAP_ENTRY_1, 1},
+                                 {FSM_TRAP_ENTRY_2, 1},
+                                 {FSM_TRAP_ENTRY_3, 1},
+                                 {FSM_TRAP_ENTRY_4, 1}});
+    break;
+  case FSM_CLASS_MRET:
+    phases.push_back({FSM_MRET_0, 1});
+    break;
+  default: // An invalid CSR address passes CSR_0 first; either way it stops
+    phases.push_back({FSM_ERROR_OPCODE_NOT_IMPLEMENTED, 0});
+    break;
+  }
+  return phases;
+}
+
+const char *FsmTiming::state_name(uint32_t state) {
+  return state < FSM_NUM_STATES ? STATE_NAMES[state] : "?";
+}
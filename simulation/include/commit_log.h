@@ -0,0 +1,158 @@
+/*
+ * Instruction Commit Log
+ *
+ * Compact record of every instruction the RTL retires, for runs far too
+ * long for a VCD. Each retired instruction becomes one fixed-size
+ * CommitRecord: cycle, PC, instruction word, register write, and the
+ * load/store address and data.
+ *
+ * CommitLogWriter fills one of two buffers on the simulation thread and
+ * hands each full buffer to a background thread, which compresses it into
+ * a gzip file (zlib, level 1). The simulation thread only copies records
+ * and waits only if the writer falls a whole buffer behind.
+ *
+ * File format (the whole file is one gzip stream, so zcat works):
+ *   CommitLogHeader: magic "RVCL", version, record size
+ *   CommitRecord[]:  host byte order (little-endian on every supported host)
+ *
+ * CommitLogReader reads a log back; format_spike() prints a record the way
+ * spike --log-commits does, so logs can be diffed against Spike's.
+ *
+ * Usage Example:
+ *   CommitLogWriter writer;
+ *   writer.open("add.commits.gz");
+ *   writer.append(record);        // Once per retired instruction
+ *   writer.close();
+ *
+ *   CommitLogReader reader;
+ *   reader.open("add.commits.gz");
+ *   CommitRecord record;
+ *   while (reader.next(record)) {
+ *     std::cout << format_spike(record) << "\n";
+ *   }
+ */
+
+#ifndef COMMIT_LOG_H
+#define COMMIT_LOG_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct gzFile_s;
+
+constexpr uint32_t COMMIT_LOG_MAGIC = 0x4C435652; // "RVCL"
+constexpr uint32_t COMMIT_LOG_VERSION = 1;
+
+// CommitRecord::flags
+constexpr uint8_t COMMIT_RD_WRITE = 0x1; // rd/rd_value valid
+constexpr uint8_t COMMIT_LOAD = 0x2;     // mem_* describe a load
+constexpr uint8_t COMMIT_STORE = 0x4;    // mem_* describe a store
+
+struct CommitRecord {
+  uint64_t cycle;    // Cycle CSR when the instruction retired
+  uint32_t pc;
+  uint32_t insn;
+  uint32_t rd_value;
+  uint32_t mem_addr; // Byte address of the access
+  uint32_t mem_data; // Bytes loaded or stored, zero-extended
+  uint8_t rd;
+  uint8_t flags;
+  uint8_t mem_size; // 1, 2 or 4 bytes
+  uint8_t reserved;
+};
+static_assert(sizeof(CommitRecord) == 32, "CommitRecord is an on-disk format");
+
+struct CommitLogHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t record_size;
+  uint32_t reserved;
+};
+
+// Destination register of an instruction that writes one (LUI, AUIPC, JAL,
+// JALR, loads, OP-IMM, OP, CSR), else 0
+uint32_t commit_dest_reg(uint32_t insn);
+
+// Access size in bytes of a load or store, else 0
+uint32_t commit_access_size(uint32_t insn);
+
+// One line in spike --log-commits format (machine mode, hart 0)
+std::string format_spike(const CommitRecord &record);
+
+class CommitLogWriter {
+public:
+  // Records per buffer (2 MB)
+  static constexpr size_t BUFFER_RECORDS = 1 << 16;
+
+  CommitLogWriter();
+  ~CommitLogWriter(); // Closes the log
+
+  CommitLogWriter(const CommitLogWriter &) = delete;
+  CommitLogWriter &operator=(const CommitLogWriter &) = delete;
+
+  // Create the file, write the header and start the writer thread
+  bool open(const std::string &path);
+
+  void append(const CommitRecord &record) {
+    buffers[active][fill++] = record;
+    if (fill == BUFFER_RECORDS) {
+      hand_off();
+    }
+  }
+
+  // Write what is buffered, stop the thread and close the file; false if
+  // any write failed
+  bool close();
+
+  bool is_open() const { return file != nullptr; }
+  uint64_t get_records() const { return records + fill; }
+
+private:
+  gzFile_s *file;
+  std::vector<CommitRecord> buffers[2];
+  size_t active; // Buffer being filled
+  size_t fill;
+  uint64_t records; // Handed off so far
+
+  // Writer thread hand-off
+  std::thread worker;
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool pending; // buffers[pending_buffer] waits to be written
+  size_t pending_buffer;
+  size_t pending_count;
+  bool stop;
+  bool failed;
+
+  void hand_off();
+  void worker_loop();
+};
+
+class CommitLogReader {
+public:
+  CommitLogReader();
+  ~CommitLogReader();
+
+  CommitLogReader(const CommitLogReader &) = delete;
+  CommitLogReader &operator=(const CommitLogReader &) = delete;
+
+  // Open a log and check its header; get_error() says why on failure
+  bool open(const std::string &path);
+
+  // Next record; false at the end of the log or on a read error
+  bool next(CommitRecord &record);
+
+  const std::string &get_error() const { return error; }
+
+private:
+  gzFile_s *file;
+  std::vector<CommitRecord> buffer;
+  size_t position;
+  std::string error;
+};
+
+#endif // COMMIT_LOG_H
@@ -0,0 +1,143 @@
+/*
+ * Lockstep Co-Simulation Checker
+ *
+ * Compares every instruction the RTL retires against Rv32iIss. The RTL
+ * side (TestRunner) sends one CosimCommit per retired instruction through
+ * a lock-free SPSC queue; a checker thread steps the ISS one instruction
+ * per commit on its own copy of the program and compares the outcome. The
+ * RTL thread only copies a few words per instruction and never waits for
+ * the ISS unless the queue fills up.
+ *
+ * Each commit carries the architectural effect of one instruction:
+ *   - the PC after it (the next instruction to fetch)
+ *   - the register it changed (writes of an unchanged value are invisible
+ *     on both sides), and how many registers changed
+ *   - the bus store it made, if any (address, data, byte enables)
+ *   - mtvec/mepc/mcause/mtval after it
+ *
+ * The first commit that differs is reported with the instructions leading
+ * up to it; later commits are drained without checking.
+ *
+ * Usage Example (TestRunner does this when TestRunnerConfig::cosim is set):
+ *   CosimChecker checker(memory_size);
+ *   checker.load_program(path);
+ *   checker.start();
+ *   checker.push(commit);         // Once per retired instruction
+ *   checker.drain();              // Wait for the ISS to catch up
+ *   if (checker.has_mismatch()) { ... checker.get_report() ... }
+ */
+
+#ifndef COSIM_H
+#define COSIM_H
+
+#include "../memory_model.h"
+#include "rv32i_iss.h"
+#include "sim_log.h"
+#include "spsc_queue.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Architectural effect of one retired instruction
+struct CosimCommit {
+  uint64_t index = 0;   // Instructions retired before this one
+  uint32_t pc = 0;      // Address of the instruction (filled in by the ISS)
+  uint32_t insn = 0;    // Instruction word (filled in by the ISS)
+  uint32_t next_pc = 0;
+  uint8_t rd = 0;          // Lowest register that changed (0 if none)
+  uint8_t reg_changes = 0; // Number of registers that changed
+  uint32_t rd_value = 0;
+  bool store = false;
+  uint32_t store_addr = 0; // Word-aligned bus address
+  uint32_t store_data = 0; // Bus data; only enabled bytes are compared
+  uint8_t store_be = 0;
+  uint32_t mtvec = 0;
+  uint32_t mepc = 0;
+  uint32_t mcause = 0;
+  uint32_t mtval = 0;
+  bool halt = false; // Reference only: the core stops on this instruction
+};
+
+class CosimChecker {
+public:
+  // Commits in flight before push() waits for the checker
+  static constexpr size_t QUEUE_CAPACITY = 4096;
+  // Instructions shown before a mismatch
+  static constexpr size_t CONTEXT_INSNS = 8;
+
+  explicit CosimChecker(uint32_t memory_size);
+  ~CosimChecker(); // Stops the checker thread
+
+  CosimChecker(const CosimChecker &) = delete;
+  CosimChecker &operator=(const CosimChecker &) = delete;
+
+  // Load the program the RTL runs into the reference model's memory
+  bool load_program(const std::string &program_file);
+
+  // Start the checker thread (once, before the first push)
+  void start();
+
+  // RTL side: queue one retired instruction (spins while the queue is full)
+  void push(const CosimCommit &commit);
+
+  // Wait until every pushed commit has been checked
+  void drain();
+
+  // Step the reference over instructions the RTL did not execute itself
+  // (TestRunner::run_functional). Call after drain(), before the next push.
+  // Returns the number the reference retired
+  uint64_t skip(uint64_t instructions);
+
+  // True once a commit differed from the reference (safe from any thread)
+  bool has_mismatch() const {
+    return mismatch.load(std::memory_order_acquire);
+  }
+
+  // Mismatch description and context, one line per entry (valid once
+  // has_mismatch() is true)
+  const std::vector<std::string> &get_report() const { return report; }
+
+  uint64_t get_pushed() const { return pushed; }
+  uint64_t get_checked() const {
+    return checked.load(std::memory_order_acquire);
+  }
+  Rv32iIss &get_iss() { return *iss; }
+
+private:
+  // Reference model (owned by the checker thread once started)
+  LogSink iss_log;
+  MemoryModel memory;
+  std::unique_ptr<Rv32iIss> iss;
+  int store_watch;
+  bool store_seen;
+  uint32_t store_addr;
+  uint32_t store_data;
+  uint8_t store_be;
+  uint32_t iss_regs[32];
+
+  // Queue and thread state
+  SpscQueue<CosimCommit> queue;
+  std::thread worker;
+  std::atomic<bool> stop;
+  std::atomic<bool> mismatch;
+  std::atomic<uint64_t> checked;
+  uint64_t pushed; // RTL thread only
+
+  // Recent (RTL, ISS) pairs for the report
+  std::deque<std::pair<CosimCommit, CosimCommit>> history;
+  std::vector<std::string> report;
+
+  // Helper functions
+  void worker_loop();
+  void check(const CosimCommit &rtl);
+  CosimCommit step_reference(const CosimCommit &rtl);
+  std::string describe_difference(const CosimCommit &rtl,
+                                  const CosimCommit &ref) const;
+  static std::string format_commit(const CosimCommit &commit);
+};
+
+#endif // COSIM_H
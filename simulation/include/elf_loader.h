@@ -0,0 +1,108 @@
+/*
+ * ELF32 Program Loader for RISC-V Core Verification
+ *
+ * Loads RV32 ELF executables into the MemoryModel the way a boot ROM or
+ * debugger would: only PT_LOAD segments are copied, each at its physical
+ * address (p_paddr), and the gap between p_filesz and p_memsz (.bss) is
+ * zero-filled. The ELF header, section headers, symbol table and string
+ * table never land in simulated memory.
+ *
+ * Features:
+ *   - Binary .elf files (memory-mapped when large)
+ *   - Legacy .ini files (the ELF dumped as space-separated hex bytes)
+ *   - Flat fallback: a hex image that is not an ELF is copied to address 0
+ *   - Entry point and symbol table lookup (e.g. tohost, begin_signature)
+ *
+ * Usage Example:
+ *   ElfImage image;
+ *   if (image.load_file(get_test_program_path("add")) &&
+ *       image.load_into(memory)) {
+ *     uint32_t tohost;
+ *     bool has_tohost = image.find_symbol("tohost", tohost);
+ *   }
+ */
+
+#ifndef ELF_LOADER_H
+#define ELF_LOADER_H
+
+#include "../memory_model.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Symbol table entry
+struct ElfSymbol {
+  uint32_t value;
+  uint32_t size;
+  uint8_t type; // STT_* (0 = NOTYPE, 1 = OBJECT, 2 = FUNC)
+};
+
+// Loadable segment (PT_LOAD program header)
+struct ElfSegment {
+  uint32_t paddr;
+  uint32_t file_offset;
+  uint32_t file_size;
+  uint32_t mem_size;
+};
+
+class ElfImage {
+public:
+  // Files at least this large are mapped instead of read
+  static constexpr size_t MMAP_THRESHOLD = 256 * 1024;
+
+  ElfImage();
+  ~ElfImage();
+
+  ElfImage(const ElfImage &) = delete;
+  ElfImage &operator=(const ElfImage &) = delete;
+
+  // Read and parse a program file (.elf or hex-text .ini)
+  // Returns true on success, false on failure (see get_error())
+  bool load_file(const std::string &filename);
+
+  // Copy the loadable contents into memory
+  // Returns true on success, false if nothing is loaded
+  bool load_into(MemoryModel &memory) const;
+
+  // Accessors
+  bool is_elf() const { return elf; }
+  uint32_t get_entry_point() const { return entry_point; }
+  size_t get_image_size() const { return size; }
+  const std::vector<ElfSegment> &get_segments() const { return segments; }
+  const std::map<std::string, ElfSymbol> &get_symbols() const {
+    return symbols;
+  }
+  const std::string &get_error() const { return error; }
+
+  // Symbol lookup - returns false if the symbol is not defined
+  bool find_symbol(const std::string &name, uint32_t &value) const;
+
+private:
+  // Image bytes - either owned, or a read-only mapping of the file
+  std::vector<uint8_t> buffer;
+  const uint8_t *data;
+  size_t size;
+  void *mapping;
+  size_t mapping_size;
+
+  // Parsed contents
+  bool elf;
+  uint32_t entry_point;
+  std::vector<ElfSegment> segments;
+  std::map<std::string, ElfSymbol> symbols;
+  std::string error;
+
+  // Helper functions
+  void release();
+  bool read_binary(const std::string &filename);
+  bool read_hex_text(const std::string &filename);
+  bool parse_elf();
+  void parse_symbols(uint32_t shoff, uint32_t shentsize, uint32_t shnum);
+  uint16_t read16(size_t offset) const;
+  uint32_t read32(size_t offset) const;
+  bool fail(const std::string &message);
+};
+
+#endif // ELF_LOADER_H
@@ -0,0 +1,107 @@
+/*
+ * Control FSM Occupancy Profile
+ *
+ * Measured breakdown of where an RTL run's cycles go: cycles spent in each
+ * control.sv state, grouped by the class of the instruction being executed
+ * (the execute path FsmTiming::classify() gives for the IR, so taken and
+ * not-taken branches are separate rows).
+ *
+ * TestRunner feeds the profile from run() (TestRunnerConfig::
+ * fsm_profile_file, RTL builds): before every step it reads
+ * u_control.state, adds the cycles the step advanced to that state, and
+ * when the FSM is back in FETCH_0 hands the finished instruction's cycles
+ * to its class, read from the IR (which only changes in FETCH_3). Cycles
+ * of an instruction still in flight when the run ends are kept apart, so
+ * every class row covers whole instructions and can be compared with
+ * FsmTiming.
+ *
+ * States are also summed into groups that match the questions usually
+ * asked of the table:
+ *   fetch      FETCH_0 FETCH_2 FETCH_3
+ *   fetch_wait FETCH_1
+ *   decode     DECODE
+ *   execute    every other state
+ *   mem_wait   LD_2 ST_3
+ *   pc_inc     PC_INC
+ *
+ * Usage Example:
+ *   FsmProfile profile;
+ *   profile.add(FSM_FETCH_1, 5);          // Cycles in one state
+ *   if (profile.instruction_done(state)) {
+ *     profile.retire(insn);               // Back in FETCH_0
+ *   }
+ *   std::cout << profile.format_table();
+ *   std::ofstream("add.fsm.json") << profile.format_json();
+ */
+
+#ifndef FSM_PROFILE_H
+#define FSM_PROFILE_H
+
+#include "fsm_timing.h"
+#include <cstdint>
+#include <string>
+
+// State groups of the profile table
+enum FsmGroup : uint8_t {
+  FSM_GROUP_FETCH,
+  FSM_GROUP_FETCH_WAIT,
+  FSM_GROUP_DECODE,
+  FSM_GROUP_EXECUTE,
+  FSM_GROUP_MEM_WAIT,
+  FSM_GROUP_PC_INC,
+  FSM_NUM_GROUPS
+};
+
+class FsmProfile {
+public:
+  FsmProfile();
+
+  // Cycles spent in state by the instruction being executed
+  void add(uint32_t state, uint64_t cycles) {
+    if (state >= FSM_NUM_STATES) {
+      state = FSM_ERROR_INVALID_OPCODE;
+    }
+    pending[state] += cycles;
+    pending_cycles += cycles;
+  }
+
+  // True when the FSM has come back to FETCH_0 with an instruction's
+  // cycles pending; retire() then attributes them
+  bool instruction_done(uint32_t state) const {
+    return state == FSM_FETCH_0 && pending_cycles > 0;
+  }
+  void retire(uint32_t insn);
+
+  void reset();
+
+  // Totals over whole instructions
+  uint64_t get_instructions() const;
+  uint64_t get_cycles() const;
+  uint64_t get_instructions(FsmClass cls) const { return instructions[cls]; }
+  uint64_t get_cycles(FsmClass cls) const;
+  uint64_t get_cycles(FsmClass cls, FsmState state) const {
+    return cycles[cls][state];
+  }
+  uint64_t get_group_cycles(FsmClass cls, FsmGroup group) const;
+  // Cycles of the instruction in flight (not in any class)
+  uint64_t get_in_flight_cycles() const { return pending_cycles; }
+
+  // One row per class that ran: instructions, cycles, CPI, state groups
+  std::string format_table() const;
+  // Totals, per-state cycles and one object per class with its groups and
+  // (non-zero) states
+  std::string format_json() const;
+
+  // Lower-case name of a class ("load", "branch_taken", ...) and group
+  static const char *class_name(FsmClass cls);
+  static const char *group_name(FsmGroup group);
+  static FsmGroup group_of(FsmState state);
+
+private:
+  uint64_t cycles[FSM_NUM_CLASSES][FSM_NUM_STATES];
+  uint64_t instructions[FSM_NUM_CLASSES];
+  uint64_t pending[FSM_NUM_STATES];
+  uint64_t pending_cycles;
+};
+
+#endif // FSM_PROFILE_H
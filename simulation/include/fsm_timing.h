@@ -0,0 +1,189 @@
+/*
+ * Control FSM Timing Model
+ *
+ * Cycle-accurate model of core_top's timing. The core has no pipeline:
+ * every instruction walks the control.sv FSM from FETCH_0, and the only
+ * variable-length states are the memory waits, so the state sequence and
+ * cycle count of an instruction follow from its opcode, whether a branch
+ * is taken and the MemoryModel latency d.
+ *
+ * Per-instruction sequences (cycles in brackets where not 1):
+ *   fetch    FETCH_0 FETCH_1[d+1] FETCH_2 FETCH_3 DECODE      d+5
+ *   LUI      + LUI_0 PC_INC                                   d+7
+ *   AUIPC    + AUIPC_0 PC_INC                                 d+7
+ *   JAL      + JAL_0 JAL_1                                    d+7
+ *   JALR     + JALR_0 JALR_1                                  d+7
+ *   branch   + BRANCH_0 (BRANCH_T | PC_INC)                   d+7
+ *   OP-IMM   + REG_IMM PC_INC                                 d+7
+ *   OP       + REG_REG PC_INC                                 d+7
+ *   FENCE    + FENCE_0 PC_INC                                 d+7
+ *   load     + LD_0 LD_1 LD_2[d] LD_3 LD_4 PC_INC            2d+10
+ *   store    + ST_0 ST_1 ST_2 ST_3[d] PC_INC                 2d+9
+ *   CSR      + CSR_0 CSR_1 PC_INC                             d+8
+ *   ECALL    + TRAP_ENTRY_0..4                                d+10
+ *   MRET     + MRET_0                                         d+6
+ *
+ * FETCH_1 asserts mem_read while it waits, so the request only reaches the
+ * memory model one edge after the state is entered; LD_1/ST_2 issue theirs
+ * before LD_2/ST_3. An unknown opcode or CSR address ends in
+ * ERROR_OPCODE_NOT_IMPLEMENTED, which the core never leaves. The model
+ * needs d >= 1 (MemoryModel never answers with a delay of 0).
+ *
+ * The cycle CSR counts from reset, so an instruction starting at cycle T
+ * reads T + d + 6 from cycle/time in CSR_1.
+ *
+ * The csr_file.sv performance counters count control.sv events (HpmEvent):
+ * the FETCH_1, LD_2 and ST_3 cycles, and one BRANCH_T, JAL_1/JALR_1,
+ * TRAP_ENTRY_0, CSR_1, LD_0 or ST_0 per instruction. A CSR instruction's
+ * own CSR event lands after its CSR_1 read.
+ *
+ * Usage Example:
+ *   FsmTiming timing(4);                              // Memory delay
+ *   uint32_t cycles = timing.cycles(0x00a00093);      // addi: 11
+ *   for (const FsmPhase &phase : timing.sequence(insn, taken)) {
+ *     std::cout << FsmTiming::state_name(phase.state) << " x"
+ *               << phase.cycles << "\n";
+ *   }
+ */
+
+#ifndef FSM_TIMING_H
+#define FSM_TIMING_H
+
+#include <cstdint>
+#include <vector>
+
+// Control FSM states (enum order in control.sv)
+enum FsmState : uint8_t {
+  FSM_FETCH_0,
+  FSM_FETCH_1,
+  FSM_FETCH_2,
+  FSM_FETCH_3,
+  FSM_DECODE,
+  FSM_BRANCH_0,
+  FSM_BRANCH_T,
+  FSM_PC_INC,
+  FSM_JAL_0,
+  FSM_JAL_1,
+  FSM_REG_REG,
+  FSM_REG_IMM,
+  FSM_LUI_0,
+  FSM_AUIPC_0,
+  FSM_JALR_0,
+  FSM_JALR_1,
+  FSM_LD_0,
+  FSM_LD_1,
+  FSM_LD_2,
+  FSM_LD_3,
+  FSM_LD_4,
+  FSM_ST_0,
+  FSM_ST_1,
+  FSM_ST_2,
+  FSM_ST_3,
+  FSM_CSR_0,
+  FSM_CSR_1,
+  FSM_TRAP_ENTRY_0,
+  FSM_TRAP_ENTRY_1,
+  FSM_TRAP_ENTRY_2,
+  FSM_TRAP_ENTRY_3,
+  FSM_TRAP_ENTRY_4,
+  FSM_MRET_0,
+  FSM_FENCE_0,
+  FSM_ERROR_INVALID_OPCODE,
+  FSM_ERROR_OPCODE_NOT_IMPLEMENTED,
+  FSM_NUM_STATES
+};
+
+// Execute paths out of DECODE, which decide an instruction's timing
+enum FsmClass : uint8_t {
+  FSM_CLASS_LUI,
+  FSM_CLASS_AUIPC,
+  FSM_CLASS_JAL,
+  FSM_CLASS_JALR,
+  FSM_CLASS_BRANCH_TAKEN,
+  FSM_CLASS_BRANCH_NOT_TAKEN,
+  FSM_CLASS_REG_IMM,
+  FSM_CLASS_REG_REG,
+  FSM_CLASS_FENCE,
+  FSM_CLASS_LOAD,
+  FSM_CLASS_STORE,
+  FSM_CLASS_CSR,
+  FSM_CLASS_TRAP,
+  FSM_CLASS_MRET,
+  FSM_CLASS_HALT, // Unknown opcode or CSR address: the core stops
+  FSM_NUM_CLASSES
+};
+
+// mhpmevent values (hpm_event_t in datatypes.sv)
+enum HpmEvent : uint8_t {
+  HPM_EVENT_NONE,
+  HPM_EVENT_FETCH_WAIT,
+  HPM_EVENT_LOAD_WAIT,
+  HPM_EVENT_STORE_WAIT,
+  HPM_EVENT_BRANCH_TAKEN,
+  HPM_EVENT_JUMP,
+  HPM_EVENT_TRAP,
+  HPM_EVENT_CSR,
+  HPM_EVENT_LOAD_BYTE,
+  HPM_EVENT_LOAD_HALF,
+  HPM_EVENT_LOAD_WORD,
+  HPM_EVENT_STORE_BYTE,
+  HPM_EVENT_STORE_HALF,
+  HPM_EVENT_STORE_WORD,
+  HPM_NUM_EVENTS
+};
+
+// mhpmcounter3 onwards in csr_file.sv (core_top's HPM_COUNTERS default;
+// rtl_backdoor.cpp checks it against the verilated model)
+constexpr uint32_t HPM_COUNTERS = 4;
+
+// csr_file address decode (csr_valid), shared by the timing model and the
+// ISS. csr_hpm_index gives the performance counter (mhpmcounter3 is 0) of
+// an [m]hpmcounter[h] or mhpmevent address and -1 for other addresses;
+// counters 3-31 all decode, implemented or not
+int csr_hpm_index(uint32_t addr);
+bool is_csr_address(uint32_t addr);
+
+// A run of cycles in one state; cycles == 0 means the core stays there
+struct FsmPhase {
+  FsmState state;
+  uint32_t cycles;
+};
+
+class FsmTiming {
+public:
+  explicit FsmTiming(uint32_t memory_delay);
+
+  // Execute path the FSM takes for an instruction word
+  static FsmClass classify(uint32_t insn, bool branch_taken);
+
+  // States from FETCH_0 up to (not including) the next FETCH_0
+  std::vector<FsmPhase> sequence(FsmClass cls) const;
+  std::vector<FsmPhase> sequence(uint32_t insn, bool branch_taken) const {
+    return sequence(classify(insn, branch_taken));
+  }
+
+  // Cycles from FETCH_0 to the next FETCH_0 (0 for FSM_CLASS_HALT)
+  uint32_t cycles(FsmClass cls) const { return class_cycles[cls]; }
+  uint32_t cycles(uint32_t insn, bool branch_taken = false) const {
+    return class_cycles[classify(insn, branch_taken)];
+  }
+
+  // Cycles from a store's FETCH_0 to the edge that makes its bus write
+  // (a TestRunner run ends there on the magic address write)
+  uint32_t store_write_cycle() const { return 2 * memory_delay + 8; }
+
+  // Cycles from a CSR instruction's FETCH_0 to CSR_1, which writes the CSR
+  // value read in that cycle to rd
+  uint32_t csr_read_cycle() const { return memory_delay + 6; }
+
+  uint32_t get_memory_delay() const { return memory_delay; }
+
+  // control.sv name of a state ("?" if out of range)
+  static const char *state_name(uint32_t state);
+
+private:
+  uint32_t memory_delay;
+  uint32_t class_cycles[FSM_NUM_CLASSES];
+};
+
+#endif // FSM_TIMING_H
@@ -0,0 +1,171 @@
+/*
+ * Memory Access Statistics
+ *
+ * Breaks the bus traffic MemoryModel serves down for cache and scratchpad
+ * sizing:
+ *   - Per 4KB page and per named address region: instruction fetches, data
+ *     reads and data writes, and how many of the data accesses were
+ *     sub-word (byte enables other than 0xF)
+ *   - Byte-enable patterns of all data reads and writes (byte, halfword and
+ *     word lanes), to see whether byte-granular loops (e.g. a byte-wise
+ *     memcpy) dominate the traffic
+ *   - Reuse distance: for each access, the number of distinct lines touched
+ *     since the last access to its line (LRU stack distance). An access
+ *     hits in a fully associative LRU cache of N lines exactly when its
+ *     distance is below N, so the histogram gives the hit ratio of every
+ *     cache size at once. Kept for fetches, data and both together
+ *   - A heatmap: accesses per page in consecutive windows of window_cycles
+ *     clock cycles
+ *
+ * Addresses are bus addresses (the magic region counts at 0xDEAD0000).
+ * Time is the clock edges the owning model has seen since the last reset().
+ *
+ * Usage Example:
+ *   MemoryStats stats(1000, 32);         // 1000-cycle windows, 32B lines
+ *   stats.add_region("rom", 0x1000, 0x1000);
+ *   stats.advance(1);                    // Each rising edge
+ *   stats.record(0x1000, MemoryStats::FETCH, 0xF);
+ *   stats.record(0x2001, MemoryStats::WRITE, 0x2);
+ *   std::cout << stats.format_table();
+ */
+
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Access counts of one page or region
+struct MemoryAccessCounts {
+  uint64_t fetches = 0;
+  uint64_t reads = 0;          // Data reads
+  uint64_t writes = 0;         // Data writes
+  uint64_t subword_reads = 0;  // Data reads with byte enables != 0xF
+  uint64_t subword_writes = 0; // Data writes with byte enables != 0xF
+
+  uint64_t accesses() const { return fetches + reads + writes; }
+};
+
+// A named address range and its counts
+struct MemoryRegionStats {
+  std::string name;
+  uint32_t start = 0;
+  uint64_t end = 0; // Exclusive
+  MemoryAccessCounts counts;
+};
+
+// Reuse distance histogram of one access stream
+struct MemoryReuseHistogram {
+  // buckets[0]: distance 0; buckets[k]: distances in [2^(k-1), 2^k)
+  static constexpr uint32_t BUCKETS = 33;
+  uint64_t buckets[BUCKETS] = {};
+  uint64_t cold = 0; // First access to a line
+
+  uint64_t accesses() const;
+  // Accesses that hit in a fully associative LRU cache of 2^k lines
+  uint64_t hits(uint32_t k) const;
+};
+
+class MemoryStats {
+public:
+  enum Access { FETCH, READ, WRITE };
+  enum Stream { STREAM_FETCH, STREAM_DATA, STREAM_ALL, NUM_STREAMS };
+
+  static constexpr uint32_t PAGE_SHIFT = 12;
+
+  // window_cycles: heatmap resolution; line_bytes: reuse granularity
+  // (rounded down to a power of two, at least 4)
+  explicit MemoryStats(uint64_t window_cycles = 10000,
+                       uint32_t line_bytes = 32);
+
+  // Name [start, start + size); an access counts in the first region
+  // containing it, or in "other"
+  void add_region(const std::string &name, uint32_t start, uint32_t size);
+  size_t get_region_count() const { return regions.size(); }
+
+  // Time
+  void advance(uint64_t cycles) {
+    if (ignored_cycles >= cycles) {
+      ignored_cycles -= cycles;
+      return;
+    }
+    now += cycles - ignored_cycles;
+    ignored_cycles = 0;
+  }
+  // The next cycles clock edges repeat ones already counted (a rewind to a
+  // snapshot): they advance no time and their accesses are not recorded
+  void ignore_cycles(uint64_t cycles) { ignored_cycles = cycles; }
+
+  // One bus transaction (byte enables are ignored for fetches)
+  void record(uint32_t addr, Access access, uint8_t byte_enables);
+
+  // Clear all counts and restart time at 0 (keeps regions and settings)
+  void reset();
+
+  // Accessors
+  uint64_t get_window_cycles() const { return window_cycles; }
+  uint32_t get_line_bytes() const { return line_bytes; }
+  uint64_t get_cycles() const { return now; }
+  const MemoryAccessCounts &get_totals() const { return totals; }
+  // Configured regions in order, then "other"
+  std::vector<MemoryRegionStats> get_regions() const;
+  // Touched pages by base address
+  const std::map<uint32_t, MemoryAccessCounts> &get_pages() const {
+    return pages;
+  }
+  // Data accesses per byte-enable pattern
+  const uint64_t *get_read_enables() const { return read_enables; }
+  const uint64_t *get_write_enables() const { return write_enables; }
+  const MemoryReuseHistogram &get_reuse(Stream stream) const {
+    return reuse[stream].histogram;
+  }
+  // Heatmap: windows so far, and a page's accesses in one of them
+  size_t get_window_count() const;
+  uint64_t get_window_accesses(size_t window, uint32_t page_addr) const;
+
+  // Per-region, byte-enable and reuse summary
+  std::string format_table() const;
+  // Everything, including the per-page counts and the heatmap
+  std::string format_json() const;
+
+private:
+  // LRU stack distances (Olken): a Fenwick tree over access times marks
+  // each line's latest access, so the distance is the number of marks
+  // after it. Times are renumbered when the tree is full
+  struct ReuseTracker {
+    std::unordered_map<uint32_t, uint32_t> last; // Line -> time
+    std::vector<uint32_t> tree;                  // 1-based Fenwick tree
+    uint32_t time = 0;
+    MemoryReuseHistogram histogram;
+
+    void access(uint32_t line);
+    void clear();
+    void mark(uint32_t t, int32_t delta);
+    uint32_t count_before(uint32_t t) const; // Marks at times < t
+    void compact();
+  };
+
+  uint64_t window_cycles;
+  uint32_t line_bytes;
+  uint32_t line_shift;
+  uint64_t now;
+  uint64_t ignored_cycles;
+
+  MemoryAccessCounts totals;
+  std::vector<MemoryRegionStats> regions;
+  MemoryAccessCounts other;
+  std::map<uint32_t, MemoryAccessCounts> pages;
+  uint32_t last_page; // Lookup cache (last_counts nullptr if none)
+  MemoryAccessCounts *last_counts;
+  uint64_t read_enables[16];
+  uint64_t write_enables[16];
+  ReuseTracker reuse[NUM_STREAMS];
+  std::vector<std::map<uint32_t, uint64_t>> windows; // Page -> accesses
+
+  MemoryAccessCounts &page_counts(uint32_t page_addr);
+};
+
+#endif // MEMORY_STATS_H
@@ -0,0 +1,53 @@
+/*
+ * Parallel Simulation Runner
+ *
+ * Runs independent (program, config) jobs on a pool of worker threads. Each
+ * job gets its own TestRunner, and with it its own VerilatedContext, DUT and
+ * MemoryModel, so jobs share no simulator state. Latency and parameter
+ * sweeps are embarrassingly parallel and scale with the number of cores.
+ *
+ * Usage Example:
+ *   std::vector<SimJob> jobs;
+ *   for (uint32_t delay = 1; delay <= 8; delay++) {
+ *     SimJob job;
+ *     job.name = "gcd_delay" + std::to_string(delay);
+ *     job.program = get_test_program_path("gcd");
+ *     job.config.memory_delay = delay;
+ *     job.config.memory_debug = false;
+ *     jobs.push_back(job);
+ *   }
+ *   std::vector<SimJobResult> results = run_parallel(jobs);
+ */
+
+#ifndef PARALLEL_RUNNER_H
+#define PARALLEL_RUNNER_H
+
+#include "test_runner.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One simulation to run
+struct SimJob {
+  std::string name;        // TestRunner name (trace/coverage file naming)
+  std::string program;     // .elf or .ini path
+  TestRunnerConfig config; // Memory, trace and coverage settings
+  uint64_t max_cycles = 1000000;
+};
+
+// Outcome of one job; ERROR if the program could not be loaded
+struct SimJobResult {
+  std::string name;
+  TestResult result = TestResult::ERROR;
+  uint64_t cycles = 0;
+};
+
+// Run all jobs on up to num_threads workers (0 = one per hardware thread)
+// Results are returned in job order regardless of completion order
+std::vector<SimJobResult> run_parallel(const std::vector<SimJob> &jobs,
+                                       unsigned num_threads = 0);
+
+// Run a single job on the calling thread
+SimJobResult run_job(const SimJob &job);
+
+#endif // PARALLEL_RUNNER_H
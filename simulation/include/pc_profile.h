@@ -0,0 +1,151 @@
+/*
+ * PC-Sampling Profile with Call Stacks
+ *
+ * Attributes a run's cycles to the functions of the loaded program: the PC
+ * is sampled every interval cycles (1 = every cycle) and looked up in the
+ * ELF symbol table, and each sample is counted against the call stack it
+ * was taken in.
+ *
+ * Symbols: STT_FUNC symbols cover [value, value + size); STT_NOTYPE labels
+ * (e.g. __start, LOOP in hand-written start-up code) run up to the next
+ * symbol. Labels inside a sized function belong to it, and PCs no symbol
+ * covers count as "[unknown]".
+ *
+ * Call stacks are rebuilt from the retired instruction stream with the
+ * RISC-V calling convention hints: JAL/JALR with rd = ra (x1) or t0 (x5)
+ * is a call and JALR x0, 0(ra/t0) a return. ECALL/EBREAK enter a trap
+ * handler as if called and MRET returns from it. Each frame is the
+ * function the call was made from; the sampled PC's own function is the
+ * leaf, so a tail jump or a stack left unbalanced by a longjmp still puts
+ * cycles in the right function.
+ *
+ * Output:
+ *   - Folded stacks, one "caller;...;leaf cycles" line per stack, the
+ *     input format of flamegraph.pl
+ *   - A per-function table: self and total (inclusive) cycles, retired
+ *     instructions, CPI (self cycles per instruction) and calls
+ *
+ * With an interval above 1 each sample stands for interval cycles, so the
+ * cycle columns are estimates; instructions and calls are always exact.
+ *
+ * Usage Example:
+ *   PcProfile profile(100);              // Sample every 100 cycles
+ *   profile.set_symbols(image.get_symbols());
+ *   profile.sample(pc, 0, 11);           // PC of cycles [0, 11)
+ *   profile.retire(pc, insn, next_pc);   // Each retired instruction
+ *   std::ofstream("add.folded") << profile.format_folded();
+ *   // flamegraph.pl add.folded > add.svg
+ */
+
+#ifndef PC_PROFILE_H
+#define PC_PROFILE_H
+
+#include "elf_loader.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// One function's line of the profile table
+struct PcProfileFunction {
+  std::string name;
+  uint64_t self_cycles = 0;  // Sampled with the PC in the function
+  uint64_t total_cycles = 0; // Sampled with the function on the stack
+  uint64_t instructions = 0; // Retired from the function
+  uint64_t calls = 0;        // Calls and trap entries into it
+};
+
+class PcProfile {
+public:
+  // Frames kept at most; deeper calls are counted but not recorded, so
+  // runaway recursion (or calls that never return) cannot grow the stack
+  static constexpr uint32_t MAX_DEPTH = 256;
+
+  explicit PcProfile(uint64_t interval = 1);
+
+  // Functions to attribute PCs to (replaces any earlier symbols; the
+  // samples taken so far keep their names)
+  void set_symbols(const std::map<std::string, ElfSymbol> &symbols);
+
+  // The PC was pc throughout cycles [from_cycle, to_cycle): take the
+  // samples that fall there (cycles divisible by the interval)
+  void sample(uint32_t pc, uint64_t from_cycle, uint64_t to_cycle) {
+    const uint64_t samples = (to_cycle + interval - 1) / interval -
+                             (from_cycle + interval - 1) / interval;
+    if (samples > 0) {
+      add_samples(pc, samples);
+    }
+  }
+
+  // The instruction insn at pc retired, continuing at next_pc
+  void retire(uint32_t pc, uint32_t insn, uint32_t next_pc);
+
+  // Clear the samples, counts and call stack (keeps symbols and interval)
+  void reset();
+
+  // Accessors
+  uint64_t get_interval() const { return interval; }
+  uint64_t get_samples() const { return samples_taken; }
+  uint64_t get_cycles() const { return samples_taken * interval; }
+  uint64_t get_instructions() const;
+  // Frames on the call stack (including any beyond MAX_DEPTH)
+  uint32_t get_depth() const { return depth + overflow; }
+
+  // Function containing pc ("[unknown]" if none)
+  const std::string &function_name(uint32_t pc) const;
+
+  // Functions that ran, by self cycles (most first)
+  std::vector<PcProfileFunction> get_functions() const;
+
+  // Folded stacks for flamegraph.pl, counts in cycles, sorted by stack
+  std::string format_folded() const;
+  // Per-function table
+  std::string format_table() const;
+
+private:
+  struct Function {
+    uint32_t start;
+    uint64_t end;  // Exclusive; may be 2^32
+    uint32_t name; // Index into names
+  };
+
+  // Call tree node: the function a call was made from, below its caller
+  struct Frame {
+    uint32_t parent;
+    uint32_t function;
+    std::map<uint32_t, uint32_t> children; // Function -> frame
+  };
+
+  uint64_t interval;
+  // Address ranges by start. Samples, frames and counts refer to names by
+  // index, names[0] being "[unknown]", so they outlive set_symbols()
+  std::vector<Function> functions;
+  std::vector<std::string> names;
+  std::map<std::string, uint32_t> name_index;
+  mutable size_t last_function; // Lookup cache (functions.size() if none)
+
+  std::vector<Frame> frames; // frames[0] is the root
+  uint32_t frame;            // Innermost frame
+  uint32_t depth;
+  uint32_t overflow; // Calls past MAX_DEPTH not yet returned
+
+  // Samples per (frame, leaf function), and the counter last used
+  std::map<std::pair<uint32_t, uint32_t>, uint64_t> stacks;
+  std::pair<uint32_t, uint32_t> last_stack;
+  uint64_t *last_count;
+  uint64_t samples_taken;
+
+  // Per name: retired instructions and calls
+  std::vector<uint64_t> instructions;
+  std::vector<uint64_t> calls;
+
+  uint32_t lookup(uint32_t pc) const;
+  uint32_t intern(const std::string &name);
+  void add_samples(uint32_t pc, uint64_t samples);
+  void push(uint32_t function);
+  void pop();
+  std::string stack_name(uint32_t frame_index) const;
+};
+
+#endif // PC_PROFILE_H
@@ -0,0 +1,91 @@
+/*
+ * RTL Backdoor Access for core_top
+ *
+ * Reads and writes internal state of the verilated RTL model through the
+ * signals marked verilator public in the RTL (control FSM state, CSR
+ * counters and machine CSRs, register file, PC/IR/MAR flops). Only the
+ * RTL libraries define RISCV_RTL_BACKDOOR; the synth and GLS netlists have
+ * no such signals, so there every query reports "unavailable" and every
+ * update is a no-op.
+ *
+ * Usage Example:
+ *   if (rtl_backdoor::available() &&
+ *       rtl_backdoor::is_memory_wait_state(dut)) {
+ *     rtl_backdoor::advance_counters(dut, skipped_cycles);
+ *   }
+ */
+
+#ifndef RTL_BACKDOOR_H
+#define RTL_BACKDOOR_H
+
+#include <cstdint>
+
+class Vcore_top;
+
+namespace rtl_backdoor {
+
+// Control FSM encodings (enum order in control.sv)
+constexpr uint32_t STATE_FETCH_0 = 0;
+constexpr uint32_t STATE_FETCH_1 = 1;
+constexpr uint32_t STATE_LD_2 = 18;
+constexpr uint32_t STATE_ST_3 = 24;
+
+// True if this build can see RTL internals
+bool available();
+
+// Current control FSM state (0 if unavailable)
+uint32_t get_control_state(Vcore_top &dut);
+
+// True if the control FSM is waiting on mem_resp (FETCH_1, LD_2, ST_3)
+bool is_memory_wait_state(Vcore_top &dut);
+
+// Current cycle CSR value (0 if unavailable)
+uint64_t get_cycle_counter(Vcore_top &dut);
+
+// Current instret CSR value (0 if unavailable)
+uint64_t get_instret(Vcore_top &dut);
+
+// Register file entry x[index] (0 if unavailable)
+uint32_t get_register(Vcore_top &dut, uint32_t index);
+
+// mtvec (0x305), mepc (0x341), mcause (0x342), mtval (0x343),
+// mcountinhibit (0x320) or an implemented mhpmcounterN[h] (0xB03/0xB83 on)
+// or mhpmeventN (0x323 on); 0 for other addresses or if unavailable
+uint32_t get_machine_csr(Vcore_top &dut, uint32_t addr);
+
+// Instruction register: the instruction executing, until the next fetch
+// loads the next one (0 if unavailable)
+uint32_t get_instruction(Vcore_top &dut);
+
+// Memory address register: the byte address of the last load or store
+// from LD_0/ST_0 until the next fetch (0 if unavailable)
+uint32_t get_memory_address(Vcore_top &dut);
+
+// Hash of the architectural state other than the PC and memory: x1-x31 and
+// the machine CSRs. The free-running counters are left out. 0 if
+// unavailable
+uint64_t hash_arch_state(Vcore_top &dut);
+
+// Add cycles to the cycle and time CSRs, and to the performance counters
+// counting the memory wait the control FSM is in, as if the core had been
+// clocked that many times while stalled
+void advance_counters(Vcore_top &dut, uint64_t cycles);
+
+// Architectural state writes, for handing a program over from a functional
+// model. Only meaningful with the control FSM in FETCH_0 (between
+// instructions); call dut.eval() afterwards so the outputs follow
+// x[index] = value (writes to x0 are ignored)
+void set_register(Vcore_top &dut, uint32_t index, uint32_t value);
+
+// Load the PC register (the 32 u_pc flops)
+void set_pc(Vcore_top &dut, uint32_t pc);
+
+// Same addresses as get_machine_csr(); other addresses are ignored
+void set_machine_csr(Vcore_top &dut, uint32_t addr, uint32_t value);
+
+// Set the cycle/time and instret CSRs
+void set_counters(Vcore_top &dut, uint64_t cycles, uint64_t instret);
+
+} // namespace rtl_backdoor
+
+#endif // RTL_BACKDOOR_H
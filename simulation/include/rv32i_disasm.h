@@ -0,0 +1,30 @@
+/*
+ * RV32I Disassembler
+ *
+ * Turns an instruction word into assembly text in the style of GNU
+ * objdump: ABI register names, the common pseudo-instructions (li, mv,
+ * j, ret, beqz, csrr, rdcycle, ...), CSR names and absolute jump and
+ * branch targets. Covers RV32I, Zicsr, Zifencei and the machine-mode
+ * SYSTEM instructions; anything else prints as ".word 0x<insn>".
+ *
+ * Usage Example:
+ *   rv32i_disassemble(0xfc010113);         // "addi sp,sp,-64"
+ *   rv32i_disassemble(0x06079e63, 0x102c); // "bnez a5,0x10a8"
+ */
+
+#ifndef RV32I_DISASM_H
+#define RV32I_DISASM_H
+
+#include <cstdint>
+#include <string>
+
+// Assembly text of insn; pc resolves jump and branch targets
+std::string rv32i_disassemble(uint32_t insn, uint32_t pc = 0);
+
+// ABI name of register x<index> ("zero", "ra", "sp", ...)
+const char *rv32i_register_name(uint32_t index);
+
+// Name of a CSR address, or nullptr if the disassembler does not know it
+const char *rv32i_csr_name(uint32_t addr);
+
+#endif // RV32I_DISASM_H
@@ -0,0 +1,208 @@
+/*
+ * RV32I Instruction-Set Simulator
+ *
+ * Functional reference model of core_top. It executes exactly the ISA that
+ * control.sv implements, on a MemoryModel, with the same magic-address
+ * pass/fail protocol as TestRunner, so any test/ program runs unchanged.
+ *
+ * Modelled behaviour (matches the RTL, including its corner cases):
+ *   - RV32I. funct7 is ignored except bit 30 (SUB/SRA; SLL/SLLI with bit 30
+ *     set pass rs1 through), so e.g. MUL executes as ADD
+ *   - JAL/JALR write rd before the jump; JALR reads rs1 after that write
+ *     (rd == rs1 jumps relative to PC+4) and keeps bit 0 of the target
+ *   - Loads/stores access the aligned word. Byte lanes come from addr[1:0],
+ *     halfword lanes from addr[1]; there are no misaligned traps. Unmapped
+ *     reads return 0xDEADBEEF, unmapped writes are dropped
+ *   - Zicsr on the csr_file CSRs (cycle/time/instret[h] read-only, mtvec,
+ *     mepc, mcause, mtval read-write, the HPM_COUNTERS performance counters
+ *     with mhpmevent and mcountinhibit). An unknown CSR address halts
+ *   - ECALL/EBREAK (any SYSTEM funct3=0 but MRET) trap to mtvec (reset
+ *     0x100) with mepc = PC, mcause = 11/3 (instruction bit 20), mtval = 0;
+ *     MRET jumps to mepc. FENCE/FENCE.I are NOPs
+ *   - Unknown opcodes halt, as the FSM stops in ERROR_OPCODE_NOT_IMPLEMENTED
+ *   - PC resets to RESET_PC (0x1000), all registers to 0
+ *   - cycle/time count the cycles the RTL would have taken (FsmTiming at
+ *     IssConfig::memory_delay), so get_cycles() predicts a TestRunner run
+ *     and a CSR read returns what the RTL reads from reset. The performance
+ *     counters count the events control.sv raises, to the same cycle
+ *
+ * Code is predecoded into blocks (up to a jump, trap or MRET, 64
+ * instructions or a page end; not-taken branches stay in the block) cached
+ * by start PC, and run with threaded dispatch (computed goto on GCC/Clang).
+ * A store into a page holding decoded code flushes the cache, so
+ * self-modifying code behaves as on the core. Memory changed behind the
+ * model's back (backdoor writes) needs a flush_cache() call.
+ *
+ * Usage Example:
+ *   MemoryModel memory(288 * 1024 * 1024, 4, false);
+ *   Rv32iIss iss(memory);
+ *   iss.load_program(get_test_program_path("add"));
+ *   TestResult result = iss.run(100000000);  // Instruction limit
+ *   uint64_t instructions = iss.get_instret();
+ */
+
+#ifndef RV32I_ISS_H
+#define RV32I_ISS_H
+
+#include "../memory_model.h"
+#include "elf_loader.h"
+#include "fsm_timing.h"
+#include "sim_log.h"
+#include "test_utils.h"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct IssConfig {
+  uint32_t reset_pc = RESET_PC;
+  uint32_t memory_delay = 4; // MemoryModel latency the cycle count assumes
+  LogLevel log_level = LogLevel::INFO;
+};
+
+class Rv32iIss {
+public:
+  // Decoded blocks end after this many instructions
+  static constexpr uint32_t MAX_BLOCK_INSNS = 64;
+
+  explicit Rv32iIss(MemoryModel &memory,
+                    const IssConfig &config = IssConfig());
+  ~Rv32iIss();
+
+  Rv32iIss(const Rv32iIss &) = delete;
+  Rv32iIss &operator=(const Rv32iIss &) = delete;
+
+  // Load a program (.elf or .ini, see ElfImage) and flush decoded code
+  bool load_program(const std::string &program_file);
+
+  // Architectural reset: PC, registers, CSRs and counters
+  void reset();
+
+  // Run until the magic address reports a result, the core halts, or
+  // max_instructions retire (TIMEOUT in both latter cases)
+  TestResult run(uint64_t max_instructions);
+
+  // Retire up to max_instructions; stops early after a halt or a write to
+  // MAGIC_RESULT_ADDR. Returns the number retired
+  uint64_t step(uint64_t max_instructions);
+
+  // Architectural state
+  uint32_t get_pc() const { return pc; }
+  void set_pc(uint32_t value) { pc = value; }
+  uint32_t get_reg(uint32_t index) const {
+    return index == 0 ? 0 : regs[index & 31];
+  }
+  void set_reg(uint32_t index, uint32_t value) {
+    if (index != 0) {
+      regs[index & 31] = value;
+    }
+  }
+  // CSR access by address; false for addresses csr_file does not decode.
+  // Writes to the read-only counters are ignored
+  bool get_csr(uint32_t addr, uint32_t &value) const;
+  bool set_csr(uint32_t addr, uint32_t value);
+  uint64_t get_instret() const { return instret; }
+  // Cycles since reset at the current instruction boundary. set_cycles()
+  // holds until the next retire; call it after set_instret()
+  uint64_t get_cycles() const { return cycle_offset + instret * base_cycles; }
+  void set_instret(uint64_t value);
+  void set_cycles(uint64_t value) {
+    cycle_offset = value - instret * base_cycles;
+  }
+
+  // Cycles the last run() takes on TestRunner with the same memory delay:
+  // up to the bus write of the result, as TestRunner counts them (0 unless
+  // the run completed)
+  uint64_t get_run_cycles() const { return run_cycles; }
+
+  // True once an unimplemented opcode or CSR address stopped the core
+  bool is_halted() const { return halted; }
+
+  // Drop all decoded blocks (after changing memory through the backdoor)
+  void flush_cache();
+
+  // Accessors
+  MemoryModel &get_memory() { return memory; }
+  const ElfImage &get_program() const { return program; }
+  const IssConfig &get_config() const { return config; }
+  const FsmTiming &get_timing() const { return timing; }
+  LogSink &get_log() { return log; }
+  uint64_t get_decoded_blocks() const { return decoded_blocks; }
+
+private:
+  struct Insn;
+  struct Block;
+
+  MemoryModel &memory;
+  IssConfig config;
+  LogSink log;
+  ElfImage program;
+
+  // Architectural state. regs[32] absorbs writes to x0 so handlers need
+  // no rd == 0 check
+  uint32_t regs[33];
+  uint32_t pc;
+  uint64_t instret;
+  uint32_t mtvec;
+  uint32_t mepc;
+  uint32_t mcause;
+  uint32_t mtval;
+  // Performance counters, counted lazily: while running, counter i is
+  // hpm_base[i] plus the events since event_total() was hpm_snapshot[i].
+  // event_counts holds the per-instruction events; the wait cycles follow
+  // from the fetches (instret less fetch_origin) and load/store counts
+  uint32_t mcountinhibit;
+  uint32_t hpm_event[HPM_COUNTERS];
+  uint64_t hpm_base[HPM_COUNTERS];
+  uint64_t hpm_snapshot[HPM_COUNTERS];
+  uint64_t event_counts[HPM_NUM_EVENTS];
+  uint64_t fetch_origin;
+  bool halted;
+
+  // Cycle count = cycle_offset + instret * base_cycles, where base_cycles
+  // is the common d+7 instruction and handlers add their class's
+  // difference (mod 2^64, MRET is shorter) to cycle_offset
+  FsmTiming timing;
+  uint64_t base_cycles;
+  uint64_t cycle_offset;
+  uint64_t extra_cycles[FSM_NUM_CLASSES];
+  uint64_t run_cycles;
+
+  // Set by the MAGIC_RESULT_ADDR write watch
+  bool result_written;
+  int magic_watch;
+
+  // Decoded block cache. lookup is direct-mapped on the start PC in front
+  // of the map; code_pages marks 4KB pages that blocks were decoded from
+  static constexpr uint32_t LOOKUP_ENTRIES = 4096;
+  std::unordered_map<uint32_t, std::unique_ptr<Block>> blocks;
+  std::array<Block *, LOOKUP_ENTRIES> lookup;
+  std::vector<bool> code_pages;
+  std::vector<uint32_t> marked_pages; // Set entries of code_pages
+  bool flush_pending; // A store hit code; flush before the next block
+  uint64_t decoded_blocks;
+
+  // Helper functions
+  Block *find_block(uint32_t block_pc);
+  Block *decode_block(uint32_t block_pc);
+  void decode(uint32_t insn_pc, uint32_t word, Insn &insn) const;
+  uint32_t fetch_word(uint32_t addr) const;
+  uint64_t execute(uint64_t budget);
+  void note_code_store(uint32_t addr);
+  void exec_csr(const Insn &insn, uint64_t retired);
+  // CSR access with retired instructions and fetched ones (retired + 1
+  // inside a CSR instruction)
+  bool read_csr(uint32_t addr, uint64_t retired, uint64_t fetched,
+                uint64_t cycles, uint32_t &value) const;
+  bool write_csr(uint32_t addr, uint32_t value, uint64_t fetched);
+  // Events of one mhpmevent value so far
+  uint64_t event_total(uint32_t event, uint64_t fetched) const;
+  uint64_t hpm_value(uint32_t index, uint64_t fetched) const;
+  // Fold the events so far into hpm_base[index]
+  void hpm_rebase(uint32_t index, uint64_t fetched);
+  bool is_test_complete() const;
+};
+
+#endif // RV32I_ISS_H
@@ -0,0 +1,80 @@
+/*
+ * Levelled Logging for the Simulation Harness
+ *
+ * Messages go through SIM_LOG, which only evaluates its stream expression
+ * when the message will actually be written, so a disabled message costs a
+ * compare and no formatting or allocation. Levels below SIM_LOG_MIN_LEVEL
+ * are removed at compile time.
+ *
+ * Each TestRunner owns a LogSink and hands it to its MemoryModel, so all
+ * output for one simulation is collected in one buffer and written in
+ * blocks rather than flushed line by line. Warnings and errors flush right
+ * away; errors go to the error stream.
+ *
+ * Usage Example:
+ *   LogSink log(LogLevel::INFO);
+ *   SIM_LOG(log, LogLevel::DEBUG, "MEM", "WRITE addr=" << to_hex_string(a));
+ *   SIM_LOG(log, LogLevel::INFO, "TEST", "Reset complete");
+ *   log.flush();
+ */
+
+#ifndef SIM_LOG_H
+#define SIM_LOG_H
+
+#include <cstddef>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+enum class LogLevel { TRACE = 0, DEBUG, INFO, WARN, ERROR, OFF };
+
+// Compile-time floor (numeric LogLevel); messages below it are compiled out
+#ifndef SIM_LOG_MIN_LEVEL
+#define SIM_LOG_MIN_LEVEL 0
+#endif
+
+class LogSink {
+public:
+  // Buffered output is written once it grows past this many bytes
+  static constexpr size_t FLUSH_THRESHOLD = 16 * 1024;
+
+  explicit LogSink(LogLevel level = LogLevel::INFO,
+                   std::ostream &out = std::cout,
+                   std::ostream &err = std::cerr);
+  ~LogSink();
+
+  LogSink(const LogSink &) = delete;
+  LogSink &operator=(const LogSink &) = delete;
+
+  bool enabled(LogLevel level) const { return level >= min_level; }
+  void set_level(LogLevel level) { min_level = level; }
+  LogLevel get_level() const { return min_level; }
+
+  // Message assembly - use SIM_LOG rather than calling these directly
+  std::ostream &begin(LogLevel level, const char *tag);
+  void end();
+
+  // Write out everything buffered so far
+  void flush();
+
+private:
+  LogLevel min_level;
+  std::ostream *out;
+  std::ostream *err;
+
+  // Message being assembled, and completed messages awaiting flush
+  LogLevel line_level;
+  std::ostringstream line;
+  std::string buffer;
+};
+
+#define SIM_LOG(sink, level, tag, expr)                                        \
+  do {                                                                         \
+    if (static_cast<int>(level) >= SIM_LOG_MIN_LEVEL &&                        \
+        (sink).enabled(level)) {                                               \
+      (sink).begin(level, tag) << expr;                                        \
+      (sink).end();                                                            \
+    }                                                                          \
+  } while (0)
+
+#endif // SIM_LOG_H
@@ -0,0 +1,151 @@
+/*
+ * Sampled Simulation (SimPoint-Style)
+ *
+ * Estimates a program's CPI on core_top from a few cycle-accurate samples:
+ *
+ *   1. Profile: split the retired instruction stream into fixed intervals
+ *      and count, per interval, the instructions executed in each basic
+ *      block (a basic-block vector). Profiling runs on Rv32iIss; the same
+ *      vectors can be built from the RTL PC stream through
+ *      TestRunner::set_retire_hook() and BbvCollector.
+ *   2. Cluster: project the normalized vectors to a few dimensions, run
+ *      k-means for k = 1..max_k and keep the smallest k whose BIC score is
+ *      within 90% of the best. The interval closest to each centroid
+ *      represents its cluster, weighted by the cluster's share of all
+ *      instructions.
+ *   3. Simulate: for each representative, execute up to warmup instructions
+ *      before it on the ISS and hand over to the RTL (run_functional), or
+ *      restore that point from a checkpoint; run the warmup and then the
+ *      interval on the RTL and measure its cycles.
+ *   4. Report: weighted CPI = sum of weight * sampled CPI. The error is
+ *      estimated from the FsmTiming cycle counts the ISS keeps for every
+ *      interval (weighted representatives against the whole program), and
+ *      measured against a full RTL run when requested.
+ *
+ * Needs the RTL backdoor (instret and the hand-over) for step 3.
+ *
+ * Usage Example:
+ *   SimPointConfig config;
+ *   config.interval = 1000000;
+ *   config.warmup = 10000;
+ *   SimPointReport report = run_simpoint(path, config);
+ *   std::cout << report.weighted_cpi << " +/- "
+ *             << report.estimated_error * 100 << "%\n";
+ */
+
+#ifndef SIMPOINT_H
+#define SIMPOINT_H
+
+#include "test_runner.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+struct SimPointConfig {
+  uint64_t interval = 100000;  // Instructions per interval
+  uint64_t warmup = 10000;     // RTL instructions run before each sample
+  uint32_t max_k = 10;         // Largest number of clusters tried
+  uint32_t dimensions = 15;    // Random projection size
+  uint32_t seeds = 5;          // k-means restarts per k
+  uint64_t seed = 1;           // Projection and k-means randomness
+  double bic_threshold = 0.9;  // Fraction of the BIC range to reach
+  uint64_t max_instructions = UINT64_MAX; // Profiling limit
+  TestRunnerConfig runner;     // Memory size and delay, logging
+  // Save each sample's hand-over point as <dir>/<name>_<interval>.ckpt
+  // and restore it instead of re-running the ISS when it already exists
+  std::string checkpoint_dir;
+  bool full_run = false; // Also run the whole program on the RTL
+};
+
+// Instructions per basic block (keyed by start PC) in one interval
+struct BasicBlockVector {
+  uint64_t instructions = 0;
+  uint64_t cycles = 0; // Cycles the interval took (as the feeder counts)
+  std::map<uint32_t, uint64_t> blocks;
+};
+
+// Builds basic-block vectors from a stream of retired instructions. A
+// block ends at any instruction whose successor is not pc + 4
+class BbvCollector {
+public:
+  explicit BbvCollector(uint64_t interval, uint64_t start_cycles = 0);
+
+  // One retired instruction; cycles is the running cycle count after it
+  void retire(uint32_t pc, uint32_t next_pc, uint64_t cycles);
+  // Close the last (partial) interval
+  void finish();
+
+  const std::vector<BasicBlockVector> &get_vectors() const { return vectors; }
+  uint64_t get_instructions() const { return instructions; }
+
+private:
+  uint64_t interval;
+  uint64_t instructions;
+  uint64_t interval_start_cycles;
+  uint64_t last_cycles;
+  bool in_block;
+  uint32_t block_pc;
+  uint64_t block_length;
+  BasicBlockVector current;
+  std::vector<BasicBlockVector> vectors;
+
+  void end_block();
+};
+
+// Cluster assignment and representatives for a set of vectors
+struct SimPointClustering {
+  uint32_t k = 0;
+  std::vector<uint32_t> cluster;        // Per interval
+  std::vector<size_t> representatives;  // Interval index per cluster
+  std::vector<double> weights;          // Instruction share per cluster
+  std::vector<double> bic;              // Score for k = 1..max_k tried
+};
+
+// One simulated representative
+struct SimPointSample {
+  size_t interval = 0;
+  uint64_t start = 0;        // Instructions retired before it
+  uint64_t instructions = 0; // In the interval
+  double weight = 0;
+  uint64_t cycles = 0;       // Measured on the RTL
+  double cpi = 0;
+  double model_cpi = 0;      // FsmTiming CPI of the interval (ISS profile)
+  bool valid = false;
+};
+
+struct SimPointReport {
+  bool ok = false;
+  std::string error; // Why ok is false
+  uint64_t total_instructions = 0;
+  size_t intervals = 0;
+  uint32_t k = 0;
+  std::vector<SimPointSample> samples;
+  uint64_t simulated_instructions = 0; // On the RTL, warmup included
+  double weighted_cpi = 0;
+  // Whole-program CPI of the timing model and the weighted estimate it
+  // gives from the same representatives; their relative difference is
+  // the sampling error estimate
+  double model_cpi = 0;
+  double model_weighted_cpi = 0;
+  double estimated_error = 0;
+  // Full RTL run (config.full_run)
+  bool full_run = false;
+  uint64_t full_cycles = 0;
+  double full_cpi = 0;
+  double full_error = 0; // Relative error of weighted_cpi against full_cpi
+};
+
+// Step 1 on Rv32iIss: basic-block vectors with FsmTiming cycles
+std::vector<BasicBlockVector> profile_bbvs(const std::string &program_file,
+                                           const SimPointConfig &config);
+
+// Step 2
+SimPointClustering cluster_bbvs(const std::vector<BasicBlockVector> &vectors,
+                                const SimPointConfig &config);
+
+// Steps 1-4
+SimPointReport run_simpoint(const std::string &program_file,
+                            const SimPointConfig &config);
+
+#endif // SIMPOINT_H
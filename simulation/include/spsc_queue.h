@@ -0,0 +1,81 @@
+/*
+ * Single-Producer Single-Consumer Lock-Free Queue
+ *
+ * Bounded ring buffer for handing fixed-size records from one thread to
+ * exactly one other thread without locks. Each side owns one index and
+ * only reads the other's; the release store of an index publishes the
+ * slot it covers. Each index keeps a cached copy of the other so the
+ * shared cache line is only touched when the ring looks full/empty.
+ *
+ * Usage Example:
+ *   SpscQueue<CosimCommit> queue(4096);   // Capacity rounded up to 2^n
+ *   // Producer thread                    // Consumer thread
+ *   while (!queue.try_push(record)) {}    CosimCommit record;
+ *                                         if (queue.try_pop(record)) {...}
+ */
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+template <typename T> class SpscQueue {
+public:
+  explicit SpscQueue(size_t min_capacity) {
+    size_t capacity = 2;
+    while (capacity < min_capacity) {
+      capacity *= 2;
+    }
+    slots.resize(capacity);
+    mask = capacity - 1;
+  }
+
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  // Producer side; false if the queue is full
+  bool try_push(const T &value) {
+    const size_t tail = producer.index.load(std::memory_order_relaxed);
+    if (tail - producer.cached_other == slots.size()) {
+      producer.cached_other = consumer.index.load(std::memory_order_acquire);
+      if (tail - producer.cached_other == slots.size()) {
+        return false;
+      }
+    }
+    slots[tail & mask] = value;
+    producer.index.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side; false if the queue is empty
+  bool try_pop(T &value) {
+    const size_t head = consumer.index.load(std::memory_order_relaxed);
+    if (head == consumer.cached_other) {
+      consumer.cached_other = producer.index.load(std::memory_order_acquire);
+      if (head == consumer.cached_other) {
+        return false;
+      }
+    }
+    value = slots[head & mask];
+    consumer.index.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t capacity() const { return slots.size(); }
+
+private:
+  // One cache line per side so the two threads do not false-share
+  struct alignas(64) Side {
+    std::atomic<size_t> index{0};
+    size_t cached_other = 0; // Last seen value of the other side's index
+  };
+
+  std::vector<T> slots;
+  size_t mask;
+  Side producer; // Next slot to write
+  Side consumer; // Next slot to read
+};
+
+#endif // SPSC_QUEUE_H
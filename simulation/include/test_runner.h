@@ -7,84 +7,475 @@
  * Features:
  *   - DUT (core_top) instantiation and lifecycle management
  *   - Memory model integration
- *   - Program loading from hex files
+ *   - Program loading from ELF files (.elf, or hex-text .ini dumps)
  *   - Simulation execution with timeout and completion detection
- *   - Result extraction from magic addresses
- *   - Optional VCD waveform tracing
- *   - Cycle counting and statistics
+ *   - Hang detection from bus traffic, retired instructions and repeated
+ *     architectural state, independent of memory latency
+ *   - Completion detected by a write watch on the magic result address
+ *     (tests can add their own via get_memory().add_write_watch())
+ *   - Optional FST (or VCD) waveform tracing of chosen scopes or of the
+ *     whole design, limited to a cycle window
+ *     and/or opened by a PC match or a store to an address, with the
+ *     cycles before the trigger replayed from periodic snapshots
+ *   - Cycle counting and statistics (64-bit)
+ *   - Long runs: wall-clock budget and periodic heartbeat (cycles, instret,
+ *     simulation speed, PC) through RunOptions
+ *   - Stall fast-forward: cycles where the core only waits on the memory
+ *     model are skipped in one step, with the cycle/time CSRs fixed up
+ *   - Lockstep co-simulation (RTL builds): every retired instruction is
+ *     checked against Rv32iIss on a separate thread (see cosim.h)
+ *   - Functional fast-forward (RTL builds): the first N instructions run on
+ *     Rv32iIss, then the registers, PC, machine CSRs and counters are
+ *     loaded into the RTL, which carries on cycle-accurately from there
+ *   - Checkpoints: the Verilated model (built with --savable), memory
+ *     contents (resident pages only), memory FSM and statistics, and the
+ *     harness counters, saved on request or periodically from run() and
+ *     restored into a fresh runner to resume the run
+ *   - Warm-state cloning: fork_clones() forks the process after a common
+ *     prefix (copy-on-write), lets each clone change a knob and run to
+ *     completion in parallel, and collects the results over pipes
+ *   - Commit log (RTL builds): PC, instruction, register write and memory
+ *     access of every instruction run() retires, compressed on a
+ *     background thread (see commit_log.h)
+ *   - FSM occupancy profile (RTL builds): cycles per control FSM state and
+ *     instruction class for each run(), as a table and JSON (see
+ *     fsm_profile.h)
+ *   - PC-sampling profile: cycles, instructions and CPI per function of the
+ *     loaded program, with call stacks, as a table and folded stacks for
+ *     flamegraph.pl (see pc_profile.h)
+ *   - Memory access statistics: bus traffic per page and region, fetch vs
+ *     data, sub-word accesses, reuse distances and a heatmap over time, as
+ *     a table and JSON (see memory_stats.h)
+ *   - Instruction timeline: instructions with their FSM states, memory
+ *     transactions and traps over a cycle window, as Chrome trace-event
+ *     JSON for Perfetto (see timeline_trace.h)
+ *   - Private VerilatedContext per instance (time, coverage, trace), so
+ *     runners on different threads do not share simulator state
  *
  * Usage Example:
  *   TestRunner runner("my_test", true);  // Enable tracing
  *   runner.load_program(get_test_program_path("add"));
  *   TestResult result = runner.run(10000);
  *   if (result == TestResult::PASS) {
- *     uint32_t cycles = runner.get_cycle_count();
+ *     uint64_t cycles = runner.get_cycle_count();
  *   }
+ *
+ *   runner.run_functional(5000000);     // Skip boot on the ISS, then
+ *   runner.get_memory().reset_statistics();
+ *   result = runner.run(10000000);      // measure steady-state CPI
+ *
+ *   RunOptions options;                 // Overnight netlist run
+ *   options.max_seconds = 12 * 3600;
+ *   options.heartbeat_seconds = 60;     // Logged at INFO unless a callback
+ *   result = runner.run(options);       // is set in options.heartbeat
+ *
+ *   options.checkpoint_file = "ckpt/dhrystone.ckpt";
+ *   options.checkpoint_cycles = 1000000; // Replaced every 1M cycles
+ *   runner.run(options);
+ *   TestRunner again("dhrystone_rerun", true); // Later, traced:
+ *   again.restore_checkpoint("ckpt/dhrystone.ckpt");
+ *   again.run(options);                 // Carries on from the checkpoint
+ *
+ *   runner.run(2000000);                // Boot and set-up, once
+ *   std::vector<CloneResult> sweep = runner.fork_clones(
+ *       8, [](TestRunner &clone, unsigned i, std::string &output) {
+ *         clone.set_memory_delay(i + 1);
+ *         return clone.run(100000000);
+ *       });
  */
 
 #ifndef TEST_RUNNER_H
 #define TEST_RUNNER_H
 
 #include "../memory_model.h"
+#include "commit_log.h"
+#include "cosim.h"
+#include "elf_loader.h"
+#include "fsm_profile.h"
+#include "pc_profile.h"
+#include "sim_log.h"
 #include "test_utils.h"
+#include "timeline_trace.h"
 #include <cstdint>
+#include <functional>
 #include <string>
+#include <vector>
 
 // Forward declarations for Verilator components
 class Vcore_top;
+class VerilatedContext;
+#ifdef RISCV_TRACE_FST
+class VerilatedFstC;
+using TraceWriter = VerilatedFstC;
+#else
 class VerilatedVcdC;
+using TraceWriter = VerilatedVcdC;
+#endif
+
+// Which part of a traced run is written to the waveform. Cycles are
+// get_cycle_count() cycles; the default traces everything from reset
+struct TraceCapture {
+  // Window: cycles [start_cycle, stop_cycle)
+  uint64_t start_cycle = 0;
+  uint64_t stop_cycle = UINT64_MAX;
+  // Triggers: with either set, nothing is written until the PC first holds
+  // trigger_pc or a store first writes [trigger_addr, trigger_addr +
+  // trigger_size). The window is then narrowed to the pre_trigger_cycles
+  // before the trigger cycle and the post_trigger_cycles from it on
+  bool pc_trigger = false;
+  uint32_t trigger_pc = 0;
+  bool write_trigger = false;
+  uint32_t trigger_addr = 0;
+  uint32_t trigger_size = 4;
+  // Cycles before the trigger are not traced as they run: the runner keeps
+  // two snapshots (see save_checkpoint()) at least this far apart, rewinds
+  // to the older one on the trigger and replays into the window. The
+  // replay does not repeat retire hook calls or commit log records, and
+  // stops co-simulation
+  uint64_t pre_trigger_cycles = 0;
+  uint64_t post_trigger_cycles = UINT64_MAX;
+};
+
+// Per-runner simulation settings
+struct TestRunnerConfig {
+  uint32_t memory_size = 288 * 1024 * 1024; // Covers ROM and RAM regions
+  uint32_t memory_delay = 4;                // Memory latency in cycles
+  bool memory_debug = true;                 // MemoryModel logging
+  bool enable_trace = false;                // FST/VCD waveform in trace/
+  TraceCapture trace_capture;               // Part of the run traced
+  // Signals traced; empty traces everything. Each entry is a hierarchy
+  // path below core_top (or from TOP. on) naming an instance, traced with
+  // everything beneath it, or a single signal, e.g. "u_control.state",
+  // "u_regfile". A ":N" suffix limits an instance to N levels ("u_pc:1" is
+  // the register without its 32 bit cells), and "bus" is the memory bus
+  // ports. Matching is by whole path components; a path that names
+  // nothing traces nothing
+  std::vector<std::string> trace_scopes;
+  bool fast_forward = true; // Skip memory stall cycles (RTL, not while the
+                            // waveform is being written)
+  LogLevel log_level = LogLevel::INFO; // Runner and memory log threshold
+  // Hang detection: TIMEOUT once no bus transaction completes, or on RTL
+  // builds no instruction retires, for hang_cycles cycles (0 derives a bound
+  // from memory_delay), or once the core comes back to an earlier
+  // architectural state without having changed memory (RTL builds only)
+  bool hang_detection = true;
+  uint64_t hang_cycles = 0;
+  // Co-simulation: compare PC, register writes, stores and trap CSRs of
+  // every retired instruction against Rv32iIss and FAIL at the first
+  // difference (RTL builds only; needs load_program() right after reset)
+  bool cosim = false;
+  // Commit log of every instruction run() retires, written to this file
+  // (gzip) if non-empty (RTL builds only; instructions run_functional()
+  // executes on the ISS are not logged)
+  std::string commit_log_file;
+  // FSM occupancy profile of each run(), logged as a table at INFO and,
+  // if fsm_profile_file is set (which implies fsm_profile), written there
+  // as JSON (RTL builds only)
+  bool fsm_profile = false;
+  std::string fsm_profile_file;
+  // PC-sampling profile of each run(): the PC is sampled every
+  // pc_profile_interval cycles and attributed to the loaded program's
+  // functions and call stack. Logged as a per-function table at INFO and,
+  // if pc_profile_file is set (which implies pc_profile), written there as
+  // folded stacks. Works on every build; the netlists see retires as PC
+  // changes. Instructions run_functional() executes are not profiled
+  bool pc_profile = false;
+  uint64_t pc_profile_interval = 1;
+  std::string pc_profile_file;
+  // Memory access statistics of each run() (MemoryModel access stats),
+  // with a heatmap in windows of memory_stats_window cycles. Logged as a
+  // table at INFO and, if memory_stats_file is set (which implies
+  // memory_stats), written there as JSON. Unless regions were added to the
+  // stats before load_program(), the program image and the magic region
+  // are named
+  bool memory_stats = false;
+  uint64_t memory_stats_window = 10000;
+  std::string memory_stats_file;
+  // Timeline of each run() written to timeline_file as Chrome trace-event
+  // JSON if non-empty: instructions and their FSM states, memory
+  // transactions and traps in cycles [timeline_start, timeline_stop). The
+  // instruction and trap tracks need the RTL backdoor; the netlists only
+  // get the memory track
+  std::string timeline_file;
+  uint64_t timeline_start = 0;
+  uint64_t timeline_stop = UINT64_MAX;
+  // Coverage output written at exit if non-empty; when left empty and
+  // RISCV_COVERAGE_DIR is set, defaults to <dir>/coverage_<test_name>.dat
+  std::string coverage_file;
+};
+
+// Progress report for RunOptions::heartbeat
+struct RunHeartbeat {
+  uint64_t cycles;        // Cycles simulated by this run so far
+  uint64_t instret;       // instret CSR; 0 when instret_valid is false
+  bool instret_valid;     // False on the synth/GLS netlists (no backdoor)
+  uint32_t pc;
+  double elapsed_seconds; // Wall-clock time since the run started
+  double sim_khz;         // Simulated kHz since the previous heartbeat
+};
+
+// Limits and progress reporting for TestRunner::run()
+struct RunOptions {
+  uint64_t max_cycles = UINT64_MAX;
+  double max_seconds = 0;       // Wall-clock budget; TIMEOUT once used up
+  double heartbeat_seconds = 0; // Wall-clock heartbeat period
+  // (0 disables the budget / heartbeat)
+  // Called on every heartbeat; when empty the heartbeat is logged at INFO
+  std::function<void(const RunHeartbeat &)> heartbeat;
+  // Periodic checkpoints to checkpoint_file (each one replaces the last):
+  // every checkpoint_cycles cycles of this run and/or checkpoint_seconds
+  // of wall-clock time (0 disables either)
+  std::string checkpoint_file;
+  uint64_t checkpoint_cycles = 0;
+  double checkpoint_seconds = 0;
+};
+
+class TestRunner;
+
+// Body of one fork_clones() clone: change the clone's configuration, run
+// it and return its result. Anything written to output (e.g. metrics) is
+// passed back to the parent
+using CloneFunction = std::function<TestResult(
+    TestRunner &clone, unsigned index, std::string &output)>;
+
+// Called by run() for every instruction the RTL retires: its address and
+// the PC after it
+using RetireHook = std::function<void(uint32_t pc, uint32_t next_pc)>;
+
+// Outcome of one clone; ERROR if it died before reporting
+struct CloneResult {
+  TestResult result = TestResult::ERROR;
+  uint64_t cycles = 0; // Clone's get_cycle_count() after the function
+  std::string output;  // From the function, or why the clone failed
+};
 
 class TestRunner {
 public:
   // Constructor
   // test_name: Name of the test (used for trace file naming)
-  // enable_trace: If true, generate VCD waveform file
+  // enable_trace: If true, write trace/<test_name>.fst (or .vcd)
   TestRunner(const std::string &test_name, bool enable_trace = false);
 
+  // Constructor with explicit memory, trace and coverage settings
+  TestRunner(const std::string &test_name, const TestRunnerConfig &config);
+
   // Destructor - cleanup DUT and trace
   ~TestRunner();
 
-  // Load a program from a hex file into memory
+  // Load a program into memory
+  // Accepts a binary .elf or a hex-text .ini; ELF images are loaded by
+  // PT_LOAD segment, other hex images are copied flat to address 0
   // Returns true on success, false on failure
-  bool load_program(const std::string &hex_file);
+  bool load_program(const std::string &program_file);
 
   // Run the simulation until completion, timeout, or error
   // max_cycles: Maximum number of cycles to run before timeout
   // Returns: TestResult indicating pass/fail/timeout/error
-  TestResult run(uint32_t max_cycles);
+  TestResult run(uint64_t max_cycles);
+
+  // As above, with an optional wall-clock budget and heartbeat
+  TestResult run(const RunOptions &options);
+
+  // Execute up to max_instructions on Rv32iIss over this runner's memory,
+  // then load the architectural state (x1-x31, PC, machine CSRs, instret)
+  // into the RTL so the next run() continues from there. The cycle/time
+  // CSRs advance by the cycles the RTL would have taken (FsmTiming at
+  // memory_delay); get_cycle_count() only counts cycles run on the RTL.
+  // Stops early if the program writes its result or halts. Needs the RTL
+  // backdoor and the control FSM in FETCH_0, as it is after reset() and
+  // load_program(). Memory statistics include the ISS's loads and stores.
+  // Returns the number of instructions executed
+  uint64_t run_functional(uint64_t max_instructions);
+
+  // Checkpointing. save_checkpoint() writes the Verilated model state,
+  // simulation time, memory contents (non-zero resident pages), memory FSM
+  // and statistics, and the cycle and hang detection counters to path
+  // (through a temporary file, so a run killed while saving keeps the
+  // previous checkpoint). restore_checkpoint() loads one into this runner,
+  // whose config must have the same memory size and delay; the next run()
+  // then continues the interrupted run, with cycle counts and max_cycles
+  // including the cycles before the checkpoint. Restore into a runner that
+  // has not run yet (a trace carries on from the checkpoint's time). Only
+  // a build of the same RTL and Verilator can read a checkpoint; coverage,
+  // the loaded program's symbols and co-simulation state are not saved,
+  // and co-simulation is stopped on restore. Both return false on error
+  bool save_checkpoint(const std::string &path);
+  bool restore_checkpoint(const std::string &path);
+
+  // Fork n copies of the whole process in the runner's current state and
+  // call fn(clone, index, output) in each, at most max_parallel at a time
+  // (0 = one per hardware thread). Memory is shared copy-on-write, so the
+  // prefix simulated so far is never repeated. Results come back over a
+  // pipe per clone, in index order; this runner is left as it was. Only
+  // the calling thread exists in a clone: call it with no other runners
+  // in flight, and check results in the parent (Boost.Test assertions made
+  // in a clone are lost). Clones run untraced and without co-simulation,
+  // and write no coverage
+  std::vector<CloneResult> fork_clones(unsigned n, const CloneFunction &fn,
+                                       unsigned max_parallel = 0);
+
+  // Observe the retired instruction stream during run() (RTL builds; the
+  // instruction that writes the result ends the run before it retires).
+  // An empty hook turns it off
+  void set_retire_hook(RetireHook hook);
+
+  // Change the memory latency from the next cycle on (the hang bound
+  // follows unless hang_cycles is set), e.g. per clone in a latency sweep
+  void set_memory_delay(uint32_t delay);
 
   // Accessors
-  uint32_t get_cycle_count() const { return cycle_count; }
+  uint64_t get_cycle_count() const { return cycle_count; }
+  uint64_t get_skipped_cycles() const { return skipped_cycles; }
   uint32_t get_result() const; // Read from magic address
   uint32_t get_pc() const;
 
   // Direct access to components for advanced testing
   MemoryModel &get_memory() { return *memory; }
+  const ElfImage &get_program() const { return program; }
   Vcore_top &get_dut() { return *dut; }
+  VerilatedContext &get_context() { return *context; }
+  const TestRunnerConfig &get_config() const { return config; }
+  LogSink &get_log() { return log; }
+  CosimChecker *get_cosim() { return cosim; } // nullptr unless active
+  // nullptr unless commit_log_file is set (closed by the destructor)
+  CommitLogWriter *get_commit_log() { return commit_log; }
+  // Profile of the last run(); nullptr unless fsm_profile is set
+  const FsmProfile *get_fsm_profile() const { return fsm_profile; }
+  // Profile of the last run(); nullptr unless pc_profile is set
+  const PcProfile *get_pc_profile() const { return pc_profile; }
+  // Statistics of the last run(); nullptr unless memory_stats is set
+  const MemoryStats *get_memory_stats() const {
+    return memory->get_access_stats();
+  }
+  // Timeline of the last run(); nullptr unless timeline_file is set
+  const TimelineTrace *get_timeline() const { return timeline; }
 
   // Control
   void reset();
   void clock_cycle();
+  // Advance up to max_cycles (>= 1): fast-forwards a memory stall when
+  // possible, otherwise one clock_cycle(). Returns the cycles advanced
+  uint64_t step(uint64_t max_cycles);
 
 private:
   // Verilator components
+  VerilatedContext *context;
   Vcore_top *dut;
   MemoryModel *memory;
-  VerilatedVcdC *trace;
+  TraceWriter *trace;
+
+  // Most recently loaded program (entry point and symbols)
+  ElfImage program;
 
-  // Simulation state
+  // Simulation state (simulation time lives in the context)
+  TestRunnerConfig config;
+  LogSink log; // Buffered; shared with the memory model
   uint64_t cycle_count;
-  uint64_t sim_time;
-  bool trace_enabled;
+  uint64_t skipped_cycles; // Cycles covered by fast-forward
+  bool fast_forward_enabled;
   std::string test_name;
 
-  // Previous PC for stuck detection
-  uint32_t previous_pc;
-  int stuck_count;
+  // Set by the MAGIC_RESULT_ADDR write watch
+  bool result_written;
+
+  // Set by restore_checkpoint(): the next run() keeps the restored counters
+  bool resume_run;
+
+  // Steps between wall-clock reads when a budget or heartbeat is set
+  static constexpr uint32_t CLOCK_CHECK_STEPS = 1024;
+
+  // Hang detection - cycle of the last completed bus transaction and the
+  // last retired instruction
+  static constexpr uint64_t MIN_HANG_CYCLES = 1000;
+  uint64_t hang_cycles; // Resolved from config
+  uint64_t last_bus_count;
+  uint64_t last_bus_cycle;
+  uint64_t last_instret;
+  uint64_t last_retire_cycle;
+
+  // Loop detection - Brent's cycle finding over instruction boundaries.
+  // The snapshot (PC, memory change count, register/CSR hash) is retaken
+  // every loop_power instructions; meeting it again means the core is
+  // going round forever
+  static constexpr uint64_t MAX_LOOP_POWER = 1u << 16;
+  bool loop_valid;
+  uint32_t loop_pc;
+  uint64_t loop_changes;
+  uint64_t loop_hash;
+  uint64_t loop_power;
+  uint64_t loop_length;
+
+  // Retired instruction stream - instret and PC at the last retire
+  RetireHook retire_hook;
+  uint64_t retire_instret;
+  uint32_t retire_pc;
+
+  // Co-simulation - the commit being collected for the next retire (the
+  // store watch fills in stores) and the register file after the last one
+  CosimChecker *cosim;
+  CosimCommit cosim_pending;
+  uint64_t cosim_instret;
+  uint32_t cosim_regs[32];
+
+  // Commit log of retired instructions
+  CommitLogWriter *commit_log;
+
+  // FSM occupancy profile of the current run
+  FsmProfile *fsm_profile;
+
+  // PC-sampling profile of the current run
+  PcProfile *pc_profile;
+
+  // Timeline of the current run
+  TimelineTrace *timeline;
+
+  // Trace capture - clock_cycle() dumps while trace_dumping. The window is
+  // known once triggered (from the start without a trigger); retires up to
+  // trace_replay_cycle were already reported before a pre-trigger rewind
+  static constexpr uint64_t MIN_SNAPSHOT_CYCLES = 100000;
+  bool trace_dumping;
+  bool trace_triggered;
+  bool trace_write_hit; // Set by the write trigger watch
+  uint64_t trace_window_start;
+  uint64_t trace_window_stop;
+  uint64_t trace_replay_cycle;
+  // Pre-trigger snapshots, used as a ring of two
+  bool trace_snapshot_valid[2];
+  uint64_t trace_snapshot_cycle[2];
+  unsigned trace_snapshot_next;
 
   // Helper functions
+  void init();
+  TestResult run_loop(const RunOptions &options);
+  RunHeartbeat make_heartbeat(double elapsed_seconds, uint64_t last_cycles,
+                              double last_elapsed_seconds) const;
+  void reset_progress();
+  uint64_t cycles_to_hang() const;
+  bool check_progress(); // True (after logging) if the core has hung
+  [[noreturn]] void run_clone(int fd, unsigned index,
+                             const CloneFunction &fn);
+  void resolve_hang_cycles();
+  void start_cosim(const std::string &program_file);
+  void commit_cosim(uint64_t instret);
+  TestResult finish_cosim(TestResult result);
+  void open_commit_log();
+  void log_commit(uint32_t pc);
+  void close_commit_log();
+  uint64_t profile_step(uint64_t max_cycles);
+  void report_fsm_profile();
+  void sample_pc(uint32_t pc, uint64_t start);
+  void report_pc_profile();
+  void report_memory_stats();
+  TimelineSample sample_timeline();
+  void report_timeline();
   void setup_trace();
   void cleanup_trace();
+  std::string trace_snapshot_path(unsigned index) const;
+  void update_trace_capture();
+  void rewind_trace();
+  uint64_t cycles_to_trace() const;
+  bool write_checkpoint(const std::string &path, size_t &memory_bytes);
+  bool read_checkpoint(const std::string &path);
   bool is_test_complete() const;
   TestResult get_test_result() const;
 };
@@ -17,6 +17,9 @@ constexpr uint32_t MAGIC_PASS_VALUE = 0x00000001;  // Write to indicate pass
 constexpr uint32_t MAGIC_FAIL_VALUE =
     0xFFFFFFFF; // Write to indicate fail (NOT 0, as memory initializes to 0)
 
+// Core reset vector (u_pc INIT in core_top.sv)
+constexpr uint32_t RESET_PC = 0x00001000;
+
 // Test result enumeration
 enum class TestResult { PASS, FAIL, TIMEOUT, ERROR };
 
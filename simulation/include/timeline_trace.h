@@ -0,0 +1,152 @@
+/*
+ * Instruction Timeline Trace
+ *
+ * Records what the core did cycle by cycle as a Chrome trace-event JSON
+ * file, which ui.perfetto.dev and chrome://tracing open directly. One
+ * process (the test) with three tracks:
+ *   - Instructions: one slice per instruction, from its FETCH_0 to the
+ *     last state before the next FETCH_0, named by its disassembly (args:
+ *     pc, insn, cycles), with a nested slice per control FSM state
+ *   - Memory: one slice per MemoryModel transaction, from the edge that
+ *     accepted the request to the one that completed it (args: addr, data,
+ *     byte enables, latency), named "fetch", "read" or "write" and the
+ *     address
+ *   - Traps: one slice per trap from TRAP_ENTRY_0 to the end of the MRET_0
+ *     that returns from it, named by mcause (args: mepc, mcause), with the
+ *     entry sequence and the MRET nested. The core does not nest traps (a
+ *     trap in a handler overwrites mepc), so a new trap ends an open one
+ *
+ * Time is in clock cycles, written as microseconds (a 1us slice is one
+ * cycle). Only slices overlapping [start_cycle, stop_cycle) are kept, cut
+ * to that window; the whole run is recorded by default, which for long
+ * programs makes large files, so pick a window around the region of
+ * interest. Slices still open when the trace is written (the instruction
+ * in flight, a trap without its MRET) end at the last cycle seen.
+ *
+ * TestRunner feeds the trace from run() (TestRunnerConfig::timeline_file):
+ * before every step it samples the control state, PC, IR and mcause and
+ * hands them over with the cycles the step advanced, and a MemoryModel bus
+ * monitor adds the transactions. The instruction and trap tracks need the
+ * RTL backdoor; the netlists only get the memory track.
+ *
+ * Usage Example:
+ *   TimelineTrace timeline(1000, 2000);   // Cycles [1000, 2000)
+ *   timeline.set_name("add");
+ *   timeline.add_cycles(sample, 1000, 1005); // State held for 5 cycles
+ *   timeline.add_transaction(transaction, 1004); // Completed in 1004
+ *   std::ofstream("add.trace.json") << timeline.format_json();
+ */
+
+#ifndef TIMELINE_TRACE_H
+#define TIMELINE_TRACE_H
+
+#include "../memory_model.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Core state sampled before a clock edge
+struct TimelineSample {
+  uint32_t state = 0;  // Control FSM state (FsmState)
+  uint32_t pc = 0;
+  uint32_t insn = 0;   // IR; holds the previous instruction until FETCH_3
+  uint32_t mcause = 0;
+};
+
+// One complete ("X") event
+struct TimelineSlice {
+  uint32_t track = 0;
+  std::string category; // "insn", "state", "read", "write", "trap", ...
+  std::string name;
+  uint64_t begin = 0; // First cycle
+  uint64_t end = 0;   // Exclusive
+  std::string args;   // JSON object members, e.g. "\"pc\": \"0x00001000\""
+};
+
+class TimelineTrace {
+public:
+  enum Track : uint32_t {
+    TRACK_INSTRUCTIONS = 1,
+    TRACK_MEMORY,
+    TRACK_TRAPS
+  };
+
+  explicit TimelineTrace(uint64_t start_cycle = 0,
+                         uint64_t stop_cycle = UINT64_MAX);
+
+  // Process name shown in the viewer
+  void set_name(const std::string &name) { process_name = name; }
+
+  // The core was in sample.state throughout cycles [from_cycle, to_cycle)
+  void add_cycles(const TimelineSample &sample, uint64_t from_cycle,
+                  uint64_t to_cycle);
+
+  // A bus transaction completed on the edge ending cycle
+  void add_transaction(const MemoryModel::BusTransaction &transaction,
+                       uint64_t cycle);
+
+  // Drop all slices and open state (keeps the window and name)
+  void reset();
+
+  // Accessors
+  uint64_t get_start_cycle() const { return start_cycle; }
+  uint64_t get_stop_cycle() const { return stop_cycle; }
+  // Instructions, transactions and traps that began, in or out of window
+  uint64_t get_instructions() const { return instructions; }
+  uint64_t get_transactions() const { return transactions; }
+  uint64_t get_traps() const { return traps; }
+  // Slices of one track in the window, in order of their first cycle
+  // (outer slices first), including the ones still open
+  std::vector<TimelineSlice> get_slices(Track track) const;
+
+  // Chrome trace-event JSON
+  std::string format_json() const;
+
+private:
+  struct Trap {
+    uint64_t begin;
+    uint64_t entry_end; // 0 while in the entry sequence
+    uint32_t mepc;
+    uint32_t mcause;
+  };
+
+  uint64_t start_cycle;
+  uint64_t stop_cycle;
+  std::string process_name;
+  std::vector<TimelineSlice> slices;
+  uint64_t instructions;
+  uint64_t transactions;
+  uint64_t traps;
+
+  // Current state slice
+  bool have_state;
+  uint32_t state;
+  uint64_t state_begin;
+  uint64_t state_end;
+  // Instruction in flight
+  bool have_insn;
+  uint64_t insn_begin;
+  uint32_t insn_pc;
+  bool insn_decoded; // insn_word is known (past FETCH_3)
+  uint32_t insn_word;
+  // Trap not returned from yet, and the MRET in progress
+  bool have_trap;
+  Trap trap;
+  uint64_t mret_begin;
+
+  // Cut [begin, end) to the window; false if nothing is left
+  bool clip(uint64_t &begin, uint64_t &end) const;
+  void add(std::vector<TimelineSlice> &out, uint32_t track,
+           const char *category, const std::string &name, uint64_t begin,
+           uint64_t end, const std::string &args = std::string()) const;
+  void close_trap(uint64_t end);
+  void change_state(const TimelineSample &sample, uint64_t from_cycle);
+  // Slices of what is open at the last cycle seen
+  std::vector<TimelineSlice> open_slices() const;
+  std::string insn_name() const;
+  std::string insn_args(uint64_t cycles) const;
+  static std::string trap_name(const Trap &trap);
+  static std::string trap_args(const Trap &trap);
+};
+
+#endif // TIMELINE_TRACE_H
@@ -3,6 +3,7 @@
  */
 
 #include "memory_model.h"
+#include <algorithm>
 #include <cctype>
 #include <iomanip>
 #include <sstream>
@@ -14,126 +15,239 @@ static std::string to_hex(uint32_t value) {
   return oss.str();
 }
 
-MemoryModel::MemoryModel(uint32_t size_bytes, uint32_t delay, bool debug)
-    : memory_size(size_bytes), delay_cycles(delay), debug_enabled(debug),
-      state(IDLE), next_state(IDLE), cycle_count(0), output_buffer(0),
-      old_read(false), old_write(false), old_clk(false), read_count(0),
-      write_count(0) {
-  memory.resize(memory_size, 0);
-  log("Memory model initialized: " + std::to_string(size_bytes) + " bytes, " +
-      std::to_string(delay) + " cycle delay");
+// Fixed-width fields of a saved state, in host byte order
+template <typename T> static void save_value(std::ostream &out, T value) {
+  out.write(reinterpret_cast<const char *>(&value), sizeof(value));
 }
 
-MemoryModel::~MemoryModel() {
-  if (debug_enabled) {
-    log("Memory statistics - Reads: " + std::to_string(read_count) +
-        ", Writes: " + std::to_string(write_count));
+template <typename T> static bool load_value(std::istream &in, T &value) {
+  return static_cast<bool>(
+      in.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+// Saved state header ("RVMS", format 1)
+static constexpr uint32_t STATE_MAGIC = 0x534D5652;
+static constexpr uint32_t STATE_VERSION = 1;
+
+// Informational and debug messages need the debug flag; warnings and errors
+// are always passed to the sink. Nothing is formatted unless it is written.
+#define MEM_LOG(level, expr)                                                   \
+  do {                                                                         \
+    if ((level) >= LogLevel::WARN || debug_enabled) {                          \
+      SIM_LOG(*sink, level, "MEM", expr);                                      \
+    }                                                                          \
+  } while (0)
+
+MemoryModel::MemoryModel(uint32_t size_bytes, uint32_t delay, bool debug,
+                         LogSink *log_sink)
+    : resident_pages(0), memory_size(size_bytes), delay_cycles(delay),
+      debug_enabled(debug), state(IDLE), next_state(IDLE), cycle_count(0),
+      output_buffer(0), old_read(false), old_write(false), old_clk(false),
+      read_count(0), write_count(0), change_count(0), next_watch_id(0),
+      sink(log_sink) {
+  if (!sink) {
+    own_sink.reset(new LogSink(LogLevel::INFO));
+    sink = own_sink.get();
   }
+  page_directory.resize(TABLE_ENTRIES);
+  MEM_LOG(LogLevel::INFO, "Memory model initialized: "
+                              << size_bytes << " bytes, " << delay
+                              << " cycle delay");
+}
+
+MemoryModel::~MemoryModel() {
+  MEM_LOG(LogLevel::INFO, "Memory statistics - Reads: "
+                              << read_count << ", Writes: " << write_count
+                              << ", Resident pages: " << resident_pages);
 }
 
+
 void MemoryModel::eval(bool clk, bool rst_n, bool read, bool write,
                        uint32_t addr, uint32_t data_in, uint32_t &data_out,
-                       bool &resp, uint8_t byte_enables) {
+                       bool &resp, uint8_t byte_enables, bool ifetch) {
   // Detect rising edge
   bool rising_edge = clk && !old_clk;
   old_clk = clk;
 
   if (!rst_n) {
-    // Reset
-    state = IDLE;
-    next_state = IDLE;
-    old_read = false;
-    old_write = false;
-    cycle_count = 0;
-    resp = false;
-    data_out = output_buffer;
+    reset_state(data_out, resp);
     return;
   }
 
   if (rising_edge) {
-    // Compute next state BEFORE updating old_read/old_write
-    // This matches SystemVerilog behavior where combinational logic
-    // sees old flip-flop values before non-blocking assignments take effect
+    clock_edge(read, write, addr, data_in, byte_enables, ifetch);
+  } else {
+    // Update next state on non-edge evals too (combinational)
     update_next_state(read, write);
+  }
 
-    // Update state on rising edge
-    bool state_changed = (state != next_state);
-    state = next_state;
-    old_read = read;
-    old_write = write;
-
-    // State-specific actions
-    if (state == WAIT_READ || state == WAIT_WRITE) {
-      if (state_changed) {
-        cycle_count = 0; // Reset count when entering wait state
-      } else {
-        cycle_count++; // Increment count while in wait state
-      }
+  // Generate outputs (combinational)
+  resp = (state == DONE_READ || state == DONE_WRITE);
+  data_out = output_buffer;
+}
+
+void MemoryModel::eval_posedge(bool rst_n, bool read, bool write,
+                               uint32_t addr, uint32_t data_in,
+                               uint32_t &data_out, bool &resp,
+                               uint8_t byte_enables, bool ifetch) {
+  // Same as eval(1, ...) following eval(0, ...): the falling-edge call only
+  // recomputes next_state, which clock_edge() does again before using it
+  if (!rst_n) {
+    reset_state(data_out, resp);
+    return;
+  }
+
+  clock_edge(read, write, addr, data_in, byte_enables, ifetch);
+
+  resp = (state == DONE_READ || state == DONE_WRITE);
+  data_out = output_buffer;
+}
+
+uint32_t MemoryModel::get_idle_wait_cycles() const {
+  if (state != WAIT_READ && state != WAIT_WRITE) {
+    return 0;
+  }
+  // update_next_state() leaves WAIT once cycle_count reaches delay - 1, and
+  // every edge before that only increments cycle_count
+  uint32_t last = delay_cycles - 1;
+  return (cycle_count < last) ? last - cycle_count : 0;
+}
+
+void MemoryModel::skip_wait_cycles(uint32_t n, bool read, bool write) {
+  if (n == 0) {
+    return;
+  }
+  cycle_count += n;
+  old_read = read;
+  old_write = write;
+  if (access_stats) {
+    access_stats->advance(n);
+  }
+}
+
+void MemoryModel::reset_state(uint32_t &data_out, bool &resp) {
+  state = IDLE;
+  next_state = IDLE;
+  old_read = false;
+  old_write = false;
+  cycle_count = 0;
+  resp = false;
+  data_out = output_buffer;
+}
+
+void MemoryModel::clock_edge(bool read, bool write, uint32_t addr,
+                             uint32_t data_in, uint8_t byte_enables,
+                             bool ifetch) {
+  // Compute next state BEFORE updating old_read/old_write
+  // This matches SystemVerilog behavior where combinational logic
+  // sees old flip-flop values before non-blocking assignments take effect
+  update_next_state(read, write);
+
+  // Update state on rising edge
+  bool state_changed = (state != next_state);
+  state = next_state;
+  old_read = read;
+  old_write = write;
+
+  // State-specific actions
+  if (state == WAIT_READ || state == WAIT_WRITE) {
+    if (state_changed) {
+      cycle_count = 0; // Reset count when entering wait state
+    } else {
+      cycle_count++; // Increment count while in wait state
     }
+  }
 
-    if (state == DONE_READ) {
-      // Perform read - little-endian byte ordering
-      if (is_valid_address(addr) && is_valid_address(addr + 3)) {
-        output_buffer = static_cast<uint32_t>(memory[addr]) |
-                        (static_cast<uint32_t>(memory[addr + 1]) << 8) |
-                        (static_cast<uint32_t>(memory[addr + 2]) << 16) |
-                        (static_cast<uint32_t>(memory[addr + 3]) << 24);
-        read_count++;
-        // log("READ  addr=0x" + to_hex(addr) + " data=0x" +
-        //     to_hex(output_buffer));
-      } else {
-        log("ERROR: Invalid read address 0x" + to_hex(addr));
-        output_buffer = 0xDEADBEEF; // Error pattern
-      }
+  if (state == DONE_READ) {
+    output_buffer = bus_read_word(addr, byte_enables, ifetch);
+  }
+
+  if (state == DONE_WRITE) {
+    bus_write_word(addr, data_in, byte_enables);
+  }
+
+  // The wait count stops at the edge before DONE
+  if (bus_monitor && (state == DONE_READ || state == DONE_WRITE)) {
+    const bool is_write = (state == DONE_WRITE);
+    bus_monitor(BusTransaction{addr, is_write ? data_in : output_buffer,
+                               byte_enables, is_write, ifetch && !is_write,
+                               cycle_count + 1});
+  }
+
+  // Accesses are timed by the edge they complete on
+  if (access_stats) {
+    access_stats->advance(1);
+  }
+}
+
+uint32_t MemoryModel::bus_read_word(uint32_t addr, uint8_t byte_enables,
+                                    bool ifetch) {
+  // Perform read - little-endian byte ordering
+  if (is_valid_address(addr) && is_valid_address(addr + 3)) {
+    uint32_t data = read_word(addr);
+    read_count++;
+    if (access_stats) {
+      access_stats->record(
+          addr, ifetch ? MemoryStats::FETCH : MemoryStats::READ, byte_enables);
     }
+    MEM_LOG(LogLevel::TRACE,
+            "READ  addr=0x" << to_hex(addr) << " data=0x" << to_hex(data));
+    return data;
+  }
 
-    if (state == DONE_WRITE) {
-      // Perform write - little-endian byte ordering
-      // Only write bytes where byte_enables is set
-      // Special case: Allow writes to magic address region
-      // (0xDEAD0000-0xDEADFFFF) even though it's outside physical memory for
-      // test result communication
-      if ((addr & 0xFFFF0000) == 0xDEAD0000) {
-        // Write to magic address region - store in special location
-        // Map 0xDEAD0000+ to the last 64KB of physical memory
-        uint32_t magic_offset = (memory_size - 65536) + (addr & 0xFFFF);
-        if (magic_offset + 3 < memory_size) {
-          if (byte_enables & 0x1)
-            memory[magic_offset] = data_in & 0xFF;
-          if (byte_enables & 0x2)
-            memory[magic_offset + 1] = (data_in >> 8) & 0xFF;
-          if (byte_enables & 0x4)
-            memory[magic_offset + 2] = (data_in >> 16) & 0xFF;
-          if (byte_enables & 0x8)
-            memory[magic_offset + 3] = (data_in >> 24) & 0xFF;
-          write_count++;
-          log("WRITE addr=0x" + to_hex(addr) + " data=0x" + to_hex(data_in) +
-              " be=0x" + to_hex(byte_enables) + " (magic address)");
-        }
-      } else if (is_valid_address(addr) && is_valid_address(addr + 3)) {
-        if (byte_enables & 0x1)
-          memory[addr] = data_in & 0xFF;
-        if (byte_enables & 0x2)
-          memory[addr + 1] = (data_in >> 8) & 0xFF;
-        if (byte_enables & 0x4)
-          memory[addr + 2] = (data_in >> 16) & 0xFF;
-        if (byte_enables & 0x8)
-          memory[addr + 3] = (data_in >> 24) & 0xFF;
-        write_count++;
-        // log("WRITE addr=0x" + to_hex(addr) + " data=0x" + to_hex(data_in) +
-        //     " be=0x" + to_hex(byte_enables));
-      } else {
-        log("ERROR: Invalid write address 0x" + to_hex(addr));
+  MEM_LOG(LogLevel::WARN, "ERROR: Invalid read address 0x" << to_hex(addr));
+  return 0xDEADBEEF; // Error pattern
+}
+
+void MemoryModel::bus_write_word(uint32_t addr, uint32_t data_in,
+                                 uint8_t byte_enables) {
+  // Perform write - little-endian byte ordering
+  // Only write bytes where byte_enables is set
+  // Special case: Allow writes to magic address region
+  // (0xDEAD0000-0xDEADFFFF) even though it's outside physical memory for
+  // test result communication
+  if ((addr & 0xFFFF0000) == 0xDEAD0000) {
+    // Write to magic address region - store in special location
+    // Map 0xDEAD0000+ to the last 64KB of physical memory
+    uint32_t magic_offset = (memory_size - 65536) + (addr & 0xFFFF);
+    if (magic_offset + 3 < memory_size) {
+      store_word(magic_offset, data_in, byte_enables);
+      if (access_stats) {
+        access_stats->record(addr, MemoryStats::WRITE, byte_enables);
+      }
+      MEM_LOG(LogLevel::DEBUG, "WRITE addr=0x"
+                                   << to_hex(addr) << " data=0x"
+                                   << to_hex(data_in) << " be=0x"
+                                   << to_hex(byte_enables)
+                                   << " (magic address)");
+      if (!write_watches.empty()) {
+        check_write_watches(addr, data_in, byte_enables);
       }
     }
+  } else if (is_valid_address(addr) && is_valid_address(addr + 3)) {
+    store_word(addr, data_in, byte_enables);
+    if (access_stats) {
+      access_stats->record(addr, MemoryStats::WRITE, byte_enables);
+    }
+    if (!write_watches.empty()) {
+      check_write_watches(addr, data_in, byte_enables);
+    }
+    MEM_LOG(LogLevel::TRACE, "WRITE addr=0x"
+                                 << to_hex(addr) << " data=0x"
+                                 << to_hex(data_in) << " be=0x"
+                                 << to_hex(byte_enables));
   } else {
-    // Update next state on non-edge evals too (combinational)
-    update_next_state(read, write);
+    MEM_LOG(LogLevel::WARN,
+            "ERROR: Invalid write address 0x" << to_hex(addr));
   }
+}
 
-  // Generate outputs (combinational)
-  resp = (state == DONE_READ || state == DONE_WRITE);
-  data_out = output_buffer;
+void MemoryModel::store_word(uint32_t offset, uint32_t data,
+                             uint8_t byte_enables) {
+  write_count++;
+  if (write_word(offset, data, byte_enables)) {
+    change_count++;
+  }
 }
 
 void MemoryModel::update_next_state(bool read, bool write) {
@@ -183,7 +297,7 @@ void MemoryModel::update_next_state(bool read, bool write) {
 bool MemoryModel::load_hex_file(const std::string &filename) {
   std::ifstream file(filename);
   if (!file.is_open()) {
-    log("ERROR: Cannot open file: " + filename);
+    MEM_LOG(LogLevel::ERROR, "ERROR: Cannot open file: " << filename);
     return false;
   }
 
@@ -201,22 +315,22 @@ bool MemoryModel::load_hex_file(const std::string &filename) {
           uint8_t byte_val =
               static_cast<uint8_t>(std::stoi(byte_str, nullptr, 16));
           if (addr < memory_size) {
-            memory[addr++] = byte_val;
+            write_byte(addr++, byte_val);
           } else {
-            log("WARNING: File exceeds memory size at byte " +
-                std::to_string(addr));
+            MEM_LOG(LogLevel::WARN,
+                    "WARNING: File exceeds memory size at byte " << addr);
             file.close();
             return false;
           }
         } catch (const std::exception &e) {
-          log("WARNING: Invalid hex value: " + byte_str);
+          MEM_LOG(LogLevel::WARN, "WARNING: Invalid hex value: " << byte_str);
         }
       }
     }
   }
 
   file.close();
-  log("Loaded " + std::to_string(addr) + " bytes from " + filename);
+  MEM_LOG(LogLevel::INFO, "Loaded " << addr << " bytes from " << filename);
   return true;
 }
 
@@ -225,10 +339,7 @@ uint32_t MemoryModel::backdoor_read_word(uint32_t addr) const {
   if ((addr & 0xFFFF0000) == 0xDEAD0000) {
     uint32_t magic_offset = (memory_size - 65536) + (addr & 0xFFFF);
     if (magic_offset + 3 < memory_size) {
-      return static_cast<uint32_t>(memory[magic_offset]) |
-             (static_cast<uint32_t>(memory[magic_offset + 1]) << 8) |
-             (static_cast<uint32_t>(memory[magic_offset + 2]) << 16) |
-             (static_cast<uint32_t>(memory[magic_offset + 3]) << 24);
+      return read_word(magic_offset);
     }
     return 0xDEADBEEF;
   }
@@ -237,17 +348,14 @@ uint32_t MemoryModel::backdoor_read_word(uint32_t addr) const {
     return 0xDEADBEEF;
   }
 
-  return static_cast<uint32_t>(memory[addr]) |
-         (static_cast<uint32_t>(memory[addr + 1]) << 8) |
-         (static_cast<uint32_t>(memory[addr + 2]) << 16) |
-         (static_cast<uint32_t>(memory[addr + 3]) << 24);
+  return read_word(addr);
 }
 
 uint8_t MemoryModel::backdoor_read_byte(uint32_t addr) const {
   if (!is_valid_address(addr)) {
     return 0xFF;
   }
-  return memory[addr];
+  return read_byte(addr);
 }
 
 void MemoryModel::backdoor_write_word(uint32_t addr, uint32_t data) {
@@ -255,17 +363,55 @@ void MemoryModel::backdoor_write_word(uint32_t addr, uint32_t data) {
     return;
   }
 
-  memory[addr] = data & 0xFF;
-  memory[addr + 1] = (data >> 8) & 0xFF;
-  memory[addr + 2] = (data >> 16) & 0xFF;
-  memory[addr + 3] = (data >> 24) & 0xFF;
+  write_word(addr, data, 0xF);
 }
 
 void MemoryModel::backdoor_write_byte(uint32_t addr, uint8_t data) {
   if (!is_valid_address(addr)) {
     return;
   }
-  memory[addr] = data;
+  write_byte(addr, data);
+}
+
+void MemoryModel::backdoor_write_block(uint32_t addr, const uint8_t *data,
+                                       uint32_t size) {
+  if (!is_valid_address(addr)) {
+    return;
+  }
+  if (size > memory_size - addr) {
+    size = memory_size - addr;
+  }
+
+  // Copy one page at a time
+  while (size > 0) {
+    uint32_t page_offset = addr & (PAGE_SIZE - 1);
+    uint32_t chunk = std::min(size, PAGE_SIZE - page_offset);
+    std::copy(data, data + chunk, touch_page(addr).data() + page_offset);
+    addr += chunk;
+    data += chunk;
+    size -= chunk;
+  }
+}
+
+void MemoryModel::backdoor_fill(uint32_t addr, uint8_t value, uint32_t size) {
+  if (!is_valid_address(addr)) {
+    return;
+  }
+  if (size > memory_size - addr) {
+    size = memory_size - addr;
+  }
+
+  while (size > 0) {
+    uint32_t page_offset = addr & (PAGE_SIZE - 1);
+    uint32_t chunk = std::min(size, PAGE_SIZE - page_offset);
+    // Zero-filling a page that was never written is a no-op
+    if (value != 0 || find_page(addr)) {
+      uint8_t *bytes = touch_page(addr).data() + page_offset;
+      std::fill(bytes, bytes + chunk, value);
+    }
+    addr += chunk;
+    size -= chunk;
+  }
 }
 
 void MemoryModel::dump_memory(uint32_t start_addr, uint32_t end_addr) const {
@@ -281,14 +427,14 @@ void MemoryModel::dump_memory(uint32_t start_addr, uint32_t end_addr) const {
     for (uint32_t i = 0;
          i < 16 && (addr + i) < end_addr && (addr + i) < memory_size; i++) {
       std::cout << std::setw(2) << std::setfill('0') << std::hex
-                << static_cast<int>(memory[addr + i]) << " ";
+                << static_cast<int>(read_byte(addr + i)) << " ";
     }
 
     // Print ASCII representation
     std::cout << " |";
     for (uint32_t i = 0;
          i < 16 && (addr + i) < end_addr && (addr + i) < memory_size; i++) {
-      char c = memory[addr + i];
+      char c = read_byte(addr + i);
       std::cout << (isprint(c) ? c : '.');
     }
     std::cout << "|\n";
@@ -297,18 +443,273 @@ void MemoryModel::dump_memory(uint32_t start_addr, uint32_t end_addr) const {
 }
 
 void MemoryModel::clear() {
-  std::fill(memory.begin(), memory.end(), 0);
+  // Release every page; unallocated pages read back as zero
+  for (auto &table : page_directory) {
+    table.reset();
+  }
+  resident_pages = 0;
   reset_statistics();
-  log("Memory cleared");
+  MEM_LOG(LogLevel::INFO, "Memory cleared");
+}
+
+int MemoryModel::add_write_watch(uint32_t addr, uint32_t size,
+                                 WriteCallback callback) {
+  WriteWatch watch;
+  watch.id = next_watch_id++;
+  watch.start = addr;
+  watch.end = static_cast<uint64_t>(addr) + size;
+  watch.callback = std::move(callback);
+  write_watches.push_back(std::move(watch));
+  return write_watches.back().id;
+}
+
+void MemoryModel::remove_write_watch(int id) {
+  for (auto it = write_watches.begin(); it != write_watches.end(); ++it) {
+    if (it->id == id) {
+      write_watches.erase(it);
+      return;
+    }
+  }
+}
+
+void MemoryModel::check_write_watches(uint32_t addr, uint32_t data,
+                                      uint8_t byte_enables) {
+  for (const WriteWatch &watch : write_watches) {
+    for (uint32_t i = 0; i < 4; i++) {
+      uint64_t byte_addr = static_cast<uint64_t>(addr) + i;
+      if ((byte_enables & (1u << i)) && byte_addr >= watch.start &&
+          byte_addr < watch.end) {
+        watch.callback(addr, data, byte_enables);
+        break;
+      }
+    }
+  }
 }
 
 void MemoryModel::reset_statistics() {
   read_count = 0;
   write_count = 0;
+  change_count = 0;
+  if (access_stats) {
+    access_stats->reset();
+  }
+}
+
+void MemoryModel::enable_access_stats(uint64_t window_cycles,
+                                      uint32_t line_bytes) {
+  access_stats.reset(new MemoryStats(window_cycles, line_bytes));
+}
+
+void MemoryModel::save_state(std::ostream &out) const {
+  save_value(out, STATE_MAGIC);
+  save_value(out, STATE_VERSION);
+  save_value(out, memory_size);
+  save_value(out, delay_cycles);
+
+  save_value(out, static_cast<uint32_t>(state));
+  save_value(out, static_cast<uint32_t>(next_state));
+  save_value(out, cycle_count);
+  save_value(out, output_buffer);
+  save_value(out, static_cast<uint8_t>(old_read));
+  save_value(out, static_cast<uint8_t>(old_write));
+  save_value(out, static_cast<uint8_t>(old_clk));
+
+  save_value(out, read_count);
+  save_value(out, write_count);
+  save_value(out, change_count);
+
+  // Only pages holding data: untouched and zero pages read back as zero
+  std::vector<std::pair<uint32_t, const Page *>> pages;
+  for (uint32_t t = 0; t < page_directory.size(); t++) {
+    const PageTable *table = page_directory[t].get();
+    if (!table) {
+      continue;
+    }
+    for (uint32_t p = 0; p < TABLE_ENTRIES; p++) {
+      const Page *page = (*table)[p].get();
+      if (page && std::any_of(page->begin(), page->end(),
+                              [](uint8_t byte) { return byte != 0; })) {
+        pages.emplace_back((t << TABLE_SHIFT) | p, page);
+      }
+    }
+  }
+  save_value(out, static_cast<uint32_t>(pages.size()));
+  for (const auto &entry : pages) {
+    save_value(out, entry.first);
+    out.write(reinterpret_cast<const char *>(entry.second->data()), PAGE_SIZE);
+  }
+  MEM_LOG(LogLevel::INFO, "Memory state saved: " << pages.size() << " of "
+                                                 << resident_pages
+                                                 << " resident pages");
+}
+
+bool MemoryModel::restore_state(std::istream &in) {
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  uint32_t size = 0;
+  uint32_t delay = 0;
+  if (!load_value(in, magic) || !load_value(in, version) ||
+      !load_value(in, size) || !load_value(in, delay) ||
+      magic != STATE_MAGIC || version != STATE_VERSION) {
+    MEM_LOG(LogLevel::ERROR, "Not a memory model state image");
+    return false;
+  }
+  if (size != memory_size || delay != delay_cycles) {
+    MEM_LOG(LogLevel::ERROR, "Memory state is for "
+                                 << size << " bytes with " << delay
+                                 << " cycle delay, model has " << memory_size
+                                 << " bytes with " << delay_cycles);
+    return false;
+  }
+
+  uint32_t saved_state = 0;
+  uint32_t saved_next_state = 0;
+  uint32_t saved_cycle_count = 0;
+  uint32_t saved_output = 0;
+  uint8_t saved_read = 0;
+  uint8_t saved_write = 0;
+  uint8_t saved_clk = 0;
+  uint64_t saved_reads = 0;
+  uint64_t saved_writes = 0;
+  uint64_t saved_changes = 0;
+  uint32_t page_count = 0;
+  if (!load_value(in, saved_state) || !load_value(in, saved_next_state) ||
+      !load_value(in, saved_cycle_count) || !load_value(in, saved_output) ||
+      !load_value(in, saved_read) || !load_value(in, saved_write) ||
+      !load_value(in, saved_clk) || !load_value(in, saved_reads) ||
+      !load_value(in, saved_writes) || !load_value(in, saved_changes) ||
+      !load_value(in, page_count) || saved_state > DONE_WRITE ||
+      saved_next_state > DONE_WRITE) {
+    MEM_LOG(LogLevel::ERROR, "Truncated or corrupt memory state");
+    return false;
+  }
+
+  // Read every page before touching the model so a bad image changes nothing
+  std::vector<std::pair<uint32_t, std::unique_ptr<Page>>> pages;
+  pages.reserve(page_count);
+  for (uint32_t i = 0; i < page_count; i++) {
+    uint32_t index = 0;
+    std::unique_ptr<Page> page(new Page());
+    if (!load_value(in, index) ||
+        !in.read(reinterpret_cast<char *>(page->data()), PAGE_SIZE) ||
+        static_cast<uint64_t>(index) << PAGE_SHIFT >= memory_size) {
+      MEM_LOG(LogLevel::ERROR, "Truncated or corrupt memory state");
+      return false;
+    }
+    pages.emplace_back(index, std::move(page));
+  }
+
+  for (auto &table : page_directory) {
+    table.reset();
+  }
+  resident_pages = 0;
+  for (auto &entry : pages) {
+    std::unique_ptr<PageTable> &table =
+        page_directory[entry.first >> TABLE_SHIFT];
+    if (!table) {
+      table.reset(new PageTable());
+    }
+    std::unique_ptr<Page> &page = (*table)[entry.first & (TABLE_ENTRIES - 1)];
+    if (!page) {
+      resident_pages++;
+    }
+    page = std::move(entry.second);
+  }
+
+  state = static_cast<State>(saved_state);
+  next_state = static_cast<State>(saved_next_state);
+  cycle_count = saved_cycle_count;
+  output_buffer = saved_output;
+  old_read = saved_read != 0;
+  old_write = saved_write != 0;
+  old_clk = saved_clk != 0;
+  read_count = saved_reads;
+  write_count = saved_writes;
+  change_count = saved_changes;
+  MEM_LOG(LogLevel::INFO,
+          "Memory state restored: " << resident_pages << " resident pages");
+  return true;
 }
 
-void MemoryModel::log(const std::string &message) const {
-  if (debug_enabled) {
-    std::cout << "[MEM] " << message << std::endl;
+
+const MemoryModel::Page *MemoryModel::find_page(uint32_t offset) const {
+  const PageTable *table =
+      page_directory[offset >> (PAGE_SHIFT + TABLE_SHIFT)].get();
+  if (!table) {
+    return nullptr;
+  }
+  return (*table)[(offset >> PAGE_SHIFT) & (TABLE_ENTRIES - 1)].get();
+}
+
+MemoryModel::Page &MemoryModel::touch_page(uint32_t offset) {
+  std::unique_ptr<PageTable> &table =
+      page_directory[offset >> (PAGE_SHIFT + TABLE_SHIFT)];
+  if (!table) {
+    table.reset(new PageTable());
+  }
+
+  std::unique_ptr<Page> &page =
+      (*table)[(offset >> PAGE_SHIFT) & (TABLE_ENTRIES - 1)];
+  if (!page) {
+    page.reset(new Page()); // Value-initialized, i.e. zero-filled
+    resident_pages++;
+  }
+  return *page;
+}
+
+uint8_t MemoryModel::read_byte(uint32_t offset) const {
+  const Page *page = find_page(offset);
+  return page ? (*page)[offset & (PAGE_SIZE - 1)] : 0;
+}
+
+void MemoryModel::write_byte(uint32_t offset, uint8_t data) {
+  touch_page(offset)[offset & (PAGE_SIZE - 1)] = data;
+}
+
+uint32_t MemoryModel::read_word(uint32_t offset) const {
+  uint32_t page_offset = offset & (PAGE_SIZE - 1);
+  if (page_offset > PAGE_SIZE - 4) {
+    // Unaligned word straddling two pages
+    return static_cast<uint32_t>(read_byte(offset)) |
+           (static_cast<uint32_t>(read_byte(offset + 1)) << 8) |
+           (static_cast<uint32_t>(read_byte(offset + 2)) << 16) |
+           (static_cast<uint32_t>(read_byte(offset + 3)) << 24);
+  }
+
+  const Page *page = find_page(offset);
+  if (!page) {
+    return 0;
+  }
+  const uint8_t *bytes = page->data() + page_offset;
+  return static_cast<uint32_t>(bytes[0]) |
+         (static_cast<uint32_t>(bytes[1]) << 8) |
+         (static_cast<uint32_t>(bytes[2]) << 16) |
+         (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+bool MemoryModel::write_word(uint32_t offset, uint32_t data,
+                             uint8_t byte_enables) {
+  // Little-endian byte ordering, only bytes with their enable set
+  uint32_t page_offset = offset & (PAGE_SIZE - 1);
+  bool changed = false;
+  if (page_offset > PAGE_SIZE - 4) {
+    for (uint32_t i = 0; i < 4; i++) {
+      if (byte_enables & (1u << i)) {
+        const uint8_t value = (data >> (8 * i)) & 0xFF;
+        changed |= read_byte(offset + i) != value;
+        write_byte(offset + i, value);
+      }
+    }
+    return changed;
+  }
+
+  uint8_t *bytes = touch_page(offset).data() + page_offset;
+  for (uint32_t i = 0; i < 4; i++) {
+    if (byte_enables & (1u << i)) {
+      const uint8_t value = (data >> (8 * i)) & 0xFF;
+      changed |= bytes[i] != value;
+      bytes[i] = value;
+    }
   }
+  return changed;
 }
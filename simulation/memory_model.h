@@ -7,22 +7,35 @@
  *
  * Features:
  *   - Parameterizable size and delay
+ *   - Sparse paged backing store (4KB pages allocated on first write)
  *   - Word-aligned 32-bit access
  *   - Little-endian byte ordering
  *   - Load from hex files
  *   - Backdoor read/write for test setup/verification
  *   - FSM-based delay modeling matching hardware
- *   - Debug logging capabilities
+ *   - Fast-forward over wait cycles (get_idle_wait_cycles/skip_wait_cycles)
+ *   - Write watchpoints on bus address ranges
+ *   - Bus monitor callback with each completed transaction and its latency
+ *   - Optional access statistics per page and region, reuse distances and
+ *     a heatmap over time (include/memory_stats.h)
+ *   - Checkpointing: contents (resident pages only), FSM and statistics
+ *   - Levelled, lazily formatted logging (include/sim_log.h)
  */
 
 #ifndef MEMORY_MODEL_H
 #define MEMORY_MODEL_H
 
+#include "include/memory_stats.h"
+#include "include/sim_log.h"
+#include <array>
 #include <cstdint>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 class MemoryModel {
@@ -30,18 +43,48 @@ public:
   // Memory states matching the SystemVerilog FSM
   enum State { IDLE = 0, WAIT_READ, WAIT_WRITE, DONE_READ, DONE_WRITE };
 
+  // Backing store page geometry
+  static constexpr uint32_t PAGE_SHIFT = 12;
+  static constexpr uint32_t PAGE_SIZE = 1u << PAGE_SHIFT; // 4KB
+
   // Constructor
   MemoryModel(uint32_t size_bytes = 1024 * 1024, // 1MB default
               uint32_t delay_cycles = 4,         // Match ram.sv default
-              bool debug = false);
+              bool debug = false,
+              LogSink *log_sink = nullptr); // nullptr: own stdout sink
 
   // Destructor
   ~MemoryModel();
 
-  // Main interface - call on every clock cycle
+  // Main interface - call on every clock cycle. ifetch marks a read as an
+  // instruction fetch (core_top's mem_ifetch); it only affects statistics
   void eval(bool clk, bool rst_n, bool read, bool write, uint32_t addr,
             uint32_t data_in, uint32_t &data_out, bool &resp,
-            uint8_t byte_enables = 0xF);
+            uint8_t byte_enables = 0xF, bool ifetch = false);
+
+  // Rising-edge-only variant of eval() for harnesses that skip the
+  // falling-edge call; produces the same state and outputs as the
+  // eval(0, ...) / eval(1, ...) pair. Do not mix with eval() on one model.
+  void eval_posedge(bool rst_n, bool read, bool write, uint32_t addr,
+                    uint32_t data_in, uint32_t &data_out, bool &resp,
+                    uint8_t byte_enables = 0xF, bool ifetch = false);
+
+  // Stall fast-forward support
+  // Rising edges, from now, on which the FSM is guaranteed to stay in
+  // WAIT_READ/WAIT_WRITE with resp low (0 when no request is pending)
+  uint32_t get_idle_wait_cycles() const;
+  // Apply n such edges at once (n <= get_idle_wait_cycles()); read/write
+  // are the request lines the requester holds during the wait
+  void skip_wait_cycles(uint32_t n, bool read, bool write);
+
+  // Untimed bus transactions for functional models (e.g. the ISS): the
+  // same address map, statistics, logging and write watches as the
+  // DONE_READ/DONE_WRITE states, without the FSM. addr is word aligned;
+  // unmapped reads return 0xDEADBEEF and unmapped writes are dropped.
+  // byte_enables and ifetch of a read only feed the access statistics
+  uint32_t bus_read_word(uint32_t addr, uint8_t byte_enables = 0xF,
+                         bool ifetch = false);
+  void bus_write_word(uint32_t addr, uint32_t data, uint8_t byte_enables);
 
   // Program loading
   bool load_hex_file(const std::string &filename);
@@ -51,23 +94,93 @@ public:
   uint8_t backdoor_read_byte(uint32_t addr) const;
   void backdoor_write_word(uint32_t addr, uint32_t data);
   void backdoor_write_byte(uint32_t addr, uint8_t data);
+  // Bulk variants used by program loaders; out-of-range bytes are dropped
+  void backdoor_write_block(uint32_t addr, const uint8_t *data, uint32_t size);
+  void backdoor_fill(uint32_t addr, uint8_t value, uint32_t size);
+
+  // Write watchpoints - the callback runs from the DONE_WRITE path, after
+  // the data is stored, whenever a bus write enables any byte in
+  // [addr, addr + size). Addresses are bus addresses (e.g. MAGIC_RESULT_ADDR),
+  // backdoor writes never trigger. Callbacks must not add or remove watches.
+  // Returns an id for remove_write_watch()
+  using WriteCallback =
+      std::function<void(uint32_t addr, uint32_t data, uint8_t byte_enables)>;
+  int add_write_watch(uint32_t addr, uint32_t size, WriteCallback callback);
+  void remove_write_watch(int id);
+
+  // Bus monitor - called from the DONE_READ/DONE_WRITE path with every
+  // transaction the FSM completes (the untimed bus_* calls are not
+  // reported). latency is the rising edges from the one that accepted the
+  // request to the one that completed it. Replaces any earlier monitor;
+  // an empty function removes it
+  struct BusTransaction {
+    uint32_t addr;
+    uint32_t data; // Read or written
+    uint8_t byte_enables;
+    bool write;
+    bool ifetch;
+    uint32_t latency;
+  };
+  using BusMonitor = std::function<void(const BusTransaction &)>;
+  void set_bus_monitor(BusMonitor monitor) { bus_monitor = std::move(monitor); }
 
   // Memory introspection
   void dump_memory(uint32_t start_addr, uint32_t end_addr) const;
   void clear();
   uint32_t get_size() const { return memory_size; }
+  uint32_t get_delay() const { return delay_cycles; }
+  // Change the latency (>= 1); a request already waiting completes against
+  // the new delay, at once if it has waited that long
+  void set_delay(uint32_t delay) { delay_cycles = delay; }
+
+  // Checkpointing - save_state() writes the FSM, statistics and every
+  // resident page that is not all zero; restore_state() replaces the
+  // contents and state with a saved image. The size and delay must match
+  // this model's. Write watches and the debug flag are not part of the
+  // state. restore_state() returns false (model unchanged) on a bad image
+  void save_state(std::ostream &out) const;
+  bool restore_state(std::istream &in);
+
+  // Backing store occupancy (pages are only allocated on first write)
+  uint64_t get_resident_pages() const { return resident_pages; }
+  uint64_t get_resident_bytes() const {
+    return resident_pages * static_cast<uint64_t>(PAGE_SIZE);
+  }
 
   // Statistics
   uint64_t get_read_count() const { return read_count; }
   uint64_t get_write_count() const { return write_count; }
+  // Bus writes that changed the stored data (hang detection treats memory
+  // as unchanged while this stays the same)
+  uint64_t get_change_count() const { return change_count; }
+  // Also clears the access statistics
   void reset_statistics();
 
-  // Debug control
+  // Access statistics (off until enabled): every bus transaction by page
+  // and region, fetch or data, byte enables and reuse distance, with a
+  // heatmap in windows of window_cycles rising edges. Enabling again starts
+  // over with the new settings. Not part of save_state()
+  void enable_access_stats(uint64_t window_cycles = 10000,
+                           uint32_t line_bytes = 32);
+  MemoryStats *get_access_stats() { return access_stats.get(); }
+  const MemoryStats *get_access_stats() const { return access_stats.get(); }
+
+  // Debug control - the debug flag enables TRACE/DEBUG/INFO messages;
+  // warnings and errors always reach the sink. A sink passed to the
+  // constructor (e.g. the owning TestRunner's) must outlive the model.
   void set_debug(bool enable) { debug_enabled = enable; }
 
 private:
-  // Memory storage
-  std::vector<uint8_t> memory;
+  // Memory storage - two-level page table over the 32-bit address space.
+  // Unallocated pages read as zero; a page is allocated (zero-filled) the
+  // first time any byte in it is written.
+  static constexpr uint32_t TABLE_SHIFT = 10;
+  static constexpr uint32_t TABLE_ENTRIES = 1u << TABLE_SHIFT;
+  using Page = std::array<uint8_t, PAGE_SIZE>;
+  using PageTable = std::array<std::unique_ptr<Page>, TABLE_ENTRIES>;
+
+  std::vector<std::unique_ptr<PageTable>> page_directory;
+  uint64_t resident_pages;
   uint32_t memory_size;
 
   // Configuration
@@ -88,14 +201,46 @@ private:
   // Statistics
   uint64_t read_count;
   uint64_t write_count;
+  uint64_t change_count;
+  std::unique_ptr<MemoryStats> access_stats;
+
+  // Write watchpoints (checked only when non-empty)
+  struct WriteWatch {
+    int id;
+    uint32_t start;
+    uint64_t end; // Exclusive
+    WriteCallback callback;
+  };
+  std::vector<WriteWatch> write_watches;
+  int next_watch_id;
+  BusMonitor bus_monitor;
+
+  // Logging (own_sink is only created when no sink is supplied)
+  std::unique_ptr<LogSink> own_sink;
+  LogSink *sink;
 
   // Helper functions
   bool is_aligned(uint32_t addr) const { return (addr & 0x3) == 0; }
   bool is_valid_address(uint32_t addr) const { return addr < memory_size; }
-  void log(const std::string &message) const;
+
+  // Page storage access (offsets are physical, already bounds-checked)
+  const Page *find_page(uint32_t offset) const;
+  Page &touch_page(uint32_t offset);
+  uint8_t read_byte(uint32_t offset) const;
+  void write_byte(uint32_t offset, uint8_t data);
+  uint32_t read_word(uint32_t offset) const;
+  // True if any enabled byte changed
+  bool write_word(uint32_t offset, uint32_t data, uint8_t byte_enables);
+  // Bus write: write_word() plus write/change statistics
+  void store_word(uint32_t offset, uint32_t data, uint8_t byte_enables);
 
   // FSM logic
   void update_next_state(bool read, bool write);
+  void reset_state(uint32_t &data_out, bool &resp);
+  void clock_edge(bool read, bool write, uint32_t addr, uint32_t data_in,
+                  uint8_t byte_enables, bool ifetch);
+  void check_write_watches(uint32_t addr, uint32_t data,
+                           uint8_t byte_enables);
   void update_state_outputs(bool clk, bool rst_n);
 };
 
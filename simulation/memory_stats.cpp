@@ -0,0 +1,405 @@
+/*
+ * Memory Access Statistics Implementation
+ */
+
+#include "include/memory_stats.h"
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+#include <utility>
+
+namespace {
+std::string hex32(uint64_t value) {
+  char text[16];
+  std::snprintf(text, sizeof(text), "0x%08llx",
+                static_cast<unsigned long long>(value));
+  return text;
+}
+
+double percent(uint64_t part, uint64_t whole) {
+  return whole ? 100.0 * static_cast<double>(part) / whole : 0.0;
+}
+
+uint32_t lanes(uint32_t byte_enables) {
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < 4; i++) {
+    count += (byte_enables >> i) & 1;
+  }
+  return count;
+}
+
+void add_access(MemoryAccessCounts &counts, MemoryStats::Access access,
+                bool subword) {
+  switch (access) {
+  case MemoryStats::FETCH:
+    counts.fetches++;
+    break;
+  case MemoryStats::READ:
+    counts.reads++;
+    counts.subword_reads += subword;
+    break;
+  case MemoryStats::WRITE:
+    counts.writes++;
+    counts.subword_writes += subword;
+    break;
+  }
+}
+
+std::string counts_json(const MemoryAccessCounts &counts) {
+  std::ostringstream out;
+  out << "\"fetches\": " << counts.fetches << ", \"reads\": " << counts.reads
+      << ", \"writes\": " << counts.writes
+      << ", \"subword_reads\": " << counts.subword_reads
+      << ", \"subword_writes\": " << counts.subword_writes;
+  return out.str();
+}
+
+// "byte N, half N, word N" over the data accesses per byte-enable pattern
+std::string lanes_summary(const uint64_t *enables) {
+  uint64_t by_lanes[5] = {};
+  for (uint32_t be = 0; be < 16; be++) {
+    by_lanes[lanes(be)] += enables[be];
+  }
+  std::ostringstream out;
+  out << "byte " << by_lanes[1] << ", half " << by_lanes[2] << ", word "
+      << by_lanes[4];
+  if (by_lanes[0] + by_lanes[3] > 0) {
+    out << ", other " << by_lanes[0] + by_lanes[3];
+  }
+  return out.str();
+}
+
+std::string size_name(uint64_t bytes) {
+  if (bytes >= (1ull << 20) && bytes % (1ull << 20) == 0) {
+    return std::to_string(bytes >> 20) + "M";
+  }
+  if (bytes >= 1024 && bytes % 1024 == 0) {
+    return std::to_string(bytes >> 10) + "K";
+  }
+  return std::to_string(bytes);
+}
+
+const char *const STREAM_NAMES[MemoryStats::NUM_STREAMS] = {"fetch", "data",
+                                                             "all"};
+} // namespace
+
+uint64_t MemoryReuseHistogram::accesses() const {
+  uint64_t total = cold;
+  for (uint64_t count : buckets) {
+    total += count;
+  }
+  return total;
+}
+
+uint64_t MemoryReuseHistogram::hits(uint32_t k) const {
+  uint64_t total = 0;
+  for (uint32_t b = 0; b <= k && b < BUCKETS; b++) {
+    total += buckets[b];
+  }
+  return total;
+}
+
+MemoryStats::MemoryStats(uint64_t window, uint32_t line)
+    : window_cycles(std::max<uint64_t>(window, 1)), line_bytes(4),
+      line_shift(2), now(0), ignored_cycles(0), last_page(0),
+      last_counts(nullptr) {
+  while (line_bytes * 2 <= line && line_shift < 31) {
+    line_bytes *= 2;
+    line_shift++;
+  }
+  reset();
+}
+
+void MemoryStats::add_region(const std::string &name, uint32_t start,
+                             uint32_t size) {
+  MemoryRegionStats region;
+  region.name = name;
+  region.start = start;
+  region.end = static_cast<uint64_t>(start) + size;
+  regions.push_back(region);
+}
+
+void MemoryStats::record(uint32_t addr, Access access, uint8_t byte_enables) {
+  if (ignored_cycles > 0) {
+    return;
+  }
+  const bool subword = access != FETCH && (byte_enables & 0xF) != 0xF;
+  add_access(totals, access, subword);
+
+  MemoryAccessCounts *region_counts = &other;
+  for (MemoryRegionStats &region : regions) {
+    if (addr >= region.start && addr < region.end) {
+      region_counts = &region.counts;
+      break;
+    }
+  }
+  add_access(*region_counts, access, subword);
+
+  const uint32_t page_addr = addr & ~((1u << PAGE_SHIFT) - 1);
+  add_access(page_counts(page_addr), access, subword);
+
+  if (access == READ) {
+    read_enables[byte_enables & 0xF]++;
+  } else if (access == WRITE) {
+    write_enables[byte_enables & 0xF]++;
+  }
+
+  const uint32_t line = addr >> line_shift;
+  reuse[access == FETCH ? STREAM_FETCH : STREAM_DATA].access(line);
+  reuse[STREAM_ALL].access(line);
+
+  const uint64_t window = now / window_cycles;
+  if (windows.size() <= window) {
+    windows.resize(window + 1);
+  }
+  windows[window][page_addr]++;
+}
+
+void MemoryStats::reset() {
+  now = 0;
+  ignored_cycles = 0;
+  totals = MemoryAccessCounts();
+  for (MemoryRegionStats &region : regions) {
+    region.counts = MemoryAccessCounts();
+  }
+  other = MemoryAccessCounts();
+  pages.clear();
+  last_counts = nullptr;
+  std::fill(read_enables, read_enables + 16, 0);
+  std::fill(write_enables, write_enables + 16, 0);
+  for (ReuseTracker &tracker : reuse) {
+    tracker.clear();
+  }
+  windows.clear();
+}
+
+std::vector<MemoryRegionStats> MemoryStats::get_regions() const {
+  std::vector<MemoryRegionStats> result = regions;
+  MemoryRegionStats rest;
+  rest.name = "other";
+  rest.counts = other;
+  result.push_back(rest);
+  return result;
+}
+
+size_t MemoryStats::get_window_count() const {
+  // Windows up to now, including ones without an access
+  return std::max<size_t>(windows.size(),
+                          (now + window_cycles - 1) / window_cycles);
+}
+
+uint64_t MemoryStats::get_window_accesses(size_t window,
+                                          uint32_t page_addr) const {
+  if (window >= windows.size()) {
+    return 0;
+  }
+  auto it = windows[window].find(page_addr);
+  return it != windows[window].end() ? it->second : 0;
+}
+
+std::string MemoryStats::format_table() const {
+  std::ostringstream out;
+  out << std::left << std::setw(14) << "region" << std::right << std::setw(12)
+      << "start" << std::setw(12) << "end" << std::setw(12) << "fetches"
+      << std::setw(12) << "reads" << std::setw(12) << "writes"
+      << std::setw(10) << "subword%" << "\n"
+      << std::fixed << std::setprecision(2);
+  std::vector<MemoryRegionStats> rows = get_regions();
+  MemoryRegionStats total;
+  total.name = "total";
+  total.counts = totals;
+  rows.push_back(total);
+  for (const MemoryRegionStats &row : rows) {
+    const bool range = row.end > row.start;
+    if (range && row.counts.accesses() == 0) {
+      continue;
+    }
+    const MemoryAccessCounts &counts = row.counts;
+    out << std::left << std::setw(14) << row.name << std::right
+        << std::setw(12) << (range ? hex32(row.start) : "-") << std::setw(12)
+        << (range ? hex32(row.end) : "-") << std::setw(12) << counts.fetches
+        << std::setw(12) << counts.reads << std::setw(12) << counts.writes
+        << std::setw(10)
+        << percent(counts.subword_reads + counts.subword_writes,
+                   counts.reads + counts.writes)
+        << "\n";
+  }
+  out << "data reads:  " << lanes_summary(read_enables) << "\n"
+      << "data writes: " << lanes_summary(write_enables) << "\n";
+
+  // Hit ratio by size, up to the size that holds every reused line
+  uint32_t largest = 0;
+  for (const ReuseTracker &tracker : reuse) {
+    for (uint32_t b = 0; b < MemoryReuseHistogram::BUCKETS; b++) {
+      if (tracker.histogram.buckets[b] > 0) {
+        largest = std::max(largest, b);
+      }
+    }
+  }
+  out << "LRU hit% by fully associative cache size (" << line_bytes
+      << "B lines):\n"
+      << std::setw(10) << "size";
+  for (const char *name : STREAM_NAMES) {
+    out << std::setw(10) << name;
+  }
+  out << "\n";
+  for (uint32_t k = 0; k <= largest; k++) {
+    out << std::setw(10) << size_name(static_cast<uint64_t>(line_bytes) << k);
+    for (const ReuseTracker &tracker : reuse) {
+      out << std::setw(10)
+          << percent(tracker.histogram.hits(k), tracker.histogram.accesses());
+    }
+    out << "\n";
+  }
+  out << std::setw(10) << "cold";
+  for (const ReuseTracker &tracker : reuse) {
+    out << std::setw(10) << tracker.histogram.cold;
+  }
+  out << "\n"
+      << pages.size() << " pages touched, " << get_window_count()
+      << " windows of " << window_cycles << " cycles\n";
+  return out.str();
+}
+
+std::string MemoryStats::format_json() const {
+  std::ostringstream out;
+  out << "{\n"
+      << "  \"cycles\": " << now << ",\n"
+      << "  \"window_cycles\": " << window_cycles << ",\n"
+      << "  \"line_bytes\": " << line_bytes << ",\n"
+      << "  \"totals\": {" << counts_json(totals) << "},\n"
+      << "  \"regions\": [";
+  const std::vector<MemoryRegionStats> rows = get_regions();
+  for (size_t i = 0; i < rows.size(); i++) {
+    out << (i ? ",\n" : "\n") << "    {\"name\": \"" << rows[i].name << "\"";
+    if (rows[i].end > rows[i].start) {
+      out << ", \"start\": \"" << hex32(rows[i].start) << "\", \"end\": \""
+          << hex32(rows[i].end) << "\"";
+    }
+    out << ", " << counts_json(rows[i].counts) << "}";
+  }
+  out << "\n  ],\n";
+
+  // Data accesses per byte-enable pattern, only the patterns seen
+  const char *const enable_keys[2] = {"read_byte_enables",
+                                      "write_byte_enables"};
+  const uint64_t *const enables[2] = {read_enables, write_enables};
+  for (int i = 0; i < 2; i++) {
+    out << "  \"" << enable_keys[i] << "\": {";
+    bool first = true;
+    for (uint32_t be = 0; be < 16; be++) {
+      if (enables[i][be] > 0) {
+        out << (first ? "" : ", ") << "\"0x" << std::hex << be << std::dec
+            << "\": " << enables[i][be];
+        first = false;
+      }
+    }
+    out << "},\n";
+  }
+
+  // Reuse histograms up to the last non-empty bucket
+  out << "  \"reuse\": {";
+  for (uint32_t s = 0; s < NUM_STREAMS; s++) {
+    const MemoryReuseHistogram &histogram = reuse[s].histogram;
+    uint32_t used = MemoryReuseHistogram::BUCKETS;
+    while (used > 0 && histogram.buckets[used - 1] == 0) {
+      used--;
+    }
+    out << (s ? ",\n" : "\n") << "    \"" << STREAM_NAMES[s]
+        << "\": {\"cold\": " << histogram.cold << ", \"buckets\": [";
+    for (uint32_t b = 0; b < used; b++) {
+      out << (b ? ", " : "") << histogram.buckets[b];
+    }
+    out << "]}";
+  }
+  out << "\n  },\n";
+
+  // Per page: counts and accesses in each window
+  const size_t window_count = get_window_count();
+  out << "  \"pages\": [";
+  bool first = true;
+  for (const auto &entry : pages) {
+    out << (first ? "\n" : ",\n") << "    {\"page\": \"" << hex32(entry.first)
+        << "\", " << counts_json(entry.second) << ",\n     \"heatmap\": [";
+    for (size_t w = 0; w < window_count; w++) {
+      out << (w ? ", " : "") << get_window_accesses(w, entry.first);
+    }
+    out << "]}";
+    first = false;
+  }
+  out << "\n  ]\n}\n";
+  return out.str();
+}
+
+MemoryAccessCounts &MemoryStats::page_counts(uint32_t page_addr) {
+  if (!last_counts || page_addr != last_page) {
+    last_counts = &pages[page_addr];
+    last_page = page_addr;
+  }
+  return *last_counts;
+}
+
+void MemoryStats::ReuseTracker::access(uint32_t line) {
+  if (static_cast<size_t>(time) + 1 >= tree.size()) {
+    compact();
+  }
+  auto it = last.find(line);
+  if (it == last.end()) {
+    histogram.cold++;
+    last.emplace(line, time);
+  } else {
+    // Distinct lines touched since: latest accesses after the previous one
+    uint32_t distance = count_before(time) - count_before(it->second + 1);
+    uint32_t bucket = 0;
+    while (distance > 0) {
+      bucket++;
+      distance >>= 1;
+    }
+    histogram.buckets[bucket]++;
+    mark(it->second, -1);
+    it->second = time;
+  }
+  mark(time, 1);
+  time++;
+}
+
+void MemoryStats::ReuseTracker::clear() {
+  last.clear();
+  tree.clear();
+  time = 0;
+  histogram = MemoryReuseHistogram();
+}
+
+void MemoryStats::ReuseTracker::mark(uint32_t t, int32_t delta) {
+  for (size_t i = static_cast<size_t>(t) + 1; i < tree.size();
+       i += i & (~i + 1)) {
+    tree[i] += static_cast<uint32_t>(delta);
+  }
+}
+
+uint32_t MemoryStats::ReuseTracker::count_before(uint32_t t) const {
+  uint32_t count = 0;
+  for (size_t i = t; i > 0; i -= i & (~i + 1)) {
+    count += tree[i];
+  }
+  return count;
+}
+
+void MemoryStats::ReuseTracker::compact() {
+  // Renumber the latest accesses 0, 1, ... in order; room for at least as
+  // many accesses again before the next compaction
+  std::vector<std::pair<uint32_t, uint32_t>> order; // Time, line
+  order.reserve(last.size());
+  for (const auto &entry : last) {
+    order.emplace_back(entry.second, entry.first);
+  }
+  std::sort(order.begin(), order.end());
+  tree.assign(std::max<size_t>(1024, 2 * order.size()) + 1, 0);
+  time = 0;
+  for (const auto &entry : order) {
+    last[entry.second] = time;
+    mark(time, 1);
+    time++;
+  }
+}
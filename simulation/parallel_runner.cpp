@@ -0,0 +1,54 @@
+/*
+ * Parallel Simulation Runner Implementation
+ */
+
+#include "include/parallel_runner.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+SimJobResult run_job(const SimJob &job) {
+  SimJobResult result;
+  result.name = job.name;
+
+  TestRunner runner(job.name, job.config);
+  if (runner.load_program(job.program)) {
+    result.result = runner.run(job.max_cycles);
+    result.cycles = runner.get_cycle_count();
+  }
+  return result;
+}
+
+std::vector<SimJobResult> run_parallel(const std::vector<SimJob> &jobs,
+                                       unsigned num_threads) {
+  std::vector<SimJobResult> results(jobs.size());
+  if (jobs.empty()) {
+    return results;
+  }
+
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  num_threads = std::min<unsigned>(num_threads, jobs.size());
+
+  // Workers pull the next unclaimed job until none are left, so a long job
+  // never holds up the short ones queued behind it
+  std::atomic<size_t> next_job(0);
+  auto worker = [&]() {
+    for (size_t i = next_job++; i < jobs.size(); i = next_job++) {
+      results[i] = run_job(jobs[i]);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(num_threads - 1);
+  for (unsigned t = 1; t < num_threads; t++) {
+    workers.emplace_back(worker);
+  }
+  worker(); // The calling thread works too
+  for (std::thread &t : workers) {
+    t.join();
+  }
+
+  return results;
+}
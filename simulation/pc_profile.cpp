@@ -0,0 +1,300 @@
+/*
+ * PC-Sampling Profile Implementation
+ */
+
+#include "include/pc_profile.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+constexpr uint8_t STT_NOTYPE = 0;
+constexpr uint8_t STT_FUNC = 2;
+
+constexpr uint32_t INSN_ECALL = 0x00000073;
+constexpr uint32_t INSN_EBREAK = 0x00100073;
+constexpr uint32_t INSN_MRET = 0x30200073;
+
+// ra and t0 are the link registers of the calling convention
+bool is_link(uint32_t reg) { return reg == 1 || reg == 5; }
+
+double percent(uint64_t part, uint64_t whole) {
+  return whole ? 100.0 * static_cast<double>(part) / whole : 0.0;
+}
+} // namespace
+
+PcProfile::PcProfile(uint64_t sample_interval)
+    : interval(std::max<uint64_t>(sample_interval, 1)), last_function(0),
+      frame(0), depth(0), overflow(0), last_stack(0, 0), last_count(nullptr),
+      samples_taken(0) {
+  intern("[unknown]");
+  frames.push_back(Frame{0, 0, {}});
+}
+
+void PcProfile::set_symbols(const std::map<std::string, ElfSymbol> &symbols) {
+  struct Candidate {
+    uint32_t start;
+    uint32_t size;
+    bool function;
+    const std::string *name;
+  };
+  std::vector<Candidate> candidates;
+  for (const auto &entry : symbols) {
+    const ElfSymbol &symbol = entry.second;
+    if (symbol.type == STT_FUNC || symbol.type == STT_NOTYPE) {
+      candidates.push_back(Candidate{symbol.value, symbol.size,
+                                     symbol.type == STT_FUNC, &entry.first});
+    }
+  }
+  // By address; at one address a function wins over a label
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate &a, const Candidate &b) {
+              if (a.start != b.start) {
+                return a.start < b.start;
+              }
+              if (a.function != b.function) {
+                return a.function;
+              }
+              return *a.name < *b.name;
+            });
+
+  functions.clear();
+  uint64_t covered = 0; // End of the last sized function
+  for (const Candidate &candidate : candidates) {
+    if (candidate.start < covered ||
+        (!functions.empty() && functions.back().start == candidate.start)) {
+      continue; // Label inside a function, or an alias
+    }
+    if (!functions.empty() && functions.back().end > candidate.start) {
+      functions.back().end = candidate.start; // Labels end at the next one
+    }
+    Function function;
+    function.start = candidate.start;
+    function.end = candidate.size
+                       ? static_cast<uint64_t>(candidate.start) + candidate.size
+                       : (1ull << 32);
+    function.name = intern(*candidate.name);
+    if (candidate.size) {
+      covered = function.end;
+    }
+    functions.push_back(function);
+  }
+  last_function = functions.size();
+}
+
+void PcProfile::retire(uint32_t pc, uint32_t insn, uint32_t next_pc) {
+  const uint32_t function = lookup(pc);
+  instructions[function]++;
+
+  const uint32_t opcode = insn & 0x7F;
+  const uint32_t rd = (insn >> 7) & 31;
+  const uint32_t rs1 = (insn >> 15) & 31;
+  if (((opcode == 0x6F || opcode == 0x67) && is_link(rd)) ||
+      insn == INSN_ECALL || insn == INSN_EBREAK) {
+    push(function);
+    calls[lookup(next_pc)]++;
+  } else if ((opcode == 0x67 && rd == 0 && is_link(rs1)) ||
+             insn == INSN_MRET) {
+    pop();
+  }
+}
+
+void PcProfile::reset() {
+  frames.resize(1);
+  frames[0].children.clear();
+  frame = 0;
+  depth = 0;
+  overflow = 0;
+  stacks.clear();
+  last_count = nullptr;
+  samples_taken = 0;
+  std::fill(instructions.begin(), instructions.end(), 0);
+  std::fill(calls.begin(), calls.end(), 0);
+}
+
+uint64_t PcProfile::get_instructions() const {
+  uint64_t total = 0;
+  for (uint64_t count : instructions) {
+    total += count;
+  }
+  return total;
+}
+
+const std::string &PcProfile::function_name(uint32_t pc) const {
+  return names[lookup(pc)];
+}
+
+std::vector<PcProfileFunction> PcProfile::get_functions() const {
+  std::vector<PcProfileFunction> table(names.size());
+  std::vector<uint32_t> seen(names.size(), UINT32_MAX);
+  uint32_t stack_id = 0;
+  for (const auto &entry : stacks) {
+    const uint64_t cycles = entry.second * interval;
+    table[entry.first.second].self_cycles += cycles;
+    // Each function once per stack, however deep the recursion
+    stack_id++;
+    seen[entry.first.second] = stack_id;
+    table[entry.first.second].total_cycles += cycles;
+    for (uint32_t f = entry.first.first; f != 0; f = frames[f].parent) {
+      const uint32_t function = frames[f].function;
+      if (seen[function] != stack_id) {
+        seen[function] = stack_id;
+        table[function].total_cycles += cycles;
+      }
+    }
+  }
+
+  std::vector<PcProfileFunction> result;
+  for (size_t i = 0; i < names.size(); i++) {
+    table[i].name = names[i];
+    table[i].instructions = instructions[i];
+    table[i].calls = calls[i];
+    if (table[i].total_cycles > 0 || table[i].instructions > 0) {
+      result.push_back(table[i]);
+    }
+  }
+  std::sort(result.begin(), result.end(),
+            [](const PcProfileFunction &a, const PcProfileFunction &b) {
+              if (a.self_cycles != b.self_cycles) {
+                return a.self_cycles > b.self_cycles;
+              }
+              if (a.total_cycles != b.total_cycles) {
+                return a.total_cycles > b.total_cycles;
+              }
+              return a.name < b.name;
+            });
+  return result;
+}
+
+std::string PcProfile::format_folded() const {
+  std::vector<std::pair<std::string, uint64_t>> lines;
+  for (const auto &entry : stacks) {
+    std::string stack = stack_name(entry.first.first);
+    if (!stack.empty()) {
+      stack += ";";
+    }
+    lines.emplace_back(stack + names[entry.first.second],
+                       entry.second * interval);
+  }
+  std::sort(lines.begin(), lines.end());
+
+  std::string out;
+  for (const auto &line : lines) {
+    out += line.first + " " + std::to_string(line.second) + "\n";
+  }
+  return out;
+}
+
+std::string PcProfile::format_table() const {
+  const std::vector<PcProfileFunction> table = get_functions();
+  size_t width = 8;
+  for (const PcProfileFunction &function : table) {
+    width = std::max(width, function.name.size());
+  }
+  const uint64_t cycles = get_cycles();
+
+  std::ostringstream out;
+  out << std::left << std::setw(static_cast<int>(width + 2)) << "function"
+      << std::right << std::setw(12) << "self" << std::setw(8) << "self%"
+      << std::setw(12) << "total" << std::setw(8) << "total%"
+      << std::setw(12) << "insns" << std::setw(8) << "CPI" << std::setw(10)
+      << "calls" << "\n"
+      << std::fixed << std::setprecision(2);
+  for (const PcProfileFunction &function : table) {
+    const double cpi =
+        function.instructions
+            ? static_cast<double>(function.self_cycles) / function.instructions
+            : 0.0;
+    out << std::left << std::setw(static_cast<int>(width + 2)) << function.name
+        << std::right << std::setw(12) << function.self_cycles
+        << std::setw(8) << percent(function.self_cycles, cycles)
+        << std::setw(12) << function.total_cycles << std::setw(8)
+        << percent(function.total_cycles, cycles) << std::setw(12)
+        << function.instructions << std::setw(8) << cpi << std::setw(10)
+        << function.calls << "\n";
+  }
+  out << samples_taken << " samples, one every " << interval << " cycles\n";
+  return out.str();
+}
+
+uint32_t PcProfile::lookup(uint32_t pc) const {
+  if (last_function < functions.size() &&
+      pc >= functions[last_function].start &&
+      pc < functions[last_function].end) {
+    return functions[last_function].name;
+  }
+  auto it = std::upper_bound(
+      functions.begin(), functions.end(), pc,
+      [](uint32_t value, const Function &function) {
+        return value < function.start;
+      });
+  if (it == functions.begin() || pc >= (--it)->end) {
+    return 0;
+  }
+  last_function = static_cast<size_t>(it - functions.begin());
+  return it->name;
+}
+
+uint32_t PcProfile::intern(const std::string &name) {
+  auto it = name_index.find(name);
+  if (it != name_index.end()) {
+    return it->second;
+  }
+  const uint32_t index = static_cast<uint32_t>(names.size());
+  names.push_back(name);
+  name_index.emplace(name, index);
+  instructions.push_back(0);
+  calls.push_back(0);
+  return index;
+}
+
+void PcProfile::add_samples(uint32_t pc, uint64_t samples) {
+  const std::pair<uint32_t, uint32_t> stack(frame, lookup(pc));
+  if (!last_count || stack != last_stack) {
+    last_count = &stacks[stack];
+    last_stack = stack;
+  }
+  *last_count += samples;
+  samples_taken += samples;
+}
+
+void PcProfile::push(uint32_t function) {
+  if (depth >= MAX_DEPTH) {
+    overflow++;
+    return;
+  }
+  auto it = frames[frame].children.find(function);
+  uint32_t child;
+  if (it != frames[frame].children.end()) {
+    child = it->second;
+  } else {
+    child = static_cast<uint32_t>(frames.size());
+    frames[frame].children.emplace(function, child);
+    frames.push_back(Frame{frame, function, {}});
+  }
+  frame = child;
+  depth++;
+}
+
+void PcProfile::pop() {
+  if (overflow > 0) {
+    overflow--;
+  } else if (depth > 0) {
+    // A return with nothing on the stack (e.g. after run_functional())
+    // is ignored
+    frame = frames[frame].parent;
+    depth--;
+  }
+}
+
+std::string PcProfile::stack_name(uint32_t frame_index) const {
+  std::vector<const std::string *> path;
+  for (uint32_t f = frame_index; f != 0; f = frames[f].parent) {
+    path.push_back(&names[frames[f].function]);
+  }
+  std::string name;
+  for (auto it = path.rbegin(); it != path.rend(); ++it) {
+    name += (name.empty() ? "" : ";") + **it;
+  }
+  return name;
+}
@@ -0,0 +1,273 @@
+/*
+ * RTL Backdoor Access Implementation
+ */
+
+#include "include/rtl_backdoor.h"
+#include "Vcore_top.h"
+#include "include/fsm_timing.h"
+#ifdef RISCV_RTL_BACKDOOR
+#include "Vcore_top___024root.h"
+#endif
+
+namespace rtl_backdoor {
+
+#ifdef RISCV_RTL_BACKDOOR
+
+bool available() { return true; }
+
+uint32_t get_control_state(Vcore_top &dut) {
+  return dut.rootp->core_top__DOT__u_control__DOT__state;
+}
+
+bool is_memory_wait_state(Vcore_top &dut) {
+  uint32_t state = get_control_state(dut);
+  return state == STATE_FETCH_1 || state == STATE_LD_2 ||
+         state == STATE_ST_3;
+}
+
+uint64_t get_cycle_counter(Vcore_top &dut) {
+  return dut.rootp->core_top__DOT__u_csr_file__DOT__cycle_counter;
+}
+
+uint64_t get_instret(Vcore_top &dut) {
+  return dut.rootp->core_top__DOT__u_csr_file__DOT__instret_counter;
+}
+
+uint32_t get_register(Vcore_top &dut, uint32_t index) {
+  return dut.rootp->core_top__DOT__u_regfile__DOT__data[index & 31];
+}
+
+namespace {
+
+// Implemented performance counter of an mhpmcounter[h]/mhpmevent address,
+// or -1 (not the read-only hpmcounter shadows)
+int hpm_index(uint32_t addr) {
+  const int index = csr_hpm_index(addr);
+  if (index >= static_cast<int>(HPM_COUNTERS) || (addr >> 8) == 0xC) {
+    return -1;
+  }
+  return index;
+}
+
+} // namespace
+
+#define HPM_SIGNAL(name) dut.rootp->core_top__DOT__u_csr_file__DOT__##name
+
+// The backdoor, the ISS counter model and the cosim hand-over size the
+// performance monitor by HPM_COUNTERS; core_top must be built to match
+#define HPM_DEPTH(name)                                                       \
+  (sizeof(Vcore_top___024root::core_top__DOT__u_csr_file__DOT__##name) /      \
+   sizeof(Vcore_top___024root::core_top__DOT__u_csr_file__DOT__##name[0]))
+static_assert(HPM_DEPTH(mhpmcounter) == HPM_COUNTERS,
+              "HPM_COUNTERS (fsm_timing.h) differs from core_top's");
+static_assert(HPM_DEPTH(mhpmevent) == HPM_COUNTERS,
+              "HPM_COUNTERS (fsm_timing.h) differs from core_top's");
+#undef HPM_DEPTH
+
+uint32_t get_machine_csr(Vcore_top &dut, uint32_t addr) {
+  const int index = hpm_index(addr);
+  if (index >= 0) {
+    switch (addr >> 5) {
+    case 0xB00 >> 5:
+      return static_cast<uint32_t>(HPM_SIGNAL(mhpmcounter)[index]);
+    case 0xB80 >> 5:
+      return static_cast<uint32_t>(HPM_SIGNAL(mhpmcounter)[index] >> 32);
+    default:
+      return HPM_SIGNAL(mhpmevent)[index];
+    }
+  }
+  switch (addr) {
+  case 0x305:
+    return dut.rootp->core_top__DOT__u_csr_file__DOT__mtvec;
+  case 0x341:
+    return dut.rootp->core_top__DOT__u_csr_file__DOT__mepc;
+  case 0x342:
+    return dut.rootp->core_top__DOT__u_csr_file__DOT__mcause;
+  case 0x343:
+    return dut.rootp->core_top__DOT__u_csr_file__DOT__mtval;
+  case 0x320:
+    return HPM_SIGNAL(mcountinhibit);
+  default:
+    return 0;
+  }
+}
+
+uint64_t hash_arch_state(Vcore_top &dut) {
+  // FNV-1a over 32-bit words
+  uint64_t hash = 0xcbf29ce484222325ull;
+  auto mix = [&hash](uint32_t word) {
+    hash ^= word;
+    hash *= 0x100000001b3ull;
+  };
+
+  for (int i = 1; i < 32; i++) {
+    mix(dut.rootp->core_top__DOT__u_regfile__DOT__data[i]);
+  }
+  mix(dut.rootp->core_top__DOT__u_csr_file__DOT__mtvec);
+  mix(dut.rootp->core_top__DOT__u_csr_file__DOT__mepc);
+  mix(dut.rootp->core_top__DOT__u_csr_file__DOT__mcause);
+  mix(dut.rootp->core_top__DOT__u_csr_file__DOT__mtval);
+  return hash;
+}
+
+void advance_counters(Vcore_top &dut, uint64_t cycles) {
+  dut.rootp->core_top__DOT__u_csr_file__DOT__cycle_counter += cycles;
+  dut.rootp->core_top__DOT__u_csr_file__DOT__time_counter += cycles;
+
+  // Performance counters on the wait the core is stalled in
+  uint32_t event = HPM_EVENT_NONE;
+  switch (get_control_state(dut)) {
+  case STATE_FETCH_1:
+    event = HPM_EVENT_FETCH_WAIT;
+    break;
+  case STATE_LD_2:
+    event = HPM_EVENT_LOAD_WAIT;
+    break;
+  case STATE_ST_3:
+    event = HPM_EVENT_STORE_WAIT;
+    break;
+  default:
+    return;
+  }
+  for (uint32_t i = 0; i < HPM_COUNTERS; i++) {
+    if (HPM_SIGNAL(mhpmevent)[i] == event &&
+        !((HPM_SIGNAL(mcountinhibit) >> (i + 3)) & 1)) {
+      HPM_SIGNAL(mhpmcounter)[i] += cycles;
+    }
+  }
+}
+
+void set_register(Vcore_top &dut, uint32_t index, uint32_t value) {
+  if ((index & 31) != 0) {
+    dut.rootp->core_top__DOT__u_regfile__DOT__data[index & 31] = value;
+  }
+}
+
+// program_register is one dff_init per bit, so Verilator flattens u_pc into
+// 32 separate signals
+#define PC_BIT(i)                                                             \
+  dut.rootp                                                                   \
+      ->core_top__DOT__u_pc__DOT__gen_bits__BRA__##i##__KET____DOT__u_bit__DOT__data
+#define SET_PC_BIT(i) PC_BIT(i) = (pc >> i) & 1;
+
+void set_pc(Vcore_top &dut, uint32_t pc) {
+  SET_PC_BIT(0) SET_PC_BIT(1) SET_PC_BIT(2) SET_PC_BIT(3)
+  SET_PC_BIT(4) SET_PC_BIT(5) SET_PC_BIT(6) SET_PC_BIT(7)
+  SET_PC_BIT(8) SET_PC_BIT(9) SET_PC_BIT(10) SET_PC_BIT(11)
+  SET_PC_BIT(12) SET_PC_BIT(13) SET_PC_BIT(14) SET_PC_BIT(15)
+  SET_PC_BIT(16) SET_PC_BIT(17) SET_PC_BIT(18) SET_PC_BIT(19)
+  SET_PC_BIT(20) SET_PC_BIT(21) SET_PC_BIT(22) SET_PC_BIT(23)
+  SET_PC_BIT(24) SET_PC_BIT(25) SET_PC_BIT(26) SET_PC_BIT(27)
+  SET_PC_BIT(28) SET_PC_BIT(29) SET_PC_BIT(30) SET_PC_BIT(31)
+}
+
+#undef SET_PC_BIT
+#undef PC_BIT
+
+// IR and MAR are flattened the same way as u_pc
+#define REG_SIGNAL(reg, i)                                                    \
+  dut.rootp                                                                   \
+      ->core_top__DOT__##reg##__DOT__gen_bits__BRA__##i##__KET____DOT__u_bit__DOT__data
+#define REG_BIT(reg, i) (static_cast<uint32_t>(REG_SIGNAL(reg, i)) << i)
+#define GATHER_REG(reg)                                                       \
+  (REG_BIT(reg, 0) | REG_BIT(reg, 1) | REG_BIT(reg, 2) | REG_BIT(reg, 3) |    \
+   REG_BIT(reg, 4) | REG_BIT(reg, 5) | REG_BIT(reg, 6) | REG_BIT(reg, 7) |    \
+   REG_BIT(reg, 8) | REG_BIT(reg, 9) | REG_BIT(reg, 10) | REG_BIT(reg, 11) |  \
+   REG_BIT(reg, 12) | REG_BIT(reg, 13) | REG_BIT(reg, 14) |                   \
+   REG_BIT(reg, 15) | REG_BIT(reg, 16) | REG_BIT(reg, 17) |                   \
+   REG_BIT(reg, 18) | REG_BIT(reg, 19) | REG_BIT(reg, 20) |                   \
+   REG_BIT(reg, 21) | REG_BIT(reg, 22) | REG_BIT(reg, 23) |                   \
+   REG_BIT(reg, 24) | REG_BIT(reg, 25) | REG_BIT(reg, 26) |                   \
+   REG_BIT(reg, 27) | REG_BIT(reg, 28) | REG_BIT(reg, 29) |                   \
+   REG_BIT(reg, 30) | REG_BIT(reg, 31))
+
+uint32_t get_instruction(Vcore_top &dut) { return GATHER_REG(u_ir); }
+
+uint32_t get_memory_address(Vcore_top &dut) { return GATHER_REG(u_mar); }
+
+#undef GATHER_REG
+#undef REG_BIT
+#undef REG_SIGNAL
+
+void set_machine_csr(Vcore_top &dut, uint32_t addr, uint32_t value) {
+  const int index = hpm_index(addr);
+  if (index >= 0) {
+    uint64_t &counter = HPM_SIGNAL(mhpmcounter)[index];
+    switch (addr >> 5) {
+    case 0xB00 >> 5:
+      counter = (counter & ~0xFFFFFFFFull) | value;
+      break;
+    case 0xB80 >> 5:
+      counter = (counter & 0xFFFFFFFFull) | (static_cast<uint64_t>(value) << 32);
+      break;
+    default:
+      HPM_SIGNAL(mhpmevent)[index] = value;
+      break;
+    }
+    return;
+  }
+  switch (addr) {
+  case 0x305:
+    dut.rootp->core_top__DOT__u_csr_file__DOT__mtvec = value;
+    break;
+  case 0x341:
+    dut.rootp->core_top__DOT__u_csr_file__DOT__mepc = value;
+    break;
+  case 0x342:
+    dut.rootp->core_top__DOT__u_csr_file__DOT__mcause = value;
+    break;
+  case 0x343:
+    dut.rootp->core_top__DOT__u_csr_file__DOT__mtval = value;
+    break;
+  case 0x320:
+    // The CY and IR bits are read-only zero, as in csr_file.sv
+    HPM_SIGNAL(mcountinhibit) = value & (((1u << HPM_COUNTERS) - 1) << 3);
+    break;
+  default:
+    break;
+  }
+}
+
+#undef HPM_SIGNAL
+
+void set_counters(Vcore_top &dut, uint64_t cycles, uint64_t instret) {
+  dut.rootp->core_top__DOT__u_csr_file__DOT__cycle_counter = cycles;
+  dut.rootp->core_top__DOT__u_csr_file__DOT__time_counter = cycles;
+  dut.rootp->core_top__DOT__u_csr_file__DOT__instret_counter = instret;
+}
+
+#else
+
+bool available() { return false; }
+
+uint32_t get_control_state(Vcore_top &) { return 0; }
+
+bool is_memory_wait_state(Vcore_top &) { return false; }
+
+uint64_t get_cycle_counter(Vcore_top &) { return 0; }
+
+uint64_t get_instret(Vcore_top &) { return 0; }
+
+uint32_t get_register(Vcore_top &, uint32_t) { return 0; }
+
+uint32_t get_machine_csr(Vcore_top &, uint32_t) { return 0; }
+
+uint32_t get_instruction(Vcore_top &) { return 0; }
+
+uint32_t get_memory_address(Vcore_top &) { return 0; }
+
+uint64_t hash_arch_state(Vcore_top &) { return 0; }
+
+void advance_counters(Vcore_top &, uint64_t) {}
+
+void set_register(Vcore_top &, uint32_t, uint32_t) {}
+
+void set_pc(Vcore_top &, uint32_t) {}
+
+void set_machine_csr(Vcore_top &, uint32_t, uint32_t) {}
+
+void set_counters(Vcore_top &, uint64_t, uint64_t) {}
+
+#endif
+
+} // namespace rtl_backdoor
@@ -0,0 +1,353 @@
+/*
+ * RV32I Disassembler Implementation
+ */
+
+#include "include/rv32i_disasm.h"
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+const char *const REGISTER_NAMES[32] = {
+    "zero", "ra", "sp", "gp", "tp",  "t0",  "t1", "t2", "s0", "s1", "a0",
+    "a1",   "a2", "a3", "a4", "a5",  "a6",  "a7", "s2", "s3", "s4", "s5",
+    "s6",   "s7", "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6"};
+
+struct CsrName {
+  uint32_t addr;
+  const char *name;
+};
+
+const CsrName CSR_NAMES[] = {
+    {0x300, "mstatus"},  {0x301, "misa"},      {0x304, "mie"},
+    {0x320, "mcountinhibit"},
+    {0x305, "mtvec"},    {0x340, "mscratch"},  {0x341, "mepc"},
+    {0x342, "mcause"},   {0x343, "mtval"},     {0x344, "mip"},
+    {0xB00, "mcycle"},   {0xB02, "minstret"},  {0xB80, "mcycleh"},
+    {0xB82, "minstreth"}, {0xC00, "cycle"},    {0xC01, "time"},
+    {0xC02, "instret"},  {0xC80, "cycleh"},    {0xC81, "timeh"},
+    {0xC82, "instreth"}, {0xF11, "mvendorid"}, {0xF12, "marchid"},
+    {0xF13, "mimpid"},   {0xF14, "mhartid"}};
+
+// Immediates by format (sign-extended)
+int32_t imm_i(uint32_t insn) { return static_cast<int32_t>(insn) >> 20; }
+
+int32_t imm_s(uint32_t insn) {
+  return ((static_cast<int32_t>(insn) >> 20) & ~0x1F) |
+         static_cast<int32_t>((insn >> 7) & 0x1F);
+}
+
+int32_t imm_b(uint32_t insn) {
+  return ((static_cast<int32_t>(insn) >> 19) & ~0xFFF) |
+         static_cast<int32_t>(((insn << 4) & 0x800) | ((insn >> 20) & 0x7E0) |
+                              ((insn >> 7) & 0x1E));
+}
+
+int32_t imm_j(uint32_t insn) {
+  return ((static_cast<int32_t>(insn) >> 11) & ~0xFFFFF) |
+         static_cast<int32_t>((insn & 0xFF000) | ((insn >> 9) & 0x800) |
+                              ((insn >> 20) & 0x7FE));
+}
+
+// printf into a std::string; every line fits the buffer
+template <typename... Args>
+std::string format(const char *fmt, Args... args) {
+  char buffer[64];
+  std::snprintf(buffer, sizeof(buffer), fmt, args...);
+  return buffer;
+}
+
+std::string unknown(uint32_t insn) { return format(".word 0x%08x", insn); }
+
+std::string csr_text(uint32_t addr) {
+  const char *name = rv32i_csr_name(addr);
+  return name ? name : format("0x%x", addr);
+}
+
+// FENCE predecessor/successor set, e.g. "rw"
+std::string fence_set(uint32_t bits) {
+  std::string set;
+  const char letters[] = "iorw";
+  for (int i = 0; i < 4; i++) {
+    if (bits & (8u >> i)) {
+      set += letters[i];
+    }
+  }
+  return set.empty() ? "0" : set;
+}
+
+std::string disassemble_branch(uint32_t insn, uint32_t pc) {
+  static const char *const NAMES[8] = {"beq", "bne", nullptr, nullptr,
+                                       "blt", "bge", "bltu",  "bgeu"};
+  const uint32_t funct3 = (insn >> 12) & 7;
+  const uint32_t rs1 = (insn >> 15) & 0x1F;
+  const uint32_t rs2 = (insn >> 20) & 0x1F;
+  const uint32_t target = pc + static_cast<uint32_t>(imm_b(insn));
+  if (!NAMES[funct3]) {
+    return unknown(insn);
+  }
+  // Comparisons with zero
+  if (rs2 == 0) {
+    static const char *const ZERO[8] = {"beqz", "bnez", nullptr, nullptr,
+                                        "bltz", "bgez", nullptr, nullptr};
+    if (ZERO[funct3]) {
+      return format("%s %s,0x%x", ZERO[funct3], REGISTER_NAMES[rs1], target);
+    }
+  }
+  if (rs1 == 0 && (funct3 == 4 || funct3 == 5)) {
+    return format("%s %s,0x%x", funct3 == 4 ? "bgtz" : "blez",
+                  REGISTER_NAMES[rs2], target);
+  }
+  return format("%s %s,%s,0x%x", NAMES[funct3], REGISTER_NAMES[rs1],
+                REGISTER_NAMES[rs2], target);
+}
+
+std::string disassemble_op_imm(uint32_t insn) {
+  const uint32_t funct3 = (insn >> 12) & 7;
+  const char *rd = REGISTER_NAMES[(insn >> 7) & 0x1F];
+  const uint32_t rs1_index = (insn >> 15) & 0x1F;
+  const char *rs1 = REGISTER_NAMES[rs1_index];
+  const int32_t imm = imm_i(insn);
+  switch (funct3) {
+  case 0:
+    if (insn == 0x00000013) {
+      return "nop";
+    }
+    if (rs1_index == 0) {
+      return format("li %s,%d", rd, imm);
+    }
+    if (imm == 0) {
+      return format("mv %s,%s", rd, rs1);
+    }
+    return format("addi %s,%s,%d", rd, rs1, imm);
+  case 1:
+    if ((insn >> 25) != 0) {
+      return unknown(insn);
+    }
+    return format("slli %s,%s,0x%x", rd, rs1, (insn >> 20) & 0x1F);
+  case 2:
+    return format("slti %s,%s,%d", rd, rs1, imm);
+  case 3:
+    if (imm == 1) {
+      return format("seqz %s,%s", rd, rs1);
+    }
+    return format("sltiu %s,%s,%d", rd, rs1, imm);
+  case 4:
+    if (imm == -1) {
+      return format("not %s,%s", rd, rs1);
+    }
+    return format("xori %s,%s,%d", rd, rs1, imm);
+  case 5:
+    if ((insn >> 25) != 0 && (insn >> 25) != 0x20) {
+      return unknown(insn);
+    }
+    return format("%s %s,%s,0x%x", (insn >> 30) ? "srai" : "srli", rd, rs1,
+                  (insn >> 20) & 0x1F);
+  case 6:
+    return format("ori %s,%s,%d", rd, rs1, imm);
+  default:
+    return format("andi %s,%s,%d", rd, rs1, imm);
+  }
+}
+
+std::string disassemble_op(uint32_t insn) {
+  static const char *const NAMES[8] = {"add", "sll", "slt", "sltu",
+                                       "xor", "srl", "or",  "and"};
+  const uint32_t funct3 = (insn >> 12) & 7;
+  const uint32_t funct7 = insn >> 25;
+  const char *rd = REGISTER_NAMES[(insn >> 7) & 0x1F];
+  const uint32_t rs1_index = (insn >> 15) & 0x1F;
+  const uint32_t rs2_index = (insn >> 20) & 0x1F;
+  const char *rs1 = REGISTER_NAMES[rs1_index];
+  const char *rs2 = REGISTER_NAMES[rs2_index];
+  const char *name = nullptr;
+  if (funct7 == 0) {
+    name = NAMES[funct3];
+  } else if (funct7 == 0x20 && funct3 == 0) {
+    name = "sub";
+  } else if (funct7 == 0x20 && funct3 == 5) {
+    name = "sra";
+  } else {
+    return unknown(insn);
+  }
+  if (funct7 == 0x20 && funct3 == 0 && rs1_index == 0) {
+    return format("neg %s,%s", rd, rs2);
+  }
+  if (funct7 == 0 && funct3 == 3 && rs1_index == 0) {
+    return format("snez %s,%s", rd, rs2);
+  }
+  if (funct7 == 0 && funct3 == 2 && rs2_index == 0) {
+    return format("sltz %s,%s", rd, rs1);
+  }
+  if (funct7 == 0 && funct3 == 2 && rs1_index == 0) {
+    return format("sgtz %s,%s", rd, rs2);
+  }
+  return format("%s %s,%s,%s", name, rd, rs1, rs2);
+}
+
+std::string disassemble_system(uint32_t insn) {
+  const uint32_t funct3 = (insn >> 12) & 7;
+  const uint32_t rd_index = (insn >> 7) & 0x1F;
+  const uint32_t rs1_index = (insn >> 15) & 0x1F;
+  const uint32_t csr = insn >> 20;
+  if (funct3 == 0) {
+    switch (insn) {
+    case 0x00000073:
+      return "ecall";
+    case 0x00100073:
+      return "ebreak";
+    case 0x30200073:
+      return "mret";
+    case 0x10500073:
+      return "wfi";
+    default:
+      return unknown(insn);
+    }
+  }
+  if (funct3 == 4) {
+    return unknown(insn);
+  }
+  static const char *const NAMES[8] = {nullptr,  "csrrw", "csrrs",  "csrrc",
+                                       nullptr,  "csrrwi", "csrrsi", "csrrci"};
+  static const char *const WRITE_ONLY[8] = {nullptr, "csrw", "csrs", "csrc",
+                                            nullptr, "csrwi", "csrsi",
+                                            "csrci"};
+  const char *rd = REGISTER_NAMES[rd_index];
+  const std::string name = csr_text(csr);
+  const bool immediate = funct3 >= 5;
+  // Counter reads
+  if (funct3 == 2 && rs1_index == 0) {
+    if ((csr & ~0x80u) >= 0xC00 && (csr & ~0x80u) <= 0xC02) {
+      return format("rd%s %s", name.c_str(), rd);
+    }
+    return format("csrr %s,%s", rd, name.c_str());
+  }
+  if (rd_index == 0) {
+    if (immediate) {
+      return format("%s %s,%u", WRITE_ONLY[funct3], name.c_str(), rs1_index);
+    }
+    return format("%s %s,%s", WRITE_ONLY[funct3], name.c_str(),
+                  REGISTER_NAMES[rs1_index]);
+  }
+  if (immediate) {
+    return format("%s %s,%s,%u", NAMES[funct3], rd, name.c_str(), rs1_index);
+  }
+  return format("%s %s,%s,%s", NAMES[funct3], rd, name.c_str(),
+                REGISTER_NAMES[rs1_index]);
+}
+
+} // namespace
+
+const char *rv32i_register_name(uint32_t index) {
+  return REGISTER_NAMES[index & 0x1F];
+}
+
+const char *rv32i_csr_name(uint32_t addr) {
+  for (const CsrName &csr : CSR_NAMES) {
+    if (csr.addr == addr) {
+      return csr.name;
+    }
+  }
+
+  // Performance monitor counters 3-31: 32 names per address block
+  static const struct {
+    uint32_t base;
+    const char *format;
+  } HPM_BLOCKS[] = {{0xB00, "mhpmcounter%u"},
+                    {0xB80, "mhpmcounter%uh"},
+                    {0xC00, "hpmcounter%u"},
+                    {0xC80, "hpmcounter%uh"},
+                    {0x320, "mhpmevent%u"}};
+  static const std::vector<std::string> hpm_names = [] {
+    std::vector<std::string> names;
+    for (const auto &block : HPM_BLOCKS) {
+      for (uint32_t i = 0; i < 32; i++) {
+        names.push_back(format(block.format, i));
+      }
+    }
+    return names;
+  }();
+  if ((addr & 0x1F) >= 3) {
+    for (size_t b = 0; b < sizeof(HPM_BLOCKS) / sizeof(HPM_BLOCKS[0]); b++) {
+      if ((addr & ~0x1Fu) == HPM_BLOCKS[b].base) {
+        return hpm_names[b * 32 + (addr & 0x1F)].c_str();
+      }
+    }
+  }
+  return nullptr;
+}
+
+std::string rv32i_disassemble(uint32_t insn, uint32_t pc) {
+  static const char *const LOADS[8] = {"lb",  "lh",  "lw",    nullptr,
+                                       "lbu", "lhu", nullptr, nullptr};
+  static const char *const STORES[8] = {"sb",    "sh",    "sw",    nullptr,
+                                        nullptr, nullptr, nullptr, nullptr};
+  const uint32_t funct3 = (insn >> 12) & 7;
+  const uint32_t rd_index = (insn >> 7) & 0x1F;
+  const uint32_t rs1_index = (insn >> 15) & 0x1F;
+  const char *rd = REGISTER_NAMES[rd_index];
+  const char *rs1 = REGISTER_NAMES[rs1_index];
+  const char *rs2 = REGISTER_NAMES[(insn >> 20) & 0x1F];
+
+  switch (insn & 0x7F) {
+  case 0x37: // LUI
+    return format("lui %s,0x%x", rd, insn >> 12);
+  case 0x17: // AUIPC
+    return format("auipc %s,0x%x", rd, insn >> 12);
+  case 0x6F: { // JAL
+    const uint32_t target = pc + static_cast<uint32_t>(imm_j(insn));
+    if (rd_index == 0) {
+      return format("j 0x%x", target);
+    }
+    return format("jal %s,0x%x", rd, target);
+  }
+  case 0x67: { // JALR
+    if (funct3 != 0) {
+      return unknown(insn);
+    }
+    const int32_t imm = imm_i(insn);
+    if (rd_index == 0 && rs1_index == 1 && imm == 0) {
+      return "ret";
+    }
+    if (rd_index == 0 && imm == 0) {
+      return format("jr %s", rs1);
+    }
+    if (rd_index == 1 && imm == 0) {
+      return format("jalr %s", rs1);
+    }
+    return format("jalr %s,%d(%s)", rd, imm, rs1);
+  }
+  case 0x63:
+    return disassemble_branch(insn, pc);
+  case 0x03:
+    if (!LOADS[funct3]) {
+      return unknown(insn);
+    }
+    return format("%s %s,%d(%s)", LOADS[funct3], rd, imm_i(insn), rs1);
+  case 0x23:
+    if (!STORES[funct3]) {
+      return unknown(insn);
+    }
+    return format("%s %s,%d(%s)", STORES[funct3], rs2, imm_s(insn), rs1);
+  case 0x13:
+    return disassemble_op_imm(insn);
+  case 0x33:
+    return disassemble_op(insn);
+  case 0x0F: // MISC-MEM
+    if (funct3 == 1) {
+      return "fence.i";
+    }
+    if (funct3 != 0) {
+      return unknown(insn);
+    }
+    if (((insn >> 20) & 0xFF) == 0xFF) {
+      return "fence";
+    }
+    return format("fence %s,%s", fence_set((insn >> 24) & 0xF).c_str(),
+                  fence_set((insn >> 20) & 0xF).c_str());
+  case 0x73:
+    return disassemble_system(insn);
+  default:
+    return unknown(insn);
+  }
+}
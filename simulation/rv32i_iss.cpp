@@ -0,0 +1,899 @@
+/*
+ * RV32I Instruction-Set Simulator Implementation
+ */
+
+#include "include/rv32i_iss.h"
+#include <algorithm>
+
+// Threaded dispatch needs the labels-as-values extension
+#if defined(__GNUC__) && !defined(RV32I_ISS_SWITCH_DISPATCH)
+#define RV32I_ISS_THREADED 1
+#else
+#define RV32I_ISS_THREADED 0
+#endif
+
+namespace {
+
+// Decoded operations. Conditional branches continue the block when not
+// taken; JAL, JALR, TRAP, MRET and HALT end it, END falls through to the
+// next block (length or page limit) and is not an instruction.
+#define ISS_OPS(X)                                                             \
+  X(LI)                                                                        \
+  X(ADDI)                                                                      \
+  X(SLTI)                                                                      \
+  X(SLTIU)                                                                     \
+  X(XORI)                                                                      \
+  X(ORI)                                                                       \
+  X(ANDI)                                                                      \
+  X(SLLI)                                                                      \
+  X(SRLI)                                                                      \
+  X(SRAI)                                                                      \
+  X(ADD)                                                                       \
+  X(SUB)                                                                       \
+  X(SLL)                                                                       \
+  X(SLT)                                                                       \
+  X(SLTU)                                                                      \
+  X(XOR)                                                                       \
+  X(SRL)                                                                       \
+  X(SRA)                                                                       \
+  X(OR)                                                                        \
+  X(AND)                                                                       \
+  X(LB)                                                                        \
+  X(LH)                                                                        \
+  X(LW)                                                                        \
+  X(LBU)                                                                       \
+  X(LHU)                                                                       \
+  X(SB)                                                                        \
+  X(SH)                                                                        \
+  X(SW)                                                                        \
+  X(BEQ)                                                                       \
+  X(BNE)                                                                       \
+  X(BLT)                                                                       \
+  X(BGE)                                                                       \
+  X(BLTU)                                                                      \
+  X(BGEU)                                                                      \
+  X(NOP)                                                                       \
+  X(CSR)                                                                       \
+  X(JAL)                                                                       \
+  X(JALR)                                                                      \
+  X(TRAP)                                                                      \
+  X(MRET)                                                                      \
+  X(HALT)                                                                      \
+  X(END)
+
+#define ISS_ENUM(name) OP_##name,
+enum Op : uint8_t { ISS_OPS(ISS_ENUM) NUM_OPS };
+#undef ISS_ENUM
+
+bool ends_block(uint8_t op) {
+  return op == OP_JAL || op == OP_JALR || op == OP_TRAP || op == OP_MRET ||
+         op == OP_HALT;
+}
+
+// Immediate formats (imm_gen.sv)
+uint32_t imm_i(uint32_t word) {
+  return static_cast<uint32_t>(static_cast<int32_t>(word) >> 20);
+}
+uint32_t imm_s(uint32_t word) {
+  return (imm_i(word) & ~0x1Fu) | ((word >> 7) & 0x1F);
+}
+uint32_t imm_b(uint32_t word) {
+  return (static_cast<uint32_t>(static_cast<int32_t>(word) >> 19) & ~0xFFFu) |
+         ((word << 4) & 0x800) | ((word >> 20) & 0x7E0) | ((word >> 7) & 0x1E);
+}
+uint32_t imm_u(uint32_t word) { return word & 0xFFFFF000; }
+uint32_t imm_j(uint32_t word) {
+  return (static_cast<uint32_t>(static_cast<int32_t>(word) >> 11) &
+          ~0xFFFFFu) |
+         (word & 0xFF000) | ((word >> 9) & 0x800) | ((word >> 20) & 0x7FE);
+}
+
+// mcountinhibit bits of the implemented counters (CY and IR are read-only
+// zero)
+constexpr uint32_t HPM_INHIBIT_MASK = ((1u << HPM_COUNTERS) - 1) << 3;
+
+constexpr uint32_t PAGE_SHIFT = MemoryModel::PAGE_SHIFT;
+constexpr uint32_t NUM_PAGES = 1u << (32 - PAGE_SHIFT);
+
+} // namespace
+
+// One predecoded instruction. rd is 32 for x0 (a write sink); imm holds
+// the resolved operand (e.g. PC + imm for AUIPC, the link value for JAL,
+// the CSR address or the raw word for HALT) and target the jump target
+struct Rv32iIss::Insn {
+  uint8_t op;
+  uint8_t rd;
+  uint8_t rs1;
+  uint8_t rs2; // funct3 for OP_CSR
+  uint32_t imm;
+  uint32_t pc;
+  uint32_t target;
+};
+
+struct Rv32iIss::Block {
+  uint32_t start_pc;
+  std::vector<Insn> insns;
+};
+
+Rv32iIss::Rv32iIss(MemoryModel &memory_model, const IssConfig &iss_config)
+    : memory(memory_model), config(iss_config), log(iss_config.log_level),
+      regs(), pc(iss_config.reset_pc), instret(0), mtvec(0x100), mepc(0),
+      mcause(0), mtval(0), mcountinhibit(0), hpm_event(), hpm_base(),
+      hpm_snapshot(), event_counts(), fetch_origin(0), halted(false),
+      timing(iss_config.memory_delay),
+      base_cycles(timing.cycles(FSM_CLASS_REG_IMM)), cycle_offset(0),
+      extra_cycles(), run_cycles(0), result_written(false), magic_watch(-1),
+      lookup(), code_pages(NUM_PAGES, false), flush_pending(false),
+      decoded_blocks(0) {
+  for (uint32_t cls = 0; cls < FSM_NUM_CLASSES; cls++) {
+    extra_cycles[cls] = timing.cycles(static_cast<FsmClass>(cls)) - base_cycles;
+  }
+
+  // Completion is signalled by the bus write to the magic address, as in
+  // TestRunner
+  magic_watch = memory.add_write_watch(
+      MAGIC_RESULT_ADDR, 4,
+      [this](uint32_t, uint32_t, uint8_t) { result_written = true; });
+  reset();
+}
+
+Rv32iIss::~Rv32iIss() { memory.remove_write_watch(magic_watch); }
+
+bool Rv32iIss::load_program(const std::string &program_file) {
+  if (!program.load_file(program_file) || !program.load_into(memory)) {
+    SIM_LOG(log, LogLevel::ERROR, "ERROR",
+            "Failed to load program: " << program_file << " ("
+                                       << program.get_error() << ")");
+    return false;
+  }
+  flush_cache();
+  SIM_LOG(log, LogLevel::INFO, "ISS", "Program loaded: " << program_file);
+  return true;
+}
+
+void Rv32iIss::reset() {
+  std::fill(std::begin(regs), std::end(regs), 0);
+  pc = config.reset_pc;
+  instret = 0;
+  cycle_offset = 0;
+  mtvec = 0x100;
+  mepc = 0;
+  mcause = 0;
+  mtval = 0;
+  mcountinhibit = 0;
+  std::fill(std::begin(hpm_event), std::end(hpm_event), 0);
+  std::fill(std::begin(hpm_base), std::end(hpm_base), 0);
+  std::fill(std::begin(hpm_snapshot), std::end(hpm_snapshot), 0);
+  std::fill(std::begin(event_counts), std::end(event_counts), 0);
+  fetch_origin = 0;
+  halted = false;
+  result_written = false;
+  flush_cache();
+}
+
+TestResult Rv32iIss::run(uint64_t max_instructions) {
+  SIM_LOG(log, LogLevel::INFO, "ISS",
+          "Starting ISS run (max " << max_instructions << " instructions)");
+  const uint64_t start = instret;
+  const uint64_t start_cycles = get_cycles();
+  run_cycles = 0;
+
+  // A result already in memory (e.g. from a previous run) ends the run
+  result_written = is_test_complete();
+
+  while (!halted) {
+    if (result_written) {
+      result_written = false;
+      if (is_test_complete()) {
+        uint32_t value = memory.backdoor_read_word(MAGIC_RESULT_ADDR);
+        TestResult result = value == MAGIC_PASS_VALUE ? TestResult::PASS
+                                                      : TestResult::FAIL;
+        // TestRunner stops at the store's bus write, before its PC_INC
+        run_cycles = get_cycles() - start_cycles -
+                     (timing.cycles(FSM_CLASS_STORE) -
+                      timing.store_write_cycle());
+        SIM_LOG(log, LogLevel::INFO, "ISS",
+                "Test completed in " << (instret - start)
+                                     << " instructions (" << run_cycles
+                                     << " RTL cycles)");
+        SIM_LOG(log, LogLevel::INFO, "ISS",
+                "Result: " << (result == TestResult::PASS ? "PASS" : "FAIL"));
+        log.flush();
+        return result;
+      }
+    }
+
+    uint64_t executed = instret - start;
+    if (executed >= max_instructions) {
+      SIM_LOG(log, LogLevel::INFO, "ISS",
+              "Instruction limit of " << max_instructions << " reached");
+      SIM_LOG(log, LogLevel::INFO, "ISS",
+              "Final PC: " << to_hex_string(pc, 8));
+      SIM_LOG(log, LogLevel::INFO, "ISS", "Result: TIMEOUT");
+      log.flush();
+      return TestResult::TIMEOUT;
+    }
+    step(max_instructions - executed);
+  }
+
+  // The RTL stops in its error state and the run times out there
+  SIM_LOG(log, LogLevel::INFO, "ISS",
+          "Halted on unimplemented instruction "
+              << to_hex_string(fetch_word(pc & ~3u), 8) << " at PC "
+              << to_hex_string(pc, 8));
+  SIM_LOG(log, LogLevel::INFO, "ISS", "Result: TIMEOUT (halted)");
+  log.flush();
+  return TestResult::TIMEOUT;
+}
+
+uint64_t Rv32iIss::step(uint64_t max_instructions) {
+  if (halted || max_instructions == 0) {
+    return 0;
+  }
+  // A result write only ends the call that made it
+  result_written = false;
+  return execute(max_instructions);
+}
+
+bool Rv32iIss::get_csr(uint32_t addr, uint32_t &value) const {
+  return read_csr(addr, instret, instret, get_cycles(), value);
+}
+
+bool Rv32iIss::set_csr(uint32_t addr, uint32_t value) {
+  return write_csr(addr, value, instret);
+}
+
+void Rv32iIss::set_instret(uint64_t value) {
+  // Instructions counted but not fetched here add no fetch waits
+  fetch_origin += value - instret;
+  instret = value;
+}
+
+uint64_t Rv32iIss::event_total(uint32_t event, uint64_t fetched) const {
+  const uint64_t delay = timing.get_memory_delay();
+  switch (event) {
+  case HPM_EVENT_FETCH_WAIT:
+    return (fetched - fetch_origin) * (delay + 1);
+  case HPM_EVENT_LOAD_WAIT:
+    return delay * (event_counts[HPM_EVENT_LOAD_BYTE] +
+                    event_counts[HPM_EVENT_LOAD_HALF] +
+                    event_counts[HPM_EVENT_LOAD_WORD]);
+  case HPM_EVENT_STORE_WAIT:
+    return delay * (event_counts[HPM_EVENT_STORE_BYTE] +
+                    event_counts[HPM_EVENT_STORE_HALF] +
+                    event_counts[HPM_EVENT_STORE_WORD]);
+  default:
+    return event < HPM_NUM_EVENTS ? event_counts[event] : 0;
+  }
+}
+
+uint64_t Rv32iIss::hpm_value(uint32_t index, uint64_t fetched) const {
+  if (mcountinhibit & (1u << (index + 3))) {
+    return hpm_base[index];
+  }
+  return hpm_base[index] + event_total(hpm_event[index], fetched) -
+         hpm_snapshot[index];
+}
+
+void Rv32iIss::hpm_rebase(uint32_t index, uint64_t fetched) {
+  hpm_base[index] = hpm_value(index, fetched);
+  hpm_snapshot[index] = event_total(hpm_event[index], fetched);
+}
+
+bool Rv32iIss::write_csr(uint32_t addr, uint32_t value, uint64_t fetched) {
+  const int index = csr_hpm_index(addr);
+  if (index >= 0) {
+    if (index >= static_cast<int>(HPM_COUNTERS) || (addr >> 8) == 0xC) {
+      return true; // Unimplemented or a read-only shadow
+    }
+    const uint32_t i = static_cast<uint32_t>(index);
+    hpm_rebase(i, fetched);
+    switch (addr >> 5) {
+    case 0xB00 >> 5:
+      hpm_base[i] = (hpm_base[i] & ~0xFFFFFFFFull) | value;
+      break;
+    case 0xB80 >> 5:
+      hpm_base[i] = (hpm_base[i] & 0xFFFFFFFFull) |
+                    (static_cast<uint64_t>(value) << 32);
+      break;
+    default: // mhpmevent
+      hpm_event[i] = value;
+      hpm_snapshot[i] = event_total(value, fetched);
+      break;
+    }
+    return true;
+  }
+
+  switch (addr) {
+  case 0x305:
+    mtvec = value;
+    return true;
+  case 0x341:
+    mepc = value;
+    return true;
+  case 0x342:
+    mcause = value;
+    return true;
+  case 0x343:
+    mtval = value;
+    return true;
+  case 0x320:
+    for (uint32_t i = 0; i < HPM_COUNTERS; i++) {
+      hpm_rebase(i, fetched);
+    }
+    mcountinhibit = value & HPM_INHIBIT_MASK;
+    return true;
+  default:
+    return is_csr_address(addr); // Counters are read-only
+  }
+}
+
+bool Rv32iIss::read_csr(uint32_t addr, uint64_t retired, uint64_t fetched,
+                        uint64_t cycles, uint32_t &value) const {
+  const int index = csr_hpm_index(addr);
+  if (index >= 0) {
+    value = 0;
+    if (index < static_cast<int>(HPM_COUNTERS)) {
+      const uint32_t i = static_cast<uint32_t>(index);
+      const uint64_t counter = hpm_value(i, fetched);
+      switch (addr >> 5) {
+      case 0x320 >> 5:
+        value = hpm_event[i];
+        break;
+      case 0xB80 >> 5:
+      case 0xC80 >> 5:
+        value = static_cast<uint32_t>(counter >> 32);
+        break;
+      default:
+        value = static_cast<uint32_t>(counter);
+        break;
+      }
+    }
+    return true;
+  }
+
+  switch (addr) {
+  case 0xC00: // cycle
+  case 0xC01: // time
+    value = static_cast<uint32_t>(cycles);
+    return true;
+  case 0xC02: // instret
+    value = static_cast<uint32_t>(retired);
+    return true;
+  case 0xC80: // cycleh
+  case 0xC81: // timeh
+    value = static_cast<uint32_t>(cycles >> 32);
+    return true;
+  case 0xC82: // instreth
+    value = static_cast<uint32_t>(retired >> 32);
+    return true;
+  case 0x305:
+    value = mtvec;
+    return true;
+  case 0x341:
+    value = mepc;
+    return true;
+  case 0x342:
+    value = mcause;
+    return true;
+  case 0x343:
+    value = mtval;
+    return true;
+  case 0x320:
+    value = mcountinhibit;
+    return true;
+  default:
+    value = 0;
+    return false;
+  }
+}
+
+void Rv32iIss::flush_cache() {
+  blocks.clear();
+  lookup.fill(nullptr);
+  for (uint32_t page : marked_pages) {
+    code_pages[page] = false;
+  }
+  marked_pages.clear();
+  flush_pending = false;
+}
+
+uint32_t Rv32iIss::fetch_word(uint32_t addr) const {
+  // A bus read; the magic region is write-only there
+  if ((addr & 0xFFFF0000) == 0xDEAD0000) {
+    return 0xDEADBEEF;
+  }
+  return memory.backdoor_read_word(addr);
+}
+
+Rv32iIss::Block *Rv32iIss::find_block(uint32_t block_pc) {
+  if (flush_pending) {
+    flush_cache();
+  }
+
+  Block *&slot = lookup[(block_pc >> 2) & (LOOKUP_ENTRIES - 1)];
+  if (slot && slot->start_pc == block_pc) {
+    return slot;
+  }
+
+  auto it = blocks.find(block_pc);
+  slot = (it != blocks.end()) ? it->second.get() : decode_block(block_pc);
+  return slot;
+}
+
+Rv32iIss::Block *Rv32iIss::decode_block(uint32_t block_pc) {
+  std::unique_ptr<Block> block(new Block());
+  block->start_pc = block_pc;
+
+  // Stay within one page so a single code_pages entry covers the block
+  const uint32_t page = (block_pc & ~3u) >> PAGE_SHIFT;
+  uint32_t insn_pc = block_pc;
+  for (uint32_t i = 0; i < MAX_BLOCK_INSNS; i++) {
+    Insn insn;
+    decode(insn_pc, fetch_word(insn_pc & ~3u), insn);
+    block->insns.push_back(insn);
+    insn_pc += 4;
+    if (ends_block(insn.op) || ((insn_pc & ~3u) >> PAGE_SHIFT) != page) {
+      break;
+    }
+  }
+
+  if (!ends_block(block->insns.back().op)) {
+    Insn end = {OP_END, 32, 0, 0, 0, insn_pc, 0};
+    block->insns.push_back(end);
+  }
+
+  if (!code_pages[page]) {
+    code_pages[page] = true;
+    marked_pages.push_back(page);
+  }
+
+  decoded_blocks++;
+  Block *result = block.get();
+  blocks[block_pc] = std::move(block);
+  return result;
+}
+
+void Rv32iIss::decode(uint32_t insn_pc, uint32_t word, Insn &insn) const {
+  const uint32_t opcode = word & 0x7F;
+  const uint32_t rd = (word >> 7) & 0x1F;
+  const uint32_t funct3 = (word >> 12) & 0x7;
+  const bool arithmetic = (word >> 30) & 1;
+  const uint32_t shamt = (word >> 20) & 0x1F;
+
+  insn.op = OP_HALT;
+  insn.rd = static_cast<uint8_t>(rd == 0 ? 32 : rd);
+  insn.rs1 = static_cast<uint8_t>((word >> 15) & 0x1F);
+  insn.rs2 = static_cast<uint8_t>((word >> 20) & 0x1F);
+  insn.imm = word;
+  insn.pc = insn_pc;
+  insn.target = 0;
+
+  switch (opcode) {
+  case 0x37: // LUI
+    insn.op = OP_LI;
+    insn.imm = imm_u(word);
+    break;
+  case 0x17: // AUIPC
+    insn.op = OP_LI;
+    insn.imm = insn_pc + imm_u(word);
+    break;
+  case 0x6F: // JAL
+    insn.op = OP_JAL;
+    insn.imm = insn_pc + 4;
+    insn.target = insn_pc + imm_j(word);
+    break;
+  case 0x67: // JALR (funct3 is not checked)
+    insn.op = OP_JALR;
+    insn.imm = imm_i(word);
+    break;
+  case 0x63: { // BRANCH - funct3 2/3 never branch (BRANCH_0 -> PC_INC)
+    static const uint8_t ops[8] = {OP_BEQ, OP_BNE, OP_NOP,  OP_NOP,
+                                   OP_BLT, OP_BGE, OP_BLTU, OP_BGEU};
+    insn.op = ops[funct3];
+    insn.target = insn_pc + imm_b(word);
+    break;
+  }
+  case 0x03: { // LOAD - other funct3 values load a word
+    static const uint8_t ops[8] = {OP_LB,  OP_LH,  OP_LW, OP_LW,
+                                   OP_LBU, OP_LHU, OP_LW, OP_LW};
+    insn.op = ops[funct3];
+    insn.imm = imm_i(word);
+    break;
+  }
+  case 0x23: // STORE - other funct3 values store a word
+    insn.op = funct3 == 0 ? OP_SB : funct3 == 1 ? OP_SH : OP_SW;
+    insn.imm = imm_s(word);
+    break;
+  case 0x13: // ALUI
+    insn.imm = imm_i(word);
+    switch (funct3) {
+    case 0:
+      insn.op = OP_ADDI;
+      break;
+    case 1: // ALU_PASS_RS1 when bit 30 is set
+      insn.op = arithmetic ? OP_ADDI : OP_SLLI;
+      insn.imm = arithmetic ? 0 : shamt;
+      break;
+    case 2:
+      insn.op = OP_SLTI;
+      break;
+    case 3:
+      insn.op = OP_SLTIU;
+      break;
+    case 4:
+      insn.op = OP_XORI;
+      break;
+    case 5:
+      insn.op = arithmetic ? OP_SRAI : OP_SRLI;
+      insn.imm = shamt;
+      break;
+    case 6:
+      insn.op = OP_ORI;
+      break;
+    default:
+      insn.op = OP_ANDI;
+      break;
+    }
+    break;
+  case 0x33: // ALU
+    switch (funct3) {
+    case 0:
+      insn.op = arithmetic ? OP_SUB : OP_ADD;
+      break;
+    case 1: // ALU_PASS_RS1 when bit 30 is set
+      insn.op = arithmetic ? OP_ADDI : OP_SLL;
+      insn.imm = 0;
+      break;
+    case 2:
+      insn.op = OP_SLT;
+      break;
+    case 3:
+      insn.op = OP_SLTU;
+      break;
+    case 4:
+      insn.op = OP_XOR;
+      break;
+    case 5:
+      insn.op = arithmetic ? OP_SRA : OP_SRL;
+      break;
+    case 6:
+      insn.op = OP_OR;
+      break;
+    default:
+      insn.op = OP_AND;
+      break;
+    }
+    break;
+  case 0x0F: // FENCE, FENCE.I
+    insn.op = OP_NOP;
+    break;
+  case 0x73: // SYSTEM
+    if (funct3 == 0) {
+      if ((word >> 20) == 0x302) {
+        insn.op = OP_MRET;
+      } else {
+        insn.op = OP_TRAP;
+        insn.imm = ((word >> 20) & 1) ? 3 : 11; // EBREAK : ECALL
+      }
+    } else if (is_csr_address(word >> 20)) {
+      insn.op = OP_CSR;
+      insn.rs2 = static_cast<uint8_t>(funct3);
+      insn.imm = word >> 20;
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+void Rv32iIss::note_code_store(uint32_t addr) {
+  (void)addr;
+  // Decoded code may be stale; drop it once the current block is left
+  flush_pending = true;
+}
+
+void Rv32iIss::exec_csr(const Insn &insn, uint64_t retired) {
+  // csr_alu: the operand is rs1 (read before rd is written) or the
+  // zero-extended rs1 field; set/clear with x0/zero do not write
+  const uint32_t funct3 = insn.rs2;
+  const uint32_t operand = (funct3 & 4) ? insn.rs1 : regs[insn.rs1];
+  const bool write_suppressed = insn.rs1 == 0;
+
+  // CSR_1 samples the counters d+6 cycles into the instruction, after
+  // this instruction's fetch wait and before its own CSR event
+  const uint64_t fetched = retired + 1;
+  uint32_t old_value = 0;
+  read_csr(insn.imm, retired, fetched,
+           cycle_offset + retired * base_cycles + timing.csr_read_cycle(),
+           old_value);
+  // The write lands on the same edge as the CSR event
+  event_counts[HPM_EVENT_CSR]++;
+
+  switch (funct3 & 3) {
+  case 1: // CSRRW(I)
+    write_csr(insn.imm, operand, fetched);
+    break;
+  case 2: // CSRRS(I)
+    if (!write_suppressed) {
+      write_csr(insn.imm, old_value | operand, fetched);
+    }
+    break;
+  case 3: // CSRRC(I)
+    if (!write_suppressed) {
+      write_csr(insn.imm, old_value & ~operand, fetched);
+    }
+    break;
+  default: // funct3 4 only reads
+    break;
+  }
+  regs[insn.rd] = old_value;
+}
+
+bool Rv32iIss::is_test_complete() const {
+  uint32_t value = memory.backdoor_read_word(MAGIC_RESULT_ADDR);
+  return value == MAGIC_PASS_VALUE || value == MAGIC_FAIL_VALUE;
+}
+
+uint64_t Rv32iIss::execute(uint64_t budget) {
+  uint32_t *const x = regs;
+  uint64_t executed = 0;
+  uint32_t next_pc = pc;
+  const Insn *insn = nullptr;
+
+#if RV32I_ISS_THREADED
+#define ISS_LABEL(name) &&L_##name,
+  static const void *const dispatch_table[NUM_OPS] = {ISS_OPS(ISS_LABEL)};
+#undef ISS_LABEL
+#define DISPATCH() goto *dispatch_table[insn->op]
+#define HANDLER(name) L_##name:
+#define DISPATCH_BEGIN DISPATCH();
+#define DISPATCH_END
+#else
+#define DISPATCH() goto dispatch
+#define HANDLER(name) case OP_##name:
+#define DISPATCH_BEGIN                                                         \
+  dispatch:                                                                    \
+  switch (insn->op) {
+#define DISPATCH_END }
+#endif
+
+// Retire the current instruction and continue with the next in the block
+#define RETIRE_NEXT()                                                          \
+  do {                                                                         \
+    insn++;                                                                    \
+    if (++executed == budget) {                                                \
+      next_pc = insn->pc;                                                      \
+      goto done;                                                               \
+    }                                                                          \
+    DISPATCH();                                                                \
+  } while (0)
+
+// Retire the current instruction and continue at another PC
+#define RETIRE_JUMP(target_pc)                                                 \
+  do {                                                                         \
+    next_pc = (target_pc);                                                     \
+    executed++;                                                                \
+    goto next_block;                                                           \
+  } while (0)
+
+// Instructions slower or faster than the common d+7 cycles
+#define ADD_CYCLES(cls) cycle_offset += extra_cycles[FSM_CLASS_##cls]
+
+// Performance monitor events other than the wait cycles, which follow
+// from the instruction and load/store counts
+#define COUNT_EVENT(event) event_counts[HPM_EVENT_##event]++
+
+// Stores may hit decoded code or finish the test; both leave the block
+#define RETIRE_STORE(addr, size)                                               \
+  do {                                                                         \
+    ADD_CYCLES(STORE);                                                         \
+    COUNT_EVENT(STORE_##size);                                                 \
+    if (code_pages[(addr) >> PAGE_SHIFT]) {                                    \
+      note_code_store(addr);                                                   \
+    }                                                                          \
+    if (flush_pending || result_written) {                                     \
+      RETIRE_JUMP(insn->pc + 4);                                               \
+    }                                                                          \
+    RETIRE_NEXT();                                                             \
+  } while (0)
+
+#define ALU_IMM(name, expr)                                                    \
+  HANDLER(name) {                                                              \
+    const uint32_t a = x[insn->rs1];                                           \
+    const uint32_t b = insn->imm;                                              \
+    x[insn->rd] = (expr);                                                      \
+    RETIRE_NEXT();                                                             \
+  }
+
+#define ALU_REG(name, expr)                                                    \
+  HANDLER(name) {                                                              \
+    const uint32_t a = x[insn->rs1];                                           \
+    const uint32_t b = x[insn->rs2];                                           \
+    x[insn->rd] = (expr);                                                      \
+    RETIRE_NEXT();                                                             \
+  }
+
+#define BRANCH(name, cond)                                                     \
+  HANDLER(name) {                                                              \
+    const uint32_t a = x[insn->rs1];                                           \
+    const uint32_t b = x[insn->rs2];                                           \
+    if (cond) {                                                                \
+      COUNT_EVENT(BRANCH_TAKEN);                                               \
+      RETIRE_JUMP(insn->target);                                               \
+    }                                                                          \
+    RETIRE_NEXT();                                                             \
+  }
+
+next_block:
+  if (executed == budget || result_written || halted) {
+    goto done;
+  }
+  insn = find_block(next_pc)->insns.data();
+
+  DISPATCH_BEGIN
+
+  HANDLER(LI) {
+    x[insn->rd] = insn->imm;
+    RETIRE_NEXT();
+  }
+
+  ALU_IMM(ADDI, a + b)
+  ALU_IMM(SLTI, static_cast<int32_t>(a) < static_cast<int32_t>(b))
+  ALU_IMM(SLTIU, a < b)
+  ALU_IMM(XORI, a ^ b)
+  ALU_IMM(ORI, a | b)
+  ALU_IMM(ANDI, a & b)
+  ALU_IMM(SLLI, a << b)
+  ALU_IMM(SRLI, a >> b)
+  ALU_IMM(SRAI, static_cast<uint32_t>(static_cast<int32_t>(a) >> b))
+
+  ALU_REG(ADD, a + b)
+  ALU_REG(SUB, a - b)
+  ALU_REG(SLL, a << (b & 31))
+  ALU_REG(SLT, static_cast<int32_t>(a) < static_cast<int32_t>(b))
+  ALU_REG(SLTU, a < b)
+  ALU_REG(XOR, a ^ b)
+  ALU_REG(SRL, a >> (b & 31))
+  ALU_REG(SRA, static_cast<uint32_t>(static_cast<int32_t>(a) >> (b & 31)))
+  ALU_REG(OR, a | b)
+  ALU_REG(AND, a & b)
+
+  // The byte enables are those byte_lane.sv drives (access statistics)
+  HANDLER(LB) {
+    const uint32_t addr = x[insn->rs1] + insn->imm;
+    ADD_CYCLES(LOAD);
+    COUNT_EVENT(LOAD_BYTE);
+    const uint32_t word = memory.bus_read_word(
+        addr & ~3u, static_cast<uint8_t>(1u << (addr & 3)));
+    x[insn->rd] = static_cast<uint32_t>(
+        static_cast<int8_t>(word >> ((addr & 3) * 8)));
+    RETIRE_NEXT();
+  }
+  HANDLER(LH) {
+    const uint32_t addr = x[insn->rs1] + insn->imm;
+    ADD_CYCLES(LOAD);
+    COUNT_EVENT(LOAD_HALF);
+    const uint32_t word =
+        memory.bus_read_word(addr & ~3u, (addr & 2) ? 0xC : 0x3);
+    x[insn->rd] = static_cast<uint32_t>(
+        static_cast<int16_t>(word >> ((addr & 2) * 8)));
+    RETIRE_NEXT();
+  }
+  HANDLER(LW) {
+    const uint32_t addr = x[insn->rs1] + insn->imm;
+    ADD_CYCLES(LOAD);
+    COUNT_EVENT(LOAD_WORD);
+    x[insn->rd] = memory.bus_read_word(addr & ~3u);
+    RETIRE_NEXT();
+  }
+  HANDLER(LBU) {
+    const uint32_t addr = x[insn->rs1] + insn->imm;
+    ADD_CYCLES(LOAD);
+    COUNT_EVENT(LOAD_BYTE);
+    const uint32_t word = memory.bus_read_word(
+        addr & ~3u, static_cast<uint8_t>(1u << (addr & 3)));
+    x[insn->rd] = (word >> ((addr & 3) * 8)) & 0xFF;
+    RETIRE_NEXT();
+  }
+  HANDLER(LHU) {
+    const uint32_t addr = x[insn->rs1] + insn->imm;
+    ADD_CYCLES(LOAD);
+    COUNT_EVENT(LOAD_HALF);
+    const uint32_t word =
+        memory.bus_read_word(addr & ~3u, (addr & 2) ? 0xC : 0x3);
+    x[insn->rd] = (word >> ((addr & 2) * 8)) & 0xFFFF;
+    RETIRE_NEXT();
+  }
+
+  // byte_lane.sv replicates the data across the word; the byte enables
+  // pick the lane
+  HANDLER(SB) {
+    const uint32_t addr = x[insn->rs1] + insn->imm;
+    memory.bus_write_word(addr & ~3u, (x[insn->rs2] & 0xFF) * 0x01010101u,
+                          static_cast<uint8_t>(1u << (addr & 3)));
+    RETIRE_STORE(addr, BYTE);
+  }
+  HANDLER(SH) {
+    const uint32_t addr = x[insn->rs1] + insn->imm;
+    memory.bus_write_word(addr & ~3u, (x[insn->rs2] & 0xFFFF) * 0x00010001u,
+                          (addr & 2) ? 0xC : 0x3);
+    RETIRE_STORE(addr, HALF);
+  }
+  HANDLER(SW) {
+    const uint32_t addr = x[insn->rs1] + insn->imm;
+    memory.bus_write_word(addr & ~3u, x[insn->rs2], 0xF);
+    RETIRE_STORE(addr, WORD);
+  }
+
+  BRANCH(BEQ, a == b)
+  BRANCH(BNE, a != b)
+  BRANCH(BLT, static_cast<int32_t>(a) < static_cast<int32_t>(b))
+  BRANCH(BGE, static_cast<int32_t>(a) >= static_cast<int32_t>(b))
+  BRANCH(BLTU, a < b)
+  BRANCH(BGEU, a >= b)
+
+  HANDLER(NOP) { RETIRE_NEXT(); }
+
+  HANDLER(CSR) {
+    exec_csr(*insn, instret + executed);
+    ADD_CYCLES(CSR);
+    RETIRE_NEXT();
+  }
+
+  // JAL_0/JALR_0 write rd before JAL_1/JALR_1 compute the target
+  HANDLER(JAL) {
+    x[insn->rd] = insn->imm;
+    COUNT_EVENT(JUMP);
+    RETIRE_JUMP(insn->target);
+  }
+  HANDLER(JALR) {
+    x[insn->rd] = insn->pc + 4;
+    COUNT_EVENT(JUMP);
+    RETIRE_JUMP(x[insn->rs1] + insn->imm);
+  }
+
+  HANDLER(TRAP) {
+    mepc = insn->pc;
+    mcause = insn->imm;
+    mtval = 0;
+    ADD_CYCLES(TRAP);
+    COUNT_EVENT(TRAP);
+    RETIRE_JUMP(mtvec);
+  }
+  HANDLER(MRET) {
+    ADD_CYCLES(MRET);
+    RETIRE_JUMP(mepc);
+  }
+
+  HANDLER(HALT) {
+    halted = true;
+    next_pc = insn->pc;
+    goto done;
+  }
+
+  HANDLER(END) {
+    next_pc = insn->pc;
+    goto next_block;
+  }
+
+  DISPATCH_END
+
+done:
+  pc = next_pc;
+  instret += executed;
+  return executed;
+
+#undef DISPATCH
+#undef HANDLER
+#undef DISPATCH_BEGIN
+#undef DISPATCH_END
+#undef RETIRE_NEXT
+#undef RETIRE_JUMP
+#undef RETIRE_STORE
+#undef ADD_CYCLES
+#undef COUNT_EVENT
+#undef ALU_IMM
+#undef ALU_REG
+#undef BRANCH
+}
@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+"""
+Compare cycle counts between two simulation builds
+
+Runs every program in $WORKSPACE/test through two riscv_sim binaries (for
+example riscv_sim_rtl and riscv_sim_fast) and checks that each program
+finishes with the same result in the same number of cycles.
+
+Usage:
+    python3 compare_cycle_counts.py <reference_sim> <candidate_sim> [test_dir]
+
+Arguments:
+    reference_sim - riscv_sim binary treated as golden (e.g. riscv_sim_rtl)
+    candidate_sim - riscv_sim binary under test (e.g. riscv_sim_fast), or
+                    any command printing the same [RESULT] lines, such as
+                    "riscv_iss --cycles" for the FSM timing model
+    test_dir      - Program directory (default: $WORKSPACE/test)
+
+Exit codes:
+    0 - Every program matches
+    1 - Mismatch, missing result, or error
+"""
+
+import os
+import re
+import shlex
+import subprocess
+import sys
+
+RESULT_RE = re.compile(r'^\[RESULT\]\s+(\S+)\s+(\S+)\s+(\d+)\s*$')
+
+
+def find_programs(test_dir):
+    """Return program paths (<name>/<name>.elf, falling back to .ini)"""
+    programs = []
+    for name in sorted(os.listdir(test_dir)):
+        for ext in ('.elf', '.ini'):
+            path = os.path.join(test_dir, name, name + ext)
+            if os.path.isfile(path):
+                programs.append(path)
+                break
+    return programs
+
+
+def run_sim(command, programs):
+    """Run a simulator over all programs, return {name: (result, cycles)}"""
+    proc = subprocess.run(shlex.split(command) + programs,
+                          stdout=subprocess.PIPE,
+                          stderr=subprocess.STDOUT, universal_newlines=True)
+    results = {}
+    for line in proc.stdout.splitlines():
+        match = RESULT_RE.match(line)
+        if match:
+            results[match.group(1)] = (match.group(2), int(match.group(3)))
+    return results
+
+
+def main():
+    """Main entry point"""
+    if len(sys.argv) not in (3, 4):
+        print("Usage: compare_cycle_counts.py <reference_sim> <candidate_sim> "
+              "[test_dir]")
+        return 1
+
+    reference, candidate = sys.argv[1], sys.argv[2]
+    if len(sys.argv) == 4:
+        test_dir = sys.argv[3]
+    else:
+        workspace = os.environ.get(
+            'WORKSPACE',
+            os.path.dirname(os.path.dirname(os.path.dirname(
+                os.path.abspath(__file__)))))
+        test_dir = os.path.join(workspace, 'test')
+
+    programs = find_programs(test_dir)
+    if not programs:
+        print(f"Error: No programs found in {test_dir}")
+        return 1
+
+    ref_results = run_sim(reference, programs)
+    cand_results = run_sim(candidate, programs)
+
+    failures = 0
+    print(f"{'Program':<20} {'Reference':>18} {'Candidate':>18}")
+    for path in programs:
+        name = os.path.splitext(os.path.basename(path))[0]
+        ref = ref_results.get(name)
+        cand = cand_results.get(name)
+        ok = ref is not None and ref == cand
+        ref_str = f"{ref[0]} {ref[1]}" if ref else "missing"
+        cand_str = f"{cand[0]} {cand[1]}" if cand else "missing"
+        mark = "✓" if ok else "✗"
+        print(f"{name:<20} {ref_str:>18} {cand_str:>18} {mark}")
+        if not ok:
+            failures += 1
+
+    if failures:
+        print(f"✗ {failures} of {len(programs)} programs differ")
+        return 1
+    print(f"✓ All {len(programs)} programs match")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -3,7 +3,9 @@
 # Run complete test regression suite
 #
 # This script builds the test infrastructure and runs all tests with
-# coverage analysis.
+# coverage analysis. System test binaries are split into individual test
+# cases and run in parallel by run_regression.py; everything else runs
+# through ctest.
 #
 # Usage:
 #   ./scripts/run_all_tests.sh
@@ -46,7 +48,29 @@ echo ""
 echo "======================================"
 echo "Running tests..."
 echo "======================================"
-ctest --output-on-failure
+ctest --output-on-failure -E "^SystemTests_"
+
+# System tests: one process per test case across all cores, longest first.
+# RTL results and merged coverage go to logs/, fast and netlist runs to
+# logs/<variant>
+echo ""
+echo "======================================"
+echo "Running system tests in parallel..."
+echo "======================================"
+REGRESSION_FAILED=0
+python3 "$SCRIPT_DIR/run_regression.py" ./riscv_tests_rtl --logs logs \
+  || REGRESSION_FAILED=1
+for variant in fast synth gls; do
+  if [ -x "./riscv_tests_$variant" ]; then
+    # The fast build has no coverage instrumentation
+    COVERAGE_ARGS=()
+    if [ "$variant" = fast ]; then
+      COVERAGE_ARGS=(--no-coverage)
+    fi
+    python3 "$SCRIPT_DIR/run_regression.py" "./riscv_tests_$variant" \
+      --logs "logs/$variant" "${COVERAGE_ARGS[@]}" || REGRESSION_FAILED=1
+  fi
+done
 
 # Generate coverage
 echo ""
@@ -64,7 +88,10 @@ echo ""
 echo "======================================"
 echo "Test Results Summary:"
 echo "======================================"
-ctest --output-on-failure --verbose | grep -E "(Test|Passed|Failed|Total)"
+ctest --output-on-failure --verbose -E "^SystemTests_" | grep -E "(Test|Passed|Failed|Total)"
+if [ "$REGRESSION_FAILED" -ne 0 ]; then
+  echo "System test failures - see logs/tests/"
+fi
 
 echo ""
 if [ -d coverage_html ]; then
@@ -74,3 +101,4 @@ echo ""
 echo "======================================"
 echo "Regression Complete"
 echo "======================================"
+exit $REGRESSION_FAILED
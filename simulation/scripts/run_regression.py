@@ -0,0 +1,226 @@
+#!/usr/bin/env python3
+"""
+Parallel regression driver for the Boost.Test executables
+
+Lists every test case in a riscv_tests_* binary, runs each case as its own
+process across all cores, and merges the results and per-test coverage.
+
+Scheduling: test cases are ordered longest-first by the cycle counts
+recorded in the history file (unknown cases go first), and idle workers
+take the next case from the shared queue. The long cases start early and
+the short ones fill in the gaps, so wall-clock time approaches
+total_time / jobs instead of waiting on one long case at the end.
+
+Usage:
+    python3 run_regression.py <test_binary> [options]
+
+Options:
+    -j, --jobs N        Parallel workers (default: all cores)
+    --suite NAME        Only run this suite (repeatable, default: all)
+    --history FILE      Cycle-count history (default: logs/test_history.json)
+    --logs DIR          Per-test logs and results (default: logs)
+    --no-coverage       Skip per-test coverage collection and merging
+    --timeout SECONDS   Per-test wall-clock limit (default: none)
+
+Outputs (under --logs):
+    tests/<suite>.<case>.log   Output of each test case
+    coverage/<suite>.<case>/   Per-test coverage_*.dat files
+    coverage.dat               Merged coverage (verilator_coverage)
+    regression_results.json    Result, cycles and wall time per case
+
+Exit codes:
+    0 - Every test case passed
+    1 - At least one failure, or error
+"""
+
+import argparse
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import threading
+import time
+
+CYCLES_RE = re.compile(r'^\[TEST\] Test completed in (\d+) cycles')
+TIMEOUT_RE = re.compile(r'^\[TEST\] Timeout after (\d+) cycles')
+
+
+def list_test_cases(binary, suites):
+    """Return ['Suite/case', ...] from --list_content"""
+    proc = subprocess.run([binary, '--list_content'], stdout=subprocess.PIPE,
+                          stderr=subprocess.STDOUT, universal_newlines=True)
+    cases = []
+    suite = None
+    for line in proc.stdout.splitlines():
+        name = line.strip().rstrip('*')
+        if not name:
+            continue
+        if not line.startswith(' '):
+            suite = name
+        elif suite and (not suites or suite in suites):
+            cases.append(f"{suite}/{name}")
+    return cases
+
+
+def load_history(path):
+    """Load {case: cycles} from a previous run"""
+    try:
+        with open(path, 'r') as f:
+            return json.load(f)
+    except (FileNotFoundError, ValueError):
+        return {}
+
+
+def save_history(path, history):
+    os.makedirs(os.path.dirname(os.path.abspath(path)), exist_ok=True)
+    with open(path, 'w') as f:
+        json.dump(history, f, indent=2, sort_keys=True)
+
+
+def run_case(binary, case, log_dir, coverage_dir, timeout):
+    """Run one test case in its own process"""
+    tag = case.replace('/', '.')
+    env = dict(os.environ)
+    if coverage_dir:
+        case_coverage = os.path.join(coverage_dir, tag)
+        os.makedirs(case_coverage, exist_ok=True)
+        env['RISCV_COVERAGE_DIR'] = case_coverage
+
+    start = time.time()
+    try:
+        proc = subprocess.run([binary, f'--run_test={case}'],
+                              stdout=subprocess.PIPE,
+                              stderr=subprocess.STDOUT,
+                              universal_newlines=True, env=env,
+                              timeout=timeout)
+        output = proc.stdout
+        status = 'PASS' if proc.returncode == 0 else 'FAIL'
+    except subprocess.TimeoutExpired as e:
+        output = e.stdout or ''
+        if isinstance(output, bytes):
+            output = output.decode(errors='replace')
+        status = 'TIMEOUT'
+    elapsed = time.time() - start
+
+    with open(os.path.join(log_dir, tag + '.log'), 'w') as f:
+        f.write(output)
+
+    # A case may run several programs; its cost is the sum of their cycles
+    cycles = 0
+    for line in output.splitlines():
+        match = CYCLES_RE.match(line) or TIMEOUT_RE.match(line)
+        if match:
+            cycles += int(match.group(1))
+
+    return {'status': status, 'cycles': cycles, 'seconds': elapsed}
+
+
+def merge_coverage(coverage_dir, output):
+    """Merge every per-test coverage file into one .dat"""
+    files = []
+    for root, _, names in os.walk(coverage_dir):
+        files.extend(os.path.join(root, n) for n in sorted(names)
+                     if n.endswith('.dat'))
+    if not files:
+        print("Warning: No coverage data found")
+        return
+    if not shutil.which('verilator_coverage'):
+        print("Warning: verilator_coverage not found, coverage not merged")
+        return
+    subprocess.run(['verilator_coverage', '--write', output] + sorted(files),
+                   check=False)
+    print(f"Merged {len(files)} coverage files into {output}")
+
+
+def main():
+    """Main entry point"""
+    parser = argparse.ArgumentParser(
+        description="Run Boost.Test cases in parallel, longest first")
+    parser.add_argument('binary')
+    parser.add_argument('-j', '--jobs', type=int, default=os.cpu_count() or 1)
+    parser.add_argument('--suite', action='append', default=[])
+    parser.add_argument('--history', default=None)
+    parser.add_argument('--logs', default='logs')
+    parser.add_argument('--no-coverage', action='store_true')
+    parser.add_argument('--timeout', type=float, default=None)
+    args = parser.parse_args()
+
+    binary = os.path.abspath(args.binary)
+    history_file = args.history or os.path.join(args.logs, 'test_history.json')
+    log_dir = os.path.join(args.logs, 'tests')
+    coverage_dir = None if args.no_coverage else os.path.join(args.logs,
+                                                              'coverage')
+    os.makedirs(log_dir, exist_ok=True)
+    if coverage_dir:
+        shutil.rmtree(coverage_dir, ignore_errors=True)
+        os.makedirs(coverage_dir)
+
+    cases = list_test_cases(binary, args.suite)
+    if not cases:
+        print(f"Error: No test cases found in {binary}")
+        return 1
+
+    # Longest first; cases without history sort ahead of everything
+    history = load_history(history_file)
+    cases.sort(key=lambda c: history.get(c, float('inf')), reverse=True)
+
+    jobs = max(1, min(args.jobs, len(cases)))
+    print(f"Running {len(cases)} test cases on {jobs} workers")
+
+    queue = list(cases)
+    results = {}
+    lock = threading.Lock()
+
+    def worker():
+        while True:
+            with lock:
+                if not queue:
+                    return
+                case = queue.pop(0)
+            result = run_case(binary, case, log_dir, coverage_dir,
+                              args.timeout)
+            with lock:
+                results[case] = result
+                print(f"  {result['status']:<8} {case} "
+                      f"({result['cycles']} cycles, "
+                      f"{result['seconds']:.1f}s)", flush=True)
+
+    start = time.time()
+    threads = [threading.Thread(target=worker) for _ in range(jobs)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    wall = time.time() - start
+
+    # Cases killed by --timeout report partial cycles; keep their old entry
+    for case, result in results.items():
+        if result['status'] != 'TIMEOUT':
+            history[case] = result['cycles']
+    save_history(history_file, history)
+
+    with open(os.path.join(args.logs, 'regression_results.json'), 'w') as f:
+        json.dump({'binary': binary, 'jobs': jobs, 'wall_seconds': wall,
+                   'cases': results}, f, indent=2, sort_keys=True)
+
+    if coverage_dir:
+        merge_coverage(coverage_dir, os.path.join(args.logs, 'coverage.dat'))
+
+    failed = sorted(c for c, r in results.items() if r['status'] != 'PASS')
+    cpu = sum(r['seconds'] for r in results.values())
+    print("")
+    print(f"Passed: {len(results) - len(failed)}/{len(results)}  "
+          f"Wall: {wall:.1f}s  CPU: {cpu:.1f}s  "
+          f"Speedup: {cpu / wall if wall > 0 else 0:.1f}x")
+    for case in failed:
+        print(f"✗ {case} ({results[case]['status']}) - see "
+              f"{os.path.join(log_dir, case.replace('/', '.') + '.log')}")
+    if not failed:
+        print("✓ All test cases passed")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
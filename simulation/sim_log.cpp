@@ -0,0 +1,45 @@
+/*
+ * Levelled Logging Implementation
+ */
+
+#include "include/sim_log.h"
+
+LogSink::LogSink(LogLevel level, std::ostream &out_stream,
+                 std::ostream &err_stream)
+    : min_level(level), out(&out_stream), err(&err_stream),
+      line_level(LogLevel::INFO) {}
+
+LogSink::~LogSink() { flush(); }
+
+std::ostream &LogSink::begin(LogLevel level, const char *tag) {
+  line_level = level;
+  line.str(std::string());
+  line.clear();
+  line << '[' << tag << "] ";
+  return line;
+}
+
+void LogSink::end() {
+  line << '\n';
+
+  if (line_level >= LogLevel::ERROR) {
+    // Keep errors ordered after everything logged before them
+    flush();
+    *err << line.str();
+    err->flush();
+    return;
+  }
+
+  buffer += line.str();
+  if (line_level >= LogLevel::WARN || buffer.size() >= FLUSH_THRESHOLD) {
+    flush();
+  }
+}
+
+void LogSink::flush() {
+  if (!buffer.empty()) {
+    out->write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    buffer.clear();
+  }
+  out->flush();
+}
@@ -0,0 +1,465 @@
+/*
+ * Sampled Simulation Implementation
+ */
+
+#include "include/simpoint.h"
+#include "include/rtl_backdoor.h"
+#include "include/rv32i_iss.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <random>
+
+namespace {
+using Point = std::vector<double>;
+
+// Stateless hash so the projection needs no matrix over all block PCs
+uint64_t mix64(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+// Projection matrix entry for a block and dimension, uniform in [-1, 1)
+double projection(uint32_t block_pc, uint32_t dimension, uint64_t seed) {
+  uint64_t bits = mix64(seed ^ mix64((static_cast<uint64_t>(block_pc) << 8) |
+                                     dimension));
+  return static_cast<double>(bits >> 11) * (2.0 / 9007199254740992.0) - 1.0;
+}
+
+double distance2(const Point &a, const Point &b) {
+  double sum = 0;
+  for (size_t i = 0; i < a.size(); i++) {
+    double d = a[i] - b[i];
+    sum += d * d;
+  }
+  return sum;
+}
+
+struct KMeansResult {
+  std::vector<uint32_t> cluster;
+  std::vector<Point> centroids;
+  double sse = std::numeric_limits<double>::infinity();
+};
+
+// Lloyd's algorithm from a k-means++ start; clusters that run empty are
+// reseeded with the point furthest from its centroid
+KMeansResult kmeans(const std::vector<Point> &points, uint32_t k,
+                    std::mt19937_64 &rng) {
+  const size_t n = points.size();
+  KMeansResult result;
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  result.centroids.push_back(points[rng() % n]);
+  std::vector<double> nearest(n, std::numeric_limits<double>::infinity());
+  while (result.centroids.size() < k) {
+    double total = 0;
+    for (size_t i = 0; i < n; i++) {
+      nearest[i] =
+          std::min(nearest[i], distance2(points[i], result.centroids.back()));
+      total += nearest[i];
+    }
+    size_t pick = rng() % n;
+    if (total > 0) {
+      double target = uniform(rng) * total;
+      for (size_t i = 0; i < n; i++) {
+        target -= nearest[i];
+        if (target <= 0) {
+          pick = i;
+          break;
+        }
+      }
+    }
+    result.centroids.push_back(points[pick]);
+  }
+
+  const size_t dims = points[0].size();
+  result.cluster.assign(n, 0);
+  for (int iteration = 0; iteration < 100; iteration++) {
+    bool changed = iteration == 0;
+    for (size_t i = 0; i < n; i++) {
+      uint32_t best = 0;
+      double best_distance = std::numeric_limits<double>::infinity();
+      for (uint32_t c = 0; c < k; c++) {
+        double d = distance2(points[i], result.centroids[c]);
+        if (d < best_distance) {
+          best_distance = d;
+          best = c;
+        }
+      }
+      if (result.cluster[i] != best) {
+        result.cluster[i] = best;
+        changed = true;
+      }
+    }
+    if (!changed) {
+      break;
+    }
+
+    std::vector<Point> sums(k, Point(dims, 0.0));
+    std::vector<size_t> counts(k, 0);
+    for (size_t i = 0; i < n; i++) {
+      counts[result.cluster[i]]++;
+      for (size_t d = 0; d < dims; d++) {
+        sums[result.cluster[i]][d] += points[i][d];
+      }
+    }
+    for (uint32_t c = 0; c < k; c++) {
+      if (counts[c] == 0) {
+        size_t furthest = 0;
+        double furthest_distance = -1;
+        for (size_t i = 0; i < n; i++) {
+          double d = distance2(points[i], result.centroids[result.cluster[i]]);
+          if (d > furthest_distance) {
+            furthest_distance = d;
+            furthest = i;
+          }
+        }
+        result.centroids[c] = points[furthest];
+        continue;
+      }
+      for (size_t d = 0; d < dims; d++) {
+        result.centroids[c][d] = sums[c][d] / counts[c];
+      }
+    }
+  }
+
+  result.sse = 0;
+  for (size_t i = 0; i < n; i++) {
+    result.sse += distance2(points[i], result.centroids[result.cluster[i]]);
+  }
+  return result;
+}
+
+// Bayesian information criterion of a clustering under identical spherical
+// Gaussians (Pelleg and Moore, as used by SimPoint)
+double bic_score(const KMeansResult &result, uint32_t k, size_t dims) {
+  const double r = static_cast<double>(result.cluster.size());
+  const double m = static_cast<double>(dims);
+  std::vector<double> sizes(k, 0.0);
+  for (uint32_t c : result.cluster) {
+    sizes[c] += 1;
+  }
+  double variance =
+      result.sse / (m * std::max(1.0, r - static_cast<double>(k)));
+  variance = std::max(variance, 1e-12);
+
+  const double two_pi = 2.0 * 3.14159265358979323846;
+  double likelihood = 0;
+  for (double size : sizes) {
+    if (size == 0) {
+      continue;
+    }
+    likelihood += size * std::log(size) - size * std::log(r) -
+                  size * m / 2 * std::log(two_pi * variance) -
+                  (size - 1) * m / 2;
+  }
+  double parameters = (k - 1) + m * k + 1;
+  return likelihood - parameters / 2 * std::log(r);
+}
+
+std::string base_name(const std::string &path) {
+  size_t slash = path.find_last_of('/');
+  std::string base =
+      (slash == std::string::npos) ? path : path.substr(slash + 1);
+  size_t dot = base.find_last_of('.');
+  return (dot == std::string::npos) ? base : base.substr(0, dot);
+}
+
+// Step the RTL until target instructions have retired; false (after
+// max_cycles) if it does not get there
+bool run_to_instret(TestRunner &runner, uint64_t target, uint64_t max_cycles,
+                    uint64_t &cycles) {
+  cycles = 0;
+  while (rtl_backdoor::get_instret(runner.get_dut()) < target) {
+    if (cycles >= max_cycles) {
+      return false;
+    }
+    cycles += runner.step(max_cycles - cycles);
+  }
+  return true;
+}
+
+// Cycle bound for n instructions, far above the slowest (a load)
+uint64_t cycle_budget(uint64_t instructions, uint32_t memory_delay) {
+  return 4 * instructions * (2 * static_cast<uint64_t>(memory_delay) + 10) +
+         1000;
+}
+
+bool measure_sample(const std::string &program_file,
+                    const SimPointConfig &config, SimPointSample &sample,
+                    uint64_t &simulated, std::string &error) {
+  const std::string name =
+      base_name(program_file) + "_interval" + std::to_string(sample.interval);
+  TestRunnerConfig runner_config = config.runner;
+  runner_config.cosim = false;
+  TestRunner runner(name, runner_config);
+
+  // Hand-over point: warmup instructions before the interval
+  const uint64_t warm_start =
+      sample.start > config.warmup ? sample.start - config.warmup : 0;
+  const std::string checkpoint =
+      config.checkpoint_dir.empty()
+          ? std::string()
+          : config.checkpoint_dir + "/" + name + ".ckpt";
+  bool restored = !checkpoint.empty() && std::ifstream(checkpoint).good() &&
+                  runner.restore_checkpoint(checkpoint);
+  if (!restored) {
+    if (!runner.load_program(program_file)) {
+      error = "cannot load " + program_file;
+      return false;
+    }
+    if (warm_start > 0 && runner.run_functional(warm_start) != warm_start) {
+      error = "program ended before instruction " +
+              std::to_string(warm_start);
+      return false;
+    }
+    if (!checkpoint.empty()) {
+      runner.save_checkpoint(checkpoint);
+    }
+  }
+
+  // Detailed warmup, then the measured interval
+  const uint32_t delay = runner_config.memory_delay;
+  uint64_t warmup_cycles = 0;
+  if (!run_to_instret(runner, sample.start,
+                      cycle_budget(sample.start - warm_start, delay),
+                      warmup_cycles) ||
+      !run_to_instret(runner, sample.start + sample.instructions,
+                      cycle_budget(sample.instructions, delay),
+                      sample.cycles)) {
+    error = "interval " + std::to_string(sample.interval) +
+            " did not complete on the RTL";
+    return false;
+  }
+  simulated += sample.start - warm_start + sample.instructions;
+  sample.cpi = static_cast<double>(sample.cycles) / sample.instructions;
+  sample.valid = true;
+  return true;
+}
+} // namespace
+
+BbvCollector::BbvCollector(uint64_t interval_length, uint64_t start_cycles)
+    : interval(std::max<uint64_t>(1, interval_length)), instructions(0),
+      interval_start_cycles(start_cycles), last_cycles(start_cycles),
+      in_block(false), block_pc(0), block_length(0) {}
+
+void BbvCollector::retire(uint32_t pc, uint32_t next_pc, uint64_t cycles) {
+  if (!in_block) {
+    in_block = true;
+    block_pc = pc;
+  }
+  block_length++;
+  current.instructions++;
+  instructions++;
+  last_cycles = cycles;
+
+  if (next_pc != pc + 4) {
+    end_block();
+    in_block = false;
+  }
+  if (current.instructions == interval) {
+    // A block cut by the boundary keeps its start PC in the next interval
+    end_block();
+    current.cycles = cycles - interval_start_cycles;
+    interval_start_cycles = cycles;
+    vectors.push_back(std::move(current));
+    current = BasicBlockVector();
+  }
+}
+
+void BbvCollector::finish() {
+  end_block();
+  in_block = false;
+  if (current.instructions > 0) {
+    current.cycles = last_cycles - interval_start_cycles;
+    interval_start_cycles = last_cycles;
+    vectors.push_back(std::move(current));
+    current = BasicBlockVector();
+  }
+}
+
+void BbvCollector::end_block() {
+  if (block_length > 0) {
+    current.blocks[block_pc] += block_length;
+    block_length = 0;
+  }
+}
+
+std::vector<BasicBlockVector> profile_bbvs(const std::string &program_file,
+                                           const SimPointConfig &config) {
+  MemoryModel memory(config.runner.memory_size, config.runner.memory_delay,
+                     false);
+  IssConfig iss_config;
+  iss_config.memory_delay = config.runner.memory_delay;
+  iss_config.log_level = config.runner.log_level;
+  Rv32iIss iss(memory, iss_config);
+  if (!iss.load_program(program_file)) {
+    return {};
+  }
+
+  bool done = false;
+  int watch = memory.add_write_watch(
+      MAGIC_RESULT_ADDR, 4, [&done](uint32_t, uint32_t, uint8_t) {
+        done = true;
+      });
+  BbvCollector collector(config.interval, iss.get_cycles());
+  while (!done && collector.get_instructions() < config.max_instructions) {
+    uint32_t pc = iss.get_pc();
+    if (iss.step(1) == 0) {
+      break; // Halted
+    }
+    collector.retire(pc, iss.get_pc(), iss.get_cycles());
+  }
+  memory.remove_write_watch(watch);
+  collector.finish();
+  return collector.get_vectors();
+}
+
+SimPointClustering cluster_bbvs(const std::vector<BasicBlockVector> &vectors,
+                                const SimPointConfig &config) {
+  SimPointClustering clustering;
+  const size_t n = vectors.size();
+  if (n == 0) {
+    return clustering;
+  }
+
+  // Normalized vectors, randomly projected to a few dimensions
+  const uint32_t dims = std::max(1u, config.dimensions);
+  std::vector<Point> points(n, Point(dims, 0.0));
+  for (size_t i = 0; i < n; i++) {
+    for (const auto &block : vectors[i].blocks) {
+      double share = static_cast<double>(block.second) /
+                     static_cast<double>(vectors[i].instructions);
+      for (uint32_t d = 0; d < dims; d++) {
+        points[i][d] += share * projection(block.first, d, config.seed);
+      }
+    }
+  }
+
+  const uint32_t max_k =
+      static_cast<uint32_t>(std::min<size_t>(std::max(1u, config.max_k), n));
+  std::vector<KMeansResult> best(max_k);
+  for (uint32_t k = 1; k <= max_k; k++) {
+    for (uint32_t s = 0; s < std::max(1u, config.seeds); s++) {
+      std::mt19937_64 rng(mix64(config.seed + 1000 * k + s));
+      KMeansResult result = kmeans(points, k, rng);
+      if (result.sse < best[k - 1].sse) {
+        best[k - 1] = std::move(result);
+      }
+    }
+    clustering.bic.push_back(bic_score(best[k - 1], k, dims));
+  }
+
+  // Smallest k within bic_threshold of the BIC range
+  double low = *std::min_element(clustering.bic.begin(), clustering.bic.end());
+  double high =
+      *std::max_element(clustering.bic.begin(), clustering.bic.end());
+  double target = low + config.bic_threshold * (high - low);
+  uint32_t k = max_k;
+  for (uint32_t i = 0; i < max_k; i++) {
+    if (clustering.bic[i] >= target) {
+      k = i + 1;
+      break;
+    }
+  }
+  const KMeansResult &chosen = best[k - 1];
+
+  // Drop clusters left empty, then pick the interval nearest each centroid
+  std::vector<int> renumber(k, -1);
+  for (uint32_t c : chosen.cluster) {
+    if (renumber[c] < 0) {
+      renumber[c] = static_cast<int>(clustering.k++);
+    }
+  }
+  clustering.cluster.resize(n);
+  clustering.representatives.assign(clustering.k, 0);
+  clustering.weights.assign(clustering.k, 0.0);
+  std::vector<double> nearest(clustering.k,
+                              std::numeric_limits<double>::infinity());
+  uint64_t total = 0;
+  for (const BasicBlockVector &vector : vectors) {
+    total += vector.instructions;
+  }
+  for (size_t i = 0; i < n; i++) {
+    uint32_t c = static_cast<uint32_t>(renumber[chosen.cluster[i]]);
+    clustering.cluster[i] = c;
+    clustering.weights[c] +=
+        static_cast<double>(vectors[i].instructions) / total;
+    double d = distance2(points[i], chosen.centroids[chosen.cluster[i]]);
+    if (d < nearest[c]) {
+      nearest[c] = d;
+      clustering.representatives[c] = i;
+    }
+  }
+  return clustering;
+}
+
+SimPointReport run_simpoint(const std::string &program_file,
+                            const SimPointConfig &config) {
+  SimPointReport report;
+  if (!rtl_backdoor::available()) {
+    report.error = "sampled simulation needs the RTL backdoor";
+    return report;
+  }
+
+  std::vector<BasicBlockVector> vectors = profile_bbvs(program_file, config);
+  if (vectors.empty()) {
+    report.error = "cannot profile " + program_file;
+    return report;
+  }
+  std::vector<uint64_t> starts;
+  uint64_t model_cycles = 0;
+  for (const BasicBlockVector &vector : vectors) {
+    starts.push_back(report.total_instructions);
+    report.total_instructions += vector.instructions;
+    model_cycles += vector.cycles;
+  }
+  report.intervals = vectors.size();
+  report.model_cpi =
+      static_cast<double>(model_cycles) / report.total_instructions;
+
+  SimPointClustering clustering = cluster_bbvs(vectors, config);
+  report.k = clustering.k;
+  for (uint32_t c = 0; c < clustering.k; c++) {
+    SimPointSample sample;
+    sample.interval = clustering.representatives[c];
+    sample.start = starts[sample.interval];
+    sample.instructions = vectors[sample.interval].instructions;
+    sample.weight = clustering.weights[c];
+    sample.model_cpi =
+        static_cast<double>(vectors[sample.interval].cycles) /
+        sample.instructions;
+    if (!measure_sample(program_file, config, sample,
+                        report.simulated_instructions, report.error)) {
+      return report;
+    }
+    report.weighted_cpi += sample.weight * sample.cpi;
+    report.model_weighted_cpi += sample.weight * sample.model_cpi;
+    report.samples.push_back(sample);
+  }
+  report.estimated_error =
+      std::fabs(report.model_weighted_cpi - report.model_cpi) /
+      report.model_cpi;
+
+  if (config.full_run) {
+    TestRunnerConfig runner_config = config.runner;
+    runner_config.cosim = false;
+    TestRunner runner(base_name(program_file) + "_full", runner_config);
+    if (!runner.load_program(program_file) ||
+        runner.run(UINT64_MAX) != TestResult::PASS) {
+      report.error = "full run of " + program_file + " did not pass";
+      return report;
+    }
+    report.full_run = true;
+    report.full_cycles = runner.get_cycle_count();
+    report.full_cpi = static_cast<double>(report.full_cycles) /
+                      report.total_instructions;
+    report.full_error =
+        std::fabs(report.weighted_cpi - report.full_cpi) / report.full_cpi;
+  }
+  report.ok = true;
+  return report;
+}
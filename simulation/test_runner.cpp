@@ -4,32 +4,221 @@
 
 #include "include/test_runner.h"
 #include "Vcore_top.h"
+#include "include/rtl_backdoor.h"
+#include "include/rv32i_iss.h"
 #include "include/test_utils.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
 #include <verilated.h>
+#include <verilated_save.h>
+#ifndef RISCV_SIM_FAST
+#ifdef RISCV_TRACE_FST
+#include <verilated_fst_c.h>
+#else
 #include <verilated_vcd_c.h>
+#endif
+#endif
+
+namespace {
+TestRunnerConfig trace_config(bool enable_trace) {
+  TestRunnerConfig config;
+  config.enable_trace = enable_trace;
+  return config;
+}
+
+// Memory bus ports of core_top, traced for the "bus" scope
+const char *const TRACE_BUS_SIGNALS[] = {
+    "clk",      "rst_n",     "mem_addr", "mem_wdata", "mem_rdata",
+    "mem_read", "mem_write", "mem_be",   "mem_resp"};
+
+// Checkpoint header ("RVCK", format 1), ahead of the harness state
+constexpr uint32_t CHECKPOINT_MAGIC = 0x4B435652;
+constexpr uint32_t CHECKPOINT_VERSION = 1;
+
+template <typename T> void save_value(VerilatedSerialize &os, T value) {
+  os.write(&value, sizeof(value));
+}
+
+template <typename T> void load_value(VerilatedDeserialize &os, T &value) {
+  os.read(&value, sizeof(value));
+}
+
+// Clone report sent over the pipe: result, cycles, output length, output
+constexpr size_t CLONE_HEADER_SIZE = 4 + 8 + 8;
+constexpr size_t CLONE_READ_CHUNK = 4096;
+
+template <typename T> void append_value(std::string &buffer, T value) {
+  buffer.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T> T extract_value(const std::string &buffer, size_t at) {
+  T value;
+  std::copy(buffer.data() + at, buffer.data() + at + sizeof(T),
+            reinterpret_cast<char *>(&value));
+  return value;
+}
+
+bool write_all(int fd, const char *data, size_t size) {
+  while (size > 0) {
+    ssize_t written = ::write(fd, data, size);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    data += written;
+    size -= static_cast<size_t>(written);
+  }
+  return true;
+}
+
+// Machine CSRs a functional fast-forward hands over: the trap CSRs and the
+// performance monitor
+std::vector<uint32_t> handover_csrs() {
+  std::vector<uint32_t> csrs = {0x305, 0x341, 0x342, 0x343, 0x320};
+  for (uint32_t i = 0; i < HPM_COUNTERS; i++) {
+    csrs.push_back(0x323 + i); // mhpmevent
+    csrs.push_back(0xB03 + i); // mhpmcounter
+    csrs.push_back(0xB83 + i); // mhpmcounterh
+  }
+  return csrs;
+}
+
+} // namespace
 
 TestRunner::TestRunner(const std::string &name, bool enable_trace)
-    : dut(nullptr), memory(nullptr), trace(nullptr), cycle_count(0),
-      sim_time(0), trace_enabled(enable_trace), test_name(name), previous_pc(0),
-      stuck_count(0) {
-  // Initialize Verilator context
+    : TestRunner(name, trace_config(enable_trace)) {}
+
+TestRunner::TestRunner(const std::string &name,
+                       const TestRunnerConfig &runner_config)
+    : context(nullptr), dut(nullptr), memory(nullptr), trace(nullptr),
+      config(runner_config), log(runner_config.log_level), cycle_count(0),
+      skipped_cycles(0), fast_forward_enabled(false), test_name(name),
+      result_written(false), resume_run(false), hang_cycles(0),
+      last_bus_count(0), last_bus_cycle(0), last_instret(0),
+      last_retire_cycle(0), loop_valid(false), loop_pc(0), loop_changes(0),
+      loop_hash(0), loop_power(1), loop_length(0), retire_instret(0),
+      retire_pc(0), cosim(nullptr), cosim_instret(0), cosim_regs(),
+      commit_log(nullptr), fsm_profile(nullptr), pc_profile(nullptr),
+      timeline(nullptr), trace_dumping(false), trace_triggered(false),
+      trace_write_hit(false), trace_window_start(0),
+      trace_window_stop(UINT64_MAX), trace_replay_cycle(0),
+      trace_snapshot_valid(), trace_snapshot_cycle(), trace_snapshot_next(0) {
+  init();
+}
+
+void TestRunner::init() {
+  // The regression driver collects coverage per test case by pointing every
+  // runner in the process at its own directory (scripts/run_regression.py)
+  if (config.coverage_file.empty()) {
+    const char *coverage_dir = std::getenv("RISCV_COVERAGE_DIR");
+    if (coverage_dir && *coverage_dir) {
+      config.coverage_file =
+          std::string(coverage_dir) + "/coverage_" + test_name + ".dat";
+    }
+  }
+
+  // Each runner owns its Verilator context: simulation time, coverage
+  // counters and trace state are private to this instance, so runners on
+  // different threads never touch shared simulator state
+  context = new VerilatedContext();
   const char *argv[] = {""};
-  Verilated::commandArgs(1, argv);
+  context->commandArgs(1, argv);
+  if (config.enable_trace) {
+    // Must be set before the model is constructed
+    context->traceEverOn(true);
+  }
+
+  // Create DUT instance in this context
+  dut = new Vcore_top(context, "TOP");
+
+  // Create memory model (default 288MB covers ROM at 0x1000 and RAM at
+  // 0x10000000, 4 cycle delay, debug enabled)
+  memory = new MemoryModel(config.memory_size, config.memory_delay,
+                           config.memory_debug, &log);
 
-  // Create DUT instance
-  dut = new Vcore_top();
+  // Completion is signalled by the bus write to the magic address instead
+  // of reading it back every cycle
+  memory->add_write_watch(MAGIC_RESULT_ADDR, 4,
+                          [this](uint32_t, uint32_t, uint8_t) {
+                            result_written = true;
+                          });
+
+  // Co-simulation compares every bus store with the reference model's
+  if (config.cosim) {
+    memory->add_write_watch(
+        0, 0xFFFFFFFF, [this](uint32_t addr, uint32_t data, uint8_t be) {
+          cosim_pending.store = true;
+          cosim_pending.store_addr = addr;
+          cosim_pending.store_data = data;
+          cosim_pending.store_be = be;
+        });
+  }
+
+  if (!config.commit_log_file.empty()) {
+    open_commit_log();
+  }
+
+  if (config.fsm_profile || !config.fsm_profile_file.empty()) {
+    if (rtl_backdoor::available()) {
+      fsm_profile = new FsmProfile();
+    } else {
+      SIM_LOG(log, LogLevel::WARN, "TEST",
+              "FSM profile needs the RTL backdoor, not available in this "
+              "build; disabled");
+    }
+  }
+
+  if (config.pc_profile || !config.pc_profile_file.empty()) {
+    pc_profile = new PcProfile(config.pc_profile_interval);
+  }
+
+  if (config.memory_stats || !config.memory_stats_file.empty()) {
+    memory->enable_access_stats(config.memory_stats_window);
+  }
 
-  // Create memory model (288MB to cover ROM at 0x1000 and RAM at 0x10000000, 4
-  // cycle delay, debug enabled)
-  memory = new MemoryModel(288 * 1024 * 1024, 4, true);
+  if (!config.timeline_file.empty()) {
+    timeline = new TimelineTrace(config.timeline_start, config.timeline_stop);
+    timeline->set_name(test_name);
+    if (!rtl_backdoor::available()) {
+      SIM_LOG(log, LogLevel::WARN, "TEST",
+              "Timeline instruction and trap tracks need the RTL backdoor, "
+              "not available in this build; only memory transactions are "
+              "recorded");
+    }
+    // Transactions complete in the cycle being clocked. Ones replayed
+    // after a pre-trigger rewind were recorded already
+    memory->set_bus_monitor(
+        [this](const MemoryModel::BusTransaction &transaction) {
+          if (timeline && cycle_count >= trace_replay_cycle) {
+            timeline->add_transaction(transaction, cycle_count);
+          }
+        });
+  }
 
   // Setup tracing if requested
-  if (trace_enabled) {
+  if (config.enable_trace) {
     setup_trace();
   }
 
+  // Fast-forward needs the RTL backdoor; step() does not skip cycles
+  // while the waveform is written, as it would have gaps
+  fast_forward_enabled = config.fast_forward && rtl_backdoor::available();
+
+  resolve_hang_cycles();
+
   // Initialize DUT inputs
   dut->clk = 0;
   dut->rst_n = 0;
@@ -40,10 +229,18 @@ TestRunner::TestRunner(const std::string &name, bool enable_trace)
   // Reset the design
   reset();
 
-  std::cout << "[TEST] TestRunner initialized for test: " << test_name << "\n";
+  SIM_LOG(log, LogLevel::INFO, "TEST",
+          "TestRunner initialized for test: " << test_name);
 }
 
 TestRunner::~TestRunner() {
+  // Stop the co-simulation checker and commit log threads
+  delete cosim;
+  close_commit_log();
+  delete fsm_profile;
+  delete pc_profile;
+  delete timeline;
+
   // Finalize trace before cleanup
   if (trace) {
     cleanup_trace();
@@ -52,51 +249,291 @@ TestRunner::~TestRunner() {
   // Clean up Verilator objects
   if (dut) {
     dut->final();
+#if VM_COVERAGE
+    if (!config.coverage_file.empty()) {
+      context->coveragep()->write(config.coverage_file.c_str());
+    }
+#endif
     delete dut;
   }
 
+  if (context) {
+    delete context;
+  }
+
   if (memory) {
     delete memory;
   }
 
-  std::cout << "[TEST] TestRunner cleanup complete\n";
+  SIM_LOG(log, LogLevel::INFO, "TEST", "TestRunner cleanup complete");
 }
 
-void TestRunner::setup_trace() {
-  // Enable tracing globally (safe to call multiple times)
-  Verilated::traceEverOn(true);
+void TestRunner::resolve_hang_cycles() {
+  // The slowest instruction (a load) makes two bus transactions of
+  // memory_delay cycles each plus ten cycles of its own; allow several
+  hang_cycles = config.hang_cycles;
+  if (hang_cycles == 0) {
+    uint64_t delay = config.memory_delay;
+    hang_cycles = std::max<uint64_t>(MIN_HANG_CYCLES, 8 * (2 * delay + 10));
+  }
+}
 
-  trace = new VerilatedVcdC();
+void TestRunner::setup_trace() {
+#ifdef RISCV_SIM_FAST
+  // The fast model is verilated without --trace
+  SIM_LOG(log, LogLevel::WARN, "TEST",
+          "Tracing not available in the fast build, ignoring");
+#else
+  trace = new TraceWriter();
   dut->trace(trace, 99); // Trace 99 levels of hierarchy
 
+  // Only the selected scopes are written (checked once per signal when the
+  // file is opened; unselected signals cost no dump time or file space)
+  for (const std::string &scope : config.trace_scopes) {
+    if (scope == "bus") {
+      for (const char *signal : TRACE_BUS_SIGNALS) {
+        trace->dumpvars(1, std::string("TOP.core_top.") + signal);
+      }
+      continue;
+    }
+    std::string path = scope;
+    int levels = 99;
+    size_t colon = path.find(':');
+    if (colon != std::string::npos) {
+      levels = std::max(1, std::atoi(path.c_str() + colon + 1));
+      path.resize(colon);
+    }
+    if (path.compare(0, 4, "TOP.") != 0) {
+      path = "TOP.core_top." + path;
+    }
+    trace->dumpvars(levels, path);
+  }
+
+#ifdef RISCV_TRACE_FST
+  std::string trace_file = "trace/" + test_name + ".fst";
+#else
   std::string trace_file = "trace/" + test_name + ".vcd";
+#endif
   trace->open(trace_file.c_str());
 
-  std::cout << "[TEST] Tracing enabled: " << trace_file << "\n";
+  SIM_LOG(log, LogLevel::INFO, "TEST", "Tracing enabled: " << trace_file);
+  if (!config.trace_scopes.empty()) {
+    std::string scopes;
+    for (const std::string &scope : config.trace_scopes) {
+      scopes += (scopes.empty() ? "" : ", ") + scope;
+    }
+    SIM_LOG(log, LogLevel::INFO, "TEST", "Traced scopes: " << scopes);
+  }
+
+  // Without a trigger the window is known now, and a trace from cycle 0
+  // includes reset
+  const TraceCapture &capture = config.trace_capture;
+  trace_triggered = !capture.pc_trigger && !capture.write_trigger;
+  trace_window_start = capture.start_cycle;
+  trace_window_stop = capture.stop_cycle;
+  trace_dumping = trace_triggered && capture.start_cycle == 0 &&
+                  capture.stop_cycle > 0;
+  if (capture.write_trigger) {
+    memory->add_write_watch(capture.trigger_addr, capture.trigger_size,
+                            [this](uint32_t, uint32_t, uint8_t) {
+                              trace_write_hit = true;
+                            });
+  }
+  if (!trace_triggered) {
+    SIM_LOG(log, LogLevel::INFO, "TEST",
+            "Trace waits for "
+                << (capture.pc_trigger
+                        ? "PC " + to_hex_string(capture.trigger_pc, 8)
+                        : std::string())
+                << (capture.pc_trigger && capture.write_trigger ? " or "
+                                                                : "")
+                << (capture.write_trigger
+                        ? "a write to " +
+                              to_hex_string(capture.trigger_addr, 8)
+                        : std::string()));
+  }
+#endif
 }
 
 void TestRunner::cleanup_trace() {
+#ifndef RISCV_SIM_FAST
   if (trace) {
     trace->close();
     delete trace;
     trace = nullptr;
   }
+#endif
+  for (unsigned i = 0; i < 2; i++) {
+    if (trace_snapshot_valid[i]) {
+      std::remove(trace_snapshot_path(i).c_str());
+      trace_snapshot_valid[i] = false;
+    }
+  }
+}
+
+std::string TestRunner::trace_snapshot_path(unsigned index) const {
+  return "trace/" + test_name + ".pretrigger" + std::to_string(index) +
+         ".ckpt";
+}
+
+void TestRunner::update_trace_capture() {
+  const TraceCapture &capture = config.trace_capture;
+  if (!trace_triggered) {
+    if (trace_write_hit ||
+        (capture.pc_trigger && get_pc() == capture.trigger_pc)) {
+      const uint64_t trigger = cycle_count;
+      trace_triggered = true;
+      trace_window_start =
+          std::max(capture.start_cycle,
+                   trigger - std::min(trigger, capture.pre_trigger_cycles));
+      trace_window_stop = capture.stop_cycle;
+      if (trigger < capture.stop_cycle &&
+          capture.post_trigger_cycles < capture.stop_cycle - trigger) {
+        trace_window_stop = trigger + capture.post_trigger_cycles;
+      }
+      SIM_LOG(log, LogLevel::INFO, "TEST",
+              "Trace triggered at cycle " << trigger << ", PC "
+                                          << to_hex_string(get_pc(), 8));
+      if (trace_window_start < cycle_count) {
+        rewind_trace();
+      }
+    } else if (capture.pre_trigger_cycles > 0) {
+      // A new snapshot once the newest is far enough back that the older
+      // one always covers the pre-trigger cycles
+      const unsigned newest = trace_snapshot_next ^ 1;
+      const uint64_t interval =
+          std::max(capture.pre_trigger_cycles, MIN_SNAPSHOT_CYCLES);
+      if (!trace_snapshot_valid[newest] ||
+          cycle_count < trace_snapshot_cycle[newest] ||
+          cycle_count - trace_snapshot_cycle[newest] >= interval) {
+        size_t memory_bytes = 0;
+        if (write_checkpoint(trace_snapshot_path(trace_snapshot_next),
+                             memory_bytes)) {
+          trace_snapshot_valid[trace_snapshot_next] = true;
+          trace_snapshot_cycle[trace_snapshot_next] = cycle_count;
+          trace_snapshot_next ^= 1;
+        } else {
+          SIM_LOG(log, LogLevel::WARN, "TEST",
+                  "Pre-trigger snapshots disabled; the trace will start "
+                  "at the trigger");
+          config.trace_capture.pre_trigger_cycles = 0;
+        }
+      }
+    }
+  }
+
+  bool dumping = trace_triggered && cycle_count >= trace_window_start &&
+                 cycle_count < trace_window_stop;
+  if (dumping != trace_dumping) {
+    SIM_LOG(log, LogLevel::INFO, "TEST",
+            "Trace " << (dumping ? "started" : "stopped") << " at cycle "
+                     << cycle_count);
+  }
+  trace_dumping = dumping;
+}
+
+void TestRunner::rewind_trace() {
+  // The newest snapshot at or before the window start, else the oldest
+  // (the window then starts at the snapshot)
+  const unsigned newest = trace_snapshot_next ^ 1;
+  const unsigned oldest = trace_snapshot_next;
+  int snapshot = -1;
+  if (trace_snapshot_valid[newest] &&
+      trace_snapshot_cycle[newest] <= trace_window_start) {
+    snapshot = static_cast<int>(newest);
+  } else if (trace_snapshot_valid[oldest]) {
+    snapshot = static_cast<int>(oldest);
+  } else if (trace_snapshot_valid[newest]) {
+    snapshot = static_cast<int>(newest);
+  }
+
+  const uint64_t trigger = cycle_count;
+  if (snapshot < 0 || !read_checkpoint(trace_snapshot_path(snapshot))) {
+    SIM_LOG(log, LogLevel::WARN, "TEST",
+            "No pre-trigger snapshot to rewind to; tracing from the "
+            "trigger");
+    trace_window_start = cycle_count;
+    return;
+  }
+
+  // Replay from the snapshot: cycles before the window run untraced, and
+  // what was retired up to the trigger is not reported again
+  trace_window_start = std::max(trace_window_start, cycle_count);
+  trace_replay_cycle = trigger;
+  if (MemoryStats *stats = memory->get_access_stats()) {
+    stats->ignore_cycles(trigger - cycle_count);
+  }
+  result_written = is_test_complete();
+  retire_instret = rtl_backdoor::get_instret(*dut);
+  retire_pc = get_pc();
+  if (cosim) {
+    SIM_LOG(log, LogLevel::WARN, "TEST",
+            "Co-simulation cannot follow a pre-trigger rewind; stopped");
+    delete cosim;
+    cosim = nullptr;
+  }
+
+  SIM_LOG(log, LogLevel::INFO, "TEST",
+          "Rewound to cycle " << cycle_count << " to trace from cycle "
+                              << trace_window_start);
+}
+
+uint64_t TestRunner::cycles_to_trace() const {
+  // Fast-forward must not run past the start of the window
+  if (!trace || !trace_triggered || trace_dumping ||
+      trace_window_start <= cycle_count) {
+    return UINT64_MAX;
+  }
+  return trace_window_start - cycle_count;
 }
 
-bool TestRunner::load_program(const std::string &hex_file) {
+bool TestRunner::load_program(const std::string &program_file) {
   if (!memory) {
-    std::cerr << "[ERROR] Memory not initialized\n";
+    SIM_LOG(log, LogLevel::ERROR, "ERROR", "Memory not initialized");
     return false;
   }
 
-  bool success = memory->load_hex_file(hex_file);
-  if (success) {
-    std::cout << "[TEST] Program loaded: " << hex_file << "\n";
-  } else {
-    std::cerr << "[ERROR] Failed to load program: " << hex_file << "\n";
+  if (!program.load_file(program_file) || !program.load_into(*memory)) {
+    const std::string &error = program.get_error();
+    SIM_LOG(log, LogLevel::ERROR, "ERROR",
+            "Failed to load program: "
+                << program_file << (error.empty() ? "" : " (" + error + ")"));
+    return false;
+  }
+
+  SIM_LOG(log, LogLevel::INFO, "TEST", "Program loaded: " << program_file);
+  if (pc_profile) {
+    pc_profile->set_symbols(program.get_symbols());
+  }
+  MemoryStats *stats = memory->get_access_stats();
+  if (stats && stats->get_region_count() == 0) {
+    // The loaded image (text, data and bss) and the magic region; the
+    // stack and anything else count as "other"
+    uint64_t start = UINT64_MAX;
+    uint64_t end = 0;
+    for (const ElfSegment &segment : program.get_segments()) {
+      start = std::min<uint64_t>(start, segment.paddr);
+      end = std::max<uint64_t>(end, static_cast<uint64_t>(segment.paddr) +
+                                        segment.mem_size);
+    }
+    if (start < end) {
+      stats->add_region("image", static_cast<uint32_t>(start),
+                        static_cast<uint32_t>(end - start));
+    }
+    stats->add_region("magic", MAGIC_RESULT_ADDR & 0xFFFF0000, 0x10000);
+  }
+  if (config.cosim) {
+    start_cosim(program_file);
+  }
+  if (program.is_elf() && program.get_entry_point() != RESET_PC) {
+    // The core always starts fetching at the reset PC
+    SIM_LOG(log, LogLevel::WARN, "TEST",
+            "Warning: ELF entry point "
+                << to_hex_string(program.get_entry_point())
+                << " differs from reset PC " << to_hex_string(RESET_PC));
   }
 
-  return success;
+  return true;
 }
 
 void TestRunner::reset() {
@@ -119,13 +556,36 @@ void TestRunner::reset() {
   // Clocking will happen when run() is called.
 
   cycle_count = 0;
-  previous_pc = 0;
-  stuck_count = 0;
+  skipped_cycles = 0;
+  resume_run = false;
+  reset_progress();
 
-  std::cout << "[TEST] Reset complete\n";
+  SIM_LOG(log, LogLevel::INFO, "TEST", "Reset complete");
 }
 
 void TestRunner::clock_cycle() {
+#ifdef RISCV_SIM_FAST
+  // Reduced clocking for the fast build. Every flop in core_top is
+  // posedge-triggered and the memory model only changes state on rising
+  // edges, so the falling-edge memory eval is dropped (eval_posedge covers
+  // it). The falling-edge DUT eval stays: Verilator detects edges by
+  // comparing clk against the value seen at the previous eval(), and it
+  // settles no sequential logic. Cycle counts match the full path.
+  bool mem_resp_out;
+  uint32_t mem_data_out;
+  memory->eval_posedge(dut->rst_n, dut->mem_read, dut->mem_write,
+                       dut->mem_addr, dut->mem_wdata, mem_data_out,
+                       mem_resp_out, dut->mem_be, dut->mem_ifetch);
+
+  dut->mem_rdata = mem_data_out;
+  dut->mem_resp = mem_resp_out;
+
+  dut->clk = 1;
+  dut->eval();
+  dut->clk = 0;
+  dut->eval();
+  context->timeInc(2);
+#else
   // Rising edge
   dut->clk = 1;
 
@@ -137,17 +597,17 @@ void TestRunner::clock_cycle() {
   uint32_t mem_data_out;
   memory->eval(dut->clk, dut->rst_n, dut->mem_read, dut->mem_write,
                dut->mem_addr, dut->mem_wdata, mem_data_out, mem_resp_out,
-               dut->mem_be);
+               dut->mem_be, dut->mem_ifetch);
 
   dut->mem_rdata = mem_data_out;
   dut->mem_resp = mem_resp_out;
 
   dut->eval(); // Now evaluate DUT with rising clock and memory responses
 
-  if (trace) {
-    trace->dump(static_cast<vluint64_t>(sim_time));
+  if (trace_dumping) {
+    trace->dump(static_cast<vluint64_t>(context->time()));
   }
-  sim_time++;
+  context->timeInc(1);
 
   // Falling edge
   dut->clk = 0;
@@ -155,74 +615,1067 @@ void TestRunner::clock_cycle() {
   // Evaluate memory before DUT on falling edge too
   memory->eval(dut->clk, dut->rst_n, dut->mem_read, dut->mem_write,
                dut->mem_addr, dut->mem_wdata, mem_data_out, mem_resp_out,
-               dut->mem_be);
+               dut->mem_be, dut->mem_ifetch);
 
   dut->mem_rdata = mem_data_out;
   dut->mem_resp = mem_resp_out;
 
   dut->eval(); // Evaluate DUT with falling clock and memory responses
 
-  if (trace) {
-    trace->dump(static_cast<vluint64_t>(sim_time));
+  if (trace_dumping) {
+    trace->dump(static_cast<vluint64_t>(context->time()));
   }
-  sim_time++;
+  context->timeInc(1);
+#endif
 
   cycle_count++;
 }
 
-TestResult TestRunner::run(uint32_t max_cycles) {
-  std::cout << "[TEST] Starting simulation (max " << max_cycles << " cycles)\n";
+uint64_t TestRunner::step(uint64_t max_cycles) {
+  if (fast_forward_enabled && !trace_dumping && max_cycles > 1 &&
+      dut->rst_n && !dut->mem_resp) {
+    // The core is provably idle while the memory model counts down a
+    // request and the control FSM waits in FETCH_1/LD_2/ST_3: mem_resp
+    // stays low, no load strobes are active, and only the cycle/time
+    // counters change. Apply those cycles in one step.
+    uint64_t idle = memory->get_idle_wait_cycles();
+    if (idle > 0 && rtl_backdoor::is_memory_wait_state(*dut)) {
+      uint64_t skip = std::min(idle, max_cycles);
+      memory->skip_wait_cycles(static_cast<uint32_t>(skip), dut->mem_read,
+                               dut->mem_write);
+      rtl_backdoor::advance_counters(*dut, skip);
+      dut->eval(); // Settle logic that reads the counters (clk stays low)
 
-  cycle_count = 0;
-  previous_pc = 0;
-  stuck_count = 0;
+      context->timeInc(2 * skip);
+      cycle_count += skip;
+      skipped_cycles += skip;
+      return skip;
+    }
+  }
 
-  while (cycle_count < max_cycles) {
-    clock_cycle();
+  clock_cycle();
+  return 1;
+}
+
+TestResult TestRunner::run(uint64_t max_cycles) {
+  RunOptions options;
+  options.max_cycles = max_cycles;
+  return run(options);
+}
+
+TestResult TestRunner::run(const RunOptions &options) {
+  TestResult result = run_loop(options);
+  if (cosim) {
+    result = finish_cosim(result);
+  }
+  if (fsm_profile) {
+    report_fsm_profile();
+  }
+  if (pc_profile) {
+    report_pc_profile();
+  }
+  if (memory->get_access_stats()) {
+    report_memory_stats();
+  }
+  if (timeline) {
+    report_timeline();
+  }
+  // Write out the buffered log before the caller prints its own results
+  log.flush();
+  return result;
+}
+
+uint64_t TestRunner::run_functional(uint64_t max_instructions) {
+  if (!rtl_backdoor::available()) {
+    SIM_LOG(log, LogLevel::WARN, "TEST",
+            "Functional fast-forward needs the RTL backdoor, not available "
+            "in this build; running everything on the RTL");
+    return 0;
+  }
+  uint32_t state = rtl_backdoor::get_control_state(*dut);
+  if (state != rtl_backdoor::STATE_FETCH_0) {
+    SIM_LOG(log, LogLevel::ERROR, "ERROR",
+            "Functional fast-forward needs the core between instructions "
+            "(control state " << state << ")");
+    return 0;
+  }
+
+  // RTL -> ISS. Memory is shared, so only the core state moves
+  IssConfig iss_config;
+  iss_config.memory_delay = config.memory_delay;
+  iss_config.log_level = config.log_level;
+  Rv32iIss iss(*memory, iss_config);
+  iss.set_pc(get_pc());
+  for (uint32_t i = 1; i < 32; i++) {
+    iss.set_reg(i, rtl_backdoor::get_register(*dut, i));
+  }
+  const std::vector<uint32_t> csrs = handover_csrs();
+  for (uint32_t addr : csrs) {
+    iss.set_csr(addr, rtl_backdoor::get_machine_csr(*dut, addr));
+  }
+  iss.set_instret(rtl_backdoor::get_instret(*dut));
+  iss.set_cycles(rtl_backdoor::get_cycle_counter(*dut));
+
+  uint64_t executed = iss.step(max_instructions);
+  if (iss.is_halted()) {
+    SIM_LOG(log, LogLevel::WARN, "TEST",
+            "Functional model halted at PC " << to_hex_string(iss.get_pc(), 8)
+                                             << "; the RTL takes over there");
+  }
+
+  // ISS -> RTL
+  for (uint32_t i = 1; i < 32; i++) {
+    rtl_backdoor::set_register(*dut, i, iss.get_reg(i));
+  }
+  for (uint32_t addr : csrs) {
+    uint32_t value = 0;
+    iss.get_csr(addr, value);
+    rtl_backdoor::set_machine_csr(*dut, addr, value);
+  }
+  rtl_backdoor::set_counters(*dut, iss.get_cycles(), iss.get_instret());
+  rtl_backdoor::set_pc(*dut, iss.get_pc());
+  dut->eval();
+
+  // The skipped instructions are progress, and the co-simulation reference
+  // has to skip them too
+  reset_progress();
+  if (cosim) {
+    cosim->drain();
+    cosim->skip(executed);
+    cosim_pending = CosimCommit();
+    cosim_instret = iss.get_instret();
+    for (uint32_t i = 0; i < 32; i++) {
+      cosim_regs[i] = rtl_backdoor::get_register(*dut, i);
+    }
+  }
+
+  SIM_LOG(log, LogLevel::INFO, "TEST",
+          "Functional fast-forward: " << executed
+                                      << " instructions on Rv32iIss, RTL "
+                                         "continues at PC "
+                                      << to_hex_string(get_pc(), 8));
+  return executed;
+}
+
+bool TestRunner::save_checkpoint(const std::string &path) {
+  size_t memory_bytes = 0;
+  if (!write_checkpoint(path, memory_bytes)) {
+    return false;
+  }
+  SIM_LOG(log, LogLevel::INFO, "TEST",
+          "Checkpoint saved at cycle " << cycle_count << " ("
+                                       << memory_bytes / 1024
+                                       << " KB of memory state): " << path);
+  return true;
+}
+
+bool TestRunner::restore_checkpoint(const std::string &path) {
+  if (!read_checkpoint(path)) {
+    return false;
+  }
+  resume_run = true;
+
+  // The reference model cannot be brought to the checkpoint
+  if (cosim) {
+    SIM_LOG(log, LogLevel::WARN, "TEST",
+            "Co-simulation state is not checkpointed; stopped");
+    delete cosim;
+    cosim = nullptr;
+  }
+
+  SIM_LOG(log, LogLevel::INFO, "TEST",
+          "Checkpoint restored at cycle " << cycle_count << ", PC "
+                                          << to_hex_string(get_pc(), 8)
+                                          << ": " << path);
+  return true;
+}
+
+bool TestRunner::write_checkpoint(const std::string &path,
+                                  size_t &memory_bytes) {
+  // Written next to the old checkpoint and renamed over it once complete
+  const std::string temp_path = path + ".tmp";
+  VerilatedSave os;
+  os.open(temp_path.c_str());
+  if (!os.isOpen()) {
+    SIM_LOG(log, LogLevel::ERROR, "ERROR",
+            "Cannot write checkpoint: " << temp_path);
+    return false;
+  }
+
+  save_value(os, CHECKPOINT_MAGIC);
+  save_value(os, CHECKPOINT_VERSION);
+  save_value(os, config.memory_size);
+  save_value(os, config.memory_delay);
+
+  save_value(os, context->time());
+  save_value(os, cycle_count);
+  save_value(os, skipped_cycles);
+  save_value(os, last_bus_count);
+  save_value(os, last_bus_cycle);
+  save_value(os, last_instret);
+  save_value(os, last_retire_cycle);
+  save_value(os, static_cast<uint8_t>(loop_valid));
+  save_value(os, loop_pc);
+  save_value(os, loop_changes);
+  save_value(os, loop_hash);
+  save_value(os, loop_power);
+  save_value(os, loop_length);
+
+  std::ostringstream memory_state;
+  memory->save_state(memory_state);
+  const std::string memory_image = memory_state.str();
+  save_value(os, static_cast<uint64_t>(memory_image.size()));
+  os.write(memory_image.data(), memory_image.size());
+
+  os << *dut;
+  os.close();
+
+  if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    SIM_LOG(log, LogLevel::ERROR, "ERROR",
+            "Cannot replace checkpoint: " << path);
+    std::remove(temp_path.c_str());
+    return false;
+  }
+  memory_bytes = memory_image.size();
+  return true;
+}
+
+bool TestRunner::read_checkpoint(const std::string &path) {
+  VerilatedRestore os;
+  os.open(path.c_str());
+  if (!os.isOpen()) {
+    SIM_LOG(log, LogLevel::ERROR, "ERROR",
+            "Cannot read checkpoint: " << path);
+    return false;
+  }
+
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  uint32_t memory_size = 0;
+  uint32_t memory_delay = 0;
+  load_value(os, magic);
+  load_value(os, version);
+  load_value(os, memory_size);
+  load_value(os, memory_delay);
+  if (magic != CHECKPOINT_MAGIC || version != CHECKPOINT_VERSION) {
+    SIM_LOG(log, LogLevel::ERROR, "ERROR",
+            "Not a TestRunner checkpoint (or an older format): " << path);
+    return false;
+  }
+  if (memory_size != config.memory_size ||
+      memory_delay != config.memory_delay) {
+    SIM_LOG(log, LogLevel::ERROR, "ERROR",
+            "Checkpoint was taken with "
+                << memory_size << " bytes of memory and " << memory_delay
+                << " cycle delay, runner has " << config.memory_size
+                << " and " << config.memory_delay);
+    return false;
+  }
+
+  uint64_t time = 0;
+  uint64_t cycles = 0;
+  uint64_t skipped = 0;
+  uint8_t valid = 0;
+  load_value(os, time);
+  load_value(os, cycles);
+  load_value(os, skipped);
+  load_value(os, last_bus_count);
+  load_value(os, last_bus_cycle);
+  load_value(os, last_instret);
+  load_value(os, last_retire_cycle);
+  load_value(os, valid);
+  load_value(os, loop_pc);
+  load_value(os, loop_changes);
+  load_value(os, loop_hash);
+  load_value(os, loop_power);
+  load_value(os, loop_length);
+  loop_valid = valid != 0;
+
+  uint64_t memory_image_size = 0;
+  load_value(os, memory_image_size);
+  std::string memory_image(memory_image_size, '\0');
+  os.read(&memory_image[0], memory_image.size());
+  std::istringstream memory_state(memory_image);
+  if (!memory->restore_state(memory_state)) {
+    SIM_LOG(log, LogLevel::ERROR, "ERROR",
+            "Bad memory state in checkpoint: " << path);
+    // The hang counters are rebuilt by the next run()
+    return false;
+  }
+
+  os >> *dut;
+  os.close();
+  context->time(time);
+  cycle_count = cycles;
+  skipped_cycles = skipped;
+  return true;
+}
+
+void TestRunner::set_retire_hook(RetireHook hook) {
+  if (hook && !rtl_backdoor::available()) {
+    SIM_LOG(log, LogLevel::WARN, "TEST",
+            "Retire hook needs the RTL backdoor, not available in this "
+            "build; ignored");
+    return;
+  }
+  retire_hook = std::move(hook);
+}
 
-    // Check for test completion
-    if (is_test_complete()) {
-      TestResult result = get_test_result();
-      std::cout << "[TEST] Test completed in " << cycle_count << " cycles\n";
+void TestRunner::set_memory_delay(uint32_t delay) {
+  config.memory_delay = delay;
+  memory->set_delay(delay);
+  resolve_hang_cycles();
+}
+
+std::vector<CloneResult> TestRunner::fork_clones(unsigned n,
+                                                 const CloneFunction &fn,
+                                                 unsigned max_parallel) {
+  std::vector<CloneResult> results(n);
+  if (max_parallel == 0) {
+    max_parallel = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  // Output still buffered here would be written again by every clone, and
+  // the checker has to be idle when its thread disappears in the clone
+  log.flush();
+  std::cout.flush();
+  std::fflush(nullptr);
+  if (cosim) {
+    cosim->drain();
+  }
+
+  struct Clone {
+    pid_t pid;
+    int fd;
+    unsigned index;
+    std::string report;
+  };
+  std::vector<Clone> running;
+  unsigned next = 0;
 
-      if (result == TestResult::PASS) {
-        std::cout << "[TEST] Result: PASS\n";
+  while (next < n || !running.empty()) {
+    while (next < n && running.size() < max_parallel) {
+      int fds[2];
+      pid_t pid = -1;
+      if (pipe(fds) == 0) {
+        pid = fork();
+        if (pid == 0) {
+          close(fds[0]);
+          for (const Clone &clone : running) {
+            close(clone.fd);
+          }
+          run_clone(fds[1], next, fn);
+        }
+        close(fds[1]);
+        if (pid < 0) {
+          close(fds[0]);
+        }
+      }
+      if (pid < 0) {
+        results[next].output = "cannot fork clone";
+        SIM_LOG(log, LogLevel::ERROR, "ERROR",
+                "Cannot fork clone " << next << " (errno " << errno << ")");
       } else {
-        std::cout << "[TEST] Result: FAIL\n";
+        running.push_back({pid, fds[0], next, std::string()});
       }
+      next++;
+    }
+    if (running.empty()) {
+      continue;
+    }
 
-      return result;
+    // Reports are read as they arrive so a clone never blocks on a full
+    // pipe; end of file means the clone has exited (or died)
+    std::vector<pollfd> polls;
+    for (const Clone &clone : running) {
+      polls.push_back({clone.fd, POLLIN, 0});
+    }
+    if (poll(polls.data(), polls.size(), -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      SIM_LOG(log, LogLevel::ERROR, "ERROR",
+              "Waiting for clones failed (errno " << errno << ")");
+      break;
     }
 
-    // Check for stuck PC (infinite loop without test completion)
-    uint32_t current_pc = get_pc();
-    if (current_pc == previous_pc) {
-      stuck_count++;
-      if (stuck_count > 100) {
-        std::cout << "[TEST] PC stuck at " << to_hex_string(current_pc, 8)
-                  << " for " << stuck_count
-                  << " cycles without test completion\n";
-        std::cout << "[TEST] Result: TIMEOUT (stuck PC)\n";
-        return TestResult::TIMEOUT;
+    for (size_t i = polls.size(); i-- > 0;) {
+      if (polls[i].revents == 0) {
+        continue;
       }
+      Clone &clone = running[i];
+      char chunk[CLONE_READ_CHUNK];
+      ssize_t got = read(clone.fd, chunk, sizeof(chunk));
+      if (got > 0) {
+        clone.report.append(chunk, static_cast<size_t>(got));
+        continue;
+      }
+      if (got < 0 && errno == EINTR) {
+        continue;
+      }
+
+      close(clone.fd);
+      int status = 0;
+      while (waitpid(clone.pid, &status, 0) < 0 && errno == EINTR) {
+      }
+      CloneResult &result = results[clone.index];
+      const std::string &report = clone.report;
+      uint64_t length = report.size() >= CLONE_HEADER_SIZE
+                            ? extract_value<uint64_t>(report, 12)
+                            : 0;
+      if (report.size() >= CLONE_HEADER_SIZE &&
+          report.size() - CLONE_HEADER_SIZE == length) {
+        result.result =
+            static_cast<TestResult>(extract_value<int32_t>(report, 0));
+        result.cycles = extract_value<uint64_t>(report, 4);
+        result.output = report.substr(CLONE_HEADER_SIZE);
+      } else {
+        std::ostringstream reason;
+        if (WIFSIGNALED(status)) {
+          reason << "clone killed by signal " << WTERMSIG(status);
+        } else {
+          reason << "clone exited with status " << WEXITSTATUS(status)
+                 << " without a result";
+        }
+        result.output = reason.str();
+        SIM_LOG(log, LogLevel::ERROR, "ERROR",
+                "Clone " << clone.index << ": " << result.output);
+      }
+      running.erase(running.begin() + i);
+    }
+  }
+
+  SIM_LOG(log, LogLevel::INFO, "TEST",
+          "Ran " << n << " clones from cycle " << cycle_count);
+  return results;
+}
+
+void TestRunner::run_clone(int fd, unsigned index, const CloneFunction &fn) {
+  // Only this thread was copied: the checker and commit log threads are
+  // gone, so both are abandoned, and the parent's trace file and commit log
+  // must not be written. The clone exits without running destructors (no
+  // coverage file either)
+  cosim = nullptr;
+  commit_log = nullptr;
+  fsm_profile = nullptr;
+  pc_profile = nullptr;
+  timeline = nullptr;
+  trace = nullptr;
+  trace_dumping = false;
+  test_name += "_clone" + std::to_string(index);
+
+  std::string output;
+  TestResult result = fn(*this, index, output);
+  log.flush();
+  std::cout.flush();
+  std::fflush(nullptr);
+
+  std::string report;
+  append_value(report, static_cast<int32_t>(result));
+  append_value(report, cycle_count);
+  append_value(report, static_cast<uint64_t>(output.size()));
+  report += output;
+  bool sent = write_all(fd, report.data(), report.size());
+  close(fd);
+  _exit(sent ? 0 : 1);
+}
+
+TestResult TestRunner::run_loop(const RunOptions &options) {
+  const uint64_t max_cycles = options.max_cycles;
+  if (max_cycles == UINT64_MAX) {
+    SIM_LOG(log, LogLevel::INFO, "TEST",
+            "Starting simulation (no cycle limit)");
+  } else {
+    SIM_LOG(log, LogLevel::INFO, "TEST",
+            "Starting simulation (max " << max_cycles << " cycles)");
+  }
+
+  if (resume_run) {
+    // Carry on from a restored checkpoint with its counters
+    resume_run = false;
+    SIM_LOG(log, LogLevel::INFO, "TEST",
+            "Resuming from cycle " << cycle_count);
+  } else {
+    cycle_count = 0;
+    trace_replay_cycle = 0;
+    reset_progress();
+    if (fsm_profile) {
+      fsm_profile->reset();
+    }
+    if (pc_profile) {
+      pc_profile->reset();
+    }
+    if (MemoryStats *stats = memory->get_access_stats()) {
+      stats->reset();
+    }
+    if (timeline) {
+      timeline->reset();
+    }
+  }
+
+  retire_instret = rtl_backdoor::get_instret(*dut);
+  retire_pc = get_pc();
+
+  // A result already in memory (e.g. from a previous run) still ends the
+  // run after the first cycle
+  result_written = is_test_complete();
+
+  if (trace) {
+    update_trace_capture();
+  }
+
+  // The wall clock is only read every CLOCK_CHECK_STEPS steps
+  using Clock = std::chrono::steady_clock;
+  const bool checkpoints = !options.checkpoint_file.empty();
+  const uint64_t checkpoint_cycles =
+      checkpoints ? options.checkpoint_cycles : 0;
+  const double checkpoint_seconds =
+      checkpoints ? options.checkpoint_seconds : 0;
+  const bool timed = options.max_seconds > 0 ||
+                     options.heartbeat_seconds > 0 || checkpoint_seconds > 0;
+  const Clock::time_point start = Clock::now();
+  uint32_t steps_to_clock_check = CLOCK_CHECK_STEPS;
+  double next_heartbeat = options.heartbeat_seconds;
+  uint64_t heartbeat_cycles = cycle_count;
+  double heartbeat_elapsed = 0;
+  double next_checkpoint_time = checkpoint_seconds;
+  // Checkpoints fall on multiples of checkpoint_cycles, also after a resume
+  uint64_t next_checkpoint =
+      checkpoint_cycles > 0
+          ? (cycle_count / checkpoint_cycles + 1) * checkpoint_cycles
+          : UINT64_MAX;
+
+  while (cycle_count < max_cycles) {
+    // Never step past the cycle where the hang check would fire, the next
+    // checkpoint or the start of the trace window
+    const uint64_t limit =
+        std::min({std::min(max_cycles, next_checkpoint) - cycle_count,
+                  cycles_to_hang(), cycles_to_trace()});
+    const uint64_t start_cycle = cycle_count;
+    const uint32_t start_pc = get_pc();
+    const bool timeline_step = timeline && rtl_backdoor::available();
+    const TimelineSample timeline_state =
+        timeline_step ? sample_timeline() : TimelineSample();
+    if (fsm_profile) {
+      profile_step(limit);
     } else {
-      stuck_count = 0;
+      step(limit);
+    }
+    if (pc_profile) {
+      sample_pc(start_pc, start_cycle);
+    }
+    // Like the FSM profile, the state before the step held throughout it
+    if (timeline_step && cycle_count > trace_replay_cycle) {
+      timeline->add_cycles(timeline_state,
+                           std::max(start_cycle, trace_replay_cycle),
+                           cycle_count);
+    }
+
+    // instret moves on the edge that loads the next PC
+    if (retire_hook || commit_log || pc_profile) {
+      uint64_t instret = rtl_backdoor::get_instret(*dut);
+      if (instret != retire_instret) {
+        uint32_t next_pc = get_pc();
+        // Retires replayed after a pre-trigger rewind were reported already
+        if (cycle_count > trace_replay_cycle) {
+          if (commit_log) {
+            log_commit(retire_pc);
+          }
+          if (retire_hook) {
+            retire_hook(retire_pc, next_pc);
+          }
+          if (pc_profile) {
+            pc_profile->retire(retire_pc, rtl_backdoor::get_instruction(*dut),
+                               next_pc);
+          }
+        }
+        retire_instret = instret;
+        retire_pc = next_pc;
+      }
     }
-    previous_pc = current_pc;
 
-    // Periodic progress updates (every 1000 cycles)
-    if (cycle_count % 1000 == 0 && cycle_count > 0) {
-      // std::cout << "[TEST] Cycle " << cycle_count
-      //           << " - PC: " << to_hex_string(get_pc(), 8) << "\n";
+    // Hand each retired instruction to the co-simulation checker
+    if (cosim) {
+      uint64_t instret = rtl_backdoor::get_instret(*dut);
+      if (instret != cosim_instret) {
+        commit_cosim(instret);
+        if (cosim->has_mismatch()) {
+          SIM_LOG(log, LogLevel::INFO, "TEST",
+                  "Co-simulation mismatch, stopped after "
+                      << cycle_count << " cycles");
+          return TestResult::FAIL;
+        }
+      }
+    }
+
+    // May rewind to a pre-trigger snapshot
+    if (trace) {
+      update_trace_capture();
+    }
+
+    // Check for test completion once the magic address has been written
+    if (result_written) {
+      result_written = false;
+      if (is_test_complete()) {
+        TestResult result = get_test_result();
+        SIM_LOG(log, LogLevel::INFO, "TEST",
+                "Test completed in " << cycle_count << " cycles");
+
+        if (result == TestResult::PASS) {
+          SIM_LOG(log, LogLevel::INFO, "TEST", "Result: PASS");
+        } else {
+          SIM_LOG(log, LogLevel::INFO, "TEST", "Result: FAIL");
+        }
+
+        return result;
+      }
+    }
+
+    // Check for a hang (no progress, or a loop without test completion)
+    if (config.hang_detection && check_progress()) {
+      return TestResult::TIMEOUT;
+    }
+
+    // A failed save is logged; the run itself carries on
+    if (cycle_count >= next_checkpoint) {
+      save_checkpoint(options.checkpoint_file);
+      next_checkpoint += checkpoint_cycles;
+    }
+
+    if (!timed || --steps_to_clock_check > 0) {
+      continue;
+    }
+    steps_to_clock_check = CLOCK_CHECK_STEPS;
+    double elapsed =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    if (options.max_seconds > 0 && elapsed >= options.max_seconds) {
+      SIM_LOG(log, LogLevel::INFO, "TEST",
+              "Wall-clock budget of " << options.max_seconds
+                                      << " s used up after " << cycle_count
+                                      << " cycles");
+      SIM_LOG(log, LogLevel::INFO, "TEST",
+              "Final PC: " << to_hex_string(get_pc(), 8));
+      SIM_LOG(log, LogLevel::INFO, "TEST", "Result: TIMEOUT (wall clock)");
+      return TestResult::TIMEOUT;
+    }
+
+    if (options.heartbeat_seconds > 0 && elapsed >= next_heartbeat) {
+      RunHeartbeat beat =
+          make_heartbeat(elapsed, heartbeat_cycles, heartbeat_elapsed);
+      if (options.heartbeat) {
+        options.heartbeat(beat);
+      } else {
+        std::ostringstream speed;
+        speed << std::fixed << std::setprecision(1) << beat.sim_khz;
+        SIM_LOG(log, LogLevel::INFO, "TEST",
+                "Heartbeat: " << beat.cycles << " cycles, instret "
+                              << (beat.instret_valid
+                                      ? std::to_string(beat.instret)
+                                      : std::string("n/a"))
+                              << ", " << speed.str() << " kHz, PC "
+                              << to_hex_string(beat.pc, 8));
+        // Long runs are watched through the log; do not sit on the line
+        log.flush();
+      }
+      heartbeat_cycles = cycle_count;
+      heartbeat_elapsed = elapsed;
+      // Skip beats missed while a callback or a step ran long
+      while (next_heartbeat <= elapsed) {
+        next_heartbeat += options.heartbeat_seconds;
+      }
+    }
+
+    if (checkpoint_seconds > 0 && elapsed >= next_checkpoint_time) {
+      save_checkpoint(options.checkpoint_file);
+      while (next_checkpoint_time <= elapsed) {
+        next_checkpoint_time += checkpoint_seconds;
+      }
     }
   }
 
-  std::cout << "[TEST] Timeout after " << max_cycles << " cycles\n";
-  std::cout << "[TEST] Final PC: " << to_hex_string(get_pc(), 8) << "\n";
-  std::cout << "[TEST] Result: TIMEOUT\n";
+  SIM_LOG(log, LogLevel::INFO, "TEST",
+          "Timeout after " << max_cycles << " cycles");
+  SIM_LOG(log, LogLevel::INFO, "TEST",
+          "Final PC: " << to_hex_string(get_pc(), 8));
+  SIM_LOG(log, LogLevel::INFO, "TEST", "Result: TIMEOUT");
   return TestResult::TIMEOUT;
 }
 
+RunHeartbeat TestRunner::make_heartbeat(double elapsed_seconds,
+                                        uint64_t last_cycles,
+                                        double last_elapsed_seconds) const {
+  RunHeartbeat beat;
+  beat.cycles = cycle_count;
+  beat.instret_valid = rtl_backdoor::available();
+  beat.instret = rtl_backdoor::get_instret(*dut);
+  beat.pc = get_pc();
+  beat.elapsed_seconds = elapsed_seconds;
+  double interval = elapsed_seconds - last_elapsed_seconds;
+  // A pre-trigger rewind moves the cycle count back
+  beat.sim_khz = interval > 0 && cycle_count >= last_cycles
+                     ? static_cast<double>(cycle_count - last_cycles) /
+                           interval / 1000.0
+                     : 0.0;
+  return beat;
+}
+
+void TestRunner::reset_progress() {
+  last_bus_count = memory->get_read_count() + memory->get_write_count();
+  last_bus_cycle = cycle_count;
+  last_instret = rtl_backdoor::get_instret(*dut);
+  last_retire_cycle = cycle_count;
+
+  loop_valid = false;
+  loop_power = 1;
+  loop_length = 0;
+}
+
+uint64_t TestRunner::cycles_to_hang() const {
+  if (!config.hang_detection) {
+    return UINT64_MAX;
+  }
+  uint64_t last_progress = std::min(last_bus_cycle, last_retire_cycle);
+  return last_progress + hang_cycles + 1 - cycle_count;
+}
+
+bool TestRunner::check_progress() {
+  // Long memory latencies hold the PC for many cycles, so progress is
+  // judged by completed bus transactions and retired instructions. Netlists
+  // have no instret to read; bus traffic stands in for it there.
+  uint64_t bus_count = memory->get_read_count() + memory->get_write_count();
+  if (bus_count != last_bus_count) {
+    last_bus_count = bus_count;
+    last_bus_cycle = cycle_count;
+  }
+  uint64_t instret = rtl_backdoor::available()
+                         ? rtl_backdoor::get_instret(*dut)
+                         : bus_count;
+  if (instret != last_instret) {
+    last_instret = instret;
+    last_retire_cycle = cycle_count;
+  }
+
+  uint64_t last_progress = std::min(last_bus_cycle, last_retire_cycle);
+  if (cycle_count - last_progress > hang_cycles) {
+    SIM_LOG(log, LogLevel::INFO, "TEST",
+            "No progress for " << (cycle_count - last_progress) << " cycles ("
+                               << (last_bus_cycle <= last_retire_cycle
+                                       ? "no bus transaction"
+                                       : "no instruction retired")
+                               << ") at PC " << to_hex_string(get_pc(), 8));
+    SIM_LOG(log, LogLevel::INFO, "TEST", "Result: TIMEOUT (hang)");
+    return true;
+  }
+
+  // A core that keeps fetching and retiring can still be stuck in a loop.
+  // Every instruction passes through FETCH_0 with the previous one
+  // retired; if the PC, registers and CSRs there match an earlier boundary
+  // and no write has changed memory since, the core will repeat the same
+  // instructions forever. Registers are only hashed when the PC and memory
+  // match or a new snapshot is taken.
+  if (!rtl_backdoor::available() ||
+      rtl_backdoor::get_control_state(*dut) != rtl_backdoor::STATE_FETCH_0) {
+    return false;
+  }
+
+  uint32_t pc = get_pc();
+  uint64_t changes = memory->get_change_count();
+  loop_length++;
+  if (loop_valid && pc == loop_pc && changes == loop_changes &&
+      rtl_backdoor::hash_arch_state(*dut) == loop_hash) {
+    SIM_LOG(log, LogLevel::INFO, "TEST",
+            "Architectural state at PC "
+                << to_hex_string(pc, 8) << " repeats every " << loop_length
+                << " instructions without test completion");
+    SIM_LOG(log, LogLevel::INFO, "TEST", "Result: TIMEOUT (loop)");
+    return true;
+  }
+
+  if (!loop_valid || loop_length == loop_power) {
+    loop_valid = true;
+    loop_pc = pc;
+    loop_changes = changes;
+    loop_hash = rtl_backdoor::hash_arch_state(*dut);
+    loop_power = std::min(loop_power * 2, MAX_LOOP_POWER);
+    loop_length = 0;
+  }
+  return false;
+}
+
+void TestRunner::start_cosim(const std::string &program_file) {
+  if (!rtl_backdoor::available()) {
+    SIM_LOG(log, LogLevel::WARN, "TEST",
+            "Co-simulation needs the RTL backdoor, not available in this "
+            "build; disabled");
+    return;
+  }
+
+  delete cosim;
+  cosim = new CosimChecker(config.memory_size);
+  if (!cosim->load_program(program_file)) {
+    SIM_LOG(log, LogLevel::ERROR, "ERROR",
+            "Co-simulation could not load " << program_file << "; disabled");
+    delete cosim;
+    cosim = nullptr;
+    return;
+  }
+
+  // Both models start from reset; later commits are diffs against this
+  cosim_pending = CosimCommit();
+  cosim_instret = rtl_backdoor::get_instret(*dut);
+  for (uint32_t i = 0; i < 32; i++) {
+    cosim_regs[i] = rtl_backdoor::get_register(*dut, i);
+  }
+  cosim->start();
+  SIM_LOG(log, LogLevel::INFO, "TEST",
+          "Co-simulation against Rv32iIss enabled");
+}
+
+void TestRunner::commit_cosim(uint64_t instret) {
+  // instret_inc (load_pc) fires as the PC takes its next value, after the
+  // instruction's register write and store
+  CosimCommit &commit = cosim_pending;
+  commit.index = cosim->get_pushed();
+  commit.next_pc = get_pc();
+  for (uint32_t i = 1; i < 32; i++) {
+    uint32_t value = rtl_backdoor::get_register(*dut, i);
+    if (value != cosim_regs[i]) {
+      if (commit.reg_changes == 0) {
+        commit.rd = static_cast<uint8_t>(i);
+        commit.rd_value = value;
+      }
+      commit.reg_changes++;
+      cosim_regs[i] = value;
+    }
+  }
+  commit.mtvec = rtl_backdoor::get_machine_csr(*dut, 0x305);
+  commit.mepc = rtl_backdoor::get_machine_csr(*dut, 0x341);
+  commit.mcause = rtl_backdoor::get_machine_csr(*dut, 0x342);
+  commit.mtval = rtl_backdoor::get_machine_csr(*dut, 0x343);
+
+  cosim->push(commit);
+  cosim_pending = CosimCommit();
+  cosim_instret = instret;
+}
+
+TestResult TestRunner::finish_cosim(TestResult result) {
+  // The checker runs behind the RTL; let it catch up before trusting a PASS
+  cosim->drain();
+  if (!cosim->has_mismatch()) {
+    SIM_LOG(log, LogLevel::INFO, "TEST",
+            "Co-simulation: " << cosim->get_checked()
+                              << " instructions match the reference");
+    return result;
+  }
+
+  for (const std::string &line : cosim->get_report()) {
+    SIM_LOG(log, LogLevel::WARN, "COSIM", line);
+  }
+  SIM_LOG(log, LogLevel::INFO, "TEST", "Result: FAIL (co-simulation mismatch)");
+  return TestResult::FAIL;
+}
+
+void TestRunner::open_commit_log() {
+  if (!rtl_backdoor::available()) {
+    SIM_LOG(log, LogLevel::WARN, "TEST",
+            "Commit log needs the RTL backdoor, not available in this "
+            "build; disabled");
+    return;
+  }
+
+  commit_log = new CommitLogWriter();
+  if (!commit_log->open(config.commit_log_file)) {
+    SIM_LOG(log, LogLevel::ERROR, "ERROR",
+            "Cannot create commit log " << config.commit_log_file);
+    delete commit_log;
+    commit_log = nullptr;
+    return;
+  }
+  SIM_LOG(log, LogLevel::INFO, "TEST",
+          "Commit log: " << config.commit_log_file);
+}
+
+void TestRunner::log_commit(uint32_t pc) {
+  // The IR still holds the instruction, and after a load or store the MAR
+  // its byte address, until the next fetch
+  CommitRecord record = CommitRecord();
+  record.cycle = rtl_backdoor::get_cycle_counter(*dut);
+  record.pc = pc;
+  record.insn = rtl_backdoor::get_instruction(*dut);
+
+  uint32_t rd = commit_dest_reg(record.insn);
+  if (rd != 0) {
+    record.flags |= COMMIT_RD_WRITE;
+    record.rd = static_cast<uint8_t>(rd);
+    record.rd_value = rtl_backdoor::get_register(*dut, rd);
+  }
+
+  uint32_t size = commit_access_size(record.insn);
+  if (size != 0) {
+    uint32_t addr = rtl_backdoor::get_memory_address(*dut);
+    uint32_t mask = (size == 4) ? 0xFFFFFFFFu : (1u << (8 * size)) - 1;
+    record.mem_addr = addr;
+    record.mem_size = static_cast<uint8_t>(size);
+    if ((record.insn & 0x7F) == 0x03) {
+      record.flags |= COMMIT_LOAD;
+      record.mem_data =
+          (memory->backdoor_read_word(addr & ~3u) >> (8 * (addr & 3))) & mask;
+    } else {
+      // Stores write no register, so rs2 still holds the data
+      record.flags |= COMMIT_STORE;
+      record.mem_data =
+          rtl_backdoor::get_register(*dut, (record.insn >> 20) & 31) & mask;
+    }
+  }
+  commit_log->append(record);
+}
+
+void TestRunner::close_commit_log() {
+  if (!commit_log) {
+    return;
+  }
+  uint64_t records = commit_log->get_records();
+  if (commit_log->close()) {
+    SIM_LOG(log, LogLevel::INFO, "TEST",
+            "Commit log: " << records << " instructions written to "
+                           << config.commit_log_file);
+  } else {
+    SIM_LOG(log, LogLevel::ERROR, "ERROR",
+            "Writing commit log " << config.commit_log_file << " failed");
+  }
+  delete commit_log;
+  commit_log = nullptr;
+}
+
+uint64_t TestRunner::profile_step(uint64_t max_cycles) {
+  // The state before the edge is the one the cycle is spent in; a
+  // fast-forwarded stall stays in its wait state throughout. Cycles
+  // replayed after a pre-trigger rewind were profiled already
+  const uint32_t state = rtl_backdoor::get_control_state(*dut);
+  const uint64_t start = cycle_count;
+  if (start >= trace_replay_cycle && fsm_profile->instruction_done(state)) {
+    // The IR holds the finished instruction until the next FETCH_3
+    fsm_profile->retire(rtl_backdoor::get_instruction(*dut));
+  }
+  uint64_t advanced = step(max_cycles);
+  if (cycle_count > trace_replay_cycle) {
+    fsm_profile->add(state,
+                     cycle_count - std::max(start, trace_replay_cycle));
+  }
+  return advanced;
+}
+
+void TestRunner::report_fsm_profile() {
+  // One line per row, so the table survives log prefixes
+  std::istringstream table(fsm_profile->format_table());
+  std::string line;
+  SIM_LOG(log, LogLevel::INFO, "TEST", "FSM occupancy profile:");
+  while (std::getline(table, line)) {
+    SIM_LOG(log, LogLevel::INFO, "TEST", "  " << line);
+  }
+
+  if (config.fsm_profile_file.empty()) {
+    return;
+  }
+  std::ofstream out(config.fsm_profile_file);
+  out << fsm_profile->format_json();
+  if (!out) {
+    SIM_LOG(log, LogLevel::ERROR, "ERROR",
+            "Cannot write FSM profile " << config.fsm_profile_file);
+    return;
+  }
+  SIM_LOG(log, LogLevel::INFO, "TEST",
+          "FSM profile written to " << config.fsm_profile_file);
+}
+
+void TestRunner::sample_pc(uint32_t pc, uint64_t start) {
+  // The PC only changes when an instruction completes, so it held pc for
+  // every cycle of the step. Cycles replayed after a pre-trigger rewind
+  // were sampled already
+  const uint64_t from = std::max(start, trace_replay_cycle);
+  if (cycle_count <= from) {
+    return;
+  }
+  pc_profile->sample(pc, from, cycle_count);
+
+  // The netlists have no instret; there an instruction retires when the PC
+  // changes (a jump to itself goes unseen)
+  const uint32_t next_pc = get_pc();
+  if (!rtl_backdoor::available() && next_pc != pc) {
+    pc_profile->retire(pc, memory->backdoor_read_word(pc), next_pc);
+  }
+}
+
+void TestRunner::report_pc_profile() {
+  std::istringstream table(pc_profile->format_table());
+  std::string line;
+  SIM_LOG(log, LogLevel::INFO, "TEST", "PC profile:");
+  while (std::getline(table, line)) {
+    SIM_LOG(log, LogLevel::INFO, "TEST", "  " << line);
+  }
+
+  if (config.pc_profile_file.empty()) {
+    return;
+  }
+  std::ofstream out(config.pc_profile_file);
+  out << pc_profile->format_folded();
+  if (!out) {
+    SIM_LOG(log, LogLevel::ERROR, "ERROR",
+            "Cannot write PC profile " << config.pc_profile_file);
+    return;
+  }
+  SIM_LOG(log, LogLevel::INFO, "TEST",
+          "PC profile (folded stacks) written to " << config.pc_profile_file);
+}
+
+void TestRunner::report_memory_stats() {
+  const MemoryStats *stats = memory->get_access_stats();
+  std::istringstream table(stats->format_table());
+  std::string line;
+  SIM_LOG(log, LogLevel::INFO, "TEST", "Memory access statistics:");
+  while (std::getline(table, line)) {
+    SIM_LOG(log, LogLevel::INFO, "TEST", "  " << line);
+  }
+
+  if (config.memory_stats_file.empty()) {
+    return;
+  }
+  std::ofstream out(config.memory_stats_file);
+  out << stats->format_json();
+  if (!out) {
+    SIM_LOG(log, LogLevel::ERROR, "ERROR",
+            "Cannot write memory statistics " << config.memory_stats_file);
+    return;
+  }
+  SIM_LOG(log, LogLevel::INFO, "TEST",
+          "Memory statistics written to " << config.memory_stats_file);
+}
+
+TimelineSample TestRunner::sample_timeline() {
+  TimelineSample sample;
+  sample.state = rtl_backdoor::get_control_state(*dut);
+  sample.pc = get_pc();
+  sample.insn = rtl_backdoor::get_instruction(*dut);
+  sample.mcause = rtl_backdoor::get_machine_csr(*dut, 0x342);
+  return sample;
+}
+
+void TestRunner::report_timeline() {
+  std::ofstream out(config.timeline_file);
+  out << timeline->format_json();
+  if (!out) {
+    SIM_LOG(log, LogLevel::ERROR, "ERROR",
+            "Cannot write timeline " << config.timeline_file);
+    return;
+  }
+  SIM_LOG(log, LogLevel::INFO, "TEST",
+          "Timeline (" << timeline->get_instructions() << " instructions, "
+                       << timeline->get_transactions()
+                       << " bus transactions) written to "
+                       << config.timeline_file);
+}
+
 bool TestRunner::is_test_complete() const {
   // Check if magic address has been written
   uint32_t magic_value = memory->backdoor_read_word(MAGIC_RESULT_ADDR);
@@ -0,0 +1,192 @@
+/*
+ * Commit Log Test Cases
+ *
+ * These tests check that records written through the double-buffered
+ * writer read back unchanged, the Spike text format, and that the commit
+ * log of an RTL run matches the instructions the ISS executes for the same
+ * program.
+ */
+
+#include "../include/commit_log.h"
+#include "../include/rtl_backdoor.h"
+#include "../include/rv32i_iss.h"
+#include "../include/test_runner.h"
+#include "../include/test_utils.h"
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+std::string temp_log(const std::string &name) {
+  return "/tmp/riscv_commit_log_" + name + ".commits.gz";
+}
+
+CommitRecord make_record(uint64_t i) {
+  CommitRecord record = CommitRecord();
+  record.cycle = 11 * i;
+  record.pc = 0x1000 + 4 * static_cast<uint32_t>(i);
+  record.insn = static_cast<uint32_t>(i * 0x9E3779B9u);
+  record.rd = static_cast<uint8_t>(i & 31);
+  record.rd_value = static_cast<uint32_t>(i);
+  record.flags = static_cast<uint8_t>(i % 8);
+  record.mem_addr = static_cast<uint32_t>(i << 2);
+  record.mem_data = ~static_cast<uint32_t>(i);
+  record.mem_size = 4;
+  return record;
+}
+
+int32_t sign_extend(uint32_t value, uint32_t bits) {
+  return static_cast<int32_t>(value << (32 - bits)) >> (32 - bits);
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(CommitLogTests)
+
+BOOST_AUTO_TEST_CASE(test_commit_log_round_trip) {
+  const std::string path = temp_log("round_trip");
+  // Two full buffers and a partial one
+  const uint64_t count = 2 * CommitLogWriter::BUFFER_RECORDS + 1234;
+  {
+    CommitLogWriter writer;
+    BOOST_REQUIRE(writer.open(path));
+    for (uint64_t i = 0; i < count; i++) {
+      writer.append(make_record(i));
+    }
+    BOOST_CHECK_EQUAL(writer.get_records(), count);
+    BOOST_CHECK(writer.close());
+    BOOST_CHECK(!writer.is_open());
+  }
+
+  CommitLogReader reader;
+  BOOST_REQUIRE(reader.open(path));
+  CommitRecord record;
+  uint64_t read = 0;
+  bool same = true;
+  while (reader.next(record)) {
+    CommitRecord expected = make_record(read++);
+    same = same && record.cycle == expected.cycle &&
+           record.pc == expected.pc && record.insn == expected.insn &&
+           record.rd == expected.rd && record.rd_value == expected.rd_value &&
+           record.flags == expected.flags &&
+           record.mem_addr == expected.mem_addr &&
+           record.mem_data == expected.mem_data;
+  }
+  BOOST_CHECK(same);
+  BOOST_CHECK_EQUAL(read, count);
+  BOOST_CHECK(reader.get_error().empty());
+  std::remove(path.c_str());
+
+  // Anything else is rejected
+  BOOST_CHECK(!reader.open(get_test_program_path("add")));
+  BOOST_CHECK(!reader.get_error().empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_commit_log_spike_format) {
+  CommitRecord record = CommitRecord();
+  record.pc = 0x1000;
+  record.insn = 0x00001137; // lui x2, 0x1
+  record.rd = 2;
+  record.rd_value = 0x1000;
+  record.flags = COMMIT_RD_WRITE;
+  BOOST_CHECK_EQUAL(format_spike(record),
+                    "core   0: 3 0x00001000 (0x00001137) x2  0x00001000");
+
+  record.insn = 0x0040C703; // lbu x14, 4(x1)
+  record.rd = 14;
+  record.rd_value = 0xAB;
+  record.flags = COMMIT_RD_WRITE | COMMIT_LOAD;
+  record.mem_addr = 0x10000005;
+  BOOST_CHECK_EQUAL(
+      format_spike(record),
+      "core   0: 3 0x00001000 (0x0040c703) x14 0x000000ab mem 0x10000005");
+
+  record.insn = 0x00E11123; // sh x14, 2(x2)
+  record.flags = COMMIT_STORE;
+  record.mem_addr = 0x10000002;
+  record.mem_data = 0xBEEF;
+  record.mem_size = 2;
+  BOOST_CHECK_EQUAL(
+      format_spike(record),
+      "core   0: 3 0x00001000 (0x00e11123) mem 0x10000002 0xbeef");
+
+  BOOST_CHECK_EQUAL(commit_dest_reg(0x00001137), 2u);
+  BOOST_CHECK_EQUAL(commit_dest_reg(0x00E11123), 0u); // Store
+  BOOST_CHECK_EQUAL(commit_dest_reg(0x00000073), 0u); // ecall
+  BOOST_CHECK_EQUAL(commit_dest_reg(0xC0002573), 10u); // rdcycle a0
+  BOOST_CHECK_EQUAL(commit_access_size(0x0040C703), 1u);
+  BOOST_CHECK_EQUAL(commit_access_size(0x00E11123), 2u);
+  BOOST_CHECK_EQUAL(commit_access_size(0x00001137), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_commit_log_matches_iss) {
+  if (!rtl_backdoor::available()) {
+    BOOST_TEST_MESSAGE("Commit log needs the RTL backdoor; skipped");
+    return;
+  }
+
+  const std::vector<std::string> programs = {"memcpy", "bubble_sort",
+                                             "byte_load_simple",
+                                             "ecall_basic"};
+  for (const std::string &program : programs) {
+    const std::string path = get_test_program_path(program);
+    const std::string log_path = temp_log(program);
+    uint64_t instret = 0;
+    {
+      TestRunnerConfig config;
+      config.memory_debug = false;
+      config.commit_log_file = log_path;
+      TestRunner runner(program + "_commit_log", config);
+      BOOST_REQUIRE(runner.load_program(path));
+      BOOST_REQUIRE(runner.get_commit_log() != nullptr);
+      BOOST_REQUIRE_EQUAL(runner.run(1000000), TestResult::PASS);
+      instret = rtl_backdoor::get_instret(runner.get_dut());
+    }
+
+    MemoryModel memory(TestRunnerConfig().memory_size, 4, false);
+    Rv32iIss iss(memory, IssConfig());
+    BOOST_REQUIRE(iss.load_program(path));
+
+    CommitLogReader reader;
+    BOOST_REQUIRE(reader.open(log_path));
+    CommitRecord record;
+    uint64_t count = 0;
+    bool same = true;
+    uint64_t last_cycle = 0;
+    while (same && reader.next(record)) {
+      uint32_t pc = iss.get_pc();
+      uint32_t insn = memory.backdoor_read_word(pc);
+      uint32_t rs1_value = iss.get_reg((insn >> 15) & 31);
+      uint32_t rs2_value = iss.get_reg((insn >> 20) & 31);
+      iss.step(1);
+
+      same = record.pc == pc && record.insn == insn &&
+             record.cycle > last_cycle;
+      uint32_t rd = commit_dest_reg(insn);
+      same = same && record.rd == rd &&
+             (rd == 0 || record.rd_value == iss.get_reg(rd));
+      if ((insn & 0x7F) == 0x03) {
+        uint32_t addr = rs1_value + sign_extend(insn >> 20, 12);
+        same = same && (record.flags & COMMIT_LOAD) && record.mem_addr == addr;
+      } else if ((insn & 0x7F) == 0x23) {
+        uint32_t imm = ((insn >> 25) << 5) | ((insn >> 7) & 31);
+        uint32_t addr = rs1_value + sign_extend(imm, 12);
+        uint32_t size = commit_access_size(insn);
+        uint32_t mask = (size == 4) ? 0xFFFFFFFFu : (1u << (8 * size)) - 1;
+        same = same && (record.flags & COMMIT_STORE) &&
+               record.mem_addr == addr &&
+               record.mem_data == (rs2_value & mask);
+      }
+      BOOST_CHECK_MESSAGE(same, program << " instruction " << count << ": "
+                                        << format_spike(record));
+      last_cycle = record.cycle;
+      count++;
+    }
+    // The store that writes the result ends the run before it retires
+    BOOST_CHECK_EQUAL(count, instret);
+    BOOST_CHECK(reader.get_error().empty());
+    std::remove(log_path.c_str());
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
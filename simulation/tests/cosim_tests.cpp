@@ -0,0 +1,154 @@
+/*
+ * Co-Simulation Test Cases
+ *
+ * These tests check the lock-free queue between the RTL and checker
+ * threads, that test/ programs run clean in lockstep with the reference
+ * model, that a divergence is caught at the instruction that caused it,
+ * and that a program handed over from the ISS to the RTL part-way through
+ * finishes in the same state as one run on the RTL throughout.
+ */
+
+#include "../include/cosim.h"
+#include "../include/rtl_backdoor.h"
+#include "../include/spsc_queue.h"
+#include "../include/test_runner.h"
+#include "../include/test_utils.h"
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+TestRunnerConfig cosim_config() {
+  TestRunnerConfig config;
+  config.memory_debug = false;
+  config.cosim = true;
+  return config;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(CosimTests)
+
+BOOST_AUTO_TEST_CASE(test_spsc_queue_order) {
+  // A small ring forces both the full and the empty paths
+  SpscQueue<uint64_t> queue(16);
+  BOOST_CHECK_EQUAL(queue.capacity(), 16u);
+  const uint64_t count = 200000;
+
+  std::thread producer([&queue, count]() {
+    for (uint64_t i = 0; i < count; i++) {
+      while (!queue.try_push(i)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint64_t expected = 0;
+  uint64_t value = 0;
+  bool in_order = true;
+  while (expected < count) {
+    if (queue.try_pop(value)) {
+      in_order = in_order && value == expected;
+      expected++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+
+  BOOST_CHECK(in_order);
+  BOOST_CHECK(!queue.try_pop(value));
+}
+
+BOOST_AUTO_TEST_CASE(test_cosim_programs_match) {
+  if (!rtl_backdoor::available()) {
+    BOOST_TEST_MESSAGE("Co-simulation needs the RTL backdoor; skipped");
+    return;
+  }
+
+  const std::vector<std::string> programs = {
+      "add",         "gcd",     "memcpy",           "bubble_sort",
+      "ecall_basic", "fence_i", "byte_load_simple", "csr_read_cycle"};
+
+  for (const std::string &program : programs) {
+    TestRunner runner(program + "_cosim", cosim_config());
+    BOOST_REQUIRE(runner.load_program(get_test_program_path(program)));
+    BOOST_REQUIRE(runner.get_cosim() != nullptr);
+
+    TestResult result = runner.run(1000000);
+    BOOST_CHECK_MESSAGE(result == TestResult::PASS, program << ": " << result);
+    BOOST_CHECK(!runner.get_cosim()->has_mismatch());
+    // Everything but the final store to the magic address was checked
+    BOOST_CHECK_EQUAL(runner.get_cosim()->get_checked(),
+                      rtl_backdoor::get_instret(runner.get_dut()));
+    BOOST_CHECK_GT(runner.get_cosim()->get_checked(), 0u);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_cosim_reports_divergence) {
+  if (!rtl_backdoor::available()) {
+    BOOST_TEST_MESSAGE("Co-simulation needs the RTL backdoor; skipped");
+    return;
+  }
+
+  TestRunner runner("cosim_divergence", cosim_config());
+  BOOST_REQUIRE(runner.load_program(get_test_program_path("gcd")));
+
+  // Patch the RTL's copy only: the call to main becomes a register write
+  const uint32_t patched = 0x07B00F93; // addi x31, x0, 123
+  const uint32_t addr = RESET_PC + 4;
+  BOOST_REQUIRE_NE(runner.get_memory().backdoor_read_word(addr), patched);
+  runner.get_memory().backdoor_write_word(addr, patched);
+
+  TestResult result = runner.run(1000000);
+
+  BOOST_CHECK_EQUAL(result, TestResult::FAIL);
+  BOOST_REQUIRE(runner.get_cosim()->has_mismatch());
+  const std::vector<std::string> &report = runner.get_cosim()->get_report();
+  BOOST_REQUIRE_GE(report.size(), 2u);
+  BOOST_CHECK_EQUAL(report[0].find("Mismatch at instruction 1, PC 0x00001004"),
+                    0u);
+  // Context: the good instruction and the bad one
+  BOOST_CHECK_EQUAL(report.size(), 2u + 2u);
+}
+
+BOOST_AUTO_TEST_CASE(test_functional_fast_forward) {
+  if (!rtl_backdoor::available()) {
+    BOOST_TEST_MESSAGE("Functional fast-forward needs the RTL backdoor; "
+                       "skipped");
+    return;
+  }
+
+  const std::vector<std::string> programs = {"gcd", "memcpy", "bubble_sort",
+                                             "ecall_basic"};
+
+  for (const std::string &program : programs) {
+    TestRunnerConfig config = cosim_config();
+    config.cosim = false;
+    TestRunner full(program + "_rtl", config);
+    BOOST_REQUIRE(full.load_program(get_test_program_path(program)));
+    BOOST_REQUIRE_EQUAL(full.run(1000000), TestResult::PASS);
+    const uint64_t instret = rtl_backdoor::get_instret(full.get_dut());
+
+    // Hand over half way, with the checker covering the RTL part
+    TestRunner handed(program + "_handover", cosim_config());
+    BOOST_REQUIRE(handed.load_program(get_test_program_path(program)));
+    const uint64_t skip = instret / 2;
+    BOOST_CHECK_EQUAL(handed.run_functional(skip), skip);
+    BOOST_CHECK_EQUAL(rtl_backdoor::get_instret(handed.get_dut()), skip);
+
+    TestResult result = handed.run(1000000);
+    BOOST_CHECK_MESSAGE(result == TestResult::PASS, program << ": " << result);
+    BOOST_CHECK_EQUAL(rtl_backdoor::get_instret(handed.get_dut()), instret);
+    BOOST_CHECK_EQUAL(rtl_backdoor::hash_arch_state(handed.get_dut()),
+                      rtl_backdoor::hash_arch_state(full.get_dut()));
+    BOOST_CHECK_EQUAL(handed.get_pc(), full.get_pc());
+    // The ISS part is charged the cycles the RTL would have taken
+    BOOST_CHECK_EQUAL(rtl_backdoor::get_cycle_counter(handed.get_dut()),
+                      rtl_backdoor::get_cycle_counter(full.get_dut()));
+    BOOST_CHECK_EQUAL(handed.get_cosim()->get_checked() + skip, instret);
+    BOOST_CHECK_LT(handed.get_cycle_count(), full.get_cycle_count());
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
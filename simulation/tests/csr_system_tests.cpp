@@ -7,10 +7,75 @@
  * Test programs use inline assembly to execute CSR instructions directly.
  */
 
+#include "../include/rtl_backdoor.h"
+#include "../include/rv32i_iss.h"
 #include "../include/test_runner.h"
 #include "../include/test_utils.h"
 #include <boost/test/unit_test.hpp>
 #include <iostream>
+#include <vector>
+
+namespace {
+// Instruction encoders for the hand-written program below
+uint32_t enc_i(uint32_t opcode, uint32_t rd, uint32_t funct3, uint32_t rs1,
+               int32_t imm) {
+  return (static_cast<uint32_t>(imm) << 20) | (rs1 << 15) | (funct3 << 12) |
+         (rd << 7) | opcode;
+}
+uint32_t addi(uint32_t rd, uint32_t rs1, int32_t imm) {
+  return enc_i(0x13, rd, 0, rs1, imm);
+}
+uint32_t csrrw(uint32_t rd, uint32_t csr, uint32_t rs1) {
+  return enc_i(0x73, rd, 1, rs1, static_cast<int32_t>(csr));
+}
+uint32_t csrr(uint32_t rd, uint32_t csr) {
+  return enc_i(0x73, rd, 2, 0, static_cast<int32_t>(csr));
+}
+
+// Programs the performance counters, runs a loop of loads and a taken
+// branch, and reads the counters into x10-x18
+constexpr uint32_t HPM_DATA_ADDR = 0x2000;
+const std::vector<uint32_t> HPM_PROGRAM = {
+    addi(5, 0, HPM_EVENT_FETCH_WAIT),
+    csrrw(0, 0x323, 5), // mhpmevent3
+    addi(5, 0, HPM_EVENT_BRANCH_TAKEN),
+    csrrw(0, 0x324, 5), // mhpmevent4
+    addi(5, 0, HPM_EVENT_LOAD_WORD),
+    csrrw(0, 0x325, 5), // mhpmevent5
+    addi(5, 0, HPM_EVENT_CSR),
+    csrrw(0, 0x326, 5),        // mhpmevent6
+    0x00002437,                // lui x8, 0x2 (HPM_DATA_ADDR)
+    addi(9, 0, 3),             // Loop count
+    enc_i(0x03, 6, 2, 8, 0),   // lw x6, 0(x8)
+    enc_i(0x03, 7, 0, 8, 1),   // lb x7, 1(x8): not a word load
+    addi(9, 9, -1),            //
+    0xFE049AE3,                // bnez x9, -12 (taken twice)
+    csrr(10, 0xC03),           // hpmcounter3
+    csrr(11, 0xB04),           // mhpmcounter4
+    csrr(12, 0xC05),           // hpmcounter5
+    csrr(13, 0xB06),           // mhpmcounter6
+    enc_i(0x73, 0, 5, 9, 0x320), // csrwi mcountinhibit, 9: stop counter 3
+    addi(0, 0, 0),             // nop
+    csrr(14, 0xC03),           // Frozen since the csrwi
+    csrr(15, 0x320),           // CY is read-only zero
+    addi(5, 0, 5),             //
+    csrrw(0, 0xB84, 5),        // mhpmcounter4h = 5
+    csrr(16, 0xC84),           // hpmcounter4h
+    csrr(17, 0xC07),           // Not implemented: reads zero
+    csrr(18, 0xB06),           // CSR instructions since mhpmevent6
+    0xDEAD0337,                // lui x6, 0xDEAD0
+    addi(7, 0, MAGIC_PASS_VALUE),
+    0x00732023,                // sw x7, 0(x6)
+};
+
+void load_hpm_program(MemoryModel &memory) {
+  for (size_t i = 0; i < HPM_PROGRAM.size(); i++) {
+    memory.backdoor_write_word(RESET_PC + static_cast<uint32_t>(i * 4),
+                               HPM_PROGRAM[i]);
+  }
+  memory.backdoor_write_word(HPM_DATA_ADDR, 0x12345678);
+}
+} // namespace
 
 BOOST_AUTO_TEST_SUITE(CSRSystemTests)
 
@@ -197,4 +262,107 @@ BOOST_AUTO_TEST_CASE(test_ebreak_basic) {
             << " writes\n";
 }
 
+/**
+ * Test: Stall fast-forward keeps cycle counts and counter CSRs exact
+ * Runs the same programs with fast-forward on and off at several memory
+ * latencies and compares cycle count, result and the final cycle CSR
+ */
+BOOST_AUTO_TEST_CASE(test_fast_forward_exact) {
+  for (const char *program : {"csr_read_cycle", "bubble_sort"}) {
+    for (uint32_t delay : {1u, 4u, 37u}) {
+      BOOST_TEST_CONTEXT(program << " delay=" << delay) {
+        TestRunnerConfig config;
+        config.memory_delay = delay;
+        config.memory_debug = false;
+
+        config.fast_forward = false;
+        TestRunner slow(std::string(program) + "_slow", config);
+        BOOST_REQUIRE(slow.load_program(get_test_program_path(program)));
+        TestResult slow_result = slow.run(500000);
+
+        config.fast_forward = true;
+        TestRunner fast(std::string(program) + "_fast", config);
+        BOOST_REQUIRE(fast.load_program(get_test_program_path(program)));
+        TestResult fast_result = fast.run(500000);
+
+        BOOST_CHECK_EQUAL(slow_result, TestResult::PASS);
+        BOOST_CHECK_EQUAL(fast_result, slow_result);
+        BOOST_CHECK_EQUAL(fast.get_cycle_count(), slow.get_cycle_count());
+        BOOST_CHECK_EQUAL(rtl_backdoor::get_cycle_counter(fast.get_dut()),
+                          rtl_backdoor::get_cycle_counter(slow.get_dut()));
+        BOOST_CHECK_EQUAL(slow.get_skipped_cycles(), 0u);
+        if (rtl_backdoor::available() && delay > 2) {
+          BOOST_CHECK_GT(fast.get_skipped_cycles(), 0u);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Test: Hardware performance counters
+ * Runs HPM_PROGRAM on the RTL with and without stall fast-forward and with
+ * a functional hand-over half way, and on the ISS; all read the same
+ * counter values
+ */
+BOOST_AUTO_TEST_CASE(test_hpm_counters) {
+  for (uint32_t delay : {1u, 4u}) {
+    BOOST_TEST_CONTEXT("delay=" << delay) {
+      // Expected values from the FSM sequences (fsm_timing.h)
+      const uint32_t fetch_wait = delay + 1;
+      const std::vector<uint32_t> expected = {
+          21 * fetch_wait, // Instructions 2-14, the loop three times
+          2,               // Taken branches
+          3,               // Word loads
+          3,               // CSR instructions 14-16
+          25 * fetch_wait, // Up to the csrwi
+          0x8,
+          5,
+          0,
+          10, // CSR instructions 14-25
+      };
+
+      // ISS
+      MemoryModel iss_memory(1024 * 1024, delay, false);
+      load_hpm_program(iss_memory);
+      IssConfig iss_config;
+      iss_config.memory_delay = delay;
+      iss_config.log_level = LogLevel::WARN;
+      Rv32iIss iss(iss_memory, iss_config);
+      BOOST_REQUIRE_EQUAL(iss.run(1000), TestResult::PASS);
+      for (uint32_t i = 0; i < expected.size(); i++) {
+        BOOST_CHECK_EQUAL(iss.get_reg(10 + i), expected[i]);
+      }
+
+      if (!rtl_backdoor::available()) {
+        continue;
+      }
+      for (int mode = 0; mode < 3; mode++) {
+        BOOST_TEST_CONTEXT("mode=" << mode) {
+          TestRunnerConfig config;
+          config.memory_delay = delay;
+          config.memory_debug = false;
+          config.log_level = LogLevel::WARN;
+          config.fast_forward = mode != 0;
+          TestRunner runner("hpm_counters", config);
+          load_hpm_program(runner.get_memory());
+          if (mode == 2) {
+            // Inside the loop, with the counters running
+            BOOST_CHECK_EQUAL(runner.run_functional(12), 12u);
+          }
+          BOOST_REQUIRE_EQUAL(runner.run(10000), TestResult::PASS);
+          for (uint32_t i = 0; i < expected.size(); i++) {
+            BOOST_CHECK_EQUAL(rtl_backdoor::get_register(runner.get_dut(),
+                                                         10 + i),
+                              expected[i]);
+          }
+          if (mode == 1 && delay > 2) {
+            BOOST_CHECK_GT(runner.get_skipped_cycles(), 0u);
+          }
+        }
+      }
+    }
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
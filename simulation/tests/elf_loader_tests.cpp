@@ -0,0 +1,74 @@
+/*
+ * ELF Loader Test Cases
+ *
+ * These tests load the compiled test programs with ElfImage and check that
+ * only the PT_LOAD segments reach memory, at their physical addresses.
+ */
+
+#include "../include/elf_loader.h"
+#include "../include/test_utils.h"
+#include <boost/test/unit_test.hpp>
+
+namespace {
+// The .elf sits next to the .ini for most programs in test/
+std::string get_test_elf_path(const std::string &test_name) {
+  std::string path = get_test_program_path(test_name);
+  return path.substr(0, path.size() - 4) + ".elf";
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(ElfLoaderTests)
+
+BOOST_AUTO_TEST_CASE(test_load_ini_as_elf) {
+  ElfImage image;
+  BOOST_REQUIRE_MESSAGE(image.load_file(get_test_program_path("add")),
+                        "Failed to load add.ini: " << image.get_error());
+
+  BOOST_CHECK(image.is_elf());
+  BOOST_CHECK_EQUAL(image.get_entry_point(), RESET_PC);
+  BOOST_REQUIRE(!image.get_segments().empty());
+
+  uint32_t start = 0;
+  BOOST_CHECK(image.find_symbol("__start", start));
+  BOOST_CHECK_EQUAL(start, RESET_PC);
+  BOOST_CHECK(!image.find_symbol("no_such_symbol", start));
+
+  MemoryModel memory(288 * 1024 * 1024, 4, false);
+  BOOST_REQUIRE(image.load_into(memory));
+
+  // The ELF header is not part of any segment, so address 0 stays empty
+  BOOST_CHECK_EQUAL(memory.backdoor_read_word(0), 0u);
+  // First instruction of add.s: lui a4, 0x1 (see add.dump)
+  BOOST_CHECK_NE(memory.backdoor_read_word(RESET_PC), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_elf_and_ini_load_identically) {
+  ElfImage ini_image;
+  ElfImage elf_image;
+  BOOST_REQUIRE(ini_image.load_file(get_test_program_path("bubble_sort")));
+  BOOST_REQUIRE(elf_image.load_file(get_test_elf_path("bubble_sort")));
+
+  MemoryModel ini_memory(288 * 1024 * 1024, 4, false);
+  MemoryModel elf_memory(288 * 1024 * 1024, 4, false);
+  BOOST_REQUIRE(ini_image.load_into(ini_memory));
+  BOOST_REQUIRE(elf_image.load_into(elf_memory));
+
+  BOOST_CHECK_EQUAL(ini_image.get_entry_point(), elf_image.get_entry_point());
+  BOOST_CHECK_EQUAL(ini_memory.get_resident_pages(),
+                    elf_memory.get_resident_pages());
+  for (const ElfSegment &segment : elf_image.get_segments()) {
+    for (uint32_t addr = segment.paddr;
+         addr < segment.paddr + segment.mem_size; addr += 4) {
+      BOOST_REQUIRE_EQUAL(ini_memory.backdoor_read_word(addr),
+                          elf_memory.backdoor_read_word(addr));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_missing_file) {
+  ElfImage image;
+  BOOST_CHECK(!image.load_file("/nonexistent/program.elf"));
+  BOOST_CHECK(!image.get_error().empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
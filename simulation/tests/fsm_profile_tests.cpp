@@ -0,0 +1,145 @@
+/*
+ * FSM Occupancy Profile Test Cases
+ *
+ * These tests check the profile's attribution of state cycles to
+ * instruction classes and its table/JSON output on a hand-fed sequence,
+ * then profile test/ programs on the RTL (with stall fast-forward) and
+ * compare every class's per-state cycles with FsmTiming.
+ */
+
+#include "../include/fsm_profile.h"
+#include "../include/rtl_backdoor.h"
+#include "../include/test_runner.h"
+#include "../include/test_utils.h"
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+// Feed one instruction's model sequence to the profile
+void feed(FsmProfile &profile, const FsmTiming &timing, uint32_t insn,
+          bool taken) {
+  for (const FsmPhase &phase : timing.sequence(insn, taken)) {
+    profile.add(phase.state, phase.cycles);
+  }
+  BOOST_REQUIRE(profile.instruction_done(FSM_FETCH_0));
+  profile.retire(insn);
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(FsmProfileTests)
+
+BOOST_AUTO_TEST_CASE(test_fsm_profile_attribution) {
+  FsmTiming timing(4);
+  FsmProfile profile;
+  BOOST_CHECK(!profile.instruction_done(FSM_FETCH_0));
+
+  feed(profile, timing, 0x00A00093, false); // addi
+  feed(profile, timing, 0x0040A103, false); // lw
+  feed(profile, timing, 0x0040A103, false); // lw
+  feed(profile, timing, 0x00208463, true);  // beq, taken
+  feed(profile, timing, 0x00208463, false); // beq, not taken
+  profile.add(FSM_FETCH_0, 1);              // Next fetch started
+  profile.add(FSM_FETCH_1, 3);
+
+  BOOST_CHECK_EQUAL(profile.get_instructions(), 5u);
+  BOOST_CHECK_EQUAL(profile.get_instructions(FSM_CLASS_LOAD), 2u);
+  BOOST_CHECK_EQUAL(profile.get_cycles(FSM_CLASS_LOAD), 2 * 18u);
+  BOOST_CHECK_EQUAL(profile.get_cycles(FSM_CLASS_LOAD, FSM_LD_2), 2 * 4u);
+  BOOST_CHECK_EQUAL(
+      profile.get_group_cycles(FSM_CLASS_LOAD, FSM_GROUP_FETCH_WAIT), 10u);
+  BOOST_CHECK_EQUAL(
+      profile.get_group_cycles(FSM_CLASS_LOAD, FSM_GROUP_MEM_WAIT), 8u);
+  BOOST_CHECK_EQUAL(
+      profile.get_group_cycles(FSM_CLASS_LOAD, FSM_GROUP_PC_INC), 2u);
+  BOOST_CHECK_EQUAL(
+      profile.get_group_cycles(FSM_CLASS_LOAD, FSM_GROUP_EXECUTE), 8u);
+  BOOST_CHECK_EQUAL(profile.get_instructions(FSM_CLASS_BRANCH_TAKEN), 1u);
+  BOOST_CHECK_EQUAL(profile.get_instructions(FSM_CLASS_BRANCH_NOT_TAKEN),
+                    1u);
+  BOOST_CHECK_EQUAL(profile.get_cycles(), 11u + 2 * 18u + 2 * 11u);
+  BOOST_CHECK_EQUAL(profile.get_in_flight_cycles(), 4u);
+
+  std::string table = profile.format_table();
+  BOOST_CHECK_NE(table.find("load"), std::string::npos);
+  BOOST_CHECK_NE(table.find("fetch_wait"), std::string::npos);
+  BOOST_CHECK_NE(table.find("18.00"), std::string::npos); // Load CPI
+  BOOST_CHECK_EQUAL(table.find("store"), std::string::npos);
+  BOOST_CHECK_NE(table.find("in flight at the end: 4 cycles"),
+                 std::string::npos);
+
+  std::string json = profile.format_json();
+  BOOST_CHECK_NE(json.find("\"instructions\": 5"), std::string::npos);
+  BOOST_CHECK_NE(json.find("\"FETCH_1\": 28"), std::string::npos);
+  BOOST_CHECK_NE(json.find("{\"class\": \"load\", \"instructions\": 2, "
+                           "\"cycles\": 36, \"cpi\": 18.0000"),
+                 std::string::npos);
+
+  profile.reset();
+  BOOST_CHECK_EQUAL(profile.get_cycles(), 0u);
+  BOOST_CHECK_EQUAL(profile.get_in_flight_cycles(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_fsm_profile_matches_timing) {
+  if (!rtl_backdoor::available()) {
+    BOOST_TEST_MESSAGE("FSM profile needs the RTL backdoor; skipped");
+    return;
+  }
+
+  const std::vector<std::string> programs = {"bubble_sort", "csr_read_cycle",
+                                             "ecall_basic", "memcpy"};
+  for (uint32_t d : {1u, 4u}) {
+    FsmTiming timing(d);
+    for (const std::string &program : programs) {
+      TestRunnerConfig config;
+      config.memory_delay = d;
+      config.memory_debug = false;
+      config.log_level = LogLevel::WARN;
+      config.fsm_profile_file = "/tmp/riscv_fsm_profile_" + program + ".json";
+      TestRunner runner(program + "_fsm_profile", config);
+      BOOST_REQUIRE(runner.load_program(get_test_program_path(program)));
+      BOOST_REQUIRE_EQUAL(runner.run(1000000), TestResult::PASS);
+      const FsmProfile *profile = runner.get_fsm_profile();
+      BOOST_REQUIRE(profile != nullptr);
+
+      // Every cycle of the run is accounted for
+      BOOST_CHECK_GT(profile->get_instructions(), 0u);
+      BOOST_CHECK_EQUAL(profile->get_cycles() +
+                            profile->get_in_flight_cycles(),
+                        runner.get_cycle_count());
+
+      // Whole instructions take exactly what the model predicts, state by
+      // state
+      for (uint32_t c = 0; c < FSM_CLASS_HALT; c++) {
+        const FsmClass cls = static_cast<FsmClass>(c);
+        const uint64_t count = profile->get_instructions(cls);
+        std::vector<uint64_t> expected(FSM_NUM_STATES, 0);
+        for (const FsmPhase &phase : timing.sequence(cls)) {
+          expected[phase.state] += count * phase.cycles;
+        }
+        for (uint32_t state = 0; state < FSM_NUM_STATES; state++) {
+          BOOST_CHECK_MESSAGE(
+              profile->get_cycles(cls, static_cast<FsmState>(state)) ==
+                  expected[state],
+              program << " (delay " << d << ") "
+                      << FsmProfile::class_name(cls) << " "
+                      << FsmTiming::state_name(state) << ": "
+                      << profile->get_cycles(cls,
+                                             static_cast<FsmState>(state))
+                      << " cycles, model " << expected[state]);
+        }
+      }
+
+      std::ifstream json(config.fsm_profile_file);
+      std::stringstream text;
+      text << json.rdbuf();
+      BOOST_CHECK_EQUAL(text.str(), profile->format_json());
+      std::remove(config.fsm_profile_file.c_str());
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,216 @@
+/*
+ * Control FSM Timing Model Test Cases
+ *
+ * These tests check FsmTiming's per-class sequences, then run every test/
+ * program on the RTL one cycle at a time at several memory latencies and
+ * compare the control FSM state in each cycle with the sequence the model
+ * predicts for the instruction the ISS executes there. Total run cycles
+ * and the final register file (which holds any cycle CSR reads) must
+ * match the ISS's prediction as well.
+ */
+
+#include "../include/fsm_timing.h"
+#include "../include/rtl_backdoor.h"
+#include "../include/rv32i_iss.h"
+#include "../include/test_runner.h"
+#include "../include/test_utils.h"
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+const std::vector<std::string> PROGRAMS = {
+    "add",         "subtract",       "gcd",            "fibonacci",
+    "bitops",      "multiply",       "strlen",         "memcpy",
+    "bubble_sort", "factorial",      "prime",          "byte_load_simple",
+    "fence_basic", "fence_i",        "fence_ordering", "csr_read_cycle",
+    "ecall_basic", "ebreak_basic"};
+
+const std::vector<uint32_t> DELAYS = {1, 4, 9};
+
+std::string format_sequence(const std::vector<FsmPhase> &phases) {
+  std::ostringstream out;
+  for (const FsmPhase &phase : phases) {
+    out << " " << FsmTiming::state_name(phase.state);
+    if (phase.cycles != 1) {
+      out << "x" << phase.cycles;
+    }
+  }
+  return out.str();
+}
+
+bool same_sequence(const std::vector<FsmPhase> &a,
+                   const std::vector<FsmPhase> &b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i].state != b[i].state || a[i].cycles != b[i].cycles) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TestRunnerConfig timing_config(uint32_t delay) {
+  TestRunnerConfig config;
+  config.memory_delay = delay;
+  config.memory_debug = false;
+  config.log_level = LogLevel::WARN;
+  return config;
+}
+
+IssConfig iss_config(uint32_t delay) {
+  IssConfig config;
+  config.memory_delay = delay;
+  config.log_level = LogLevel::WARN;
+  return config;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(FsmTimingTests)
+
+BOOST_AUTO_TEST_CASE(test_fsm_timing_classes) {
+  for (uint32_t d : DELAYS) {
+    FsmTiming timing(d);
+    BOOST_CHECK_EQUAL(timing.cycles(0x00A00093), d + 7);     // addi
+    BOOST_CHECK_EQUAL(timing.cycles(0x123450B7), d + 7);     // lui
+    BOOST_CHECK_EQUAL(timing.cycles(0x0080006F), d + 7);     // jal
+    BOOST_CHECK_EQUAL(timing.cycles(0x00208463), d + 7);     // beq
+    BOOST_CHECK_EQUAL(timing.cycles(0x00208463, true), d + 7);
+    BOOST_CHECK_EQUAL(timing.cycles(0x0000200F), d + 7);     // fence
+    BOOST_CHECK_EQUAL(timing.cycles(0x0040A103), 2 * d + 10); // lw
+    BOOST_CHECK_EQUAL(timing.cycles(0x0020A223), 2 * d + 9);  // sw
+    BOOST_CHECK_EQUAL(timing.cycles(0xC0002573), d + 8);     // rdcycle
+    BOOST_CHECK_EQUAL(timing.cycles(0x00000073), d + 10);    // ecall
+    BOOST_CHECK_EQUAL(timing.cycles(0x30200073), d + 6);     // mret
+    BOOST_CHECK_EQUAL(timing.cycles(0x00000000), 0u);        // Stops
+    BOOST_CHECK_EQUAL(timing.cycles(0x7C002573), 0u);        // Bad CSR
+  }
+
+  FsmTiming timing(4);
+  std::vector<FsmPhase> load = timing.sequence(0x0040A103, false);
+  BOOST_CHECK_EQUAL(format_sequence(load),
+                    " FETCH_0 FETCH_1x5 FETCH_2 FETCH_3 DECODE LD_0 LD_1 "
+                    "LD_2x4 LD_3 LD_4 PC_INC");
+  // funct3 2/3 never branch
+  BOOST_CHECK_EQUAL(FsmTiming::classify(0x0020A463, true),
+                    FSM_CLASS_BRANCH_NOT_TAKEN);
+  BOOST_CHECK_EQUAL(std::string(FsmTiming::state_name(FSM_ST_3)), "ST_3");
+  BOOST_CHECK_EQUAL(std::string(FsmTiming::state_name(FSM_NUM_STATES)), "?");
+}
+
+BOOST_AUTO_TEST_CASE(test_fsm_timing_hpm_csrs) {
+  const std::vector<uint32_t> accesses = {
+      0xB0302573, // csrr a0, mhpmcounter3
+      0xB8302573, // csrr a0, mhpmcounter3h
+      0xB0309073, // csrw mhpmcounter3, ra
+      0xC0302573, // csrr a0, hpmcounter3
+      0xC8402573, // csrr a0, hpmcounter4h
+      0x32329073, // csrw mhpmevent3, t0
+      0x32302573, // csrr a0, mhpmevent3
+      0x3204D073, // csrwi mcountinhibit, 9
+      0x32002573, // csrr a0, mcountinhibit
+      0x33F02573, // csrr a0, mhpmevent31 (decodes, reads zero)
+      0xC9F02573, // csrr a0, hpmcounter31h
+  };
+  for (uint32_t d : DELAYS) {
+    FsmTiming timing(d);
+    for (uint32_t insn : accesses) {
+      BOOST_CHECK_MESSAGE(FsmTiming::classify(insn, false) == FSM_CLASS_CSR,
+                          to_hex_string(insn, 8) << " is not a CSR access");
+      BOOST_CHECK_EQUAL(timing.cycles(insn), d + 8);
+    }
+  }
+
+  // Slots 0-2 of the counter ranges only decode as cycle, time and instret
+  BOOST_CHECK_EQUAL(FsmTiming::classify(0x32102573, false), FSM_CLASS_HALT);
+  BOOST_CHECK_EQUAL(FsmTiming::classify(0xB0002573, false), FSM_CLASS_HALT);
+  BOOST_CHECK_EQUAL(csr_hpm_index(0xB03), 0);
+  BOOST_CHECK_EQUAL(csr_hpm_index(0xC9F), 28);
+  BOOST_CHECK_EQUAL(csr_hpm_index(0xC02), -1);
+  BOOST_CHECK_EQUAL(csr_hpm_index(0x320), -1);
+}
+
+BOOST_AUTO_TEST_CASE(test_fsm_timing_matches_rtl) {
+  if (!rtl_backdoor::available()) {
+    BOOST_TEST_MESSAGE("FSM timing check needs the RTL backdoor; skipped");
+    return;
+  }
+
+  for (uint32_t d : DELAYS) {
+    FsmTiming timing(d);
+    for (const std::string &program : PROGRAMS) {
+      const std::string path = get_test_program_path(program);
+
+      // Cycle by cycle, with the ISS one instruction ahead of the RTL
+      TestRunner runner(program + "_timing", timing_config(d));
+      BOOST_REQUIRE(runner.load_program(path));
+      MemoryModel iss_memory(runner.get_config().memory_size, d, false);
+      Rv32iIss iss(iss_memory, iss_config(d));
+      BOOST_REQUIRE(iss.load_program(path));
+
+      std::vector<FsmPhase> expected;
+      std::vector<FsmPhase> seen;
+      uint64_t instructions = 0;
+      uint32_t insn_pc = 0;
+      bool sequences_match = true;
+      for (uint64_t cycle = 0; cycle < 1000000 && sequences_match; cycle++) {
+        uint32_t state = rtl_backdoor::get_control_state(runner.get_dut());
+        if (state == FSM_FETCH_0 && !seen.empty()) {
+          sequences_match = same_sequence(seen, expected);
+          BOOST_CHECK_MESSAGE(sequences_match,
+                              program << " (delay " << d << ") instruction "
+                                      << instructions << " at PC "
+                                      << to_hex_string(insn_pc, 8)
+                                      << ": RTL" << format_sequence(seen)
+                                      << ", model"
+                                      << format_sequence(expected));
+          seen.clear();
+        }
+        if (seen.empty()) {
+          insn_pc = iss.get_pc();
+          uint32_t insn = iss_memory.backdoor_read_word(insn_pc & ~3u);
+          iss.step(1);
+          expected = timing.sequence(insn, iss.get_pc() != insn_pc + 4);
+          instructions++;
+        }
+
+        if (!seen.empty() && seen.back().state == state) {
+          seen.back().cycles++;
+        } else {
+          seen.push_back({static_cast<FsmState>(state), 1});
+        }
+        runner.clock_cycle();
+        if (runner.get_result() == MAGIC_PASS_VALUE) {
+          break;
+        }
+      }
+      BOOST_CHECK_MESSAGE(runner.get_result() == MAGIC_PASS_VALUE,
+                          program << " (delay " << d << ") did not pass");
+
+      // Whole runs: cycle count and final state
+      TestRunner full(program + "_timing_run", timing_config(d));
+      BOOST_REQUIRE(full.load_program(path));
+      MemoryModel run_memory(full.get_config().memory_size, d, false);
+      Rv32iIss predicted(run_memory, iss_config(d));
+      BOOST_REQUIRE(predicted.load_program(path));
+      BOOST_REQUIRE_EQUAL(full.run(1000000), TestResult::PASS);
+      BOOST_REQUIRE_EQUAL(predicted.run(1000000), TestResult::PASS);
+      BOOST_CHECK_MESSAGE(full.get_cycle_count() ==
+                              predicted.get_run_cycles(),
+                          program << " (delay " << d << "): RTL "
+                                  << full.get_cycle_count()
+                                  << " cycles, model "
+                                  << predicted.get_run_cycles());
+      for (uint32_t i = 1; i < 32; i++) {
+        BOOST_CHECK_MESSAGE(rtl_backdoor::get_register(full.get_dut(), i) ==
+                                predicted.get_reg(i),
+                            program << " (delay " << d << "): x" << i);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
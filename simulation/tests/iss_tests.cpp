@@ -0,0 +1,169 @@
+/*
+ * Instruction-Set Simulator Test Cases
+ *
+ * These tests run the test/ programs on Rv32iIss and check that it follows
+ * the core's behaviour in the corner cases where the RTL departs from the
+ * RV32I specification.
+ */
+
+#include "../include/rv32i_iss.h"
+#include "../include/test_utils.h"
+#include <boost/test/unit_test.hpp>
+#include <iostream>
+#include <vector>
+
+namespace {
+constexpr uint32_t DATA_ADDR = 0x2000;
+
+// Instruction encoders for the hand-written sequences below
+uint32_t enc_i(uint32_t opcode, uint32_t rd, uint32_t funct3, uint32_t rs1,
+               int32_t imm) {
+  return (static_cast<uint32_t>(imm) << 20) | (rs1 << 15) | (funct3 << 12) |
+         (rd << 7) | opcode;
+}
+uint32_t enc_r(uint32_t funct7, uint32_t rs2, uint32_t rs1, uint32_t funct3,
+               uint32_t rd) {
+  return (funct7 << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) |
+         (rd << 7) | 0x33;
+}
+uint32_t enc_s(uint32_t funct3, uint32_t rs1, uint32_t rs2, int32_t imm) {
+  uint32_t u = static_cast<uint32_t>(imm);
+  return ((u >> 5) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) |
+         ((u & 0x1F) << 7) | 0x23;
+}
+uint32_t enc_b(uint32_t funct3, uint32_t rs1, uint32_t rs2, int32_t offset) {
+  uint32_t u = static_cast<uint32_t>(offset);
+  return (((u >> 12) & 1) << 31) | (((u >> 5) & 0x3F) << 25) | (rs2 << 20) |
+         (rs1 << 15) | (funct3 << 12) | (((u >> 1) & 0xF) << 8) |
+         (((u >> 11) & 1) << 7) | 0x63;
+}
+uint32_t addi(uint32_t rd, uint32_t rs1, int32_t imm) {
+  return enc_i(0x13, rd, 0, rs1, imm);
+}
+uint32_t lui(uint32_t rd, uint32_t imm20) {
+  return (imm20 << 12) | (rd << 7) | 0x37;
+}
+
+void write_program(MemoryModel &memory, const std::vector<uint32_t> &words) {
+  for (size_t i = 0; i < words.size(); i++) {
+    memory.backdoor_write_word(RESET_PC + static_cast<uint32_t>(i * 4),
+                               words[i]);
+  }
+}
+
+IssConfig quiet_config() {
+  IssConfig config;
+  config.log_level = LogLevel::WARN;
+  return config;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(IssTests)
+
+BOOST_AUTO_TEST_CASE(test_iss_runs_test_programs) {
+  const std::vector<std::string> programs = {
+      "add",         "subtract",       "gcd",            "fibonacci",
+      "bitops",      "multiply",       "strlen",         "memcpy",
+      "bubble_sort", "factorial",      "prime",          "byte_load_simple",
+      "fence_basic", "fence_i",        "fence_ordering", "csr_read_cycle",
+      "ecall_basic", "ebreak_basic"};
+
+  for (const std::string &program : programs) {
+    MemoryModel memory(288 * 1024 * 1024, 4, false);
+    Rv32iIss iss(memory, quiet_config());
+    BOOST_REQUIRE_MESSAGE(iss.load_program(get_test_program_path(program)),
+                          "Failed to load " << program);
+
+    TestResult result = iss.run(10000000);
+    BOOST_CHECK_MESSAGE(result == TestResult::PASS,
+                        program << ": " << result << " after "
+                                << iss.get_instret() << " instructions");
+    std::cout << "ISS " << program << ": " << iss.get_instret()
+              << " instructions\n";
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_iss_rtl_corner_cases) {
+  MemoryModel memory(1024 * 1024, 4, false);
+  memory.backdoor_write_word(DATA_ADDR, 0x80017FFF);
+  write_program(memory, {
+                            addi(1, 0, 0x100),           // x1 = 0x100
+                            enc_i(0x67, 1, 0, 1, 8),     // jalr x1, 8(x1)
+                            0,                           // Skipped
+                            0,                           // Skipped
+                            addi(2, 0, 5),               // x2 = 5
+                            enc_i(0x13, 3, 1, 2, 0x401), // slli, bit 30 set
+                            lui(4, DATA_ADDR >> 12),     // x4 = DATA_ADDR
+                            enc_i(0x03, 5, 1, 4, 3),     // lh x5, 3(x4)
+                            addi(6, 0, 0xAB),            // x6 = 0xAB
+                            enc_s(0, 4, 6, 5),           // sb x6, 5(x4)
+                            enc_r(0x01, 2, 2, 0, 7),     // mul x7, x2, x2
+                            enc_r(0x20, 2, 2, 1, 8),     // sll, bit 30 set
+                            0,                           // Halt
+                        });
+
+  Rv32iIss iss(memory, quiet_config());
+  iss.run(100);
+
+  BOOST_CHECK(iss.is_halted());
+  BOOST_CHECK_EQUAL(iss.get_pc(), 0x1030u);
+  BOOST_CHECK_EQUAL(iss.get_instret(), 10u);
+  BOOST_CHECK_EQUAL(iss.get_reg(1), 0x1008u); // Jumped to x1 + 8 after
+  BOOST_CHECK_EQUAL(iss.get_reg(3), 5u);      // ALU_PASS_RS1
+  BOOST_CHECK_EQUAL(iss.get_reg(5), 0xFFFF8001u);
+  BOOST_CHECK_EQUAL(iss.get_reg(7), 10u);
+  BOOST_CHECK_EQUAL(iss.get_reg(8), 5u);
+  BOOST_CHECK_EQUAL(memory.backdoor_read_word(DATA_ADDR + 4), 0x0000AB00u);
+}
+
+BOOST_AUTO_TEST_CASE(test_iss_self_modifying_code) {
+  // The store rewrites "addi x1, x0, 1" at 0x100C into "addi x1, x0, 2"
+  // while the block holding it is cached; the second pass must see it
+  MemoryModel memory(1024 * 1024, 4, false);
+  write_program(memory, {
+                            lui(5, 0x00200),       // x5 = 0x00200000
+                            addi(5, 5, 0x093),     // x5 = addi x1, x0, 2
+                            addi(6, 0, 0),         // Pass counter
+                            addi(1, 0, 1),         // 0x100C: patched
+                            addi(6, 6, 1),         // Count the pass
+                            lui(7, 0x1),           // x7 = 0x1000
+                            enc_s(2, 7, 5, 0xC),   // sw x5, 0xC(x7)
+                            addi(8, 0, 2),         // x8 = 2
+                            enc_b(4, 6, 8, -0x14), // blt x6, x8, 0x100C
+                            0,                     // Halt
+                        });
+
+  Rv32iIss iss(memory, quiet_config());
+  iss.run(100);
+
+  BOOST_CHECK(iss.is_halted());
+  BOOST_CHECK_EQUAL(iss.get_reg(6), 2u);
+  BOOST_CHECK_EQUAL(iss.get_reg(1), 2u);
+  BOOST_CHECK_GE(iss.get_decoded_blocks(), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(test_iss_halt_and_instruction_budget) {
+  MemoryModel memory(1024 * 1024, 4, false);
+  Rv32iIss iss(memory, quiet_config());
+
+  // A zero word is not an implemented opcode
+  BOOST_CHECK_EQUAL(iss.run(1000), TestResult::TIMEOUT);
+  BOOST_CHECK(iss.is_halted());
+  BOOST_CHECK_EQUAL(iss.get_pc(), RESET_PC);
+  BOOST_CHECK_EQUAL(iss.get_instret(), 0u);
+
+  // Budgets are exact, also in the middle of a block
+  memory.backdoor_write_word(RESET_PC, addi(1, 1, 1));
+  memory.backdoor_write_word(RESET_PC + 4, 0xFFDFF06F); // j 0x1000
+  iss.reset();
+  BOOST_CHECK_EQUAL(iss.step(5), 5u);
+  BOOST_CHECK_EQUAL(iss.get_instret(), 5u);
+  BOOST_CHECK_EQUAL(iss.get_reg(1), 3u);
+  BOOST_CHECK_EQUAL(iss.get_pc(), RESET_PC + 4);
+  BOOST_CHECK_EQUAL(iss.run(7), TestResult::TIMEOUT);
+  BOOST_CHECK_EQUAL(iss.get_instret(), 12u);
+  BOOST_CHECK_EQUAL(iss.get_reg(1), 6u);
+  BOOST_CHECK_EQUAL(iss.get_pc(), RESET_PC);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
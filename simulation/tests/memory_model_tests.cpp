@@ -0,0 +1,199 @@
+/*
+ * MemoryModel Test Cases
+ *
+ * These tests exercise the C++ memory model directly (no DUT): sparse page
+ * allocation, backdoor access, the magic address region, write
+ * watchpoints and state save/restore.
+ */
+
+#include "../memory_model.h"
+#include "../include/test_utils.h"
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace {
+// Drive one complete bus write through the FSM (rising edges only)
+void bus_write(MemoryModel &memory, uint32_t addr, uint32_t data,
+               uint8_t byte_enables = 0xF) {
+  uint32_t data_out = 0;
+  bool resp = false;
+  memory.eval_posedge(true, false, false, 0, 0, data_out, resp);
+  for (int i = 0; i < 16 && !resp; i++) {
+    memory.eval_posedge(true, false, true, addr, data, data_out, resp,
+                        byte_enables);
+  }
+  memory.eval_posedge(true, false, false, 0, 0, data_out, resp);
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(MemoryModelTests)
+
+BOOST_AUTO_TEST_CASE(test_pages_allocated_on_first_write) {
+  MemoryModel memory(288 * 1024 * 1024, 4, false);
+
+  // A fresh model has no resident pages and reads back as zero
+  BOOST_CHECK_EQUAL(memory.get_resident_pages(), 0u);
+  BOOST_CHECK_EQUAL(memory.backdoor_read_word(0x1000), 0u);
+  BOOST_CHECK_EQUAL(memory.backdoor_read_byte(0x10000000), 0u);
+  BOOST_CHECK_EQUAL(memory.get_resident_pages(), 0u);
+
+  memory.backdoor_write_word(0x1000, 0x12345678);
+  memory.backdoor_write_byte(0x1004, 0xAB);
+  BOOST_CHECK_EQUAL(memory.get_resident_pages(), 1u);
+  BOOST_CHECK_EQUAL(memory.backdoor_read_word(0x1000), 0x12345678u);
+  BOOST_CHECK_EQUAL(memory.backdoor_read_byte(0x1004), 0xABu);
+
+  memory.backdoor_write_word(0x10000000, 0xCAFEF00D);
+  BOOST_CHECK_EQUAL(memory.get_resident_pages(), 2u);
+  BOOST_CHECK_EQUAL(memory.get_resident_bytes(),
+                    2u * MemoryModel::PAGE_SIZE);
+}
+
+BOOST_AUTO_TEST_CASE(test_word_straddling_pages) {
+  MemoryModel memory(1024 * 1024, 4, false);
+
+  memory.backdoor_write_byte(0x1FFE, 0x11);
+  memory.backdoor_write_byte(0x1FFF, 0x22);
+  memory.backdoor_write_byte(0x2000, 0x33);
+  memory.backdoor_write_byte(0x2001, 0x44);
+
+  BOOST_CHECK_EQUAL(memory.backdoor_read_word(0x1FFE), 0x44332211u);
+  BOOST_CHECK_EQUAL(memory.get_resident_pages(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(test_clear_releases_pages) {
+  MemoryModel memory(1024 * 1024, 4, false);
+
+  memory.backdoor_write_word(0x1000, 0xFFFFFFFF);
+  memory.backdoor_write_word(0x8000, 0xFFFFFFFF);
+  BOOST_CHECK_EQUAL(memory.get_resident_pages(), 2u);
+
+  memory.clear();
+  BOOST_CHECK_EQUAL(memory.get_resident_pages(), 0u);
+  BOOST_CHECK_EQUAL(memory.backdoor_read_word(0x1000), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_state_round_trip) {
+  MemoryModel memory(288 * 1024 * 1024, 4, false);
+  memory.backdoor_write_word(0x1000, 0x12345678);
+  memory.backdoor_write_word(0x10000ffc, 0xCAFEF00D);
+  memory.backdoor_write_word(0x4000, 0); // Resident but all zero
+  bus_write(memory, 0x10000000, 0xA5A5A5A5);
+
+  // Stop part-way through a read so the FSM is mid-transaction
+  uint32_t data_out = 0;
+  bool resp = false;
+  memory.eval_posedge(true, true, false, 0x1000, 0, data_out, resp);
+  memory.eval_posedge(true, true, false, 0x1000, 0, data_out, resp);
+  const uint32_t idle = memory.get_idle_wait_cycles();
+  BOOST_REQUIRE_GT(idle, 0u);
+
+  std::ostringstream saved;
+  memory.save_state(saved);
+  // Header, FSM and statistics plus the two non-zero pages
+  BOOST_CHECK_EQUAL(memory.get_resident_pages(), 3u);
+  BOOST_CHECK_LT(saved.str().size(), 3u * (MemoryModel::PAGE_SIZE + 4));
+
+  MemoryModel restored(288 * 1024 * 1024, 4, false);
+  restored.backdoor_write_word(0x8000, 0xFFFFFFFF); // Replaced by the image
+  std::istringstream in(saved.str());
+  BOOST_REQUIRE(restored.restore_state(in));
+
+  BOOST_CHECK_EQUAL(restored.get_resident_pages(), 2u);
+  BOOST_CHECK_EQUAL(restored.backdoor_read_word(0x8000), 0u);
+  BOOST_CHECK_EQUAL(restored.backdoor_read_word(0x1000), 0x12345678u);
+  BOOST_CHECK_EQUAL(restored.backdoor_read_word(0x10000ffc), 0xCAFEF00Du);
+  BOOST_CHECK_EQUAL(restored.backdoor_read_word(0x10000000), 0xA5A5A5A5u);
+  BOOST_CHECK_EQUAL(restored.get_write_count(), memory.get_write_count());
+  BOOST_CHECK_EQUAL(restored.get_change_count(), memory.get_change_count());
+  BOOST_CHECK_EQUAL(restored.get_idle_wait_cycles(), idle);
+
+  // Both finish the read on the same edge
+  uint32_t restored_out = 0;
+  bool restored_resp = false;
+  for (int i = 0; i < 16 && !resp; i++) {
+    memory.eval_posedge(true, true, false, 0x1000, 0, data_out, resp);
+    restored.eval_posedge(true, true, false, 0x1000, 0, restored_out,
+                          restored_resp);
+    BOOST_CHECK_EQUAL(restored_resp, resp);
+  }
+  BOOST_CHECK(resp);
+  BOOST_CHECK_EQUAL(restored_out, 0x12345678u);
+  BOOST_CHECK_EQUAL(restored.get_read_count(), memory.get_read_count());
+
+  // A model with a different delay refuses the image and is left alone
+  MemoryModel other(288 * 1024 * 1024, 2, false);
+  other.backdoor_write_word(0x8000, 0xFFFFFFFF);
+  std::istringstream again(saved.str());
+  BOOST_CHECK(!other.restore_state(again));
+  BOOST_CHECK_EQUAL(other.backdoor_read_word(0x8000), 0xFFFFFFFFu);
+  std::istringstream truncated(saved.str().substr(0, 100));
+  BOOST_CHECK(!other.restore_state(truncated));
+}
+
+BOOST_AUTO_TEST_CASE(test_magic_region_write) {
+  MemoryModel memory(288 * 1024 * 1024, 1, false);
+  uint32_t data_out = 0;
+  bool resp = false;
+
+  // Drive a single bus write to the magic result address through the FSM
+  memory.eval(false, true, false, false, 0, 0, data_out, resp);
+  memory.eval(true, true, false, true, MAGIC_RESULT_ADDR, MAGIC_PASS_VALUE,
+              data_out, resp);
+  for (int i = 0; i < 4 && !resp; i++) {
+    memory.eval(false, true, false, true, MAGIC_RESULT_ADDR, MAGIC_PASS_VALUE,
+                data_out, resp);
+    memory.eval(true, true, false, true, MAGIC_RESULT_ADDR, MAGIC_PASS_VALUE,
+                data_out, resp);
+  }
+
+  BOOST_CHECK(resp);
+  BOOST_CHECK_EQUAL(memory.backdoor_read_word(MAGIC_RESULT_ADDR),
+                    MAGIC_PASS_VALUE);
+  BOOST_CHECK_EQUAL(memory.get_write_count(), 1u);
+  BOOST_CHECK_EQUAL(memory.get_resident_pages(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(test_write_watch) {
+  MemoryModel memory(288 * 1024 * 1024, 2, false);
+  std::vector<std::pair<uint32_t, uint32_t>> hits; // (addr, stored word)
+  int id = memory.add_write_watch(0x2000, 8,
+                                  [&](uint32_t addr, uint32_t, uint8_t) {
+                                    // The store is already visible here
+                                    hits.emplace_back(
+                                        addr, memory.backdoor_read_word(addr));
+                                  });
+
+  bus_write(memory, 0x1FFC, 0x11111111);      // Just below the range
+  bus_write(memory, 0x2000, 0x22222222);      // First word
+  bus_write(memory, 0x2004, 0x33333333, 0x8); // Last byte only
+  bus_write(memory, 0x2008, 0x44444444);      // Just above the range
+  memory.backdoor_write_word(0x2000, 0);      // Backdoor never triggers
+
+  BOOST_REQUIRE_EQUAL(hits.size(), 2u);
+  BOOST_CHECK_EQUAL(hits[0].first, 0x2000u);
+  BOOST_CHECK_EQUAL(hits[0].second, 0x22222222u);
+  BOOST_CHECK_EQUAL(hits[1].first, 0x2004u);
+  BOOST_CHECK_EQUAL(hits[1].second, 0x33000000u);
+
+  memory.remove_write_watch(id);
+  bus_write(memory, 0x2000, 0x55555555);
+  BOOST_CHECK_EQUAL(hits.size(), 2u);
+  BOOST_CHECK_EQUAL(memory.backdoor_read_word(0x2000), 0x55555555u);
+}
+
+BOOST_AUTO_TEST_CASE(test_magic_write_watch) {
+  MemoryModel memory(288 * 1024 * 1024, 4, false);
+  uint32_t result = 0;
+  memory.add_write_watch(MAGIC_RESULT_ADDR, 4,
+                         [&](uint32_t, uint32_t data, uint8_t) {
+                           result = data;
+                         });
+
+  bus_write(memory, MAGIC_RESULT_ADDR, MAGIC_FAIL_VALUE);
+  BOOST_CHECK_EQUAL(result, MAGIC_FAIL_VALUE);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,273 @@
+/*
+ * Memory Access Statistics Test Cases
+ *
+ * These tests check the per-page/region counts, reuse distances and
+ * heatmap on a hand-fed access sequence, the MemoryModel hooks (fetch vs
+ * data, byte enables, timing), and then run a byte-wise test/ program on
+ * the core and compare its data traffic with the ISS's.
+ */
+
+#include "../include/memory_stats.h"
+#include "../include/rtl_backdoor.h"
+#include "../include/rv32i_iss.h"
+#include "../include/test_runner.h"
+#include "../include/test_utils.h"
+#include "../memory_model.h"
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+// Drive one complete bus transaction through the FSM (rising edges only):
+// an idle edge, the request until resp, and an idle edge
+void bus_access(MemoryModel &memory, bool write, uint32_t addr,
+                uint8_t byte_enables, bool ifetch = false) {
+  uint32_t data_out = 0;
+  bool resp = false;
+  memory.eval_posedge(true, false, false, 0, 0, data_out, resp);
+  for (int i = 0; i < 16 && !resp; i++) {
+    memory.eval_posedge(true, !write, write, addr, 0x12345678, data_out, resp,
+                        byte_enables, ifetch);
+  }
+  memory.eval_posedge(true, false, false, 0, 0, data_out, resp);
+}
+
+const MemoryRegionStats *find_region(
+    const std::vector<MemoryRegionStats> &regions, const std::string &name) {
+  for (const MemoryRegionStats &region : regions) {
+    if (region.name == name) {
+      return &region;
+    }
+  }
+  return nullptr;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(MemoryStatsTests)
+
+BOOST_AUTO_TEST_CASE(test_memory_stats_counts) {
+  MemoryStats stats(10, 32);
+  stats.add_region("rom", 0x1000, 0x1000);
+
+  // Lines: A = 0x1000, B = 0x2000, C = 0x2040
+  stats.record(0x1000, MemoryStats::FETCH, 0xF); // A cold
+  stats.record(0x1004, MemoryStats::FETCH, 0x1); // A again; enables ignored
+  stats.record(0x2000, MemoryStats::READ, 0x1);  // B cold
+  stats.record(0x2040, MemoryStats::WRITE, 0xF); // C cold
+  stats.record(0x2000, MemoryStats::READ, 0x3);  // B after C
+  stats.record(0x1008, MemoryStats::FETCH, 0xF); // A after B and C
+  stats.advance(25);
+  stats.record(0x1000, MemoryStats::FETCH, 0xF);
+  stats.record(MAGIC_RESULT_ADDR, MemoryStats::WRITE, 0xF);
+
+  const MemoryAccessCounts &totals = stats.get_totals();
+  BOOST_CHECK_EQUAL(totals.fetches, 4u);
+  BOOST_CHECK_EQUAL(totals.reads, 2u);
+  BOOST_CHECK_EQUAL(totals.writes, 2u);
+  BOOST_CHECK_EQUAL(totals.subword_reads, 2u);
+  BOOST_CHECK_EQUAL(totals.subword_writes, 0u);
+  BOOST_CHECK_EQUAL(stats.get_read_enables()[0x1], 1u);
+  BOOST_CHECK_EQUAL(stats.get_read_enables()[0x3], 1u);
+  BOOST_CHECK_EQUAL(stats.get_write_enables()[0xF], 2u);
+
+  std::vector<MemoryRegionStats> regions = stats.get_regions();
+  BOOST_REQUIRE_EQUAL(regions.size(), 2u);
+  BOOST_CHECK_EQUAL(regions[0].name, "rom");
+  BOOST_CHECK_EQUAL(regions[0].counts.fetches, 4u);
+  BOOST_CHECK_EQUAL(regions[0].counts.accesses(), 4u);
+  BOOST_CHECK_EQUAL(regions[1].name, "other");
+  BOOST_CHECK_EQUAL(regions[1].counts.reads, 2u);
+  BOOST_CHECK_EQUAL(regions[1].counts.writes, 2u);
+
+  BOOST_REQUIRE_EQUAL(stats.get_pages().size(), 3u);
+  BOOST_CHECK_EQUAL(stats.get_pages().at(0x1000).fetches, 4u);
+  BOOST_CHECK_EQUAL(stats.get_pages().at(0x2000).accesses(), 3u);
+  BOOST_CHECK_EQUAL(stats.get_pages().at(MAGIC_RESULT_ADDR).writes, 1u);
+
+  // Separate streams see only their own lines
+  const MemoryReuseHistogram &fetch =
+      stats.get_reuse(MemoryStats::STREAM_FETCH);
+  BOOST_CHECK_EQUAL(fetch.cold, 1u);
+  BOOST_CHECK_EQUAL(fetch.buckets[0], 3u);
+  BOOST_CHECK_EQUAL(fetch.hits(0), 3u);
+  const MemoryReuseHistogram &data = stats.get_reuse(MemoryStats::STREAM_DATA);
+  BOOST_CHECK_EQUAL(data.cold, 3u);
+  BOOST_CHECK_EQUAL(data.buckets[1], 1u);
+  const MemoryReuseHistogram &all = stats.get_reuse(MemoryStats::STREAM_ALL);
+  BOOST_CHECK_EQUAL(all.cold, 4u);
+  BOOST_CHECK_EQUAL(all.buckets[0], 2u);
+  BOOST_CHECK_EQUAL(all.buckets[1], 1u);
+  BOOST_CHECK_EQUAL(all.buckets[2], 1u); // Two lines between
+  BOOST_CHECK_EQUAL(all.accesses(), 8u);
+  BOOST_CHECK_EQUAL(all.hits(1), 3u); // A two-line cache
+  BOOST_CHECK_EQUAL(all.hits(2), 4u);
+
+  // Windows 0 and 2 were used; window 1 passed without an access
+  BOOST_CHECK_EQUAL(stats.get_cycles(), 25u);
+  BOOST_CHECK_EQUAL(stats.get_window_count(), 3u);
+  BOOST_CHECK_EQUAL(stats.get_window_accesses(0, 0x1000), 3u);
+  BOOST_CHECK_EQUAL(stats.get_window_accesses(0, 0x2000), 3u);
+  BOOST_CHECK_EQUAL(stats.get_window_accesses(1, 0x1000), 0u);
+  BOOST_CHECK_EQUAL(stats.get_window_accesses(2, 0x1000), 1u);
+
+  std::string table = stats.format_table();
+  BOOST_CHECK_NE(table.find("rom"), std::string::npos);
+  BOOST_CHECK_NE(table.find("data reads:  byte 1, half 1, word 0"),
+                 std::string::npos);
+  BOOST_CHECK_NE(table.find("3 pages touched, 3 windows of 10 cycles"),
+                 std::string::npos);
+  std::string json = stats.format_json();
+  BOOST_CHECK_NE(json.find("{\"page\": \"0x00001000\", \"fetches\": 4"),
+                 std::string::npos);
+  BOOST_CHECK_NE(json.find("\"heatmap\": [3, 0, 1]"), std::string::npos);
+  BOOST_CHECK_NE(json.find("\"read_byte_enables\": {\"0x1\": 1, \"0x3\": 1}"),
+                 std::string::npos);
+
+  // Replayed cycles neither advance time nor count
+  stats.ignore_cycles(5);
+  stats.advance(3);
+  stats.record(0x1000, MemoryStats::FETCH, 0xF);
+  stats.advance(4);
+  BOOST_CHECK_EQUAL(stats.get_cycles(), 27u);
+  BOOST_CHECK_EQUAL(stats.get_totals().fetches, 4u);
+
+  stats.reset();
+  BOOST_CHECK_EQUAL(stats.get_cycles(), 0u);
+  BOOST_CHECK_EQUAL(stats.get_totals().accesses(), 0u);
+  BOOST_CHECK(stats.get_pages().empty());
+  BOOST_CHECK_EQUAL(stats.get_region_count(), 1u);
+  BOOST_CHECK_EQUAL(stats.get_regions()[0].counts.accesses(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_memory_stats_reuse_distance) {
+  // Cycling over more lines than the tracker's initial capacity renumbers
+  // its timestamps; every repeat is still 2999 lines away
+  MemoryStats stats(1000, 64);
+  BOOST_CHECK_EQUAL(stats.get_line_bytes(), 64u);
+  for (int pass = 0; pass < 3; pass++) {
+    for (uint32_t line = 0; line < 3000; line++) {
+      stats.record(0x10000 + line * 64 + (pass * 4), MemoryStats::READ, 0xF);
+    }
+  }
+  const MemoryReuseHistogram &data = stats.get_reuse(MemoryStats::STREAM_DATA);
+  BOOST_CHECK_EQUAL(data.cold, 3000u);
+  BOOST_CHECK_EQUAL(data.buckets[12], 6000u); // [2048, 4096)
+  BOOST_CHECK_EQUAL(data.hits(11), 0u);       // LRU thrashes below 3000 lines
+  BOOST_CHECK_EQUAL(data.hits(12), 6000u);
+  BOOST_CHECK_EQUAL(MemoryStats(1, 48).get_line_bytes(), 32u);
+}
+
+BOOST_AUTO_TEST_CASE(test_memory_model_access_stats) {
+  MemoryModel memory(1024 * 1024, 2, false);
+  BOOST_CHECK(memory.get_access_stats() == nullptr);
+  memory.enable_access_stats(4, 32);
+  const MemoryStats *stats = memory.get_access_stats();
+  BOOST_REQUIRE(stats != nullptr);
+
+  bus_access(memory, false, 0x1000, 0xF, true); // Instruction fetch
+  bus_access(memory, false, 0x2000, 0x4);       // lbu
+  bus_access(memory, true, 0x2000, 0x3);        // sh
+  BOOST_CHECK_EQUAL(memory.bus_read_word(0x2004, 0xC), 0u); // ISS lh
+  memory.bus_write_word(0x2008, 0, 0xF);                    // ISS sw
+  BOOST_CHECK_EQUAL(memory.bus_read_word(0xF0000000), 0xDEADBEEFu);
+
+  BOOST_CHECK_EQUAL(stats->get_totals().fetches, 1u);
+  BOOST_CHECK_EQUAL(stats->get_totals().reads, 2u);
+  BOOST_CHECK_EQUAL(stats->get_totals().writes, 2u);
+  BOOST_CHECK_EQUAL(stats->get_totals().subword_reads, 2u);
+  BOOST_CHECK_EQUAL(stats->get_totals().subword_writes, 1u);
+  BOOST_CHECK_EQUAL(stats->get_totals().fetches + stats->get_totals().reads,
+                    memory.get_read_count());
+  BOOST_CHECK_EQUAL(stats->get_totals().writes, memory.get_write_count());
+  // Five rising edges per transaction with a delay of 2, completing on the
+  // fourth; the untimed accesses fall in the window of the last edge
+  BOOST_CHECK_EQUAL(stats->get_cycles(), 15u);
+  BOOST_CHECK_EQUAL(stats->get_window_count(), 4u);
+  BOOST_CHECK_EQUAL(stats->get_window_accesses(0, 0x1000), 1u);
+  BOOST_CHECK_EQUAL(stats->get_window_accesses(1, 0x2000), 0u);
+  BOOST_CHECK_EQUAL(stats->get_window_accesses(2, 0x2000), 1u);
+  BOOST_CHECK_EQUAL(stats->get_window_accesses(3, 0x2000), 3u);
+
+  memory.reset_statistics();
+  BOOST_CHECK_EQUAL(stats->get_totals().accesses(), 0u);
+  BOOST_CHECK_EQUAL(stats->get_cycles(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_memory_stats_program) {
+  const std::string json_path = "/tmp/riscv_memory_stats_strlen.json";
+  TestRunnerConfig config;
+  config.memory_debug = false;
+  config.log_level = LogLevel::WARN;
+  config.memory_stats_window = 100;
+  config.memory_stats_file = json_path;
+  TestRunner runner("strlen_memory_stats", config);
+  BOOST_REQUIRE(runner.load_program(get_test_program_path("strlen")));
+  BOOST_REQUIRE_EQUAL(runner.run(1000000), TestResult::PASS);
+  const MemoryStats *stats = runner.get_memory_stats();
+  BOOST_REQUIRE(stats != nullptr);
+
+  // Every cycle and bus transaction of the run, stalls fast-forwarded or not
+  const MemoryAccessCounts &totals = stats->get_totals();
+  BOOST_CHECK_EQUAL(stats->get_cycles(), runner.get_cycle_count());
+  BOOST_CHECK_EQUAL(totals.fetches + totals.reads,
+                    runner.get_memory().get_read_count());
+  BOOST_CHECK_EQUAL(totals.writes, runner.get_memory().get_write_count());
+  if (rtl_backdoor::available()) {
+    // One fetch per instruction; the last fetch may still be in flight
+    const uint64_t instret = rtl_backdoor::get_instret(runner.get_dut());
+    BOOST_CHECK_GE(totals.fetches, instret);
+    BOOST_CHECK_LE(totals.fetches, instret + 1);
+  }
+  BOOST_CHECK_GT(totals.subword_reads, 0u); // Byte-wise string scan
+
+  // Code is fetched from the image; the result goes to the magic region
+  std::vector<MemoryRegionStats> regions = stats->get_regions();
+  const MemoryRegionStats *image = find_region(regions, "image");
+  const MemoryRegionStats *magic = find_region(regions, "magic");
+  BOOST_REQUIRE(image && magic);
+  BOOST_CHECK_EQUAL(image->start, RESET_PC);
+  BOOST_CHECK_EQUAL(image->counts.fetches, totals.fetches);
+  BOOST_CHECK_EQUAL(magic->counts.writes, 1u);
+
+  // The heatmap adds up to the totals
+  uint64_t heat = 0;
+  for (size_t w = 0; w < stats->get_window_count(); w++) {
+    for (const auto &page : stats->get_pages()) {
+      heat += stats->get_window_accesses(w, page.first);
+    }
+  }
+  BOOST_CHECK_EQUAL(heat, totals.accesses());
+  BOOST_CHECK_EQUAL(stats->get_window_count(),
+                    (runner.get_cycle_count() + 99) / 100);
+
+  std::ifstream file(json_path);
+  std::stringstream text;
+  text << file.rdbuf();
+  BOOST_CHECK_EQUAL(text.str(), stats->format_json());
+  std::remove(json_path.c_str());
+
+  // Same data traffic, lane for lane, as the ISS (which fetches through
+  // the backdoor, so no fetches there)
+  MemoryModel memory(config.memory_size, config.memory_delay, false);
+  memory.enable_access_stats();
+  IssConfig iss_config;
+  iss_config.log_level = LogLevel::WARN;
+  Rv32iIss iss(memory, iss_config);
+  BOOST_REQUIRE(iss.load_program(get_test_program_path("strlen")));
+  BOOST_REQUIRE_EQUAL(iss.run(1000000), TestResult::PASS);
+  const MemoryStats *reference = memory.get_access_stats();
+  BOOST_CHECK_EQUAL(reference->get_totals().fetches, 0u);
+  BOOST_CHECK_EQUAL(reference->get_totals().reads, totals.reads);
+  BOOST_CHECK_EQUAL(reference->get_totals().writes, totals.writes);
+  for (uint32_t be = 0; be < 16; be++) {
+    BOOST_CHECK_EQUAL(reference->get_read_enables()[be],
+                      stats->get_read_enables()[be]);
+    BOOST_CHECK_EQUAL(reference->get_write_enables()[be],
+                      stats->get_write_enables()[be]);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,7 +2,8 @@
  * CSR Register File Module-Level Tests
  *
  * Unit tests for the CSR register file module.
- * Tests counter increments, address decoding, and invalid address handling.
+ * Tests counter increments, address decoding, invalid address handling and
+ * the performance counters.
  */
 
 #include "Vcsr_file.h"
@@ -18,6 +19,12 @@ constexpr uint16_t CSR_CYCLEH = 0xC80;
 constexpr uint16_t CSR_TIMEH = 0xC81;
 constexpr uint16_t CSR_INSTRETH = 0xC82;
 constexpr uint16_t CSR_INVALID = 0x123; // Invalid address for testing
+constexpr uint16_t CSR_MCOUNTINHIBIT = 0x320;
+constexpr uint16_t CSR_MHPMEVENT3 = 0x323;
+constexpr uint16_t CSR_MHPMCOUNTER3 = 0xB03;
+constexpr uint16_t CSR_MHPMCOUNTER3H = 0xB83;
+constexpr uint16_t CSR_HPMCOUNTER3 = 0xC03;
+constexpr uint16_t CSR_HPMCOUNTER3H = 0xC83;
 
 BOOST_AUTO_TEST_SUITE(csr_file_tests)
 
@@ -655,4 +662,120 @@ BOOST_AUTO_TEST_CASE(test_mixed_csr_access) {
   delete dut;
 }
 
+/**
+ * Test: Performance counters
+ * mhpmcounter3 counts the hpm_events bit mhpmevent3 selects, stops under
+ * mcountinhibit and loses an increment to a CSR write in the same cycle
+ */
+BOOST_AUTO_TEST_CASE(test_hpm_counters) {
+  Vcsr_file *dut = new Vcsr_file();
+
+  // Initialize
+  dut->rst_n = 0;
+  dut->csr_addr = CSR_CYCLE;
+  dut->csr_we = 0;
+  dut->csr_wdata = 0;
+  dut->instret_inc = 0;
+  dut->hpm_events = 0;
+  tick(dut);
+
+  dut->rst_n = 1;
+  tick(dut);
+
+  // Count event 2 (load wait)
+  dut->csr_addr = CSR_MHPMEVENT3;
+  dut->csr_we = 1;
+  dut->csr_wdata = 2;
+  tick(dut);
+  dut->csr_we = 0;
+  BOOST_CHECK_EQUAL(dut->csr_rdata, 2);
+  BOOST_CHECK_EQUAL(dut->csr_valid, 1);
+
+  for (int i = 0; i < 5; i++) {
+    dut->hpm_events = 1 << 2;
+    tick(dut);
+  }
+  for (int i = 0; i < 3; i++) {
+    dut->hpm_events = (1 << 3) | (1 << 1); // Other events
+    tick(dut);
+  }
+
+  dut->csr_addr = CSR_MHPMCOUNTER3;
+  dut->eval();
+  BOOST_CHECK_EQUAL(dut->csr_rdata, 5);
+  dut->csr_addr = CSR_HPMCOUNTER3;
+  dut->eval();
+  BOOST_CHECK_EQUAL(dut->csr_rdata, 5);
+  BOOST_CHECK_EQUAL(dut->csr_valid, 1);
+
+  // Inhibited; bits 0-2 are read-only zero
+  dut->hpm_events = 0;
+  dut->csr_addr = CSR_MCOUNTINHIBIT;
+  dut->csr_we = 1;
+  dut->csr_wdata = 0xF;
+  tick(dut);
+  dut->csr_we = 0;
+  BOOST_CHECK_EQUAL(dut->csr_rdata, 0x8);
+  for (int i = 0; i < 3; i++) {
+    dut->hpm_events = 1 << 2;
+    tick(dut);
+  }
+  dut->csr_addr = CSR_HPMCOUNTER3;
+  dut->eval();
+  BOOST_CHECK_EQUAL(dut->csr_rdata, 5);
+
+  // Running again; the write wins over the event in its cycle
+  dut->hpm_events = 0;
+  dut->csr_addr = CSR_MCOUNTINHIBIT;
+  dut->csr_we = 1;
+  dut->csr_wdata = 0;
+  tick(dut);
+  dut->hpm_events = 1 << 2;
+  dut->csr_addr = CSR_MHPMCOUNTER3;
+  dut->csr_wdata = 100;
+  tick(dut);
+  dut->csr_we = 0;
+  dut->eval();
+  BOOST_CHECK_EQUAL(dut->csr_rdata, 100);
+  tick(dut);
+  BOOST_CHECK_EQUAL(dut->csr_rdata, 101);
+
+  // High half
+  dut->hpm_events = 0;
+  dut->csr_addr = CSR_MHPMCOUNTER3H;
+  dut->csr_we = 1;
+  dut->csr_wdata = 1;
+  tick(dut);
+  dut->csr_we = 0;
+  dut->csr_addr = CSR_HPMCOUNTER3H;
+  dut->eval();
+  BOOST_CHECK_EQUAL(dut->csr_rdata, 1);
+  dut->csr_addr = CSR_HPMCOUNTER3;
+  dut->eval();
+  BOOST_CHECK_EQUAL(dut->csr_rdata, 101);
+
+  // Counters past HPM_COUNTERS (4) decode and read zero
+  dut->csr_addr = 0xB07;
+  dut->csr_we = 1;
+  dut->csr_wdata = 0x1234;
+  tick(dut);
+  dut->csr_we = 0;
+  dut->eval();
+  BOOST_CHECK_EQUAL(dut->csr_valid, 1);
+  BOOST_CHECK_EQUAL(dut->csr_rdata, 0);
+  dut->csr_addr = 0x33F; // mhpmevent31
+  dut->eval();
+  BOOST_CHECK_EQUAL(dut->csr_valid, 1);
+
+  // Counters 0-2 of the block are not performance counters
+  dut->csr_addr = 0xB01;
+  dut->eval();
+  BOOST_CHECK_EQUAL(dut->csr_valid, 0);
+  dut->csr_addr = 0x321;
+  dut->eval();
+  BOOST_CHECK_EQUAL(dut->csr_valid, 0);
+
+  delete dut;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,125 @@
+/*
+ * Parallel Runner Test Cases
+ *
+ * These tests run several TestRunners at once on worker threads and check
+ * that every job behaves exactly as it does when run alone, and that clones
+ * forked from a warm runner finish exactly like a runner that changed the
+ * same knob in-process.
+ */
+
+#include "../include/parallel_runner.h"
+#include "../include/test_utils.h"
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+SimJob make_job(const std::string &program, uint32_t memory_delay = 4) {
+  SimJob job;
+  job.name = program + "_delay" + std::to_string(memory_delay);
+  job.program = get_test_program_path(program);
+  job.config.memory_delay = memory_delay;
+  job.config.memory_debug = false;
+  job.max_cycles = 100000;
+  return job;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(ParallelRunnerTests)
+
+BOOST_AUTO_TEST_CASE(test_parallel_matches_serial) {
+  std::vector<SimJob> jobs = {make_job("add"), make_job("subtract"),
+                              make_job("gcd"), make_job("fibonacci"),
+                              make_job("memcpy"), make_job("bitops")};
+
+  std::vector<SimJobResult> parallel = run_parallel(jobs, 4);
+  BOOST_REQUIRE_EQUAL(parallel.size(), jobs.size());
+
+  for (size_t i = 0; i < jobs.size(); i++) {
+    SimJobResult serial = run_job(jobs[i]);
+    BOOST_TEST_CONTEXT("job " << jobs[i].name) {
+      BOOST_CHECK_EQUAL(parallel[i].name, jobs[i].name);
+      BOOST_CHECK_EQUAL(parallel[i].result, TestResult::PASS);
+      BOOST_CHECK_EQUAL(parallel[i].result, serial.result);
+      BOOST_CHECK_EQUAL(parallel[i].cycles, serial.cycles);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_memory_delay_sweep) {
+  std::vector<SimJob> jobs = {make_job("gcd", 1), make_job("gcd", 2),
+                              make_job("gcd", 4), make_job("gcd", 8)};
+
+  std::vector<SimJobResult> results = run_parallel(jobs);
+  BOOST_REQUIRE_EQUAL(results.size(), jobs.size());
+
+  for (size_t i = 0; i < results.size(); i++) {
+    BOOST_CHECK_EQUAL(results[i].result, TestResult::PASS);
+    if (i > 0) {
+      // Slower memory must cost cycles on every fetch
+      BOOST_CHECK_GT(results[i].cycles, results[i - 1].cycles);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_missing_program) {
+  SimJob job = make_job("add");
+  job.program = "/nonexistent/program.elf";
+
+  std::vector<SimJobResult> results = run_parallel({job, make_job("add")}, 2);
+  BOOST_REQUIRE_EQUAL(results.size(), 2u);
+  BOOST_CHECK_EQUAL(results[0].result, TestResult::ERROR);
+  BOOST_CHECK_EQUAL(results[0].cycles, 0u);
+  BOOST_CHECK_EQUAL(results[1].result, TestResult::PASS);
+}
+
+BOOST_AUTO_TEST_CASE(test_fork_clones_latency_sweep) {
+  TestRunnerConfig config;
+  config.memory_debug = false;
+  const uint64_t prefix = 1000;
+  const std::vector<uint32_t> delays = {1, 4, 9};
+
+  TestRunner warm("gcd_warm", config);
+  BOOST_REQUIRE(warm.load_program(get_test_program_path("gcd")));
+  BOOST_REQUIRE_EQUAL(warm.run(prefix), TestResult::TIMEOUT);
+  const uint32_t warm_pc = warm.get_pc();
+
+  std::vector<CloneResult> clones = warm.fork_clones(
+      delays.size() + 1,
+      [&delays](TestRunner &clone, unsigned index, std::string &output) {
+        if (index == delays.size()) {
+          _exit(3); // A clone that dies without reporting
+        }
+        clone.set_memory_delay(delays[index]);
+        TestResult result = clone.run(1000000);
+        output = std::to_string(clone.get_memory().get_read_count());
+        return result;
+      },
+      2);
+  BOOST_REQUIRE_EQUAL(clones.size(), delays.size() + 1);
+
+  // The parent is untouched and each clone matches an in-process switch
+  BOOST_CHECK_EQUAL(warm.get_pc(), warm_pc);
+  for (size_t i = 0; i < delays.size(); i++) {
+    TestRunner serial("gcd_serial", config);
+    BOOST_REQUIRE(serial.load_program(get_test_program_path("gcd")));
+    BOOST_REQUIRE_EQUAL(serial.run(prefix), TestResult::TIMEOUT);
+    serial.set_memory_delay(delays[i]);
+    TestResult expected = serial.run(1000000);
+    BOOST_TEST_CONTEXT("delay " << delays[i]) {
+      BOOST_CHECK_EQUAL(clones[i].result, TestResult::PASS);
+      BOOST_CHECK_EQUAL(clones[i].result, expected);
+      BOOST_CHECK_EQUAL(clones[i].cycles, serial.get_cycle_count());
+      BOOST_CHECK_EQUAL(
+          clones[i].output,
+          std::to_string(serial.get_memory().get_read_count()));
+    }
+  }
+  BOOST_CHECK_GT(clones[2].cycles, clones[0].cycles);
+  BOOST_CHECK_EQUAL(clones.back().result, TestResult::ERROR);
+  BOOST_CHECK_EQUAL(clones.back().output,
+                    "clone exited with status 3 without a result");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
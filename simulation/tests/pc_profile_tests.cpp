@@ -0,0 +1,221 @@
+/*
+ * PC Profile Test Cases
+ *
+ * These tests check symbol lookup, call stack reconstruction and the
+ * folded/table output on a hand-fed run, sampling at an interval, and
+ * then profile a recursive test/ program on the core.
+ */
+
+#include "../include/pc_profile.h"
+#include "../include/rtl_backdoor.h"
+#include "../include/test_runner.h"
+#include "../include/test_utils.h"
+#include <algorithm>
+#include <boost/test/unit_test.hpp>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr uint32_t JAL_RA = 0x000000EF;  // jal ra, <offset>
+constexpr uint32_t RET = 0x00008067;     // jalr x0, 0(ra)
+constexpr uint32_t ADDI = 0x00A00093;    // addi x1, x0, 10
+constexpr uint32_t ECALL = 0x00000073;
+constexpr uint32_t MRET = 0x30200073;
+
+ElfSymbol make_symbol(uint32_t value, uint32_t size, uint8_t type) {
+  ElfSymbol symbol;
+  symbol.value = value;
+  symbol.size = size;
+  symbol.type = type;
+  return symbol;
+}
+
+const PcProfileFunction *find_function(
+    const std::vector<PcProfileFunction> &table, const std::string &name) {
+  for (const PcProfileFunction &function : table) {
+    if (function.name == name) {
+      return &function;
+    }
+  }
+  return nullptr;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(PcProfileTests)
+
+BOOST_AUTO_TEST_CASE(test_pc_profile_stacks) {
+  std::map<std::string, ElfSymbol> symbols;
+  symbols["__start"] = make_symbol(0x1000, 0, 0);
+  symbols["LOOP"] = make_symbol(0x1008, 0, 0);
+  symbols["helper"] = make_symbol(0x100C, 0x20, 2);
+  symbols["inner"] = make_symbol(0x1014, 0, 0); // Label inside helper
+  symbols["main"] = make_symbol(0x1040, 0x40, 2);
+  symbols["buffer"] = make_symbol(0x2000, 64, 1); // Data
+
+  PcProfile profile;
+  profile.set_symbols(symbols);
+  BOOST_CHECK_EQUAL(profile.function_name(0x1004), "__start");
+  BOOST_CHECK_EQUAL(profile.function_name(0x1008), "LOOP");
+  BOOST_CHECK_EQUAL(profile.function_name(0x1018), "helper");
+  BOOST_CHECK_EQUAL(profile.function_name(0x1030), "[unknown]"); // Gap
+  BOOST_CHECK_EQUAL(profile.function_name(0x107C), "main");
+  BOOST_CHECK_EQUAL(profile.function_name(0x2000), "[unknown]");
+  BOOST_CHECK_EQUAL(profile.function_name(0x0FFC), "[unknown]");
+
+  profile.sample(0x1000, 0, 5);
+  profile.retire(0x1004, JAL_RA, 0x1040); // __start calls main
+  profile.sample(0x1040, 5, 15);
+  profile.retire(0x1044, JAL_RA, 0x100C); // main calls helper
+  profile.sample(0x1018, 15, 35);
+  profile.retire(0x1028, RET, 0x1048);
+  profile.sample(0x1048, 35, 40);
+  profile.retire(0x104C, ECALL, 0x100C); // Trap into helper
+  BOOST_CHECK_EQUAL(profile.get_depth(), 2u);
+  profile.sample(0x100C, 40, 42);
+  profile.retire(0x1010, MRET, 0x1050);
+  profile.retire(0x1050, RET, 0x1008); // main returns to LOOP
+  profile.sample(0x1008, 42, 50);
+  BOOST_CHECK_EQUAL(profile.get_depth(), 0u);
+
+  BOOST_CHECK_EQUAL(profile.get_samples(), 50u);
+  BOOST_CHECK_EQUAL(profile.get_cycles(), 50u);
+  BOOST_CHECK_EQUAL(profile.get_instructions(), 6u);
+  BOOST_CHECK_EQUAL(profile.format_folded(), "LOOP 8\n"
+                                             "__start 5\n"
+                                             "__start;main 15\n"
+                                             "__start;main;helper 22\n");
+
+  std::vector<PcProfileFunction> table = profile.get_functions();
+  BOOST_REQUIRE_EQUAL(table.size(), 4u);
+  BOOST_CHECK_EQUAL(table[0].name, "helper"); // Most self cycles first
+  BOOST_CHECK_EQUAL(table[0].self_cycles, 22u);
+  BOOST_CHECK_EQUAL(table[0].instructions, 2u);
+  BOOST_CHECK_EQUAL(table[0].calls, 2u);
+  const PcProfileFunction *main_function = find_function(table, "main");
+  BOOST_REQUIRE(main_function != nullptr);
+  BOOST_CHECK_EQUAL(main_function->self_cycles, 15u);
+  BOOST_CHECK_EQUAL(main_function->total_cycles, 37u);
+  BOOST_CHECK_EQUAL(main_function->instructions, 3u);
+  BOOST_CHECK_EQUAL(main_function->calls, 1u);
+  const PcProfileFunction *start = find_function(table, "__start");
+  BOOST_REQUIRE(start != nullptr);
+  BOOST_CHECK_EQUAL(start->total_cycles, 42u);
+
+  std::string text = profile.format_table();
+  BOOST_CHECK_NE(text.find("helper"), std::string::npos);
+  BOOST_CHECK_NE(text.find("11.00"), std::string::npos); // helper's CPI
+  BOOST_CHECK_NE(text.find("50 samples, one every 1 cycles"),
+                 std::string::npos);
+
+  profile.reset();
+  BOOST_CHECK_EQUAL(profile.get_samples(), 0u);
+  BOOST_CHECK_EQUAL(profile.get_instructions(), 0u);
+  BOOST_CHECK(profile.format_folded().empty());
+  BOOST_CHECK_EQUAL(profile.function_name(0x1040), "main");
+}
+
+BOOST_AUTO_TEST_CASE(test_pc_profile_interval_and_depth) {
+  PcProfile profile(10);
+  profile.sample(0x1000, 0, 25); // Cycles 0, 10 and 20
+  profile.sample(0x1000, 25, 30);
+  profile.sample(0x1000, 30, 31);
+  BOOST_CHECK_EQUAL(profile.get_samples(), 4u);
+  BOOST_CHECK_EQUAL(profile.get_cycles(), 40u);
+  BOOST_CHECK_EQUAL(profile.format_folded(), "[unknown] 40\n");
+
+  // Unbounded recursion keeps at most MAX_DEPTH frames but still balances
+  const uint32_t calls = PcProfile::MAX_DEPTH + 10;
+  for (uint32_t i = 0; i < calls; i++) {
+    profile.retire(0x1000, JAL_RA, 0x1000);
+  }
+  BOOST_CHECK_EQUAL(profile.get_depth(), calls);
+  profile.sample(0x1000, 40, 41);
+  std::string folded = profile.format_folded();
+  BOOST_CHECK_EQUAL(std::count(folded.begin(), folded.end(), ';'),
+                    static_cast<std::ptrdiff_t>(PcProfile::MAX_DEPTH));
+  for (uint32_t i = 0; i < calls; i++) {
+    profile.retire(0x1000, RET, 0x1000);
+  }
+  BOOST_CHECK_EQUAL(profile.get_depth(), 0u);
+  profile.retire(0x1000, RET, 0x1000); // Unmatched return is ignored
+  profile.retire(0x1000, ADDI, 0x1004);
+  BOOST_CHECK_EQUAL(profile.get_depth(), 0u);
+  BOOST_CHECK_EQUAL(profile.get_instructions(), 2 * calls + 2);
+}
+
+BOOST_AUTO_TEST_CASE(test_pc_profile_program) {
+  const std::string folded_path = "/tmp/riscv_pc_profile_factorial.folded";
+  TestRunnerConfig config;
+  config.memory_debug = false;
+  config.log_level = LogLevel::WARN;
+  config.pc_profile_file = folded_path;
+  TestRunner runner("factorial_pc_profile", config);
+  BOOST_REQUIRE(runner.load_program(get_test_program_path("factorial")));
+  BOOST_REQUIRE_EQUAL(runner.run(1000000), TestResult::PASS);
+  const PcProfile *profile = runner.get_pc_profile();
+  BOOST_REQUIRE(profile != nullptr);
+
+  // Every cycle sampled, every instruction attributed
+  BOOST_CHECK_EQUAL(profile->get_cycles(), runner.get_cycle_count());
+  if (rtl_backdoor::available()) {
+    BOOST_CHECK_EQUAL(profile->get_instructions(),
+                      rtl_backdoor::get_instret(runner.get_dut()));
+  }
+  BOOST_CHECK_GT(profile->get_instructions(), 0u);
+  // The result is written from main
+  BOOST_CHECK_EQUAL(profile->get_depth(), 1u);
+
+  std::ifstream file(folded_path);
+  std::stringstream text;
+  text << file.rdbuf();
+  BOOST_CHECK_EQUAL(text.str(), profile->format_folded());
+  std::remove(folded_path.c_str());
+
+  // Recursion shows as nested frames; every stack starts at __start
+  const std::string recursion = "__start;main;factorial;factorial;";
+  std::istringstream lines(text.str());
+  std::string line;
+  bool recursed = false;
+  while (std::getline(lines, line)) {
+    BOOST_CHECK_MESSAGE(line.compare(0, 7, "__start") == 0, line);
+    recursed = recursed ||
+               line.compare(0, recursion.size(), recursion) == 0;
+  }
+  BOOST_CHECK(recursed);
+
+  std::vector<PcProfileFunction> table = profile->get_functions();
+  const PcProfileFunction *main_function = find_function(table, "main");
+  const PcProfileFunction *factorial = find_function(table, "factorial");
+  const PcProfileFunction *multiply = find_function(table, "multiply");
+  const PcProfileFunction *start = find_function(table, "__start");
+  BOOST_REQUIRE(main_function && factorial && multiply && start);
+  BOOST_CHECK_EQUAL(main_function->calls, 1u);
+  // Everything after the call to main is below it
+  BOOST_CHECK_EQUAL(main_function->total_cycles,
+                    runner.get_cycle_count() - start->self_cycles);
+  BOOST_CHECK_GT(factorial->calls, 5u); // Five calls from main, recursing
+  BOOST_CHECK_GT(multiply->calls, 0u);
+  BOOST_CHECK_GT(multiply->self_cycles, 0u);
+  BOOST_CHECK(find_function(table, "[unknown]") == nullptr);
+
+  // Sampled every 7 cycles: same run, a seventh of the samples
+  TestRunnerConfig sparse = config;
+  sparse.pc_profile_file.clear();
+  sparse.pc_profile = true;
+  sparse.pc_profile_interval = 7;
+  TestRunner sampled("factorial_pc_profile_sparse", sparse);
+  BOOST_REQUIRE(sampled.load_program(get_test_program_path("factorial")));
+  BOOST_REQUIRE_EQUAL(sampled.run(1000000), TestResult::PASS);
+  BOOST_REQUIRE(sampled.get_pc_profile() != nullptr);
+  BOOST_CHECK_EQUAL(sampled.get_pc_profile()->get_samples(),
+                    (sampled.get_cycle_count() + 6) / 7);
+  BOOST_CHECK_EQUAL(sampled.get_pc_profile()->get_instructions(),
+                    profile->get_instructions());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
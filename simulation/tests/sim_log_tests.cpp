@@ -0,0 +1,65 @@
+/*
+ * Logging Test Cases
+ *
+ * These tests check that SIM_LOG skips formatting for disabled levels and
+ * that LogSink buffers output until it is flushed.
+ */
+
+#include "../include/sim_log.h"
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+
+namespace {
+int formatted = 0;
+
+// Stream argument with a visible side effect
+int count_format() { return ++formatted; }
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(SimLogTests)
+
+BOOST_AUTO_TEST_CASE(test_disabled_levels_not_formatted) {
+  std::ostringstream out;
+  std::ostringstream err;
+  LogSink log(LogLevel::INFO, out, err);
+  formatted = 0;
+
+  SIM_LOG(log, LogLevel::DEBUG, "MEM", "value " << count_format());
+  SIM_LOG(log, LogLevel::TRACE, "MEM", "value " << count_format());
+  BOOST_CHECK_EQUAL(formatted, 0);
+
+  SIM_LOG(log, LogLevel::INFO, "MEM", "value " << count_format());
+  BOOST_CHECK_EQUAL(formatted, 1);
+
+  log.set_level(LogLevel::OFF);
+  SIM_LOG(log, LogLevel::ERROR, "MEM", "value " << count_format());
+  BOOST_CHECK_EQUAL(formatted, 1);
+
+  log.flush();
+  BOOST_CHECK_EQUAL(out.str(), "[MEM] value 1\n");
+  BOOST_CHECK(err.str().empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_buffering_and_flush) {
+  std::ostringstream out;
+  std::ostringstream err;
+  LogSink log(LogLevel::TRACE, out, err);
+
+  SIM_LOG(log, LogLevel::INFO, "TEST", "first");
+  SIM_LOG(log, LogLevel::DEBUG, "TEST", "second " << 2);
+  BOOST_CHECK(out.str().empty()); // Still buffered
+
+  // Warnings flush everything before them
+  SIM_LOG(log, LogLevel::WARN, "TEST", "warning");
+  BOOST_CHECK_EQUAL(out.str(), "[TEST] first\n[TEST] second 2\n"
+                               "[TEST] warning\n");
+
+  // Errors flush pending output, then go to the error stream
+  SIM_LOG(log, LogLevel::INFO, "TEST", "third");
+  SIM_LOG(log, LogLevel::ERROR, "ERROR", "failed");
+  BOOST_CHECK_EQUAL(out.str(), "[TEST] first\n[TEST] second 2\n"
+                               "[TEST] warning\n[TEST] third\n");
+  BOOST_CHECK_EQUAL(err.str(), "[ERROR] failed\n");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,167 @@
+/*
+ * Sampled Simulation Test Cases
+ *
+ * These tests check basic-block vector collection and clustering on
+ * synthetic input, that the RTL retire hook yields the same vectors as the
+ * ISS profile, and that a sampled run of a test/ program estimates the CPI
+ * of a full RTL run.
+ */
+
+#include "../include/rtl_backdoor.h"
+#include "../include/simpoint.h"
+#include "../include/test_runner.h"
+#include "../include/test_utils.h"
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <vector>
+
+namespace {
+SimPointConfig simpoint_config() {
+  SimPointConfig config;
+  config.interval = 200;
+  config.warmup = 50;
+  config.max_k = 4;
+  config.runner.memory_debug = false;
+  config.runner.log_level = LogLevel::WARN;
+  return config;
+}
+
+// Loop of `length` straight-line instructions at `pc`, run `count` times
+void retire_loop(BbvCollector &collector, uint32_t pc, uint32_t length,
+                 uint32_t count, uint64_t &cycles) {
+  for (uint32_t n = 0; n < count; n++) {
+    for (uint32_t i = 0; i < length; i++) {
+      uint32_t insn_pc = pc + 4 * i;
+      cycles += 10;
+      collector.retire(insn_pc, (i + 1 == length) ? pc : insn_pc + 4, cycles);
+    }
+  }
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(SimPointTests)
+
+BOOST_AUTO_TEST_CASE(test_bbv_collector) {
+  BbvCollector collector(10, 100);
+  uint64_t cycles = 100;
+  // Two 4-instruction blocks, then a 6-instruction block cut by the
+  // interval boundary
+  retire_loop(collector, 0x1000, 4, 2, cycles);
+  retire_loop(collector, 0x2000, 6, 1, cycles);
+  collector.finish();
+
+  const std::vector<BasicBlockVector> &vectors = collector.get_vectors();
+  BOOST_REQUIRE_EQUAL(vectors.size(), 2u);
+  BOOST_CHECK_EQUAL(collector.get_instructions(), 14u);
+  BOOST_CHECK_EQUAL(vectors[0].instructions, 10u);
+  BOOST_CHECK_EQUAL(vectors[0].cycles, 100u);
+  BOOST_CHECK_EQUAL(vectors[0].blocks.size(), 2u);
+  BOOST_CHECK_EQUAL(vectors[0].blocks.at(0x1000), 8u);
+  BOOST_CHECK_EQUAL(vectors[0].blocks.at(0x2000), 2u);
+  // The rest of the cut block counts under its start PC
+  BOOST_CHECK_EQUAL(vectors[1].instructions, 4u);
+  BOOST_CHECK_EQUAL(vectors[1].cycles, 40u);
+  BOOST_REQUIRE_EQUAL(vectors[1].blocks.size(), 1u);
+  BOOST_CHECK_EQUAL(vectors[1].blocks.at(0x2000), 4u);
+}
+
+BOOST_AUTO_TEST_CASE(test_cluster_phases) {
+  // Three phases, each a different loop: A B A C A B
+  BbvCollector collector(100);
+  uint64_t cycles = 0;
+  const uint32_t phases[] = {0x1000, 0x2000, 0x1000, 0x3000, 0x1000, 0x2000};
+  for (uint32_t phase : phases) {
+    retire_loop(collector, phase, 5, 100, cycles);
+  }
+  collector.finish();
+  const std::vector<BasicBlockVector> &vectors = collector.get_vectors();
+  BOOST_REQUIRE_EQUAL(vectors.size(), 30u);
+
+  SimPointClustering clustering = cluster_bbvs(vectors, simpoint_config());
+  BOOST_REQUIRE_EQUAL(clustering.k, 3u);
+  BOOST_REQUIRE_EQUAL(clustering.cluster.size(), vectors.size());
+  // Same loop, same cluster: each phase is five intervals
+  const size_t first_of_loop[] = {0, 5, 0, 15, 0, 5};
+  for (size_t i = 0; i < vectors.size(); i++) {
+    BOOST_CHECK_EQUAL(clustering.cluster[i],
+                      clustering.cluster[first_of_loop[i / 5]]);
+  }
+  BOOST_CHECK_NE(clustering.cluster[0], clustering.cluster[5]);
+  BOOST_CHECK_NE(clustering.cluster[0], clustering.cluster[15]);
+  BOOST_CHECK_NE(clustering.cluster[5], clustering.cluster[15]);
+
+  double total = 0;
+  for (uint32_t c = 0; c < clustering.k; c++) {
+    size_t rep = clustering.representatives[c];
+    BOOST_CHECK_EQUAL(clustering.cluster[rep], c);
+    total += clustering.weights[c];
+  }
+  BOOST_CHECK_CLOSE(total, 1.0, 1e-9);
+  BOOST_CHECK_CLOSE(clustering.weights[clustering.cluster[0]], 0.5, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(test_retire_hook_matches_profile) {
+  if (!rtl_backdoor::available()) {
+    BOOST_TEST_MESSAGE("Retire hook needs the RTL backdoor; skipped");
+    return;
+  }
+
+  SimPointConfig config = simpoint_config();
+  const std::string path = get_test_program_path("bubble_sort");
+  std::vector<BasicBlockVector> profile = profile_bbvs(path, config);
+  BOOST_REQUIRE(!profile.empty());
+
+  TestRunner runner("bubble_sort_bbv", config.runner);
+  BOOST_REQUIRE(runner.load_program(path));
+  BbvCollector collector(config.interval, 0);
+  runner.set_retire_hook([&](uint32_t pc, uint32_t next_pc) {
+    collector.retire(pc, next_pc, runner.get_cycle_count());
+  });
+  BOOST_REQUIRE_EQUAL(runner.run(1000000), TestResult::PASS);
+  collector.finish();
+
+  // The store that writes the result ends the run before it retires
+  const std::vector<BasicBlockVector> &rtl = collector.get_vectors();
+  uint64_t profiled = 0;
+  for (const BasicBlockVector &vector : profile) {
+    profiled += vector.instructions;
+  }
+  BOOST_CHECK_EQUAL(collector.get_instructions() + 1, profiled);
+  BOOST_REQUIRE_EQUAL(rtl.size(), profile.size());
+  for (size_t i = 0; i + 1 < rtl.size(); i++) {
+    BOOST_CHECK(rtl[i].blocks == profile[i].blocks);
+    BOOST_CHECK_EQUAL(rtl[i].cycles, profile[i].cycles);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_sampled_cpi) {
+  if (!rtl_backdoor::available()) {
+    BOOST_TEST_MESSAGE("Sampled simulation needs the RTL backdoor; skipped");
+    return;
+  }
+
+  for (const std::string program : {"bubble_sort", "prime"}) {
+    SimPointConfig config = simpoint_config();
+    config.full_run = true;
+    SimPointReport report =
+        run_simpoint(get_test_program_path(program), config);
+    BOOST_REQUIRE_MESSAGE(report.ok, program << ": " << report.error);
+
+    BOOST_CHECK_GT(report.intervals, 1u);
+    BOOST_CHECK_GE(report.k, 1u);
+    BOOST_CHECK_LE(report.k, config.max_k);
+    BOOST_CHECK_EQUAL(report.samples.size(), report.k);
+    BOOST_CHECK_LT(report.simulated_instructions, report.total_instructions);
+    for (const SimPointSample &sample : report.samples) {
+      // No caches or pipeline: the RTL takes what the timing model predicts
+      BOOST_CHECK(sample.valid);
+      BOOST_CHECK_CLOSE(sample.cpi, sample.model_cpi, 1e-9);
+    }
+    BOOST_CHECK_CLOSE(report.weighted_cpi, report.model_weighted_cpi, 1e-9);
+    BOOST_REQUIRE(report.full_run);
+    BOOST_CHECK_LT(report.full_error, 0.05);
+    BOOST_CHECK_LT(report.estimated_error, 0.05);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -10,10 +10,109 @@
  *   - MAGIC_FAIL_VALUE (0x00000000) for failure
  */
 
+#include "../include/rtl_backdoor.h"
 #include "../include/test_runner.h"
 #include "../include/test_utils.h"
+#include "verilated.h"
+#include <algorithm>
 #include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#include <vector>
+#if defined(RISCV_TRACE_FST) && !defined(RISCV_SIM_FAST)
+#include "gtkwave/fstapi.h"
+#endif
+
+namespace {
+// What a TestRunner waveform holds: the full path of every traced signal
+// ("TOP.core_top.u_control.state") and the first and last dump times
+struct TraceContents {
+  bool opened = false;
+  std::vector<std::string> signals;
+  uint64_t first_time = 0;
+  uint64_t last_time = 0;
+};
+
+// Reads trace/<test_name>.fst or .vcd, whichever the build writes (the
+// fast build writes none)
+#ifdef RISCV_SIM_FAST
+TraceContents read_trace(const std::string &) { return TraceContents(); }
+#else
+std::string join_path(const std::vector<std::string> &scopes,
+                      std::string name) {
+  // Drop a bus range ("mem_addr [31:0]")
+  name.resize(std::min(name.size(), name.find(' ')));
+  std::string path;
+  for (const std::string &scope : scopes) {
+    path += scope + ".";
+  }
+  return path + name;
+}
+
+TraceContents read_trace(const std::string &test_name) {
+  TraceContents contents;
+  std::vector<std::string> scopes;
+#ifdef RISCV_TRACE_FST
+  void *fst = fstReaderOpen(("trace/" + test_name + ".fst").c_str());
+  if (!fst) {
+    return contents;
+  }
+  contents.opened = true;
+  while (struct fstHier *hier = fstReaderIterateHier(fst)) {
+    if (hier->htyp == FST_HT_SCOPE) {
+      scopes.push_back(hier->u.scope.name);
+    } else if (hier->htyp == FST_HT_UPSCOPE && !scopes.empty()) {
+      scopes.pop_back();
+    } else if (hier->htyp == FST_HT_VAR) {
+      contents.signals.push_back(join_path(scopes, hier->u.var.name));
+    }
+  }
+  contents.first_time = fstReaderGetStartTime(fst);
+  contents.last_time = fstReaderGetEndTime(fst);
+  fstReaderClose(fst);
+#else
+  std::ifstream in("trace/" + test_name + ".vcd");
+  if (!in) {
+    return contents;
+  }
+  contents.opened = true;
+  bool timed = false;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string keyword, kind, name, width, id;
+    fields >> keyword;
+    if (keyword == "$scope" && fields >> kind >> name) {
+      scopes.push_back(name);
+    } else if (keyword == "$upscope" && !scopes.empty()) {
+      scopes.pop_back();
+    } else if (keyword == "$var" && fields >> kind >> width >> id >> name) {
+      contents.signals.push_back(join_path(scopes, name));
+    } else if (keyword.size() > 1 && keyword[0] == '#') {
+      // Timestamps are the only lines starting with '#'
+      contents.last_time = std::stoull(keyword.substr(1));
+      if (!timed) {
+        contents.first_time = contents.last_time;
+        timed = true;
+      }
+    }
+  }
+#endif
+  return contents;
+}
+#endif
+
+// Number of traced signals whose path contains part
+size_t count_signals(const TraceContents &trace, const std::string &part) {
+  return std::count_if(trace.signals.begin(), trace.signals.end(),
+                       [&part](const std::string &signal) {
+                         return signal.find(part) != std::string::npos;
+                       });
+}
+} // namespace
 
 BOOST_AUTO_TEST_SUITE(SystemLevelTests)
 
@@ -284,6 +383,280 @@ BOOST_AUTO_TEST_CASE(test_timeout_detection) {
   std::cout << "Timeout detection working correctly\n";
 }
 
+BOOST_AUTO_TEST_CASE(test_long_latency_no_false_hang) {
+  // The PC stays put for the whole of every fetch at this latency
+  TestRunnerConfig config;
+  config.memory_delay = 150;
+  config.memory_debug = false;
+  TestRunner runner("add_slow_memory", config);
+
+  BOOST_REQUIRE(runner.load_program(get_test_program_path("add")));
+  TestResult result = runner.run(1000000);
+
+  BOOST_CHECK_EQUAL(result, TestResult::PASS);
+  std::cout << "ADD test with 150-cycle memory completed in "
+            << runner.get_cycle_count() << " cycles\n";
+}
+
+BOOST_AUTO_TEST_CASE(test_hang_detection_no_progress) {
+  // An all-zero word is an illegal instruction: the core stops in its
+  // error state and never touches the bus again
+  TestRunnerConfig config;
+  config.memory_debug = false;
+  config.hang_cycles = 500;
+  TestRunner runner("hang_no_progress", config);
+
+  TestResult result = runner.run(1000000);
+
+  BOOST_CHECK_EQUAL(result, TestResult::TIMEOUT);
+  BOOST_CHECK_LT(runner.get_cycle_count(), 1000);
+}
+
+BOOST_AUTO_TEST_CASE(test_hang_detection_loop) {
+  // Two jumps bouncing between 0x1000 and 0x1004 keep fetching and
+  // retiring, so only the repeated architectural state gives them away
+  TestRunnerConfig config;
+  config.memory_debug = false;
+  TestRunner runner("hang_loop", config);
+
+  runner.get_memory().backdoor_write_word(0x1000, 0x0040006F); // j 0x1004
+  runner.get_memory().backdoor_write_word(0x1004, 0xFFDFF06F); // j 0x1000
+  TestResult result = runner.run(20000); // Netlists only stop at the limit
+
+  BOOST_CHECK_EQUAL(result, TestResult::TIMEOUT);
+  if (rtl_backdoor::available()) {
+    BOOST_CHECK_LT(runner.get_cycle_count(), 1000);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_wall_clock_budget_and_heartbeat) {
+  // An endless loop with hang detection off only stops on the wall clock
+  TestRunnerConfig config;
+  config.memory_debug = false;
+  config.hang_detection = false;
+  TestRunner runner("wall_clock", config);
+  runner.get_memory().backdoor_write_word(0x1000, 0x0000006F); // j .
+
+  std::vector<RunHeartbeat> beats;
+  RunOptions options;
+  options.max_seconds = 0.5;
+  options.heartbeat_seconds = 0.1;
+  options.heartbeat = [&beats](const RunHeartbeat &beat) {
+    beats.push_back(beat);
+  };
+  TestResult result = runner.run(options);
+
+  BOOST_CHECK_EQUAL(result, TestResult::TIMEOUT);
+  BOOST_REQUIRE_GE(beats.size(), 2u);
+  for (size_t i = 1; i < beats.size(); i++) {
+    BOOST_CHECK_GT(beats[i].cycles, beats[i - 1].cycles);
+    BOOST_CHECK_GT(beats[i].elapsed_seconds, beats[i - 1].elapsed_seconds);
+  }
+  BOOST_CHECK_GT(beats.back().sim_khz, 0.0);
+  BOOST_CHECK_EQUAL(beats.back().pc, 0x1000u);
+  if (beats.back().instret_valid) {
+    BOOST_CHECK_GT(beats.back().instret, 0u);
+  }
+  BOOST_CHECK_GE(runner.get_cycle_count(), beats.back().cycles);
+}
+
+BOOST_AUTO_TEST_CASE(test_checkpoint_resume) {
+  TestRunnerConfig config;
+  config.memory_debug = false;
+  const std::string path = "checkpoint_bubble_sort.ckpt";
+
+  TestRunner full("checkpoint_full", config);
+  BOOST_REQUIRE(full.load_program(get_test_program_path("bubble_sort")));
+  BOOST_REQUIRE_EQUAL(full.run(1000000), TestResult::PASS);
+  const uint64_t total = full.get_cycle_count();
+  BOOST_REQUIRE_GT(total, 2000u);
+
+  // Checkpoints every 1000 cycles; the last one is kept
+  TestRunner first("checkpoint_first", config);
+  BOOST_REQUIRE(first.load_program(get_test_program_path("bubble_sort")));
+  RunOptions options;
+  options.max_cycles = 1000000;
+  options.checkpoint_file = path;
+  options.checkpoint_cycles = 1000;
+  BOOST_REQUIRE_EQUAL(first.run(options), TestResult::PASS);
+  BOOST_CHECK_EQUAL(first.get_cycle_count(), total);
+
+  // A fresh runner resumes from the last checkpoint and ends identically
+  TestRunner resumed("checkpoint_resumed", config);
+  BOOST_REQUIRE(resumed.restore_checkpoint(path));
+  BOOST_CHECK_EQUAL(resumed.get_cycle_count(), (total - 1) / 1000 * 1000);
+  BOOST_CHECK_EQUAL(resumed.get_memory().backdoor_read_word(0x1000),
+                    full.get_memory().backdoor_read_word(0x1000));
+  BOOST_CHECK_EQUAL(resumed.run(1000000), TestResult::PASS);
+  BOOST_CHECK_EQUAL(resumed.get_cycle_count(), total);
+  BOOST_CHECK_EQUAL(resumed.get_pc(), full.get_pc());
+  BOOST_CHECK_EQUAL(resumed.get_memory().get_read_count(),
+                    full.get_memory().get_read_count());
+  if (rtl_backdoor::available()) {
+    BOOST_CHECK_EQUAL(rtl_backdoor::hash_arch_state(resumed.get_dut()),
+                      rtl_backdoor::hash_arch_state(full.get_dut()));
+    BOOST_CHECK_EQUAL(rtl_backdoor::get_cycle_counter(resumed.get_dut()),
+                      rtl_backdoor::get_cycle_counter(full.get_dut()));
+  }
+
+  // Only a runner with the same memory delay accepts it
+  config.memory_delay = 2;
+  TestRunner mismatched("checkpoint_mismatched", config);
+  BOOST_CHECK(!mismatched.restore_checkpoint(path));
+  BOOST_CHECK(!mismatched.restore_checkpoint(path + ".missing"));
+  std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(test_trace_write_trigger_rewind) {
+  TestRunnerConfig config;
+  config.memory_debug = false;
+  const std::string program = get_test_program_path("bubble_sort");
+
+  TestRunner full("trace_untraced", config);
+  BOOST_REQUIRE(full.load_program(program));
+  uint64_t full_retired = 0;
+  full.set_retire_hook([&](uint32_t, uint32_t) { full_retired++; });
+  BOOST_REQUIRE_EQUAL(full.run(1000000), TestResult::PASS);
+
+  // The result store triggers the trace at the very end; the 1000 cycles
+  // before it are replayed from the snapshot taken at the start
+  mkdir("trace", 0755);
+  config.enable_trace = true;
+  config.trace_capture.write_trigger = true;
+  config.trace_capture.trigger_addr = MAGIC_RESULT_ADDR;
+  config.trace_capture.pre_trigger_cycles = 1000;
+  config.trace_capture.post_trigger_cycles = 100;
+  uint64_t start_time = 0;
+  uint64_t trigger = 0;
+  {
+    TestRunner traced("trace_write_trigger", config);
+    BOOST_REQUIRE(traced.load_program(program));
+    uint64_t retired = 0;
+    traced.set_retire_hook([&](uint32_t, uint32_t) { retired++; });
+    start_time = traced.get_context().time();
+    BOOST_REQUIRE_EQUAL(traced.run(1000000), TestResult::PASS);
+    // The run ends in the cycle of the result store
+    trigger = traced.get_cycle_count();
+
+    // Same run, each instruction reported once
+    BOOST_CHECK_EQUAL(traced.get_cycle_count(), full.get_cycle_count());
+    BOOST_CHECK_EQUAL(retired, full_retired);
+    BOOST_CHECK_EQUAL(traced.get_memory().get_read_count(),
+                      full.get_memory().get_read_count());
+    if (rtl_backdoor::available()) {
+      BOOST_CHECK_EQUAL(rtl_backdoor::hash_arch_state(traced.get_dut()),
+                        rtl_backdoor::hash_arch_state(full.get_dut()));
+    }
+  }
+  // Snapshots are removed with the runner
+  BOOST_CHECK(!std::ifstream("trace/trace_write_trigger.pretrigger0.ckpt"));
+
+  // Cycle c is dumped at start_time + 2c (rising edge) and + 1 (falling)
+  TraceContents trace = read_trace("trace_write_trigger");
+  if (!trace.opened) {
+    BOOST_TEST_MESSAGE("No waveform in this build; window not checked");
+    return;
+  }
+  BOOST_REQUIRE_GT(trigger, 1000u);
+  BOOST_CHECK_EQUAL(trace.first_time, start_time + 2 * (trigger - 1000));
+  BOOST_CHECK_EQUAL(trace.last_time, start_time + 2 * trigger - 1);
+
+  // A trigger early in the run shows the end of the window: the first
+  // stack store (main's prologue) with nothing traced before it
+  config.trace_capture.trigger_addr = 0x1FF00;
+  config.trace_capture.trigger_size = 0x100;
+  config.trace_capture.pre_trigger_cycles = 0;
+  uint64_t store_cycle = 0;
+  {
+    TestRunner traced("trace_write_trigger_post", config);
+    BOOST_REQUIRE(traced.load_program(program));
+    bool stored = false;
+    traced.get_memory().add_write_watch(
+        0x1FF00, 0x100, [&](uint32_t, uint32_t, uint8_t) {
+          if (!stored) {
+            store_cycle = traced.get_cycle_count();
+            stored = true;
+          }
+        });
+    start_time = traced.get_context().time();
+    BOOST_REQUIRE_EQUAL(traced.run(1000000), TestResult::PASS);
+    BOOST_REQUIRE(stored);
+    BOOST_REQUIRE_GT(traced.get_cycle_count(), store_cycle + 200);
+  }
+
+  // The runner sees the write at the end of the cycle that makes it, and
+  // writes the 100 cycles from there (two dumps each)
+  trace = read_trace("trace_write_trigger_post");
+  BOOST_REQUIRE(trace.opened);
+  BOOST_CHECK_EQUAL(trace.first_time, start_time + 2 * (store_cycle + 1));
+  BOOST_CHECK_EQUAL(trace.last_time, trace.first_time + 2 * 100 - 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_trace_scopes) {
+  TestRunnerConfig config;
+  config.memory_debug = false;
+  const std::string program = get_test_program_path("memcpy");
+
+  TestRunner full("trace_scopes_untraced", config);
+  BOOST_REQUIRE(full.load_program(program));
+  BOOST_REQUIRE_EQUAL(full.run(100000), TestResult::PASS);
+
+  // A filtered trace observes the run without changing it
+  mkdir("trace", 0755);
+  config.enable_trace = true;
+  const std::vector<std::vector<std::string>> scope_sets = {
+      {"u_control.state", "u_pc:1", "bus"},
+      {"u_pc", "u_contr"}, // Whole components only: u_contr is nothing
+      {"u_nowhere"}};
+  for (size_t i = 0; i < scope_sets.size(); i++) {
+    config.trace_scopes = scope_sets[i];
+    const std::string name = "trace_scopes" + std::to_string(i);
+    {
+      TestRunner traced(name, config);
+      BOOST_REQUIRE(traced.load_program(program));
+      BOOST_REQUIRE_EQUAL(traced.run(100000), TestResult::PASS);
+      BOOST_CHECK_EQUAL(traced.get_cycle_count(), full.get_cycle_count());
+      BOOST_CHECK_EQUAL(traced.get_pc(), full.get_pc());
+    }
+
+    // Signal names below are the RTL hierarchy; the netlists flatten it
+    TraceContents trace = read_trace(name);
+    if (!trace.opened || !rtl_backdoor::available()) {
+      BOOST_TEST_MESSAGE("No RTL waveform in this build; scopes not checked");
+      return;
+    }
+    // Only u_pc is selected of the dff_init-based registers
+    const size_t pc_bits = count_signals(trace, ".u_bit.");
+    switch (i) {
+    case 0:
+      BOOST_CHECK(std::find(trace.signals.begin(), trace.signals.end(),
+                            "TOP.core_top.u_control.state") !=
+                  trace.signals.end());
+      BOOST_CHECK_EQUAL(count_signals(trace, "TOP.core_top.u_control."), 1u);
+      BOOST_CHECK_GT(count_signals(trace, "TOP.core_top.u_pc."), 0u);
+      for (const char *port : {"mem_addr", "mem_wdata", "mem_rdata",
+                               "mem_read", "mem_write", "mem_resp"}) {
+        BOOST_CHECK_MESSAGE(
+            count_signals(trace, std::string("TOP.core_top.") + port) > 0,
+            port << " not traced");
+      }
+      // ":1" keeps u_pc's own signals, not its dff_init bit cells
+      BOOST_CHECK_EQUAL(pc_bits, 0u);
+      BOOST_CHECK_EQUAL(count_signals(trace, "TOP.core_top.u_regfile"), 0u);
+      break;
+    case 1:
+      // Without a level limit the bit cells are traced too
+      BOOST_CHECK_GE(pc_bits, 32u);
+      BOOST_CHECK_EQUAL(count_signals(trace, "TOP.core_top.u_control"), 0u);
+      BOOST_CHECK_EQUAL(count_signals(trace, "TOP.core_top.u_regfile"), 0u);
+      break;
+    default:
+      BOOST_CHECK(trace.signals.empty());
+      break;
+    }
+  }
+}
+
 BOOST_AUTO_TEST_CASE(test_fence_basic_program) {
   TestRunner runner("fence_basic", false);
 
@@ -0,0 +1,364 @@
+/*
+ * Timeline Trace Test Cases
+ *
+ * These tests check the disassembler, the slices and window of a hand-fed
+ * timeline, and then trace a test/ program with a trap on the core.
+ */
+
+#include "../include/rtl_backdoor.h"
+#include "../include/rv32i_disasm.h"
+#include "../include/test_runner.h"
+#include "../include/test_utils.h"
+#include "../include/timeline_trace.h"
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+TimelineSample make_sample(uint32_t state, uint32_t pc, uint32_t insn,
+                           uint32_t mcause = 0) {
+  TimelineSample sample;
+  sample.state = state;
+  sample.pc = pc;
+  sample.insn = insn;
+  sample.mcause = mcause;
+  return sample;
+}
+
+MemoryModel::BusTransaction make_transaction(uint32_t addr, bool write,
+                                             bool ifetch, uint32_t latency) {
+  MemoryModel::BusTransaction transaction;
+  transaction.addr = addr;
+  transaction.data = 0x12345678;
+  transaction.byte_enables = 0xF;
+  transaction.write = write;
+  transaction.ifetch = ifetch;
+  transaction.latency = latency;
+  return transaction;
+}
+
+// Walk one instruction through its states; returns the next free cycle
+uint64_t run_states(TimelineTrace &timeline, uint64_t cycle, uint32_t pc,
+                    uint32_t insn, uint32_t previous_insn,
+                    const std::vector<std::pair<uint32_t, uint64_t>> &states,
+                    uint32_t mcause = 0) {
+  for (const auto &state : states) {
+    // The IR changes in FETCH_3
+    const uint32_t ir = state.first <= FSM_FETCH_3 ? previous_insn : insn;
+    timeline.add_cycles(make_sample(state.first, pc, ir, mcause), cycle,
+                        cycle + state.second);
+    cycle += state.second;
+  }
+  return cycle;
+}
+
+const TimelineSlice *find_slice(const std::vector<TimelineSlice> &slices,
+                                const std::string &name) {
+  for (const TimelineSlice &slice : slices) {
+    if (slice.name == name) {
+      return &slice;
+    }
+  }
+  return nullptr;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(TimelineTests)
+
+BOOST_AUTO_TEST_CASE(test_disassembler) {
+  const struct {
+    uint32_t insn;
+    uint32_t pc;
+    const char *text;
+  } cases[] = {
+      {0xfc010113, 0, "addi sp,sp,-64"},
+      {0x00000013, 0, "nop"},
+      {0x00a00093, 0, "li ra,10"},
+      {0x00050793, 0, "mv a5,a0"},
+      {0x00020137, 0, "lui sp,0x20"},
+      {0x00000517, 0, "auipc a0,0x0"},
+      {0x188000ef, 0x1004, "jal ra,0x118c"},
+      {0x0000006f, 0x1008, "j 0x1008"},
+      {0x00008067, 0, "ret"},
+      {0x000780e7, 0, "jalr a5"},
+      {0xffc50067, 0, "jalr zero,-4(a0)"},
+      {0x06079e63, 0x102c, "bnez a5,0x10a8"},
+      {0xfcf760e3, 0x10a0, "bltu a4,a5,0x1060"},
+      {0x00f05463, 0x2000, "blez a5,0x2008"},
+      {0xfec42783, 0, "lw a5,-20(s0)"},
+      {0xfff54503, 0, "lbu a0,-1(a0)"},
+      {0x02812e23, 0, "sw s0,60(sp)"},
+      {0x00f51023, 0, "sh a5,0(a0)"},
+      {0x4027d793, 0, "srai a5,a5,0x2"},
+      {0x40f707b3, 0, "sub a5,a4,a5"},
+      {0x40f757b3, 0, "sra a5,a4,a5"},
+      {0x40f007b3, 0, "neg a5,a5"},
+      {0x0017b793, 0, "seqz a5,a5"},
+      {0x0ff0000f, 0, "fence"},
+      {0x0310000f, 0, "fence rw,w"},
+      {0x0000100f, 0, "fence.i"},
+      {0x00000073, 0, "ecall"},
+      {0x00100073, 0, "ebreak"},
+      {0x30200073, 0, "mret"},
+      {0x34202573, 0, "csrr a0,mcause"},
+      {0x34151073, 0, "csrw mepc,a0"},
+      {0xc0002573, 0, "rdcycle a0"},
+      {0xc8202573, 0, "rdinstreth a0"},
+      {0x305515f3, 0, "csrrw a1,mtvec,a0"},
+      {0x3422d5f3, 0, "csrrwi a1,mcause,5"},
+      {0xc0302573, 0, "csrr a0,hpmcounter3"},
+      {0xb8402573, 0, "csrr a0,mhpmcounter4h"},
+      {0x32329073, 0, "csrw mhpmevent3,t0"},
+      {0x32045073, 0, "csrwi mcountinhibit,8"},
+      {0x7c002573, 0, "csrr a0,0x7c0"},
+      {0x02b50533, 0, ".word 0x02b50533"}, // mul: not RV32I
+      {0x0000007f, 0, ".word 0x0000007f"},
+  };
+  for (const auto &c : cases) {
+    BOOST_CHECK_EQUAL(rv32i_disassemble(c.insn, c.pc), c.text);
+  }
+  BOOST_CHECK_EQUAL(rv32i_register_name(8), "s0");
+  BOOST_CHECK_EQUAL(rv32i_csr_name(0x305), "mtvec");
+  BOOST_CHECK(rv32i_csr_name(0x7C0) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(test_timeline_slices) {
+  const uint32_t ADDI = 0x00a00093; // li ra,10
+  const uint32_t ECALL = 0x00000073;
+  const uint32_t MRET = 0x30200073;
+  const std::vector<std::pair<uint32_t, uint64_t>> fetch = {
+      {FSM_FETCH_0, 1}, {FSM_FETCH_1, 5}, {FSM_FETCH_2, 1}, {FSM_FETCH_3, 1}};
+
+  TimelineTrace timeline;
+  timeline.set_name("slices");
+  std::vector<std::pair<uint32_t, uint64_t>> states = fetch;
+  states.push_back({FSM_DECODE, 1});
+  states.push_back({FSM_REG_IMM, 1});
+  states.push_back({FSM_PC_INC, 1});
+  uint64_t cycle = run_states(timeline, 0, 0x1000, ADDI, 0, states); // 11
+  timeline.add_transaction(make_transaction(0x1000, false, true, 4), 5);
+
+  // The ECALL traps; the entry sequence writes mcause
+  states = fetch;
+  states.push_back({FSM_DECODE, 1});
+  for (uint32_t s = FSM_TRAP_ENTRY_0; s <= FSM_TRAP_ENTRY_4; s++) {
+    states.push_back({s, 1});
+  }
+  cycle = run_states(timeline, cycle, 0x1004, ECALL, ADDI, states); // 25
+  states = fetch;
+  states.push_back({FSM_DECODE, 1});
+  states.push_back({FSM_MRET_0, 1});
+  cycle = run_states(timeline, cycle, 0x100, MRET, ECALL, states, 11); // 35
+  // The next instruction is still being fetched
+  timeline.add_cycles(make_sample(FSM_FETCH_0, 0x1008, MRET, 11), cycle,
+                      cycle + 1);
+  timeline.add_cycles(make_sample(FSM_FETCH_1, 0x1008, MRET, 11), cycle + 1,
+                      cycle + 3);
+  timeline.add_transaction(make_transaction(0x2000, true, false, 2), 30);
+
+  BOOST_CHECK_EQUAL(timeline.get_instructions(), 4u);
+  BOOST_CHECK_EQUAL(timeline.get_transactions(), 2u);
+  BOOST_CHECK_EQUAL(timeline.get_traps(), 1u);
+
+  std::vector<TimelineSlice> insns;
+  uint64_t state_cycles = 0;
+  for (const TimelineSlice &slice :
+       timeline.get_slices(TimelineTrace::TRACK_INSTRUCTIONS)) {
+    if (slice.category == "insn") {
+      insns.push_back(slice);
+    } else {
+      state_cycles += slice.end - slice.begin;
+    }
+  }
+  BOOST_CHECK_EQUAL(state_cycles, 38u);
+  BOOST_REQUIRE_EQUAL(insns.size(), 4u);
+  BOOST_CHECK_EQUAL(insns[0].name, "li ra,10");
+  BOOST_CHECK_EQUAL(insns[0].begin, 0u);
+  BOOST_CHECK_EQUAL(insns[0].end, 11u);
+  BOOST_CHECK_EQUAL(insns[0].args,
+                    "\"pc\": \"0x00001000\", \"insn\": \"0x00a00093\", "
+                    "\"cycles\": 11");
+  BOOST_CHECK_EQUAL(insns[1].name, "ecall");
+  BOOST_CHECK_EQUAL(insns[1].end, 25u);
+  BOOST_CHECK_EQUAL(insns[2].name, "mret");
+  BOOST_CHECK_EQUAL(insns[3].name, "fetch"); // In flight, not decoded
+  BOOST_CHECK_EQUAL(insns[3].begin, 35u);
+  BOOST_CHECK_EQUAL(insns[3].end, 38u);
+
+  std::vector<TimelineSlice> memory =
+      timeline.get_slices(TimelineTrace::TRACK_MEMORY);
+  BOOST_REQUIRE_EQUAL(memory.size(), 2u);
+  BOOST_CHECK_EQUAL(memory[0].name, "fetch 0x00001000");
+  BOOST_CHECK_EQUAL(memory[0].begin, 1u); // Same cycles as FETCH_1
+  BOOST_CHECK_EQUAL(memory[0].end, 6u);
+  BOOST_CHECK_EQUAL(memory[1].name, "write 0x00002000");
+  BOOST_CHECK_EQUAL(memory[1].args,
+                    "\"addr\": \"0x00002000\", \"data\": \"0x12345678\", "
+                    "\"be\": \"0xf\", \"latency\": 2");
+
+  // Trap slice from TRAP_ENTRY_0 to the end of MRET_0, outer first
+  std::vector<TimelineSlice> traps =
+      timeline.get_slices(TimelineTrace::TRACK_TRAPS);
+  BOOST_REQUIRE_EQUAL(traps.size(), 3u);
+  BOOST_CHECK_EQUAL(traps[0].name, "ecall");
+  BOOST_CHECK_EQUAL(traps[0].begin, 20u);
+  BOOST_CHECK_EQUAL(traps[0].end, 35u);
+  BOOST_CHECK_EQUAL(traps[0].args, "\"mepc\": \"0x00001004\", \"mcause\": 11");
+  BOOST_CHECK_EQUAL(traps[1].name, "entry");
+  BOOST_CHECK_EQUAL(traps[1].end, 25u);
+  BOOST_CHECK_EQUAL(traps[2].name, "mret");
+  BOOST_CHECK_EQUAL(traps[2].begin, 34u);
+
+  std::string json = timeline.format_json();
+  BOOST_CHECK_EQUAL(json.compare(0, 2, "{\n"), 0);
+  BOOST_CHECK_NE(json.find("\"name\": \"process_name\", \"args\": "
+                           "{\"name\": \"slices\"}"),
+                 std::string::npos);
+  BOOST_CHECK_NE(json.find("{\"ph\": \"X\", \"pid\": 1, \"tid\": 3, \"cat\": "
+                           "\"trap\", \"name\": \"ecall\", \"ts\": 20, "
+                           "\"dur\": 15"),
+                 std::string::npos);
+
+  // Only cycles [8, 21) are kept, cut to the window
+  TimelineTrace window(8, 21);
+  states = fetch;
+  states.push_back({FSM_DECODE, 1});
+  states.push_back({FSM_REG_IMM, 1});
+  states.push_back({FSM_PC_INC, 1});
+  cycle = run_states(window, 0, 0x1000, ADDI, 0, states);
+  cycle = run_states(window, cycle, 0x1004, ADDI, ADDI, states);
+  run_states(window, cycle, 0x1008, ADDI, ADDI, states);
+  window.add_transaction(make_transaction(0x1000, false, true, 4), 5);
+  std::vector<TimelineSlice> clipped =
+      window.get_slices(TimelineTrace::TRACK_INSTRUCTIONS);
+  BOOST_REQUIRE(!clipped.empty());
+  for (const TimelineSlice &slice : clipped) {
+    BOOST_CHECK_GE(slice.begin, 8u);
+    BOOST_CHECK_LE(slice.end, 21u);
+  }
+  BOOST_CHECK_EQUAL(clipped.front().name, "li ra,10");
+  BOOST_CHECK_EQUAL(clipped.front().begin, 8u);
+  BOOST_CHECK_EQUAL(clipped.back().name, "REG_IMM");
+  BOOST_CHECK_EQUAL(clipped.back().end, 21u);
+  BOOST_CHECK(window.get_slices(TimelineTrace::TRACK_MEMORY).empty());
+  BOOST_CHECK_EQUAL(window.get_instructions(), 3u);
+
+  timeline.reset();
+  BOOST_CHECK_EQUAL(timeline.get_instructions(), 0u);
+  BOOST_CHECK(timeline.get_slices(TimelineTrace::TRACK_TRAPS).empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_timeline_program) {
+  const std::string path = "/tmp/riscv_timeline_ecall_basic.trace.json";
+  TestRunnerConfig config;
+  config.memory_debug = false;
+  config.log_level = LogLevel::WARN;
+  config.timeline_file = path;
+  TestRunner runner("ecall_basic_timeline", config);
+  BOOST_REQUIRE(runner.load_program(get_test_program_path("ecall_basic")));
+  BOOST_REQUIRE_EQUAL(runner.run(100000), TestResult::PASS);
+  const TimelineTrace *timeline = runner.get_timeline();
+  BOOST_REQUIRE(timeline != nullptr);
+
+  std::ifstream file(path);
+  std::stringstream text;
+  text << file.rdbuf();
+  BOOST_CHECK_EQUAL(text.str(), timeline->format_json());
+  std::remove(path.c_str());
+
+  // Every bus transaction of the run, the last one the result
+  std::vector<TimelineSlice> memory =
+      timeline->get_slices(TimelineTrace::TRACK_MEMORY);
+  BOOST_REQUIRE(!memory.empty());
+  BOOST_CHECK_EQUAL(memory.size(), timeline->get_transactions());
+  BOOST_CHECK_EQUAL(memory.back().name, "write 0xdead0000");
+  BOOST_CHECK_LE(memory.back().end, runner.get_cycle_count());
+
+  if (!rtl_backdoor::available()) {
+    BOOST_CHECK(
+        timeline->get_slices(TimelineTrace::TRACK_INSTRUCTIONS).empty());
+    return;
+  }
+
+  // Instructions back to back over the whole run
+  std::vector<TimelineSlice> insns;
+  std::vector<TimelineSlice> fetch_waits;
+  for (const TimelineSlice &slice :
+       timeline->get_slices(TimelineTrace::TRACK_INSTRUCTIONS)) {
+    if (slice.category == "insn") {
+      insns.push_back(slice);
+    } else if (slice.name == "FETCH_1") {
+      fetch_waits.push_back(slice);
+    }
+  }
+  BOOST_REQUIRE(!insns.empty());
+  BOOST_CHECK_EQUAL(insns.front().begin, 0u);
+  BOOST_CHECK_EQUAL(insns.back().end, runner.get_cycle_count());
+  for (size_t i = 1; i < insns.size(); i++) {
+    BOOST_CHECK_EQUAL(insns[i].begin, insns[i - 1].end);
+  }
+  // Retired ones plus the store of the result, still in flight
+  BOOST_CHECK_EQUAL(insns.size(),
+                    rtl_backdoor::get_instret(runner.get_dut()) + 1);
+  BOOST_CHECK_EQUAL(insns.back().name, "sw a4,0(a5)");
+  const TimelineSlice *ecall = find_slice(insns, "ecall");
+  BOOST_REQUIRE(ecall != nullptr);
+  BOOST_CHECK_NE(ecall->args.find("\"pc\": \"0x00001098\""),
+                 std::string::npos);
+  BOOST_CHECK(find_slice(insns, "csrr a0,mcause") != nullptr);
+
+  // Each fetch occupies the bus exactly while the FSM waits in FETCH_1
+  size_t fetches = 0;
+  for (const TimelineSlice &slice : memory) {
+    if (slice.category != "fetch") {
+      continue;
+    }
+    BOOST_REQUIRE_LT(fetches, fetch_waits.size());
+    BOOST_CHECK_EQUAL(slice.begin, fetch_waits[fetches].begin);
+    BOOST_CHECK_EQUAL(slice.end, fetch_waits[fetches].end);
+    fetches++;
+  }
+  BOOST_CHECK_EQUAL(fetches, insns.size());
+
+  // One ECALL, handled and returned from
+  std::vector<TimelineSlice> traps =
+      timeline->get_slices(TimelineTrace::TRACK_TRAPS);
+  BOOST_REQUIRE_EQUAL(traps.size(), 3u);
+  BOOST_CHECK_EQUAL(traps[0].name, "ecall");
+  BOOST_CHECK_EQUAL(traps[0].args, "\"mepc\": \"0x00001098\", \"mcause\": 11");
+  BOOST_CHECK_EQUAL(traps[0].begin, ecall->end - 5); // TRAP_ENTRY_0..4
+  BOOST_CHECK_EQUAL(traps[1].name, "entry");
+  BOOST_CHECK_EQUAL(traps[1].end, ecall->end);
+  BOOST_CHECK_EQUAL(traps[2].name, "mret");
+  const TimelineSlice *mret = find_slice(insns, "mret");
+  BOOST_REQUIRE(mret != nullptr);
+  BOOST_CHECK_EQUAL(traps[0].end, mret->end);
+
+  // Windowed: only cycles [100, 200)
+  TestRunnerConfig windowed = config;
+  windowed.timeline_file = path;
+  windowed.timeline_start = 100;
+  windowed.timeline_stop = 200;
+  TestRunner window_runner("ecall_basic_timeline_window", windowed);
+  BOOST_REQUIRE(
+      window_runner.load_program(get_test_program_path("ecall_basic")));
+  BOOST_REQUIRE_EQUAL(window_runner.run(100000), TestResult::PASS);
+  std::remove(path.c_str());
+  uint64_t covered = 0;
+  for (const TimelineSlice &slice : window_runner.get_timeline()->get_slices(
+           TimelineTrace::TRACK_INSTRUCTIONS)) {
+    BOOST_CHECK_GE(slice.begin, 100u);
+    BOOST_CHECK_LE(slice.end, 200u);
+    if (slice.category == "insn") {
+      covered += slice.end - slice.begin;
+    }
+  }
+  BOOST_CHECK_EQUAL(covered, 100u);
+  BOOST_CHECK_EQUAL(window_runner.get_timeline()->get_instructions(),
+                    timeline->get_instructions());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
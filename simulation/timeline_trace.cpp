@@ -0,0 +1,308 @@
+/*
+ * Instruction Timeline Trace Implementation
+ */
+
+#include "include/timeline_trace.h"
+#include "include/fsm_timing.h"
+#include "include/rv32i_disasm.h"
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+namespace {
+
+const char *const TRACK_NAMES[] = {"", "Instructions", "Memory", "Traps"};
+
+bool is_trap_entry(uint32_t state) {
+  return state >= FSM_TRAP_ENTRY_0 && state <= FSM_TRAP_ENTRY_4;
+}
+
+std::string hex32(uint32_t value) {
+  char text[16];
+  std::snprintf(text, sizeof(text), "0x%08x", value);
+  return text;
+}
+
+// Names and categories are plain text; only the test name needs escaping
+std::string json_string(const std::string &text) {
+  std::string out = "\"";
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+    }
+    out += c;
+  }
+  return out + "\"";
+}
+
+// First cycle first; of slices starting together the longer (outer) first
+bool slice_order(const TimelineSlice &a, const TimelineSlice &b) {
+  if (a.begin != b.begin) {
+    return a.begin < b.begin;
+  }
+  return a.end > b.end;
+}
+
+} // namespace
+
+TimelineTrace::TimelineTrace(uint64_t start, uint64_t stop)
+    : start_cycle(start), stop_cycle(stop) {
+  reset();
+}
+
+void TimelineTrace::reset() {
+  slices.clear();
+  instructions = 0;
+  transactions = 0;
+  traps = 0;
+  have_state = false;
+  state = 0;
+  state_begin = 0;
+  state_end = 0;
+  have_insn = false;
+  insn_begin = 0;
+  insn_pc = 0;
+  insn_decoded = false;
+  insn_word = 0;
+  have_trap = false;
+  trap = Trap();
+  mret_begin = 0;
+}
+
+void TimelineTrace::add_cycles(const TimelineSample &sample,
+                               uint64_t from_cycle, uint64_t to_cycle) {
+  if (to_cycle <= from_cycle) {
+    return;
+  }
+  // A fast-forwarded wait arrives as more cycles of the same state
+  if (!have_state || sample.state != state || from_cycle != state_end) {
+    change_state(sample, from_cycle);
+  }
+  state_end = to_cycle;
+}
+
+void TimelineTrace::change_state(const TimelineSample &sample,
+                                 uint64_t from_cycle) {
+  if (have_state) {
+    add(slices, TRACK_INSTRUCTIONS, "state", FsmTiming::state_name(state),
+        state_begin, state_end);
+    // mcause is written by the entry sequence
+    if (is_trap_entry(state) && !is_trap_entry(sample.state) && have_trap &&
+        trap.entry_end == 0) {
+      trap.entry_end = state_end;
+      trap.mcause = sample.mcause;
+      add(slices, TRACK_TRAPS, "trap", "entry", trap.begin, trap.entry_end);
+    }
+    if (state == FSM_MRET_0) {
+      add(slices, TRACK_TRAPS, "trap", "mret", mret_begin, state_end);
+      close_trap(state_end);
+    }
+  }
+
+  // The IR still holds the finished instruction in FETCH_0
+  if (sample.state == FSM_FETCH_0 || !have_insn) {
+    if (have_insn) {
+      add(slices, TRACK_INSTRUCTIONS, "insn", insn_name(), insn_begin,
+          state_end, insn_args(state_end - insn_begin));
+    }
+    have_insn = true;
+    insn_begin = from_cycle;
+    insn_pc = sample.pc;
+    insn_decoded = false;
+    instructions++;
+  }
+  if (!insn_decoded && sample.state > FSM_FETCH_3) {
+    insn_decoded = true;
+    insn_word = sample.insn;
+  }
+
+  if (sample.state == FSM_TRAP_ENTRY_0) {
+    if (have_trap) {
+      close_trap(from_cycle);
+    }
+    have_trap = true;
+    trap = Trap();
+    trap.begin = from_cycle;
+    trap.mepc = insn_pc;
+    traps++;
+  }
+  if (sample.state == FSM_MRET_0) {
+    mret_begin = from_cycle;
+  }
+
+  have_state = true;
+  state = sample.state;
+  state_begin = from_cycle;
+  state_end = from_cycle;
+}
+
+void TimelineTrace::close_trap(uint64_t end) {
+  if (!have_trap) {
+    return;
+  }
+  add(slices, TRACK_TRAPS, "trap", trap_name(trap), trap.begin, end,
+      trap_args(trap));
+  have_trap = false;
+}
+
+void TimelineTrace::add_transaction(
+    const MemoryModel::BusTransaction &transaction, uint64_t cycle) {
+  transactions++;
+  // The request was seen latency edges before the one ending cycle
+  const uint64_t begin =
+      cycle >= transaction.latency ? cycle - transaction.latency : 0;
+  const char *kind =
+      transaction.write ? "write" : (transaction.ifetch ? "fetch" : "read");
+  char byte_enables[8];
+  std::snprintf(byte_enables, sizeof(byte_enables), "0x%x",
+                transaction.byte_enables);
+  add(slices, TRACK_MEMORY, kind,
+      std::string(kind) + " " + hex32(transaction.addr), begin, cycle + 1,
+      "\"addr\": \"" + hex32(transaction.addr) + "\", \"data\": \"" +
+          hex32(transaction.data) + "\", \"be\": \"" + byte_enables +
+          "\", \"latency\": " + std::to_string(transaction.latency));
+}
+
+bool TimelineTrace::clip(uint64_t &begin, uint64_t &end) const {
+  begin = std::max(begin, start_cycle);
+  end = std::min(end, stop_cycle);
+  return begin < end;
+}
+
+void TimelineTrace::add(std::vector<TimelineSlice> &out, uint32_t track,
+                        const char *category, const std::string &name,
+                        uint64_t begin, uint64_t end,
+                        const std::string &args) const {
+  if (!clip(begin, end)) {
+    return;
+  }
+  TimelineSlice slice;
+  slice.track = track;
+  slice.category = category;
+  slice.name = name;
+  slice.begin = begin;
+  slice.end = end;
+  slice.args = args;
+  out.push_back(slice);
+}
+
+std::vector<TimelineSlice> TimelineTrace::open_slices() const {
+  std::vector<TimelineSlice> open;
+  if (!have_state) {
+    return open;
+  }
+  add(open, TRACK_INSTRUCTIONS, "state", FsmTiming::state_name(state),
+      state_begin, state_end);
+  if (have_insn) {
+    add(open, TRACK_INSTRUCTIONS, "insn", insn_name(), insn_begin, state_end,
+        insn_args(state_end - insn_begin));
+  }
+  if (have_trap) {
+    if (trap.entry_end == 0) {
+      add(open, TRACK_TRAPS, "trap", "entry", trap.begin, state_end);
+    }
+    if (state == FSM_MRET_0) {
+      add(open, TRACK_TRAPS, "trap", "mret", mret_begin, state_end);
+    }
+    add(open, TRACK_TRAPS, "trap", trap_name(trap), trap.begin, state_end,
+        trap_args(trap));
+  } else if (state == FSM_MRET_0) {
+    add(open, TRACK_TRAPS, "trap", "mret", mret_begin, state_end);
+  }
+  return open;
+}
+
+std::string TimelineTrace::insn_name() const {
+  return insn_decoded ? rv32i_disassemble(insn_word, insn_pc) : "fetch";
+}
+
+std::string TimelineTrace::insn_args(uint64_t cycles) const {
+  std::string args = "\"pc\": \"" + hex32(insn_pc) + "\"";
+  if (insn_decoded) {
+    args += ", \"insn\": \"" + hex32(insn_word) + "\"";
+  }
+  return args + ", \"cycles\": " + std::to_string(cycles);
+}
+
+std::string TimelineTrace::trap_name(const Trap &trap) {
+  if (trap.entry_end == 0) {
+    return "trap";
+  }
+  if (trap.mcause & 0x80000000) {
+    return "interrupt " + std::to_string(trap.mcause & 0x7FFFFFFF);
+  }
+  switch (trap.mcause) {
+  case 0:
+    return "instruction address misaligned";
+  case 2:
+    return "illegal instruction";
+  case 3:
+    return "ebreak";
+  case 4:
+    return "load address misaligned";
+  case 6:
+    return "store address misaligned";
+  case 11:
+    return "ecall";
+  default:
+    return "exception " + std::to_string(trap.mcause);
+  }
+}
+
+std::string TimelineTrace::trap_args(const Trap &trap) {
+  std::string args = "\"mepc\": \"" + hex32(trap.mepc) + "\"";
+  if (trap.entry_end != 0) {
+    args += ", \"mcause\": " + std::to_string(trap.mcause);
+  }
+  return args;
+}
+
+std::vector<TimelineSlice> TimelineTrace::get_slices(Track track) const {
+  std::vector<TimelineSlice> result;
+  for (const std::vector<TimelineSlice> &source : {slices, open_slices()}) {
+    for (const TimelineSlice &slice : source) {
+      if (slice.track == track) {
+        result.push_back(slice);
+      }
+    }
+  }
+  std::stable_sort(result.begin(), result.end(), slice_order);
+  return result;
+}
+
+std::string TimelineTrace::format_json() const {
+  std::vector<TimelineSlice> all = slices;
+  std::vector<TimelineSlice> open = open_slices();
+  all.insert(all.end(), open.begin(), open.end());
+  // Viewers nest slices of a track by time; outer ones must come first
+  std::stable_sort(all.begin(), all.end(), slice_order);
+
+  std::ostringstream out;
+  out << "{\n"
+      << "  \"otherData\": {\"time_unit\": \"1us = 1 clock cycle\", "
+      << "\"start_cycle\": " << start_cycle;
+  if (stop_cycle != UINT64_MAX) {
+    out << ", \"stop_cycle\": " << stop_cycle;
+  }
+  out << "},\n"
+      << "  \"traceEvents\": [\n"
+      << "    {\"ph\": \"M\", \"pid\": 1, \"name\": \"process_name\", "
+      << "\"args\": {\"name\": " << json_string(process_name) << "}}";
+  for (uint32_t track = TRACK_INSTRUCTIONS; track <= TRACK_TRAPS; track++) {
+    out << ",\n    {\"ph\": \"M\", \"pid\": 1, \"tid\": " << track
+        << ", \"name\": \"thread_name\", \"args\": {\"name\": \""
+        << TRACK_NAMES[track] << "\"}},\n"
+        << "    {\"ph\": \"M\", \"pid\": 1, \"tid\": " << track
+        << ", \"name\": \"thread_sort_index\", \"args\": {\"sort_index\": "
+        << track << "}}";
+  }
+  for (const TimelineSlice &slice : all) {
+    out << ",\n    {\"ph\": \"X\", \"pid\": 1, \"tid\": " << slice.track
+        << ", \"cat\": \"" << slice.category << "\", \"name\": \""
+        << slice.name << "\", \"ts\": " << slice.begin
+        << ", \"dur\": " << slice.end - slice.begin << ", \"args\": {"
+        << slice.args << "}}";
+  }
+  out << "\n  ]\n}\n";
+  return out.str();
+}
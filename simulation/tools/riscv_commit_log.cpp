@@ -0,0 +1,105 @@
+/*
+ * Commit Log Reader
+ *
+ * Prints a commit log written by TestRunner (TestRunnerConfig::
+ * commit_log_file, riscv_sim --commit-log-dir) as spike --log-commits
+ * text, one line per retired instruction:
+ *
+ *   core   0: 3 0x00001000 (0x00001137) x2  0x00001000
+ *   core   0: 3 0x00001010 (0x00a12023) mem 0x00000ffc 0x0000000a
+ *
+ * so an RTL run can be diffed against Spike's log of the same program.
+ *
+ * Usage:
+ *   riscv_commit_log [--cycles] [--summary] <log>
+ *
+ *   --cycles prefixes each line with the cycle the instruction retired in.
+ *   --summary prints only the instruction, load and store counts and the
+ *   cycles between the first and last retire.
+ *
+ * Exit code is 0 if the whole log was read.
+ */
+
+#include "../include/commit_log.h"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace {
+void usage() {
+  std::cerr << "Usage: riscv_commit_log [--cycles] [--summary] <log>\n";
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  bool cycles = false;
+  bool summary = false;
+  std::string path;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--cycles") {
+      cycles = true;
+    } else if (arg == "--summary") {
+      summary = true;
+    } else if (arg == "-h" || arg == "--help") {
+      usage();
+      return 0;
+    } else if (!arg.empty() && arg[0] == '-') {
+      std::cerr << "Unknown option: " << arg << "\n";
+      usage();
+      return 1;
+    } else if (path.empty()) {
+      path = arg;
+    } else {
+      usage();
+      return 1;
+    }
+  }
+
+  if (path.empty()) {
+    usage();
+    return 1;
+  }
+
+  CommitLogReader reader;
+  if (!reader.open(path)) {
+    std::cerr << reader.get_error() << "\n";
+    return 1;
+  }
+
+  CommitRecord record;
+  uint64_t instructions = 0;
+  uint64_t loads = 0;
+  uint64_t stores = 0;
+  uint64_t first_cycle = 0;
+  uint64_t last_cycle = 0;
+  while (reader.next(record)) {
+    if (instructions == 0) {
+      first_cycle = record.cycle;
+    }
+    last_cycle = record.cycle;
+    instructions++;
+    loads += (record.flags & COMMIT_LOAD) ? 1 : 0;
+    stores += (record.flags & COMMIT_STORE) ? 1 : 0;
+    if (summary) {
+      continue;
+    }
+    if (cycles) {
+      std::cout << record.cycle << " ";
+    }
+    std::cout << format_spike(record) << "\n";
+  }
+
+  if (summary) {
+    std::cout << "instructions " << instructions << "\n"
+              << "loads " << loads << "\n"
+              << "stores " << stores << "\n"
+              << "cycles " << (last_cycle - first_cycle) << "\n";
+  }
+  if (!reader.get_error().empty()) {
+    std::cerr << path << ": " << reader.get_error() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,125 @@
+/*
+ * Standalone Instruction-Set Simulator Driver
+ *
+ * Runs one or more programs on Rv32iIss and prints a result line per
+ * program in the riscv_sim format, with instructions in place of cycles,
+ * followed by the simulation rate:
+ *
+ *   [RESULT] <name> <PASS|FAIL|TIMEOUT|ERROR> <instructions>
+ *   [ISS] <name> <MIPS> MIPS
+ *
+ * Usage:
+ *   riscv_iss [--max-instructions N] [--memory-delay D] [--cycles] [--quiet]
+ *             <program>...
+ *
+ *   <program> is either a test name under $WORKSPACE/test (e.g. "add") or a
+ *   path to a .elf/.ini file. --quiet drops the per-run INFO messages.
+ *   --cycles reports the cycles the RTL takes at memory delay D (default 4)
+ *   instead of instructions, so the output compares with riscv_sim's
+ *   (scripts/compare_cycle_counts.py).
+ *
+ * Exit code is 0 only if every program passes.
+ */
+
+#include "../include/rv32i_iss.h"
+#include "../include/test_utils.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr uint64_t DEFAULT_MAX_INSTRUCTIONS = 100000000;
+constexpr uint32_t MEMORY_SIZE = 288 * 1024 * 1024; // As TestRunnerConfig
+
+bool is_path(const std::string &program) {
+  return program.find('/') != std::string::npos ||
+         program.find('.') != std::string::npos;
+}
+
+// Program name without directory or extension
+std::string program_name(const std::string &program) {
+  size_t slash = program.find_last_of('/');
+  std::string base =
+      (slash == std::string::npos) ? program : program.substr(slash + 1);
+  size_t dot = base.find_last_of('.');
+  return (dot == std::string::npos) ? base : base.substr(0, dot);
+}
+
+void usage() {
+  std::cerr << "Usage: riscv_iss [--max-instructions N] [--memory-delay D] "
+               "[--cycles] [--quiet] <program>...\n";
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  uint64_t max_instructions = DEFAULT_MAX_INSTRUCTIONS;
+  IssConfig config;
+  bool report_cycles = false;
+  std::vector<std::string> programs;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--max-instructions" && i + 1 < argc) {
+      max_instructions = std::strtoull(argv[++i], nullptr, 0);
+    } else if (arg == "--memory-delay" && i + 1 < argc) {
+      config.memory_delay = std::strtoul(argv[++i], nullptr, 0);
+    } else if (arg == "--cycles") {
+      report_cycles = true;
+    } else if (arg == "--quiet") {
+      config.log_level = LogLevel::WARN;
+    } else if (arg == "-h" || arg == "--help") {
+      usage();
+      return 0;
+    } else if (!arg.empty() && arg[0] == '-') {
+      std::cerr << "Unknown option: " << arg << "\n";
+      usage();
+      return 1;
+    } else {
+      programs.push_back(arg);
+    }
+  }
+
+  if (programs.empty()) {
+    usage();
+    return 1;
+  }
+
+  bool all_passed = true;
+  for (const std::string &program : programs) {
+    std::string name = program_name(program);
+    std::string path =
+        is_path(program) ? program : get_test_program_path(program);
+
+    TestResult result = TestResult::ERROR;
+    uint64_t instructions = 0;
+    uint64_t cycles = 0;
+    double seconds = 0.0;
+    {
+      MemoryModel memory(MEMORY_SIZE, config.memory_delay, false);
+      Rv32iIss iss(memory, config);
+      if (iss.load_program(path)) {
+        auto start = std::chrono::steady_clock::now();
+        result = iss.run(max_instructions);
+        seconds = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+        instructions = iss.get_instret();
+        cycles = iss.get_run_cycles();
+      }
+    }
+
+    std::cout << "[RESULT] " << name << " " << result << " "
+              << (report_cycles ? cycles : instructions) << std::endl;
+    if (seconds > 0.0) {
+      std::cout << "[ISS] " << name << " " << std::fixed
+                << std::setprecision(1) << instructions / seconds / 1e6
+                << " MIPS" << std::defaultfloat << std::endl;
+    }
+    all_passed = all_passed && (result == TestResult::PASS);
+  }
+
+  return all_passed ? 0 : 1;
+}
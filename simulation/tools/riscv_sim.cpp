@@ -0,0 +1,326 @@
+/*
+ * Standalone Simulation Driver
+ *
+ * Runs one or more programs on core_top outside of Boost.Test and prints a
+ * single machine-readable result line per program:
+ *
+ *   [RESULT] <name> <PASS|FAIL|TIMEOUT|ERROR> <cycles>
+ *
+ * Built against each verilated library (riscv_sim_rtl, riscv_sim_fast, and
+ * riscv_sim_synth/riscv_sim_gls when the netlists exist) so scripts can
+ * compare builds program by program.
+ *
+ * Usage:
+ *   riscv_sim [--max-cycles N] [--max-seconds S] [--heartbeat S] [--trace]
+ *             [--cosim] [--skip-instructions N] [--checkpoint-dir DIR]
+ *             [--checkpoint-cycles N] [--checkpoint-seconds S] [--resume]
+ *             [--commit-log-dir DIR] [--fsm-profile-dir DIR]
+ *             [--pc-profile-dir DIR] [--pc-profile-interval N]
+ *             [--memory-stats-dir DIR] [--memory-stats-window N]
+ *             [--timeline-dir DIR] [--timeline-start N] [--timeline-stop N]
+ *             [--trace-start N] [--trace-stop N]
+ *             [--trace-pc ADDR] [--trace-write ADDR] [--trace-pre N]
+ *             [--trace-post N] [--trace-scope S]...
+ *             [--simpoint N [--warmup N] [--max-k K] [--full]] <program>...
+ *
+ *   <program> is either a test name under $WORKSPACE/test (e.g. "add") or a
+ *   path to a .elf/.ini file. --max-seconds bounds each program's wall-clock
+ *   time; --heartbeat logs cycles, instret, kHz and PC every S seconds.
+ *   --cosim checks every retired instruction against the ISS (RTL builds).
+ *   --skip-instructions runs the first N instructions on the ISS and hands
+ *   the state over to the RTL (RTL builds); <cycles> then only counts the
+ *   cycles simulated on the RTL.
+ *   --checkpoint-dir keeps a checkpoint of each program in DIR/<name>.ckpt,
+ *   replaced every N cycles and/or S seconds; with --resume a program whose
+ *   checkpoint exists carries on from it (e.g. rerunning a preempted job
+ *   with the same command), otherwise it starts from reset.
+ *   --commit-log-dir writes a commit log of each program's retired
+ *   instructions to DIR/<name>.commits.gz (RTL builds; read it with
+ *   riscv_commit_log).
+ *   --fsm-profile-dir logs each program's cycles per control FSM state and
+ *   instruction class and writes them to DIR/<name>.fsm.json (RTL builds).
+ *   --pc-profile-dir logs each program's cycles, instructions and CPI per
+ *   function and writes its folded call stacks to DIR/<name>.folded
+ *   (flamegraph.pl DIR/<name>.folded > <name>.svg). The PC is sampled
+ *   every cycle, or every N cycles with --pc-profile-interval (which logs
+ *   the table without writing a file unless --pc-profile-dir is given).
+ *   --memory-stats-dir logs each program's memory traffic per region (fetch
+ *   vs data, sub-word accesses, LRU hit ratio by cache size) and writes it,
+ *   with per-page counts and a heatmap in windows of N cycles
+ *   (--memory-stats-window, default 10000; implies the table), to
+ *   DIR/<name>.memory.json.
+ *   --timeline-dir writes each program's instructions (with their FSM
+ *   states), bus transactions and traps to DIR/<name>.trace.json, Chrome
+ *   trace-event JSON that ui.perfetto.dev opens; --timeline-start and
+ *   --timeline-stop keep only cycles [start, stop). The netlists only get
+ *   the bus transactions.
+ *   --trace writes trace/<name>.fst (.vcd if built without
+ *   RISCV_TRACE_FST). The other --trace-* options imply it and limit it to
+ *   cycles [start, stop), or to the cycles around the first time the PC
+ *   reaches ADDR or a store writes the word at ADDR: --trace-pre cycles
+ *   before (replayed from snapshots) and --trace-post cycles from it.
+ *   --trace-scope traces only the named scopes (repeatable; see
+ *   TestRunnerConfig::trace_scopes), e.g. --trace-scope u_control.state
+ *   --trace-scope bus.
+ *   --simpoint estimates each program's CPI from representative N-instruction
+ *   intervals instead of running it whole (RTL builds, see simpoint.h):
+ *
+ *     [SIMPOINT] <name> interval <i> start <n> weight <w> cpi <c>
+ *     [SIMPOINT] <name> cpi <c> estimated_error <e> [full_cpi <c> error <e>]
+ *
+ *   and <cycles> is the estimate for the whole program. --warmup sets the
+ *   RTL instructions run before each interval, --max-k the most intervals
+ *   simulated, --full adds a full RTL run to measure the error, and
+ *   --checkpoint-dir keeps each interval's starting point for later runs.
+ *
+ * Exit code is 0 only if every program passes.
+ */
+
+#include "../include/simpoint.h"
+#include "../include/test_runner.h"
+#include "../include/test_utils.h"
+#include <cstdlib>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr uint64_t DEFAULT_MAX_CYCLES = 1000000;
+
+bool is_path(const std::string &program) {
+  return program.find('/') != std::string::npos ||
+         program.find('.') != std::string::npos;
+}
+
+// Program name without directory or extension
+std::string program_name(const std::string &program) {
+  size_t slash = program.find_last_of('/');
+  std::string base =
+      (slash == std::string::npos) ? program : program.substr(slash + 1);
+  size_t dot = base.find_last_of('.');
+  return (dot == std::string::npos) ? base : base.substr(0, dot);
+}
+
+void usage() {
+  std::cerr << "Usage: riscv_sim [--max-cycles N] [--max-seconds S] "
+               "[--heartbeat S] [--trace] [--cosim] "
+               "[--skip-instructions N] [--checkpoint-dir DIR]\n"
+               "                 [--checkpoint-cycles N] "
+               "[--checkpoint-seconds S] [--resume] "
+               "[--commit-log-dir DIR] [--fsm-profile-dir DIR]\n"
+               "                 [--pc-profile-dir DIR] "
+               "[--pc-profile-interval N]\n"
+               "                 [--memory-stats-dir DIR] "
+               "[--memory-stats-window N]\n"
+               "                 [--timeline-dir DIR] [--timeline-start N] "
+               "[--timeline-stop N]\n"
+               "                 [--trace-start N] [--trace-stop N] "
+               "[--trace-pc ADDR] [--trace-write ADDR]\n"
+               "                 [--trace-pre N] [--trace-post N] "
+               "[--trace-scope S]...\n"
+               "                 [--simpoint N [--warmup N] [--max-k K] "
+               "[--full]] <program>...\n";
+}
+
+// Sampled estimate of one program; returns the result for its [RESULT] line
+TestResult run_sampled(const std::string &name, const std::string &path,
+                       const SimPointConfig &config, uint64_t &cycles) {
+  SimPointReport report = run_simpoint(path, config);
+  if (!report.ok) {
+    std::cerr << name << ": " << report.error << "\n";
+    return TestResult::ERROR;
+  }
+  for (const SimPointSample &sample : report.samples) {
+    std::cout << "[SIMPOINT] " << name << " interval " << sample.interval
+              << " start " << sample.start << " weight " << sample.weight
+              << " cpi " << sample.cpi << "\n";
+  }
+  std::cout << "[SIMPOINT] " << name << " cpi " << report.weighted_cpi
+            << " estimated_error " << report.estimated_error;
+  if (report.full_run) {
+    std::cout << " full_cpi " << report.full_cpi << " error "
+              << report.full_error;
+  }
+  std::cout << "\n";
+  cycles = static_cast<uint64_t>(
+      std::llround(report.weighted_cpi * report.total_instructions));
+  return TestResult::PASS;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  RunOptions options;
+  options.max_cycles = DEFAULT_MAX_CYCLES;
+  TestRunnerConfig config;
+  uint64_t skip_instructions = 0;
+  std::string checkpoint_dir;
+  bool resume = false;
+  std::string commit_log_dir;
+  std::string fsm_profile_dir;
+  std::string pc_profile_dir;
+  std::string memory_stats_dir;
+  std::string timeline_dir;
+  SimPointConfig simpoint;
+  bool sampled = false;
+  std::vector<std::string> programs;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--max-cycles" && i + 1 < argc) {
+      options.max_cycles = std::strtoull(argv[++i], nullptr, 0);
+    } else if (arg == "--max-seconds" && i + 1 < argc) {
+      options.max_seconds = std::strtod(argv[++i], nullptr);
+    } else if (arg == "--heartbeat" && i + 1 < argc) {
+      options.heartbeat_seconds = std::strtod(argv[++i], nullptr);
+    } else if (arg == "--trace") {
+      config.enable_trace = true;
+    } else if (arg == "--trace-start" && i + 1 < argc) {
+      config.enable_trace = true;
+      config.trace_capture.start_cycle = std::strtoull(argv[++i], nullptr, 0);
+    } else if (arg == "--trace-stop" && i + 1 < argc) {
+      config.enable_trace = true;
+      config.trace_capture.stop_cycle = std::strtoull(argv[++i], nullptr, 0);
+    } else if (arg == "--trace-pc" && i + 1 < argc) {
+      config.enable_trace = true;
+      config.trace_capture.pc_trigger = true;
+      config.trace_capture.trigger_pc =
+          static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 0));
+    } else if (arg == "--trace-write" && i + 1 < argc) {
+      config.enable_trace = true;
+      config.trace_capture.write_trigger = true;
+      config.trace_capture.trigger_addr =
+          static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 0));
+    } else if (arg == "--trace-pre" && i + 1 < argc) {
+      config.enable_trace = true;
+      config.trace_capture.pre_trigger_cycles =
+          std::strtoull(argv[++i], nullptr, 0);
+    } else if (arg == "--trace-post" && i + 1 < argc) {
+      config.enable_trace = true;
+      config.trace_capture.post_trigger_cycles =
+          std::strtoull(argv[++i], nullptr, 0);
+    } else if (arg == "--trace-scope" && i + 1 < argc) {
+      config.enable_trace = true;
+      config.trace_scopes.push_back(argv[++i]);
+    } else if (arg == "--cosim") {
+      config.cosim = true;
+    } else if (arg == "--skip-instructions" && i + 1 < argc) {
+      skip_instructions = std::strtoull(argv[++i], nullptr, 0);
+    } else if (arg == "--checkpoint-dir" && i + 1 < argc) {
+      checkpoint_dir = argv[++i];
+    } else if (arg == "--checkpoint-cycles" && i + 1 < argc) {
+      options.checkpoint_cycles = std::strtoull(argv[++i], nullptr, 0);
+    } else if (arg == "--checkpoint-seconds" && i + 1 < argc) {
+      options.checkpoint_seconds = std::strtod(argv[++i], nullptr);
+    } else if (arg == "--resume") {
+      resume = true;
+    } else if (arg == "--commit-log-dir" && i + 1 < argc) {
+      commit_log_dir = argv[++i];
+    } else if (arg == "--fsm-profile-dir" && i + 1 < argc) {
+      fsm_profile_dir = argv[++i];
+    } else if (arg == "--pc-profile-dir" && i + 1 < argc) {
+      pc_profile_dir = argv[++i];
+    } else if (arg == "--pc-profile-interval" && i + 1 < argc) {
+      config.pc_profile = true;
+      config.pc_profile_interval = std::strtoull(argv[++i], nullptr, 0);
+    } else if (arg == "--memory-stats-dir" && i + 1 < argc) {
+      memory_stats_dir = argv[++i];
+    } else if (arg == "--memory-stats-window" && i + 1 < argc) {
+      config.memory_stats = true;
+      config.memory_stats_window = std::strtoull(argv[++i], nullptr, 0);
+    } else if (arg == "--timeline-dir" && i + 1 < argc) {
+      timeline_dir = argv[++i];
+    } else if (arg == "--timeline-start" && i + 1 < argc) {
+      config.timeline_start = std::strtoull(argv[++i], nullptr, 0);
+    } else if (arg == "--timeline-stop" && i + 1 < argc) {
+      config.timeline_stop = std::strtoull(argv[++i], nullptr, 0);
+    } else if (arg == "--simpoint" && i + 1 < argc) {
+      simpoint.interval = std::strtoull(argv[++i], nullptr, 0);
+      sampled = true;
+    } else if (arg == "--warmup" && i + 1 < argc) {
+      simpoint.warmup = std::strtoull(argv[++i], nullptr, 0);
+    } else if (arg == "--max-k" && i + 1 < argc) {
+      simpoint.max_k =
+          static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 0));
+    } else if (arg == "--full") {
+      simpoint.full_run = true;
+    } else if (arg == "-h" || arg == "--help") {
+      usage();
+      return 0;
+    } else if (!arg.empty() && arg[0] == '-') {
+      std::cerr << "Unknown option: " << arg << "\n";
+      usage();
+      return 1;
+    } else {
+      programs.push_back(arg);
+    }
+  }
+
+  if (programs.empty()) {
+    usage();
+    return 1;
+  }
+
+  bool all_passed = true;
+  for (const std::string &program : programs) {
+    std::string name = program_name(program);
+    std::string path =
+        is_path(program) ? program : get_test_program_path(program);
+
+    RunOptions program_options = options;
+    bool restore = false;
+    if (!checkpoint_dir.empty()) {
+      program_options.checkpoint_file = checkpoint_dir + "/" + name + ".ckpt";
+      restore = resume && std::ifstream(program_options.checkpoint_file).good();
+    }
+    TestRunnerConfig program_config = config;
+    if (!commit_log_dir.empty()) {
+      program_config.commit_log_file =
+          commit_log_dir + "/" + name + ".commits.gz";
+    }
+    if (!fsm_profile_dir.empty()) {
+      program_config.fsm_profile_file =
+          fsm_profile_dir + "/" + name + ".fsm.json";
+    }
+    if (!pc_profile_dir.empty()) {
+      program_config.pc_profile_file = pc_profile_dir + "/" + name + ".folded";
+    }
+    if (!memory_stats_dir.empty()) {
+      program_config.memory_stats_file =
+          memory_stats_dir + "/" + name + ".memory.json";
+    }
+    if (!timeline_dir.empty()) {
+      program_config.timeline_file = timeline_dir + "/" + name + ".trace.json";
+    }
+
+    TestResult result = TestResult::ERROR;
+    uint64_t cycles = 0;
+    if (sampled) {
+      simpoint.runner = config;
+      simpoint.checkpoint_dir = checkpoint_dir;
+      result = run_sampled(name, path, simpoint, cycles);
+    } else {
+      TestRunner runner(name, program_config);
+      if (restore) {
+        if (runner.restore_checkpoint(program_options.checkpoint_file)) {
+          result = runner.run(program_options);
+          cycles = runner.get_cycle_count();
+        }
+      } else if (runner.load_program(path)) {
+        if (skip_instructions > 0) {
+          runner.run_functional(skip_instructions);
+          runner.get_memory().reset_statistics();
+        }
+        result = runner.run(program_options);
+        cycles = runner.get_cycle_count();
+      }
+    }
+
+    std::cout << "[RESULT] " << name << " " << result << " " << cycles
+              << std::endl;
+    all_passed = all_passed && (result == TestResult::PASS);
+  }
+
+  return all_passed ? 0 : 1;
+}